@@ -0,0 +1,584 @@
+#include "AsyncLog.h"
+#include "System/SystemClock.h"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Log {
+
+	/*
+	 * Layout of the binary log, a header followed by chunks, in host byte order:
+	 *  header:  u8[4] magic, u8 version
+	 *  SITE:    u8 type, u32 id, u8 level, u32 line, u32 maxPerSecond, u16 length, format, u16 length, file
+	 *  RECORD:  u8 type, u32 threadIndex, the record as in the thread buffers
+	 *  DROPPED: u8 type, u32 threadIndex, u64 the number of records dropped by the thread so far
+	 * A site is written before the first record referring to it
+	 */
+	constexpr static uint8_t LOG_MAGIC[4] = { 'N', 'L', 'O', 'G' };
+	constexpr static uint8_t LOG_VERSION = 1;
+
+	enum class LogChunkType : uint8_t {
+		SITE = 1, RECORD = 2, DROPPED = 3
+	};
+
+	struct LogArg {
+		LogArgType type;
+		int64_t i;
+		uint64_t u;
+		double d;
+		std::string_view s;
+	};
+
+	static spdlog::level::level_enum ToSpdlogLevel(LogLevel level) {
+		switch(level) {
+			case LogLevel::DEBUG: return spdlog::level::debug;
+			case LogLevel::INFO: return spdlog::level::info;
+			case LogLevel::WARN: return spdlog::level::warn;
+			case LogLevel::ERR: return spdlog::level::err;
+			default: return spdlog::level::critical;
+		}
+	}
+
+	/*
+	 * Reads the arguments of a record, false if they overrun the record
+	 */
+	static bool ReadArgs(const uint8_t * src, uint32_t size, uint32_t numArgs, std::vector<LogArg> & args) {
+		const uint8_t * end = src + size;
+		args.clear();
+
+		for(uint32_t i = 0; i < numArgs; i++) {
+			if(src >= end) {
+				return false;
+			}
+
+			LogArg arg{};
+			arg.type = static_cast<LogArgType>(*src++);
+
+			switch(arg.type) {
+				case LogArgType::INT:
+				case LogArgType::UINT:
+				case LogArgType::DOUBLE:
+				case LogArgType::POINTER:
+					if(end - src < 8) {
+						return false;
+					}
+					memcpy(&arg.i, src, 8);
+					memcpy(&arg.u, src, 8);
+					memcpy(&arg.d, src, 8);
+					src += 8;
+					break;
+				case LogArgType::BOOL:
+					if(end - src < 1) {
+						return false;
+					}
+					arg.u = *src++;
+					break;
+				case LogArgType::STRING: {
+					uint16_t length;
+					if(end - src < 2) {
+						return false;
+					}
+					memcpy(&length, src, 2);
+					src += 2;
+					if(end - src < length) {
+						return false;
+					}
+					arg.s = std::string_view{ reinterpret_cast<const char *>(src), length };
+					src += length;
+				} break;
+				default:
+					return false;
+			}
+
+			args.push_back(arg);
+		}
+
+		return true;
+	}
+
+	static void FormatArg(std::string & out, std::string_view spec, const LogArg & arg) {
+		const std::string argFormat = "{:" + std::string{ spec } + "}";
+
+		try {
+			switch(arg.type) {
+				case LogArgType::INT: out += fmt::vformat(argFormat, fmt::make_format_args(arg.i)); break;
+				case LogArgType::UINT: out += fmt::vformat(argFormat, fmt::make_format_args(arg.u)); break;
+				case LogArgType::DOUBLE: out += fmt::vformat(argFormat, fmt::make_format_args(arg.d)); break;
+				case LogArgType::STRING: out += fmt::vformat(argFormat, fmt::make_format_args(arg.s)); break;
+				case LogArgType::BOOL: {
+					const bool b = arg.u != 0;
+					out += fmt::vformat(argFormat, fmt::make_format_args(b));
+				} break;
+				case LogArgType::POINTER: {
+					const void * p = reinterpret_cast<const void *>(static_cast<uintptr_t>(arg.u));
+					out += fmt::vformat(argFormat, fmt::make_format_args(p));
+				} break;
+			}
+		} catch(fmt::format_error &) {
+			out += "{?}";
+		}
+	}
+
+	/*
+	 * Substitutes the {index:spec} fields of the format like spdlog would, the arguments are formatted one by one
+	 */
+	static std::string FormatRecord(std::string_view format, const std::vector<LogArg> & args) {
+		std::string out;
+		out.reserve(format.size() + 16 * args.size());
+
+		size_t nextArg = 0;
+
+		for(size_t i = 0; i < format.size(); i++) {
+			const char c = format[i];
+
+			if((c == '{' || c == '}') && i + 1 < format.size() && format[i + 1] == c) {
+				out += c;
+				i++;
+				continue;
+			}
+
+			if(c != '{') {
+				out += c;
+				continue;
+			}
+
+			const size_t close = format.find('}', i);
+
+			if(close == std::string_view::npos) {
+				out.append(format.substr(i));
+				break;
+			}
+
+			const std::string_view field = format.substr(i + 1, close - i - 1);
+			const size_t colon = field.find(':');
+			const std::string_view indexText = field.substr(0, colon);
+			const std::string_view spec = (colon == std::string_view::npos) ? std::string_view{} : field.substr(colon + 1);
+
+			size_t index = nextArg;
+
+			if(!indexText.empty()) {
+				index = 0;
+				for(char digit : indexText) {
+					index = index * 10 + static_cast<size_t>(digit - '0');
+				}
+			}
+
+			nextArg = index + 1;
+
+			if(index < args.size()) {
+				FormatArg(out, spec, args[index]);
+			} else {
+				out.append(format.substr(i, close - i + 1));
+			}
+
+			i = close;
+		}
+
+		return out;
+	}
+
+	struct LogThreadBufferHolder {
+		LogThreadBuffer * buffer = nullptr;
+
+		~LogThreadBufferHolder() {
+			if(buffer != nullptr) {
+				buffer->isOrphaned.store(true, std::memory_order_release);
+			}
+		}
+	};
+
+	static thread_local LogThreadBufferHolder threadBuffer;
+
+	/*
+	 * Owns the thread buffers, the call sites and the thread that drains them
+	 */
+	class AsyncLogBackend {
+	public:
+		std::mutex buffersMutex;
+		std::vector<std::unique_ptr<LogThreadBuffer>> buffers;
+
+		std::mutex sitesMutex;
+		std::vector<CallSite *> sites;
+
+		// one consumer at a time, either the worker or Flush
+		std::mutex drainMutex;
+		std::vector<LogThreadBuffer *> drainedBuffers;
+		std::vector<const CallSite *> knownSites;
+		std::vector<uint64_t> reportedDrops;
+		std::vector<LogArg> args;
+		std::ofstream binaryOutput;
+		uint32_t numWrittenSites;
+
+		std::mutex workerMutex;
+		std::condition_variable workerCv;
+		std::thread worker;
+		bool stopping;
+
+		AsyncLogBackend() : buffersMutex{}, buffers{}, sitesMutex{}, sites{}, drainMutex{}, drainedBuffers{}, knownSites{}, reportedDrops{},
+			args{}, binaryOutput{}, numWrittenSites{ 0 }, workerMutex{}, workerCv{}, worker{}, stopping{ false } {
+			// the registry of spdlog is created first, so it is still alive when the last records are drained on exit
+			spdlog::default_logger();
+		}
+
+		~AsyncLogBackend() {
+			{
+				std::unique_lock<std::mutex> lock{ workerMutex };
+				stopping = true;
+			}
+			workerCv.notify_one();
+
+			if(worker.joinable()) {
+				worker.join();
+			}
+
+			Drain();
+		}
+
+		void Start() {
+			std::unique_lock<std::mutex> lock{ workerMutex };
+
+			if(worker.joinable()) {
+				return;
+			}
+
+			worker = std::thread{ [this]() -> void {
+				std::unique_lock<std::mutex> workerLock{ workerMutex };
+
+				while(!stopping) {
+					workerCv.wait_for(workerLock, std::chrono::milliseconds(10));
+
+					workerLock.unlock();
+					Drain();
+					workerLock.lock();
+				}
+			} };
+		}
+
+		template<typename T>
+		void WriteBinary(const T & value) {
+			binaryOutput.write(reinterpret_cast<const char *>(&value), sizeof(T));
+		}
+
+		void WriteBinaryString(const char * str) {
+			const std::string_view view = (str != nullptr) ? std::string_view{ str } : std::string_view{};
+			const uint16_t length = static_cast<uint16_t>(std::min<size_t>(view.size(), 0xFFFF));
+			WriteBinary(length);
+			binaryOutput.write(view.data(), length);
+		}
+
+		void WriteSites() {
+			for(; numWrittenSites < knownSites.size(); numWrittenSites++) {
+				const CallSite * site = knownSites[numWrittenSites];
+
+				WriteBinary(LogChunkType::SITE);
+				WriteBinary(numWrittenSites + 1);
+				WriteBinary(site->level);
+				WriteBinary(site->line);
+				WriteBinary(site->maxPerSecond);
+				WriteBinaryString(site->format);
+				WriteBinaryString(site->file);
+			}
+		}
+
+		void Emit(uint32_t threadIndex, const uint8_t * record) {
+			uint32_t header[2];
+			memcpy(header, record, sizeof(header));
+			const uint32_t siteId = header[1];
+
+			if(siteId > knownSites.size()) {
+				std::unique_lock<std::mutex> lock{ sitesMutex };
+				knownSites.assign(std::begin(sites), std::end(sites));
+			}
+
+			const CallSite * site = knownSites[siteId - 1];
+
+			if(binaryOutput.is_open()) {
+				WriteSites();
+				WriteBinary(LogChunkType::RECORD);
+				WriteBinary(threadIndex);
+				binaryOutput.write(reinterpret_cast<const char *>(record), header[0]);
+			}
+
+			const std::shared_ptr<spdlog::logger> logger = spdlog::default_logger();
+			const spdlog::level::level_enum level = ToSpdlogLevel(site->level);
+
+			if(!logger->should_log(level)) {
+				return;
+			}
+
+			uint32_t numSuppressed;
+			memcpy(&numSuppressed, record + 16, sizeof(numSuppressed));
+
+			if(!ReadArgs(record + LOG_RECORD_HEADER_SIZE, header[0] - LOG_RECORD_HEADER_SIZE, record[20], args)) {
+				return;
+			}
+
+			std::string message = FormatRecord(site->format, args);
+
+			if(numSuppressed > 0) {
+				message += fmt::format(" [{0} similar records suppressed]", numSuppressed);
+			}
+
+			logger->log(level, "{}", message);
+		}
+
+		void Drain() {
+			std::unique_lock<std::mutex> drainLock{ drainMutex };
+
+			{
+				std::unique_lock<std::mutex> lock{ buffersMutex };
+				drainedBuffers.clear();
+				for(const std::unique_ptr<LogThreadBuffer> & buffer : buffers) {
+					drainedBuffers.push_back(buffer.get());
+				}
+			}
+
+			reportedDrops.resize(drainedBuffers.size(), 0);
+
+			for(LogThreadBuffer * buffer : drainedBuffers) {
+				buffer->Drain([this, buffer](const uint8_t * record) -> void {
+					Emit(buffer->threadIndex, record);
+				});
+
+				const uint64_t numDropped = buffer->GetNumDropped();
+
+				if(numDropped > reportedDrops[buffer->threadIndex]) {
+					spdlog::warn("{0} log records of thread #{1} were dropped, the buffer was full", numDropped - reportedDrops[buffer->threadIndex], buffer->threadIndex);
+
+					if(binaryOutput.is_open()) {
+						WriteBinary(LogChunkType::DROPPED);
+						WriteBinary(buffer->threadIndex);
+						WriteBinary(numDropped);
+					}
+
+					reportedDrops[buffer->threadIndex] = numDropped;
+				}
+			}
+
+			if(binaryOutput.is_open()) {
+				binaryOutput.flush();
+			}
+		}
+
+		bool SetBinaryOutput(const std::wstring & path) {
+			std::unique_lock<std::mutex> drainLock{ drainMutex };
+
+			if(binaryOutput.is_open()) {
+				binaryOutput.close();
+			}
+
+			if(path.empty()) {
+				return true;
+			}
+
+			binaryOutput.clear();
+			binaryOutput.open(std::filesystem::path{ path }, std::ios::binary | std::ios::trunc);
+
+			if(!binaryOutput.is_open()) {
+				return false;
+			}
+
+			binaryOutput.write(reinterpret_cast<const char *>(LOG_MAGIC), sizeof(LOG_MAGIC));
+			WriteBinary(LOG_VERSION);
+
+			// the sites are written again before their first record in the new file
+			numWrittenSites = 0;
+
+			return true;
+		}
+	};
+
+	static AsyncLogBackend & GetBackend() {
+		static AsyncLogBackend backend;
+		return backend;
+	}
+
+	std::atomic<uint8_t> AsyncLog::minLevel{ static_cast<uint8_t>(LogLevel::DEBUG) };
+
+	LogThreadBuffer::LogThreadBuffer(uint32_t index) : data{ std::make_unique<uint8_t[]>(CAPACITY) },
+		writeIndex{ 0 }, readIndex{ 0 }, numDropped{ 0 }, threadIndex{ index }, isOrphaned{ false } {
+
+	}
+
+	LogThreadBuffer * AsyncLog::GetThreadBuffer() {
+		if(threadBuffer.buffer != nullptr) {
+			return threadBuffer.buffer;
+		}
+
+		AsyncLogBackend & backend = GetBackend();
+		std::unique_lock<std::mutex> lock{ backend.buffersMutex };
+
+		// short lived threads reuse the buffers of the exited ones once those are drained
+		for(const std::unique_ptr<LogThreadBuffer> & buffer : backend.buffers) {
+			if(buffer->isOrphaned.load(std::memory_order_acquire) && buffer->IsEmpty()) {
+				buffer->isOrphaned.store(false, std::memory_order_relaxed);
+				threadBuffer.buffer = buffer.get();
+				return threadBuffer.buffer;
+			}
+		}
+
+		backend.buffers.emplace_back(std::make_unique<LogThreadBuffer>(static_cast<uint32_t>(backend.buffers.size())));
+		threadBuffer.buffer = backend.buffers.back().get();
+		return threadBuffer.buffer;
+	}
+
+	void AsyncLog::Register(CallSite & site, const char * format) {
+		AsyncLogBackend & backend = GetBackend();
+		std::unique_lock<std::mutex> lock{ backend.sitesMutex };
+
+		if(site.id.load(std::memory_order_relaxed) != 0) {
+			return;
+		}
+
+		site.format = format;
+		backend.sites.push_back(&site);
+		site.id.store(static_cast<uint32_t>(backend.sites.size()), std::memory_order_release);
+	}
+
+	int64_t AsyncLog::Now() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(Netcode::SystemClock::LocalNow().time_since_epoch()).count();
+	}
+
+	void AsyncLog::Start() {
+		GetBackend().Start();
+	}
+
+	bool AsyncLog::SetBinaryOutput(const std::wstring & path) {
+		return GetBackend().SetBinaryOutput(path);
+	}
+
+	void AsyncLog::Flush() {
+		GetBackend().Drain();
+	}
+
+	bool DecodeBinaryLog(Netcode::ArrayView<uint8_t> data, const std::function<void(const DecodedLogRecord &)> & f) {
+		const uint8_t * src = data.Data();
+		const uint8_t * end = src + data.Size();
+
+		if(data.Size() < sizeof(LOG_MAGIC) + 1 || memcmp(src, LOG_MAGIC, sizeof(LOG_MAGIC)) != 0 || src[sizeof(LOG_MAGIC)] != LOG_VERSION) {
+			return false;
+		}
+
+		src += sizeof(LOG_MAGIC) + 1;
+
+		struct Site {
+			LogLevel level;
+			uint32_t line;
+			std::string format;
+			std::string file;
+		};
+
+		std::vector<Site> sites;
+		std::vector<LogArg> args;
+		int64_t lastTimestamp = 0;
+
+		const auto read = [&src, end](void * dst, size_t size) -> bool {
+			if(static_cast<size_t>(end - src) < size) {
+				return false;
+			}
+			memcpy(dst, src, size);
+			src += size;
+			return true;
+		};
+
+		const auto readString = [&](std::string & str) -> bool {
+			uint16_t length;
+			if(!read(&length, sizeof(length)) || static_cast<size_t>(end - src) < length) {
+				return false;
+			}
+			str.assign(reinterpret_cast<const char *>(src), length);
+			src += length;
+			return true;
+		};
+
+		while(src < end) {
+			LogChunkType type;
+			uint32_t index;
+
+			if(!read(&type, sizeof(type)) || !read(&index, sizeof(index))) {
+				break;
+			}
+
+			if(type == LogChunkType::SITE) {
+				Site site;
+				uint32_t maxPerSecond;
+
+				if(!read(&site.level, sizeof(site.level)) || !read(&site.line, sizeof(site.line)) || !read(&maxPerSecond, sizeof(maxPerSecond)) ||
+					!readString(site.format) || !readString(site.file)) {
+					break;
+				}
+
+				if(index == 0) {
+					break;
+				}
+
+				if(sites.size() < index) {
+					sites.resize(index);
+				}
+
+				sites[index - 1] = std::move(site);
+			} else if(type == LogChunkType::RECORD) {
+				uint32_t header[2];
+
+				if(static_cast<size_t>(end - src) < LOG_RECORD_HEADER_SIZE) {
+					break;
+				}
+
+				memcpy(header, src, sizeof(header));
+
+				if(header[0] < LOG_RECORD_HEADER_SIZE || static_cast<size_t>(end - src) < header[0]) {
+					break;
+				}
+
+				if(header[1] == 0 || header[1] > sites.size() ||
+					!ReadArgs(src + LOG_RECORD_HEADER_SIZE, header[0] - LOG_RECORD_HEADER_SIZE, src[20], args)) {
+					return false;
+				}
+
+				const Site & site = sites[header[1] - 1];
+
+				DecodedLogRecord record;
+				record.threadIndex = index;
+				record.level = site.level;
+				memcpy(&record.timestamp, src + 8, sizeof(record.timestamp));
+				memcpy(&record.numSuppressed, src + 16, sizeof(record.numSuppressed));
+				record.file = site.file.c_str();
+				record.line = site.line;
+				record.message = FormatRecord(site.format, args);
+
+				src += header[0];
+				lastTimestamp = record.timestamp;
+
+				f(record);
+			} else if(type == LogChunkType::DROPPED) {
+				uint64_t numDropped;
+
+				if(!read(&numDropped, sizeof(numDropped))) {
+					break;
+				}
+
+				DecodedLogRecord record;
+				record.threadIndex = index;
+				record.level = LogLevel::WARN;
+				record.timestamp = lastTimestamp;
+				record.numSuppressed = 0;
+				record.file = nullptr;
+				record.line = 0;
+				record.message = fmt::format("{0} log records of thread #{1} were dropped so far, the buffer was full", numDropped, index);
+
+				f(record);
+			} else {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+}
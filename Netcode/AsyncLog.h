@@ -0,0 +1,339 @@
+#pragma once
+
+#include <NetcodeFoundation/ArrayView.hpp>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace Log {
+
+	enum class LogLevel : uint8_t {
+		DEBUG = 0, INFO = 1, WARN = 2, ERR = 3, CRITICAL = 4
+	};
+
+	/**
+	 * A log statement, declared as a static by the NETCODE_LOG macros. The format string and the id
+	 * are registered on the first record, the records only carry the id.
+	 */
+	struct CallSite {
+		const char * format;
+		const char * file;
+		uint32_t line;
+		LogLevel level;
+		// 0: unlimited
+		uint32_t maxPerSecond;
+		std::atomic<uint32_t> id;
+		// the second of the rate limit window in the upper 32 bits, the records of the window in the lower ones
+		std::atomic<uint64_t> window;
+		std::atomic<uint32_t> numSuppressed;
+
+		constexpr CallSite(LogLevel level, uint32_t maxPerSecond, const char * file, uint32_t line) :
+			format{ nullptr }, file{ file }, line{ line }, level{ level }, maxPerSecond{ maxPerSecond },
+			id{ 0 }, window{ 0 }, numSuppressed{ 0 } { }
+	};
+
+	enum class LogArgType : uint8_t {
+		INT = 1, UINT = 2, DOUBLE = 3, BOOL = 4, STRING = 5, POINTER = 6
+	};
+
+	/*
+	 * Layout of a record, in the thread buffers and in the binary log alike. Host byte order, records are padded to 8 bytes:
+	 *  u32 size, u32 callSiteId, i64 timestamp, u32 numSuppressed, u8 numArgs, u8[3] padding
+	 *  args: { u8 type, INT/UINT/POINTER: u64, DOUBLE: f64, BOOL: u8, STRING: u16 length, u8[length] }
+	 */
+	constexpr uint32_t LOG_RECORD_HEADER_SIZE = 24;
+	constexpr uint32_t LOG_MAX_STRING_ARG = 256;
+
+	/**
+	 * Single producer single consumer byte ring of the records of a thread. A full buffer drops the record and counts it.
+	 */
+	class LogThreadBuffer {
+		constexpr static uint32_t CAPACITY = 1 << 18;
+		constexpr static uint32_t MASK = CAPACITY - 1;
+
+		std::unique_ptr<uint8_t[]> data;
+		std::atomic<uint64_t> writeIndex;
+		std::atomic<uint64_t> readIndex;
+		std::atomic<uint64_t> numDropped;
+
+	public:
+		uint32_t threadIndex;
+		// set when the owner thread exits, a drained buffer is handed to the next new thread
+		std::atomic<bool> isOrphaned;
+
+		LogThreadBuffer(uint32_t index);
+
+		/**
+		 * Owner only, size is a multiple of 8, write(uint8_t *) fills the reserved bytes
+		 * @return false if the record was dropped
+		 */
+		template<typename F>
+		bool Write(uint32_t size, F write) {
+			const uint64_t w = writeIndex.load(std::memory_order_relaxed);
+			const uint32_t pos = static_cast<uint32_t>(w & MASK);
+			const uint32_t contiguous = CAPACITY - pos;
+			const uint32_t required = (contiguous < size) ? (contiguous + size) : size;
+
+			if(w + required - readIndex.load(std::memory_order_acquire) > CAPACITY) {
+				numDropped.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+
+			uint64_t recordAt = w;
+
+			// the record does not fit the end of the ring, a padding record with the id 0 skips it
+			if(contiguous < size) {
+				const uint32_t padding[2] = { contiguous, 0 };
+				memcpy(data.get() + pos, padding, sizeof(padding));
+				recordAt += contiguous;
+			}
+
+			write(data.get() + (recordAt & MASK));
+			writeIndex.store(recordAt + size, std::memory_order_release);
+			return true;
+		}
+
+		/**
+		 * Consumer only, calls f(const uint8_t * record) with every record written so far
+		 */
+		template<typename F>
+		void Drain(F f) {
+			const uint64_t w = writeIndex.load(std::memory_order_acquire);
+			uint64_t r = readIndex.load(std::memory_order_relaxed);
+
+			while(r < w) {
+				const uint8_t * record = data.get() + (r & MASK);
+				uint32_t header[2];
+				memcpy(header, record, sizeof(header));
+
+				if(header[1] != 0) {
+					f(record);
+				}
+
+				r += header[0];
+			}
+
+			readIndex.store(r, std::memory_order_release);
+		}
+
+		bool IsEmpty() const {
+			return readIndex.load(std::memory_order_acquire) == writeIndex.load(std::memory_order_acquire);
+		}
+
+		uint64_t GetNumDropped() const {
+			return numDropped.load(std::memory_order_relaxed);
+		}
+	};
+
+	namespace Detail {
+
+		template<typename T>
+		constexpr bool IsStringArg = std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view> ||
+			std::is_same_v<std::decay_t<T>, const char *> || std::is_same_v<std::decay_t<T>, char *>;
+
+		template<typename T>
+		uint32_t ArgSize(const T & value) {
+			if constexpr(IsStringArg<T>) {
+				const size_t length = std::string_view{ value }.size();
+				return 3 + static_cast<uint32_t>((length < LOG_MAX_STRING_ARG) ? length : LOG_MAX_STRING_ARG);
+			} else if constexpr(std::is_same_v<T, bool>) {
+				return 2;
+			} else {
+				static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T> || std::is_pointer_v<T>,
+					"Only numbers, enums, strings and pointers are recorded, convert the argument before logging it");
+				return 9;
+			}
+		}
+
+		template<typename T>
+		uint8_t * WriteArg(uint8_t * dst, const T & value) {
+			const auto put = [&dst](LogArgType type, const void * src, uint32_t size) -> void {
+				*dst++ = static_cast<uint8_t>(type);
+				memcpy(dst, src, size);
+				dst += size;
+			};
+
+			if constexpr(IsStringArg<T>) {
+				const std::string_view str{ value };
+				const uint16_t length = static_cast<uint16_t>((str.size() < LOG_MAX_STRING_ARG) ? str.size() : LOG_MAX_STRING_ARG);
+				put(LogArgType::STRING, &length, sizeof(length));
+				memcpy(dst, str.data(), length);
+				dst += length;
+			} else if constexpr(std::is_same_v<T, bool>) {
+				const uint8_t b = value ? 1 : 0;
+				put(LogArgType::BOOL, &b, 1);
+			} else if constexpr(std::is_floating_point_v<T>) {
+				const double d = static_cast<double>(value);
+				put(LogArgType::DOUBLE, &d, sizeof(d));
+			} else if constexpr(std::is_pointer_v<T>) {
+				const uint64_t p = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(value));
+				put(LogArgType::POINTER, &p, sizeof(p));
+			} else if constexpr(std::is_enum_v<T>) {
+				const int64_t i = static_cast<int64_t>(value);
+				put(LogArgType::INT, &i, sizeof(i));
+			} else if constexpr(std::is_signed_v<T>) {
+				const int64_t i = static_cast<int64_t>(value);
+				put(LogArgType::INT, &i, sizeof(i));
+			} else {
+				const uint64_t u = static_cast<uint64_t>(value);
+				put(LogArgType::UINT, &u, sizeof(u));
+			}
+
+			return dst;
+		}
+
+	}
+
+	/**
+	 * Logging backend of the hot paths. A record costs a rate check, a timestamp and a copy of the raw
+	 * arguments into the ring of the calling thread. A background thread formats the records into the
+	 * spdlog sinks and optionally appends them to a binary log, DecodeBinaryLog reads it back offline.
+	 */
+	class AsyncLog {
+		static std::atomic<uint8_t> minLevel;
+
+		static LogThreadBuffer * GetThreadBuffer();
+
+		static void Register(CallSite & site, const char * format);
+
+		static int64_t Now();
+
+	public:
+		static bool IsEnabled(LogLevel level) {
+			return static_cast<uint8_t>(level) >= minLevel.load(std::memory_order_relaxed);
+		}
+
+		static void SetLevel(LogLevel level) {
+			minLevel.store(static_cast<uint8_t>(level), std::memory_order_relaxed);
+		}
+
+		/**
+		 * Rate limit of the site, now is in nanoseconds. The windows are the whole seconds of the clock, a window and its
+		 * count are replaced in one atomic step. The first record of a window takes the count of the suppressed records,
+		 * the ones suppressed by a thread that raced the start of the window are reported with the window after.
+		 * @return false if the record is suppressed
+		 */
+		static bool Admit(CallSite & site, int64_t now, uint32_t & numSuppressed) {
+			numSuppressed = 0;
+
+			if(site.maxPerSecond == 0) {
+				return true;
+			}
+
+			const uint64_t second = static_cast<uint64_t>(now / 1000000000);
+			uint64_t window = site.window.load(std::memory_order_relaxed);
+			uint64_t next;
+
+			do {
+				// a thread that read the clock before the window started counts into the started one
+				if(second > (window >> 32)) {
+					next = (second << 32) | 1;
+				} else {
+					const uint64_t count = window & 0xFFFFFFFFull;
+					next = (count < 0xFFFFFFFFull) ? (window + 1) : window;
+				}
+			} while(!site.window.compare_exchange_weak(window, next, std::memory_order_relaxed));
+
+			if((next & 0xFFFFFFFFull) > site.maxPerSecond) {
+				site.numSuppressed.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+
+			if((next & 0xFFFFFFFFull) == 1) {
+				numSuppressed = site.numSuppressed.exchange(0, std::memory_order_relaxed);
+			}
+
+			return true;
+		}
+
+		template<typename ... T>
+		static void Write(CallSite & site, const char * format, const T & ... args) {
+			if(site.id.load(std::memory_order_acquire) == 0) {
+				Register(site, format);
+			}
+
+			const int64_t timestamp = Now();
+			uint32_t numSuppressed;
+
+			if(!Admit(site, timestamp, numSuppressed)) {
+				return;
+			}
+
+			const uint32_t argsSize = (0 + ... + Detail::ArgSize(args));
+			const uint32_t size = (LOG_RECORD_HEADER_SIZE + argsSize + 7) & ~7u;
+
+			const bool isWritten = GetThreadBuffer()->Write(size, [&](uint8_t * dst) -> void {
+				const uint32_t ids[2] = { size, site.id.load(std::memory_order_relaxed) };
+				const uint8_t numArgs = static_cast<uint8_t>(sizeof...(T));
+
+				memcpy(dst, ids, sizeof(ids));
+				memcpy(dst + 8, &timestamp, sizeof(timestamp));
+				memcpy(dst + 16, &numSuppressed, sizeof(numSuppressed));
+				memcpy(dst + 20, &numArgs, sizeof(numArgs));
+
+				[[maybe_unused]] uint8_t * argDst = dst + LOG_RECORD_HEADER_SIZE;
+				((argDst = Detail::WriteArg(argDst, args)), ...);
+			});
+
+			// the dropped record is counted by the buffer, the records it reported are handed to the next one
+			if(!isWritten && numSuppressed > 0) {
+				site.numSuppressed.fetch_add(numSuppressed, std::memory_order_relaxed);
+			}
+		}
+
+		/**
+		 * Starts the background thread, records written before are kept until the buffers fill up
+		 */
+		static void Start();
+
+		/**
+		 * Appends every record to the file from now on, an empty path closes it
+		 * @return false if the file could not be opened
+		 */
+		static bool SetBinaryOutput(const std::wstring & path);
+
+		/**
+		 * Formats and writes the records of every thread before returning
+		 */
+		static void Flush();
+	};
+
+	struct DecodedLogRecord {
+		uint32_t threadIndex;
+		LogLevel level;
+		// nanoseconds, the clock of SystemClock::LocalNow
+		int64_t timestamp;
+		uint32_t numSuppressed;
+		const char * file;
+		uint32_t line;
+		std::string message;
+	};
+
+	/**
+	 * Reads a binary log, calls f(const DecodedLogRecord &) for every record in the order they were drained. Dropped records
+	 * are reported as a WARN record without a file. A log cut short by a crash is read up to its last whole record.
+	 * @return false if the data is not a binary log
+	 */
+	bool DecodeBinaryLog(Netcode::ArrayView<uint8_t> data, const std::function<void(const DecodedLogRecord &)> & f);
+
+}
+
+#define NETCODE_LOG_IMPL(level, maxPerSecond, ...) do { \
+	if(::Log::AsyncLog::IsEnabled(level)) { \
+		static ::Log::CallSite netcodeLogCallSite{ level, maxPerSecond, __FILE__, __LINE__ }; \
+		::Log::AsyncLog::Write(netcodeLogCallSite, __VA_ARGS__); \
+	} } while(false)
+
+/*
+ * NETCODE_LOG_DEBUG(maxPerSecond, format, args...), the format string must be a literal,
+ * maxPerSecond limits the records of the call site, 0 is unlimited
+ */
+#define NETCODE_LOG_DEBUG(maxPerSecond, ...) NETCODE_LOG_IMPL(::Log::LogLevel::DEBUG, maxPerSecond, __VA_ARGS__)
+#define NETCODE_LOG_INFO(maxPerSecond, ...) NETCODE_LOG_IMPL(::Log::LogLevel::INFO, maxPerSecond, __VA_ARGS__)
+#define NETCODE_LOG_WARN(maxPerSecond, ...) NETCODE_LOG_IMPL(::Log::LogLevel::WARN, maxPerSecond, __VA_ARGS__)
+#define NETCODE_LOG_ERROR(maxPerSecond, ...) NETCODE_LOG_IMPL(::Log::LogLevel::ERR, maxPerSecond, __VA_ARGS__)
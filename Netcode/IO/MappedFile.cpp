@@ -0,0 +1,136 @@
+#include <NetcodeFoundation/Platform.h>
+#include <NetcodeFoundation/Exception/IOException.h>
+
+#include "MappedFile.h"
+#include "Path.h"
+#include "../Logger.h"
+#include "../Utility.h"
+
+#if defined(NETCODE_OS_WINDOWS)
+#include <Windows.h>
+#endif
+
+namespace Netcode::IO {
+
+	struct MappedFile::detail {
+	private:
+		std::wstring path;
+		HANDLE handle;
+		HANDLE mapping;
+		const uint8_t * view;
+		size_t size;
+
+	public:
+		detail(std::wstring wstr) : path{ std::move(wstr) }, handle{ INVALID_HANDLE_VALUE }, mapping{ nullptr }, view{ nullptr }, size{ 0 } {
+			Path::FixFilePath(path);
+
+			if(Path::IsRelative(path)) {
+				path.insert(0, Path::WorkingDirectory());
+			}
+		}
+
+		~detail() noexcept {
+			Close();
+		}
+
+		void Open() {
+			Close();
+
+			HANDLE f = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+			if(f == INVALID_HANDLE_VALUE) {
+				throw IOException{ "Failed to open file", Utility::ToNarrowString(path) };
+			}
+
+			handle = f;
+
+			LARGE_INTEGER fileSize;
+
+			if(!GetFileSizeEx(handle, &fileSize)) {
+				Close();
+				throw IOException{ "Failed to query the file size", Utility::ToNarrowString(path) };
+			}
+
+			// an empty file can not be mapped, its view is empty
+			if(fileSize.QuadPart == 0) {
+				return;
+			}
+
+			mapping = CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+			if(mapping == nullptr) {
+				Close();
+				throw IOException{ "Failed to map file", Utility::ToNarrowString(path) };
+			}
+
+			view = static_cast<const uint8_t *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+
+			if(view == nullptr) {
+				Close();
+				throw IOException{ "Failed to map file", Utility::ToNarrowString(path) };
+			}
+
+			size = static_cast<size_t>(fileSize.QuadPart);
+		}
+
+		void Close() noexcept {
+			if(view != nullptr) {
+				UnmapViewOfFile(view);
+				view = nullptr;
+				size = 0;
+			}
+
+			if(mapping != nullptr) {
+				CloseHandle(mapping);
+				mapping = nullptr;
+			}
+
+			if(handle != INVALID_HANDLE_VALUE) {
+				if(!CloseHandle(handle)) {
+					Log::Error("Failed to close file: {0}", Utility::ToNarrowString(path));
+				}
+
+				handle = INVALID_HANDLE_VALUE;
+			}
+		}
+
+		ArrayView<uint8_t> GetView() const {
+			return ArrayView<uint8_t>{ view, size };
+		}
+
+		const std::wstring & GetFullPath() const noexcept {
+			return path;
+		}
+	};
+
+	MappedFile::MappedFile(std::wstring fullPath) : impl{ nullptr }
+	{
+		impl.reset(new detail{ std::move(fullPath) });
+	}
+
+	MappedFile::~MappedFile()
+	{
+		impl.reset();
+	}
+
+	void MappedFile::Open()
+	{
+		impl->Open();
+	}
+
+	void MappedFile::Close()
+	{
+		impl->Close();
+	}
+
+	ArrayView<uint8_t> MappedFile::GetView() const
+	{
+		return impl->GetView();
+	}
+
+	const std::wstring & MappedFile::GetFullPath() const noexcept
+	{
+		return impl->GetFullPath();
+	}
+
+}
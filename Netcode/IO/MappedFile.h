@@ -0,0 +1,41 @@
+#pragma once
+
+#include <NetcodeFoundation/ArrayView.hpp>
+
+#include <memory>
+#include <string>
+
+namespace Netcode::IO {
+
+	/**
+	 * Read only view of a whole file, mapped into memory instead of being read into a buffer
+	 */
+	class MappedFile {
+		struct detail;
+		std::unique_ptr<detail> impl;
+
+	public:
+		MappedFile(std::wstring fullPath);
+		MappedFile & operator=(MappedFile &&) noexcept = default;
+		MappedFile(MappedFile &&) noexcept = default;
+		~MappedFile();
+
+		MappedFile(const MappedFile &) = delete;
+		MappedFile & operator=(const MappedFile &) = delete;
+
+		/**
+		 * Maps the file, throws an IOException if it can not be opened
+		 */
+		void Open();
+
+		void Close();
+
+		/**
+		 * Empty until the file is opened, valid until it is closed
+		 */
+		ArrayView<uint8_t> GetView() const;
+
+		const std::wstring & GetFullPath() const noexcept;
+	};
+
+}
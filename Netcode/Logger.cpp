@@ -1,4 +1,5 @@
 #include "Logger.h"
+#include "AsyncLog.h"
 
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
@@ -13,7 +14,7 @@ namespace Log {
 
 	void Setup(bool isVerbose) {
 #if defined(NETCODE_EDITOR_VARIANT)
-		auto console = std::make_shared<spdlog::logger>("msvc", std::make_shared<spdlog::sinks::msvc_sink_st>());
+		auto console = std::make_shared<spdlog::logger>("msvc", std::make_shared<spdlog::sinks::msvc_sink_mt>());
 #else
 		auto console = spdlog::stdout_color_mt("console");
 #endif
@@ -33,6 +34,9 @@ namespace Log {
 		*/
 		//spdlog::set_pattern("[%T][%P][%t][%l] %v");
 		spdlog::set_default_logger(console);
+
+		AsyncLog::SetLevel(isVerbose ? LogLevel::DEBUG : LogLevel::INFO);
+		AsyncLog::Start();
 	}
 
 	template<typename ... T>
@@ -97,17 +101,29 @@ namespace Log {
 	template void Info<const char *>(const char * message, const char * const & value);
 	template void Info<int32_t>(const char * message, const int32_t & value);
 	template void Info<uint16_t>(const char * message, const uint16_t & value);
+	template void Info<uint32_t>(const char * message, const uint32_t & value);
 	template void Info<int32_t, int32_t>(const char * message, const int32_t & value, const int32_t & value2);
 	template void Info<uint16_t, uint16_t>(const char * message, const uint16_t & value, const uint16_t & value2);
 	template void Info<int32_t, int32_t, int32_t>(const char * message, const int32_t & x, const int32_t & y, const int32_t & z);
 	template void Info<uint64_t>(const char * message, const uint64_t & value);
+	template void Info<uint32_t, uint32_t>(const char * message, const uint32_t & value, const uint32_t & value2);
+	template void Info<uint64_t, uint64_t>(const char * message, const uint64_t & value, const uint64_t & value2);
+	template void Info<uint64_t, double, double, double, double>(const char * message, const uint64_t & value, const double & value2,
+		const double & value3, const double & value4, const double & value5);
+	template void Info<uint32_t, uint32_t, uint32_t, double, double, double>(const char * message, const uint32_t & value, const uint32_t & value2,
+		const uint32_t & value3, const double & value4, const double & value5, const double & value6);
+	template void Info<uint32_t, uint32_t, double, double, double, double, double, double, double>(const char * message, const uint32_t & value, const uint32_t & value2,
+		const double & value3, const double & value4, const double & value5, const double & value6, const double & value7, const double & value8, const double & value9);
 
 
 	template void Warn<>(const char * message);
+	template void Warn<const char *>(const char * message, const char * const & value);
 
 	template void Error<>(const char * message);
 	template void Error<std::string>(const char * message, const std::string & value);
 	template void Error<const char *>(const char * message, const char * const & value);
+	template void Error<int32_t>(const char * message, const int32_t & value);
+	template void Error<uint32_t, uint32_t>(const char * message, const uint32_t & value, const uint32_t & value2);
 
 	template void Critical<>(const char * message);
 
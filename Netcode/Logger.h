@@ -4,6 +4,10 @@
 
 namespace Log {
 
+	/*
+	 * Also starts the AsyncLog backend. The functions below format on the calling thread,
+	 * the hot paths use the NETCODE_LOG macros of AsyncLog.h instead
+	 */
 	void Setup(bool isVerbose);
 
 	template<typename ... T>
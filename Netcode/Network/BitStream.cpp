@@ -0,0 +1,120 @@
+#include "BitStream.h"
+
+namespace Netcode::Network {
+
+	constexpr static uint32_t MAX_VARINT_GROUPS = 5;
+
+	static uint32_t LowBits(uint32_t value, uint32_t numBits) {
+		return (numBits >= 32) ? value : (value & ((1u << numBits) - 1u));
+	}
+
+	BitWriter::BitWriter(MutableArrayView<uint8_t> buffer) :
+		data{ buffer.Data() }, sizeInBits{ buffer.Size() * 8 }, bitIndex{ 0 }, scratch{ 0 }, scratchBits{ 0 }, overflowed{ false } {
+
+	}
+
+	void BitWriter::Write(uint32_t value, uint32_t numBits) {
+		if(numBits == 0 || overflowed) {
+			return;
+		}
+
+		if(numBits > 32 || (bitIndex + numBits) > sizeInBits) {
+			overflowed = true;
+			return;
+		}
+
+		// the scratch never holds more than 7 pending bits between calls, so 39 bits at most
+		scratch = (scratch << numBits) | LowBits(value, numBits);
+		scratchBits += numBits;
+
+		size_t byteIndex = bitIndex / 8;
+		bitIndex += numBits;
+
+		while(scratchBits >= 8) {
+			scratchBits -= 8;
+			data[byteIndex++] = static_cast<uint8_t>(scratch >> scratchBits);
+		}
+
+		if(scratchBits > 0) {
+			data[byteIndex] = static_cast<uint8_t>(scratch << (8 - scratchBits));
+		}
+	}
+
+	void BitWriter::WriteBool(bool value) {
+		Write(value ? 1u : 0u, 1);
+	}
+
+	void BitWriter::WriteVarUInt(uint32_t value) {
+		do {
+			const uint32_t group = value & 0x7Fu;
+			value >>= 7;
+			Write(group | ((value != 0) ? 0x80u : 0u), 8);
+		} while(value != 0);
+	}
+
+	void BitWriter::WriteVarInt(int32_t value) {
+		const uint32_t u = static_cast<uint32_t>(value);
+		WriteVarUInt((u << 1) ^ static_cast<uint32_t>(value >> 31));
+	}
+
+	BitReader::BitReader(ArrayView<uint8_t> buffer) :
+		data{ buffer.Data() }, sizeInBits{ buffer.Size() * 8 }, bitIndex{ 0 }, overflowed{ false } {
+
+	}
+
+	uint32_t BitReader::Read(uint32_t numBits) {
+		if(numBits == 0 || overflowed) {
+			return 0;
+		}
+
+		if(numBits > 32 || (bitIndex + numBits) > sizeInBits) {
+			overflowed = true;
+			return 0;
+		}
+
+		const size_t byteIndex = bitIndex / 8;
+		const uint32_t bitOffset = static_cast<uint32_t>(bitIndex % 8);
+		const uint32_t numBytes = (bitOffset + numBits + 7) / 8;
+
+		uint64_t window = 0;
+		for(uint32_t i = 0; i < numBytes; i++) {
+			window = (window << 8) | data[byteIndex + i];
+		}
+
+		bitIndex += numBits;
+
+		return LowBits(static_cast<uint32_t>(window >> (numBytes * 8 - bitOffset - numBits)), numBits);
+	}
+
+	bool BitReader::ReadBool() {
+		return Read(1) != 0;
+	}
+
+	uint32_t BitReader::ReadVarUInt() {
+		uint32_t value = 0;
+
+		for(uint32_t i = 0; i < MAX_VARINT_GROUPS; i++) {
+			const uint32_t group = Read(8);
+
+			if(overflowed) {
+				return 0;
+			}
+
+			value |= (group & 0x7Fu) << (7 * i);
+
+			if((group & 0x80u) == 0) {
+				return value;
+			}
+		}
+
+		// a well formed 32 bit value never needs more groups
+		overflowed = true;
+		return 0;
+	}
+
+	int32_t BitReader::ReadVarInt() {
+		const uint32_t u = ReadVarUInt();
+		return static_cast<int32_t>((u >> 1) ^ (~(u & 1u) + 1u));
+	}
+
+}
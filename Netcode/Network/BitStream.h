@@ -0,0 +1,91 @@
+#pragma once
+
+#include <NetcodeFoundation/ArrayView.hpp>
+#include <cstdint>
+
+namespace Netcode::Network {
+
+	/**
+	 * Packs values of arbitrary bit widths into a byte buffer, most significant bit first.
+	 * The last partially written byte is zero padded, so the buffer is always ready to be sent.
+	 * Writing past the end of the buffer sets the overflow flag and ignores the value.
+	 */
+	class BitWriter {
+		uint8_t * data;
+		size_t sizeInBits;
+		size_t bitIndex;
+		uint64_t scratch;
+		uint32_t scratchBits;
+		bool overflowed;
+
+	public:
+		BitWriter(MutableArrayView<uint8_t> buffer);
+
+		/**
+		 * Writes the lowest numBits bits of the value
+		 * @param numBits in the range [0, 32]
+		 */
+		void Write(uint32_t value, uint32_t numBits);
+
+		void WriteBool(bool value);
+
+		/**
+		 * Groups of 7 bits with a continuation bit, least significant group first
+		 */
+		void WriteVarUInt(uint32_t value);
+
+		/**
+		 * Zigzag encoded so small negative values stay short
+		 */
+		void WriteVarInt(int32_t value);
+
+		size_t GetNumBits() const {
+			return bitIndex;
+		}
+
+		size_t GetNumBytes() const {
+			return (bitIndex + 7) / 8;
+		}
+
+		bool HasOverflowed() const {
+			return overflowed;
+		}
+	};
+
+	/**
+	 * Reads the output of BitWriter, reading past the end sets the overflow flag and returns zeros
+	 */
+	class BitReader {
+		const uint8_t * data;
+		size_t sizeInBits;
+		size_t bitIndex;
+		bool overflowed;
+
+	public:
+		BitReader(ArrayView<uint8_t> buffer);
+
+		/**
+		 * @param numBits in the range [0, 32]
+		 */
+		uint32_t Read(uint32_t numBits);
+
+		bool ReadBool();
+
+		uint32_t ReadVarUInt();
+
+		int32_t ReadVarInt();
+
+		size_t GetNumBits() const {
+			return bitIndex;
+		}
+
+		size_t GetNumBytes() const {
+			return (bitIndex + 7) / 8;
+		}
+
+		bool HasOverflowed() const {
+			return overflowed;
+		}
+	};
+
+}
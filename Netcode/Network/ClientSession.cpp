@@ -177,7 +177,7 @@ namespace Netcode::Network {
 		control->set_type(Protocol::MessageType::CONNECT_REQUEST);
 		Protocol::ConnectRequest* cr = control->mutable_connect_request();
 		cr->set_type(Protocol::ConnectType::DIRECT);
-		cr->set_query("query");
+		cr->set_query(sessionHash);
 
 		ControlMessage cm;
 		cm.allocator = alloc;
@@ -0,0 +1,228 @@
+#include "ClockDiscipline.h"
+#include <Netcode/System/SystemClock.h>
+#include <Netcode/Sync/LockGuards.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace Netcode::Network {
+
+	// error bound reported while unsynchronized
+	constexpr static Duration MAX_DISPERSION = std::chrono::seconds(16);
+
+	ClockDiscipline::ClockDiscipline() : ClockDiscipline(ClockDisciplineConfig{}) {
+
+	}
+
+	ClockDiscipline::ClockDiscipline(const ClockDisciplineConfig & config) : srwLock{}, config{ config } {
+		Reset();
+	}
+
+	void ClockDiscipline::Reset() {
+		ScopedExclusiveLock<SlimReadWriteLock> lock{ srwLock };
+
+		for(Sample & s : window) {
+			s.offset = 0.0;
+			s.delay = DurationToDouble(MAX_DISPERSION);
+			s.time = Timestamp{};
+		}
+
+		std::fill(std::begin(history), std::end(history), window[0]);
+
+		numSamples = 0;
+		numSpikes = 0;
+		lastUsedSample = Timestamp{};
+		numHistory = 0;
+		modelTime = Timestamp{};
+		modelOffset = 0.0;
+		frequency = 0.0;
+		correction = 0.0;
+		selectedDelay = DurationToDouble(MAX_DISPERSION);
+		jitter = PRECISION;
+		isSynchronized = false;
+	}
+
+	double ClockDiscipline::EvaluateUnsafe(Timestamp at, double * remainingCorrection) const {
+		const double dt = DurationToDouble(at - modelTime);
+		const double maxSlew = config.maxSlewRate * std::max(dt, 0.0);
+		const double applied = std::clamp(correction, -maxSlew, maxSlew);
+
+		if(remainingCorrection != nullptr) {
+			*remainingCorrection = correction - applied;
+		}
+
+		return modelOffset + frequency * dt + applied;
+	}
+
+	void ClockDiscipline::PushHistoryUnsafe(const Sample & sample) {
+		std::rotate(std::rbegin(history), std::rbegin(history) + 1, std::rend(history));
+		history[0] = sample;
+		numHistory++;
+	}
+
+	void ClockDiscipline::StepUnsafe(const Sample & sample, Timestamp now) {
+		// a step invalidates the drift history too
+		history[0] = sample;
+		numHistory = 1;
+		modelTime = now;
+		modelOffset = sample.offset;
+		frequency = 0.0;
+		correction = 0.0;
+		numSpikes = 0;
+		isSynchronized = true;
+	}
+
+	ClockSampleResult ClockDiscipline::AddSample(Duration offset, Duration delay, Timestamp receivedAt) {
+		ScopedExclusiveLock<SlimReadWriteLock> lock{ srwLock };
+
+		// shift 1 out regardless of what happens next
+		std::rotate(std::rbegin(window), std::rbegin(window) + 1, std::rend(window));
+		window[0].offset = DurationToDouble(offset);
+		window[0].delay = std::max(DurationToDouble(delay), PRECISION);
+		window[0].time = receivedAt;
+		numSamples++;
+
+		// clock filter: the sample with the lowest delay has the least asymmetry in it
+		const uint32_t numValid = std::min(numSamples, WINDOW_SIZE);
+		const Sample * selected = &window[0];
+
+		for(uint32_t i = 1; i < numValid; i++) {
+			if(window[i].delay < selected->delay) {
+				selected = &window[i];
+			}
+		}
+
+		// samples with a much larger delay than the best one would only measure the queueing
+		double sumSq = 0.0;
+		uint32_t numJitterSamples = 0;
+		for(uint32_t i = 0; i < numValid; i++) {
+			if(window[i].delay <= 2.0 * selected->delay) {
+				const double d = window[i].offset - selected->offset;
+				sumSq += d * d;
+				numJitterSamples++;
+			}
+		}
+		jitter = std::max(std::sqrt(sumSq / std::max(numJitterSamples - 1, 1u)), PRECISION);
+
+		// do not reuse samples
+		if(isSynchronized && selected->time <= lastUsedSample) {
+			return ClockSampleResult::FILTERED;
+		}
+
+		if(!isSynchronized) {
+			StepUnsafe(*selected, receivedAt);
+			lastUsedSample = selected->time;
+			selectedDelay = selected->delay;
+			return ClockSampleResult::STEPPED;
+		}
+
+		const double residual = selected->offset - EvaluateUnsafe(selected->time, nullptr);
+		const double stepThreshold = DurationToDouble(config.stepThreshold);
+
+		// spike suppressor: isolated outliers are dropped, persistent ones are believed
+		if(std::fabs(residual) > stepThreshold || std::fabs(residual) > config.popcornThreshold * jitter) {
+			if(++numSpikes < config.stepoutCount) {
+				return ClockSampleResult::REJECTED;
+			}
+		}
+
+		if(std::fabs(residual) > stepThreshold) {
+			StepUnsafe(*selected, receivedAt);
+			lastUsedSample = selected->time;
+			selectedDelay = selected->delay;
+			return ClockSampleResult::STEPPED;
+		}
+
+		numSpikes = 0;
+
+		// rebase the model to now, the new residual supersedes the correction still being slewed
+		modelOffset = EvaluateUnsafe(receivedAt, nullptr);
+		modelTime = receivedAt;
+		correction = residual;
+
+		// frequency locked loop: least squares slope of the raw offsets used so far, independent of the slewing
+		PushHistoryUnsafe(*selected);
+
+		if(numHistory >= 3) {
+			const uint32_t n = std::min(numHistory, WINDOW_SIZE);
+			const Timestamp origin = history[0].time;
+			double sumX = 0.0, sumY = 0.0, sumXX = 0.0, sumXY = 0.0;
+
+			for(uint32_t i = 0; i < n; i++) {
+				const double x = DurationToDouble(history[i].time - origin);
+				sumX += x;
+				sumY += history[i].offset;
+				sumXX += x * x;
+				sumXY += x * history[i].offset;
+			}
+
+			const double denominator = n * sumXX - sumX * sumX;
+
+			if(denominator > PRECISION) {
+				const double measuredFrequency = (n * sumXY - sumX * sumY) / denominator;
+				frequency = std::clamp(frequency + config.frequencyGain * (measuredFrequency - frequency), -config.maxFrequency, config.maxFrequency);
+			}
+		}
+
+		lastUsedSample = selected->time;
+		selectedDelay = selected->delay;
+		return ClockSampleResult::ACCEPTED;
+	}
+
+	ClockSampleResult ClockDiscipline::Update(const Protocol::TimeSync & timeSync) {
+		const Timestamp t0{ ConvertUInt64ToTimestamp(timeSync.client_req_transmission()) };
+		const Timestamp t1{ ConvertUInt64ToTimestamp(timeSync.server_req_reception()) };
+		const Timestamp t2{ ConvertUInt64ToTimestamp(timeSync.server_resp_transmission()) };
+		const Timestamp t3{ ConvertUInt64ToTimestamp(timeSync.client_resp_reception()) };
+
+		const Duration delta = (t3 - t0) - (t2 - t1);
+		const Duration theta = ((t1 - t0) + (t2 - t3)) / 2;
+
+		return AddSample(theta, delta, t3);
+	}
+
+	bool ClockDiscipline::IsSynchronized() const {
+		ScopedSharedLock<SlimReadWriteLock> lock{ srwLock };
+		return isSynchronized;
+	}
+
+	uint32_t ClockDiscipline::GetNumSamples() const {
+		ScopedSharedLock<SlimReadWriteLock> lock{ srwLock };
+		return numSamples;
+	}
+
+	Duration ClockDiscipline::GetOffset(Timestamp at) const {
+		ScopedSharedLock<SlimReadWriteLock> lock{ srwLock };
+		return DoubleToDuration(EvaluateUnsafe(at, nullptr));
+	}
+
+	Duration ClockDiscipline::GetDelay() const {
+		ScopedSharedLock<SlimReadWriteLock> lock{ srwLock };
+		return DoubleToDuration(selectedDelay);
+	}
+
+	Duration ClockDiscipline::GetJitter() const {
+		ScopedSharedLock<SlimReadWriteLock> lock{ srwLock };
+		return DoubleToDuration(jitter);
+	}
+
+	double ClockDiscipline::GetFrequency() const {
+		ScopedSharedLock<SlimReadWriteLock> lock{ srwLock };
+		return frequency;
+	}
+
+	Duration ClockDiscipline::GetErrorBound(Timestamp at) const {
+		ScopedSharedLock<SlimReadWriteLock> lock{ srwLock };
+
+		if(!isSynchronized) {
+			return MAX_DISPERSION;
+		}
+
+		double remaining = 0.0;
+		EvaluateUnsafe(at, &remaining);
+
+		const double age = std::max(DurationToDouble(at - lastUsedSample), 0.0);
+
+		return DoubleToDuration(selectedDelay / 2.0 + jitter + std::fabs(remaining) + config.frequencyTolerance * age);
+	}
+
+}
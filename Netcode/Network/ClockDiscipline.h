@@ -0,0 +1,140 @@
+#pragma once
+
+#include <Netcode/System/TimeTypes.h>
+#include <Netcode/Sync/SlimReadWriteLock.h>
+#include "NetcodeProtocol/header.pb.h"
+
+namespace Netcode::Network {
+
+	struct ClockDisciplineConfig {
+		// residuals above this are corrected with a step instead of slewing
+		Duration stepThreshold;
+		// consecutive outliers needed before they are trusted
+		uint32_t stepoutCount;
+		// samples farther from the prediction than this multiple of the jitter are outliers
+		double popcornThreshold;
+		// fastest rate the offset may change while slewing, in seconds per second
+		double maxSlewRate;
+		// clamp of the estimated frequency difference between the two clocks
+		double maxFrequency;
+		// fraction of the observed frequency error corrected by a single sample
+		double frequencyGain;
+		// assumed stability of the local oscillator, grows the error bound as the last sample ages
+		double frequencyTolerance;
+
+		ClockDisciplineConfig() :
+			stepThreshold{ std::chrono::milliseconds(128) },
+			stepoutCount{ 3 },
+			popcornThreshold{ 3.0 },
+			maxSlewRate{ 0.005 },
+			maxFrequency{ 500e-6 },
+			frequencyGain{ 0.25 },
+			frequencyTolerance{ 15e-6 } { }
+	};
+
+	enum class ClockSampleResult : uint32_t {
+		// the sample adjusted the slewed offset and the frequency
+		ACCEPTED,
+		// the offset was set directly: first sample or a persistent large error
+		STEPPED,
+		// a sample with lower delay was used before, nothing changed
+		FILTERED,
+		// outlier
+		REJECTED
+	};
+
+	/**
+	 * Continuous offset estimation between the local and a remote clock, in the style of the ntpd clock discipline.
+	 * Samples go through a minimum delay clock filter and a spike suppressor,
+	 * then a frequency locked loop tracks the drift while offset corrections are slewed at a bounded rate.
+	 * Every member function is thread safe.
+	 */
+	class ClockDiscipline {
+		struct Sample {
+			double offset;
+			double delay;
+			Timestamp time;
+		};
+
+		constexpr static uint32_t WINDOW_SIZE = 8;
+		constexpr static double PRECISION = 1.0 / (1 << 18);
+
+		mutable SlimReadWriteLock srwLock;
+		ClockDisciplineConfig config;
+		Sample window[WINDOW_SIZE];
+		// samples that were used by the loop, newest first
+		Sample history[WINDOW_SIZE];
+		uint32_t numSamples;
+		uint32_t numHistory;
+		uint32_t numSpikes;
+		// arrival of the last sample that went into the loop
+		Timestamp lastUsedSample;
+		// the offset model is linear from this point in time
+		Timestamp modelTime;
+		double modelOffset;
+		double frequency;
+		double correction;
+		double selectedDelay;
+		double jitter;
+		bool isSynchronized;
+
+		double EvaluateUnsafe(Timestamp at, double * remainingCorrection) const;
+
+		void PushHistoryUnsafe(const Sample & sample);
+
+		void StepUnsafe(const Sample & sample, Timestamp now);
+
+	public:
+		constexpr static double DurationToDouble(const Duration & d) {
+			return std::chrono::duration<double, std::milli>(d).count();
+		}
+
+		constexpr static Duration DoubleToDuration(double d) {
+			return std::chrono::duration_cast<Duration>(std::chrono::duration<double, std::milli>(d));
+		}
+
+		ClockDiscipline();
+
+		ClockDiscipline(const ClockDisciplineConfig & config);
+
+		ClockSampleResult AddSample(Duration offset, Duration delay, Timestamp receivedAt);
+
+		ClockSampleResult Update(const Protocol::TimeSync & timeSync);
+
+		void Reset();
+
+		[[nodiscard]]
+		bool IsSynchronized() const;
+
+		[[nodiscard]]
+		uint32_t GetNumSamples() const;
+
+		/**
+		 * Remote minus local time at the given local time, moves smoothly between samples
+		 */
+		[[nodiscard]]
+		Duration GetOffset(Timestamp at) const;
+
+		/**
+		 * Round trip of the sample the current estimate is based on
+		 */
+		[[nodiscard]]
+		Duration GetDelay() const;
+
+		[[nodiscard]]
+		Duration GetJitter() const;
+
+		/**
+		 * Estimated frequency difference, dimensionless
+		 */
+		[[nodiscard]]
+		double GetFrequency() const;
+
+		/**
+		 * Upper estimate of |true offset - GetOffset(at)|, grows as the last sample ages
+		 */
+		[[nodiscard]]
+		Duration GetErrorBound(Timestamp at) const;
+	};
+
+}
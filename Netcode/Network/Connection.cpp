@@ -2,7 +2,7 @@
 #include "NetworkErrorCode.h"
 
 namespace Netcode::Network {
-	void PendingTokenStorage::Ack(uint32_t sequence, const UdpEndpoint & sender, AckClassification ackClass) {
+	void PendingTokenStorage::Ack(uint32_t sequence, const UdpEndpoint & sender, AckClassification ackClass, Timestamp ackedAt) {
 		ScopedExclusiveLock<SlimReadWriteLock> scopedLock{ srwLock };
 
 		PendingTokenNode * prev = nullptr;
@@ -15,6 +15,12 @@ namespace Netcode::Network {
 					prev->next = iter->next;
 				}
 
+				// Karn's algorithm: the ack of a retransmitted message is ambiguous, it is not sampled
+				if(iter->retransmissionTimer != nullptr && ackedAt != Timestamp{} &&
+					iter->numTransmissions.load(std::memory_order_acquire) == 1 && ackedAt >= iter->sentAt) {
+					iter->retransmissionTimer->AddSample(ackedAt - iter->sentAt);
+				}
+
 				TrResult tr;
 				iter->token->Set(TrResult{ make_error_code(NetworkErrc::SUCCESS), iter->packet->GetSize() });
 				iter->timer->cancel();
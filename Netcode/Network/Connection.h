@@ -6,6 +6,7 @@
 #include <Netcode/Utility.h>
 #include <Netcode/Sync/SlimReadWriteLock.h>
 #include <Netcode/Config.h>
+#include <Netcode/AsyncLog.h>
 #include "NetcodeFoundation/Enum.hpp"
 #include <boost/lockfree/queue.hpp>
 #include "NetAllocator.h"
@@ -235,9 +236,14 @@ namespace Netcode::Network {
 		UdpPacket * packet;
 		PendingTokenNode * next;
 		AckClassification ackClass;
-
-		PendingTokenNode(CompletionToken<TrResult> token, WaitableTimer * timer, UdpPacket * packet, AckClassification classification) :
-			token{ std::move(token) }, timer{ timer }, packet{ packet }, next{ nullptr }, ackClass{ classification } { }
+		// optional, sampled when the acknowledged message was only sent once
+		RetransmissionTimer * retransmissionTimer;
+		Timestamp sentAt;
+		std::atomic_uint32_t numTransmissions;
+
+		PendingTokenNode(CompletionToken<TrResult> token, WaitableTimer * timer, UdpPacket * packet, AckClassification classification, RetransmissionTimer * retransmissionTimer) :
+			token{ std::move(token) }, timer{ timer }, packet{ packet }, next{ nullptr }, ackClass{ classification },
+			retransmissionTimer{ retransmissionTimer }, sentAt{}, numTransmissions{ 0 } { }
 	};
 
 	class PendingTokenStorage {
@@ -247,7 +253,10 @@ namespace Netcode::Network {
 	public:
 		PendingTokenStorage() : srwLock{}, head{ nullptr }{}
 		
-		void Ack(uint32_t sequence, const UdpEndpoint & sender, AckClassification ackClass);
+		/**
+		 * @param ackedAt arrival of the acknowledgement, the default value skips the round trip sampling
+		 */
+		void Ack(uint32_t sequence, const UdpEndpoint & sender, AckClassification ackClass, Timestamp ackedAt = Timestamp{});
 
 		void AddNode(PendingTokenNode * node) {
 			ScopedExclusiveLock<SlimReadWriteLock> scopedLock{ srwLock };
@@ -266,7 +275,9 @@ namespace Netcode::Network {
 		UdpPacket * packet;
 		const DtlsRoute * route;
 		WaitableTimer * timer;
-		Duration resendInterval;
+		PendingTokenNode * node;
+		RetransmissionConfig retransmissionConfig;
+		Duration initialTimeout;
 		uint32_t attemptCount;
 		uint32_t attemptIndex;
 
@@ -280,7 +291,9 @@ namespace Netcode::Network {
 			UdpPacket * packet,
 			const DtlsRoute * route,
 			WaitableTimer * timer,
-			Duration resendInterval,
+			PendingTokenNode * node,
+			const RetransmissionConfig & retransmissionConfig,
+			Duration initialTimeout,
 			uint32_t numAttempts) : pendingTokenStorage{ pendingTokenStorage },
 			socket{ socket },
 			completionToken{ std::move(token) },
@@ -288,7 +301,9 @@ namespace Netcode::Network {
 			packet{ packet },
 			route { route },
 			timer{ timer },
-			resendInterval{ resendInterval },
+			node{ node },
+			retransmissionConfig{ retransmissionConfig },
+			initialTimeout{ initialTimeout },
 			attemptCount{ numAttempts },
 			attemptIndex{ 0 } {
 
@@ -317,9 +332,14 @@ namespace Netcode::Network {
 				}
 			}
 
+			if(attemptIndex == 0) {
+				node->sentAt = SystemClock::LocalNow();
+			}
+			node->numTransmissions.fetch_add(1, std::memory_order_release);
+
 			attemptIndex++;
 
-			Log::Debug("AttemptIndex:{0} AttemptCount: {1}", static_cast<int>(attemptIndex), static_cast<int>(attemptCount));
+			NETCODE_LOG_DEBUG(16, "AttemptIndex:{0} AttemptCount: {1}", attemptIndex, attemptCount);
 			
 			socket->Send(packet->GetConstBuffer(), packet->GetEndpoint(),
 				[this, lt = Base::shared_from_this()](const ErrorCode & ec, size_t s) -> void {
@@ -332,7 +352,12 @@ namespace Netcode::Network {
 		}
 
 		void InitTimer() {
-			timer->expires_after(resendInterval);
+			// the path estimate is read on every attempt, so a retransmission benefits from samples taken in the meantime
+			const Duration timeout = (route != nullptr) ?
+				route->retransmissionTimer.GetTimeout(initialTimeout, attemptIndex - 1, retransmissionConfig) :
+				RetransmissionTimer::Backoff(initialTimeout, attemptIndex - 1, retransmissionConfig);
+
+			timer->expires_after(timeout);
 			timer->async_wait([this, lt = Base::shared_from_this()](const ErrorCode & ec) -> void {
 				if(!ec) {
 					Attempt();
@@ -6,6 +6,7 @@
 #include "SslUtil.h"
 #include "NetworkErrorCode.h"
 #include "CompletionToken.h"
+#include "RetransmissionTimer.h"
 
 namespace Netcode::Network {
 
@@ -50,8 +51,10 @@ namespace Netcode::Network {
 		uint16_t mtu;
 		DtlsRouteState state;
 		DtlsRoute * next;
+		// round trip estimation of the acknowledged control messages on this route
+		mutable RetransmissionTimer retransmissionTimer;
 
-		DtlsRoute() : ssl{}, lastReceivedAt{}, lastResentAt{}, endpoint{}, mtu{ 0 }, state{ DtlsRouteState::UNDEFINED }, next{ nullptr } {}
+		DtlsRoute() : ssl{}, lastReceivedAt{}, lastResentAt{}, endpoint{}, mtu{ 0 }, state{ DtlsRouteState::UNDEFINED }, next{ nullptr }, retransmissionTimer{} {}
 	};
 
 	class NetAllocator;
@@ -0,0 +1,109 @@
+#include "HistoryBuffer.h"
+#include <NetcodeFoundation/Exceptions.h>
+#include <algorithm>
+
+namespace Netcode::Network {
+
+	HistoryBuffer::HistoryBuffer(Duration duration, uint32_t initialCapacity) : timestamps{}, positions{}, rotations{}, flags{},
+		window{ duration }, head{ 0 }, size{ 0 } {
+		uint32_t capacity = 2;
+		while(capacity < initialCapacity) {
+			capacity <<= 1;
+		}
+
+		timestamps.resize(capacity);
+		positions.resize(capacity);
+		rotations.resize(capacity);
+		flags.resize(capacity);
+	}
+
+	void HistoryBuffer::Grow() {
+		const uint32_t capacity = GetCapacity();
+
+		// linearize, the oldest sample goes to the front
+		std::rotate(std::begin(timestamps), std::begin(timestamps) + head, std::end(timestamps));
+		std::rotate(std::begin(positions), std::begin(positions) + head, std::end(positions));
+		std::rotate(std::begin(rotations), std::begin(rotations) + head, std::end(rotations));
+		std::rotate(std::begin(flags), std::begin(flags) + head, std::end(flags));
+
+		timestamps.resize(2 * capacity);
+		positions.resize(2 * capacity);
+		rotations.resize(2 * capacity);
+		flags.resize(2 * capacity);
+		head = 0;
+	}
+
+	void HistoryBuffer::Evict() {
+		const Timestamp cutoff = GetTimestamp(size - 1) - window;
+
+		// the oldest sample stays while the next one is inside the window, it is needed for interpolating at the cutoff
+		while(size > 2 && GetTimestamp(1) <= cutoff) {
+			head = ToIndex(1);
+			size--;
+		}
+	}
+
+	void HistoryBuffer::Insert(Timestamp timestamp, const Float3 & position, const Float4 & rotation, uint32_t sampleFlags) {
+		UndefinedBehaviourAssertion(size == 0 || GetTimestamp(size - 1) <= timestamp);
+
+		if(size > 0) {
+			const Timestamp cutoff = timestamp - window;
+
+			if(size == GetCapacity() && GetTimestamp(1) > cutoff) {
+				Grow();
+			}
+		}
+
+		const uint32_t idx = ToIndex(size);
+		timestamps[idx] = timestamp;
+		positions[idx] = position;
+		rotations[idx] = rotation;
+		flags[idx] = sampleFlags;
+
+		if(size < GetCapacity()) {
+			size++;
+		} else {
+			head = ToIndex(1);
+		}
+
+		Evict();
+	}
+
+	uint32_t HistoryBuffer::UpperBound(Timestamp timestamp) const {
+		uint32_t first = 0;
+		uint32_t count = size;
+
+		while(count > 0) {
+			const uint32_t step = count / 2;
+
+			if(timestamps[ToIndex(first + step)] <= timestamp) {
+				first += step + 1;
+				count -= step + 1;
+			} else {
+				count = step;
+			}
+		}
+
+		return first;
+	}
+
+	bool HistoryBuffer::Sample(Timestamp timestamp, HistorySample & sample) const {
+		const uint32_t newer = UpperBound(timestamp);
+
+		if(newer == 0 || newer == size) {
+			return false;
+		}
+
+		const uint32_t i0 = ToIndex(newer - 1);
+		const uint32_t i1 = ToIndex(newer);
+
+		const float t = std::clamp(std::chrono::duration<float>(timestamp - timestamps[i0]).count() /
+			std::chrono::duration<float>(timestamps[i1] - timestamps[i0]).count(), 0.0f, 1.0f);
+
+		sample.position = Vector3::Lerp(positions[i0], positions[i1], t);
+		sample.rotation = Quaternion::Slerp(rotations[i0], rotations[i1], t);
+		sample.flags = flags[i0] & flags[i1];
+		return true;
+	}
+
+}
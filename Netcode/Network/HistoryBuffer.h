@@ -0,0 +1,88 @@
+#pragma once
+
+#include <NetcodeFoundation/Math.h>
+#include <Netcode/System/TimeTypes.h>
+#include <vector>
+
+namespace Netcode::Network {
+
+	struct HistorySample {
+		Float3 position;
+		Float4 rotation;
+		// flags of the two samples around the time, combined with a bitwise and
+		uint32_t flags;
+	};
+
+	/**
+	 * Time indexed history of a transform, kept as a structure of arrays: a non decreasing timestamp column
+	 * for the binary search, separate position and rotation columns for the interpolation, and a column of
+	 * flags that are not interpolated. The capacity is given as a duration, the columns grow while the
+	 * samples inside it do not fit.
+	 */
+	class HistoryBuffer {
+		std::vector<Timestamp> timestamps;
+		std::vector<Float3> positions;
+		std::vector<Float4> rotations;
+		std::vector<uint32_t> flags;
+		Duration window;
+		// ring of capacity items (power of 2), head is the index of the oldest
+		uint32_t head;
+		uint32_t size;
+
+		uint32_t GetCapacity() const {
+			return static_cast<uint32_t>(timestamps.size());
+		}
+
+		uint32_t ToIndex(uint32_t i) const {
+			return (head + i) & (GetCapacity() - 1);
+		}
+
+		void Grow();
+
+		void Evict();
+
+		/*
+		 * Logical index of the first sample newer than the timestamp, size if none
+		 */
+		uint32_t UpperBound(Timestamp timestamp) const;
+
+	public:
+		/**
+		 * @param duration samples older than this compared to the newest are dropped, except the one
+		 * needed to interpolate at the edge of the window
+		 */
+		HistoryBuffer(Duration duration, uint32_t initialCapacity = 16);
+
+		/**
+		 * Appends the newest sample, the timestamp must not be older than the previous one
+		 */
+		void Insert(Timestamp timestamp, const Float3 & position, const Float4 & rotation, uint32_t sampleFlags = 0);
+
+		/**
+		 * Interpolates between the newest sample not newer than the timestamp and the sample after it.
+		 * @return false if the timestamp is not inside the stored history, the output is unchanged then
+		 */
+		bool Sample(Timestamp timestamp, HistorySample & sample) const;
+
+		void Clear() {
+			head = 0;
+			size = 0;
+		}
+
+		uint32_t GetSize() const {
+			return size;
+		}
+
+		Duration GetDuration() const {
+			return window;
+		}
+
+		/**
+		 * @param i 0 is the oldest sample
+		 */
+		Timestamp GetTimestamp(uint32_t i) const {
+			return timestamps[ToIndex(i)];
+		}
+	};
+
+}
@@ -1,53 +1,137 @@
 #include "HttpSession.h"
 #include <Netcode/Logger.h>
+#include <Netcode/AsyncLog.h>
+#include <Netcode/System/SystemClock.h>
 #include "Response.hpp"
 #include "CompletionToken.h"
 
 
 namespace Netcode::Network {
 
-	void HttpSession::OnReceive(const boost::system::error_code& ec, size_t transferredBytes, CompletionToken<Response> token) {
-		if(ec) {
-			Log::Error("[Network][Http] Failed to read from stream: {0}", ec.message());
+	struct HttpSession::Exchange {
+		http::request<http::string_body> request;
+		Response response;
+		CompletionToken<Response> token;
+		bool isRetried;
 
-			stream.close();
-			isConnected = false;
-
-			response.SetErrorCode(ec);
-			response.result(http::status::client_closed_request);
-
-			token->Set(std::move(response));
-		} else {
-			Log::Debug("[Network][Http] Successfully read {0} bytes", static_cast<int32_t>(transferredBytes));
+		Exchange() : request{}, response{}, token{}, isRetried{ false } { }
 
+		void Complete() {
 			token->Set(std::move(response));
 		}
-	}
 
-	void HttpSession::OnSent(const boost::system::error_code & ec, size_t transferredBytes, CompletionToken<Response> token) {
-		if(ec) {
-			Log::Error("[Network][Http] Failed to write to stream: {0}", ec.message());
+		void Fail(const boost::system::error_code & ec) {
 			response.SetErrorCode(ec);
 			response.result(http::status::client_closed_request);
 			token->Set(std::move(response));
-		} else {
-			Log::Debug("[Network][Http] Successfully wrote {0} bytes", static_cast<int32_t>(transferredBytes));
+		}
+	};
+
+	enum class HttpStreamState : uint32_t {
+		DISCONNECTED, CONNECTING, CONNECTED, CLOSED
+	};
 
-			http::async_read(stream, readBuffer, response, [this, ct = std::move(token), lt = shared_from_this()]
-				(const boost::system::error_code & ec, size_t numBytes) mutable -> void {
-					OnReceive(ec, numBytes, std::move(ct));
+	/*
+	 * A single keep-alive TCP stream. Requests are written in the order they were enqueued,
+	 * responses are read in the same order, which makes HTTP/1.1 pipelining possible.
+	 */
+	class HttpSession::Stream : public std::enable_shared_from_this<HttpSession::Stream> {
+		HttpSession * session;
+		HostPool * pool;
+		TcpResolver resolver;
+		boost::beast::tcp_stream stream;
+		boost::beast::flat_buffer readBuffer;
+		std::deque<Ref<Exchange>> writeQueue;
+		std::deque<Ref<Exchange>> readQueue;
+		Timestamp idleSince;
+		HttpStreamState state;
+		uint32_t numServedRequests;
+		bool isWriting;
+		bool isReading;
+
+		/*
+		 * a reused stream might have been closed by the server while it was idle,
+		 * those failures are worth a retry on a fresh stream. A timeout is not: the host might still be processing the request
+		 */
+		static bool IsRetriable(const boost::system::error_code & ec) {
+			return ec == http::error::end_of_stream ||
+				ec == boost::asio::error::eof ||
+				ec == boost::asio::error::connection_reset ||
+				ec == boost::asio::error::connection_aborted ||
+				ec == boost::asio::error::broken_pipe;
+		}
+
+		/*
+		 * sending these again has the same effect on the host as sending them once
+		 */
+		static bool IsIdempotent(http::verb method) {
+			return method == http::verb::get ||
+				method == http::verb::head ||
+				method == http::verb::options ||
+				method == http::verb::trace ||
+				method == http::verb::put ||
+				method == http::verb::delete_;
+		}
+
+		/*
+		 * numUnprocessed: the number of written requests at the front of the read queue that the host surely did not process.
+		 * Only those, the unwritten ones and the idempotent ones are sent again, a login must not be replayed
+		 */
+		void Fail(const boost::system::error_code & ec, size_t numUnprocessed) {
+			boost::system::error_code closeEc;
+			stream.socket().close(closeEc);
+			state = HttpStreamState::CLOSED;
+
+			const size_t numWritten = readQueue.size();
+
+			std::deque<Ref<Exchange>> failed;
+			std::swap(failed, readQueue);
+			std::move(std::begin(writeQueue), std::end(writeQueue), std::back_inserter(failed));
+			writeQueue.clear();
+
+			const bool wasReused = numServedRequests > 0;
+
+			// requeued in reverse to keep the original order at the front of the pending queue
+			for(size_t i = failed.size(); i > 0; i--) {
+				Ref<Exchange> & ex = failed[i - 1];
+				const bool isUnprocessed = (i - 1) < numUnprocessed || (i - 1) >= numWritten;
+
+				if(wasReused && !ex->isRetried && IsRetriable(ec) && (isUnprocessed || IsIdempotent(ex->request.method()))) {
+					NETCODE_LOG_DEBUG(32, "[Network][Http] Stream was closed by the host, retrying request");
+					ex->isRetried = true;
+					session->Requeue(*pool, std::move(ex));
+				} else {
+					ex->Fail(ec);
+				}
+			}
+
+			session->OnStreamClosed(*pool, this);
+		}
+
+		void OnResolved(const boost::system::error_code & ec, TcpResolver::results_type results) {
+			if(ec) {
+				Log::Error("[Network][Http] Failed to resolve hostname: {0}", ec.message());
+				Fail(ec, 0);
+				return;
+			}
+
+			NETCODE_LOG_DEBUG(32, "[Network][Http] Successfully resolved hostname");
+			stream.expires_after(session->config.requestTimeout);
+
+			stream.async_connect(results, [this, lt = shared_from_this(), sl = session->shared_from_this()]
+				(const boost::system::error_code & ec, TcpEndpoint endpoint) -> void {
+					OnConnected(ec);
 			});
 		}
-	}
 
-	void HttpSession::OnConnected(boost::system::error_code ec, TcpEndpoint endpoint, CompletionToken<Response> token) {
-		if(ec) {
-			Log::Error("[Network][Http] Failed to connect to host: {0}", ec.message());
-			response.SetErrorCode(ec);
-			response.result(http::status::client_closed_request);
-			token->Set(std::move(response));
-		} else {
-			isConnected = true;
+		void OnConnected(boost::system::error_code ec) {
+			if(ec) {
+				Log::Error("[Network][Http] Failed to connect to host: {0}", ec.message());
+				Fail(ec, 0);
+				return;
+			}
+
+			state = HttpStreamState::CONNECTED;
 
 			boost::asio::ip::tcp::socket::keep_alive opt(true);
 			stream.socket().set_option(opt, ec);
@@ -55,69 +139,306 @@ namespace Netcode::Network {
 				Log::Error("[Network][Http] Failed to set socket option: {0}", ec.message());
 			}
 
-			Log::Debug("[Network][Http] Successfully connected to host");
-			http::async_write(stream, request, [this, ct = std::move(token), lt = shared_from_this()]
-				(const boost::system::error_code & ec, size_t numBytes) mutable -> void {
-					OnSent(ec, numBytes, std::move(ct));
+			NETCODE_LOG_DEBUG(32, "[Network][Http] Successfully connected to host");
+			WriteNext();
+		}
+
+		void WriteNext() {
+			if(isWriting || writeQueue.empty() || state != HttpStreamState::CONNECTED) {
+				return;
+			}
+
+			isWriting = true;
+			stream.expires_after(session->config.requestTimeout);
+
+			http::async_write(stream, writeQueue.front()->request, [this, lt = shared_from_this(), sl = session->shared_from_this()]
+				(const boost::system::error_code & ec, size_t numBytes) -> void {
+					OnWritten(ec, numBytes);
 			});
 		}
-	}
 
-	void HttpSession::OnResolved(const boost::system::error_code & ec, boost::asio::ip::tcp::resolver::results_type results, CompletionToken<Response> token) {
-		if(ec) {
-			Log::Error("[Network][Http] Failed to resolve hostname: {0}", ec.message());
-			response.SetErrorCode(ec);
-			response.result(http::status::client_closed_request);
-			token->Set(std::move(response));
-		} else {
-			Log::Debug("[Network][Http] Successfully resolved hostname");
-			stream.expires_after(std::chrono::seconds(5));
+		void OnWritten(const boost::system::error_code & ec, size_t transferredBytes) {
+			isWriting = false;
+
+			if(ec) {
+				Log::Error("[Network][Http] Failed to write to stream: {0}", ec.message());
+				Fail(ec, 0);
+				return;
+			}
+
+			NETCODE_LOG_DEBUG(32, "[Network][Http] Successfully wrote {0} bytes", transferredBytes);
 
-			stream.async_connect(results, [this, ct = std::move(token), lt = shared_from_this()]
-				(const boost::system::error_code & ec, TcpEndpoint endpoint) mutable -> void{
-					OnConnected(ec, endpoint, std::move(ct));
+			readQueue.emplace_back(std::move(writeQueue.front()));
+			writeQueue.pop_front();
+
+			ReadNext();
+			WriteNext();
+		}
+
+		void ReadNext() {
+			if(isReading || readQueue.empty()) {
+				return;
+			}
+
+			isReading = true;
+			stream.expires_after(session->config.requestTimeout);
+
+			http::async_read(stream, readBuffer, readQueue.front()->response, [this, lt = shared_from_this(), sl = session->shared_from_this()]
+				(const boost::system::error_code & ec, size_t numBytes) -> void {
+					OnReceived(ec, numBytes);
 			});
 		}
+
+		void OnReceived(const boost::system::error_code & ec, size_t transferredBytes) {
+			isReading = false;
+
+			if(ec) {
+				Log::Error("[Network][Http] Failed to read from stream: {0}", ec.message());
+				// closed before a byte of the response arrived: the host dropped the stream instead of the first request
+				const bool isUnanswered = transferredBytes == 0 && readBuffer.size() == 0;
+				Fail(ec, isUnanswered ? 1 : 0);
+				return;
+			}
+
+			NETCODE_LOG_DEBUG(32, "[Network][Http] Successfully read {0} bytes", transferredBytes);
+
+			Ref<Exchange> ex = std::move(readQueue.front());
+			readQueue.pop_front();
+			numServedRequests++;
+
+			const bool keepAlive = ex->response.keep_alive();
+
+			ex->Complete();
+
+			if(!keepAlive) {
+				// the host will close the stream without processing anything written after this request, all of it is sent again
+				Fail(http::error::end_of_stream, readQueue.size());
+				return;
+			}
+
+			ReadNext();
+
+			if(GetInFlightCount() == 0) {
+				// the host is allowed to close the stream, the timeout is only a concern for in-flight requests
+				stream.expires_never();
+				idleSince = SystemClock::LocalNow();
+				session->OnStreamIdle(*pool);
+			}
+		}
+
+	public:
+		Stream(HttpSession * session, HostPool * pool) :
+			session{ session },
+			pool{ pool },
+			resolver{ session->strand },
+			stream{ session->strand },
+			readBuffer{},
+			writeQueue{},
+			readQueue{},
+			idleSince{ SystemClock::LocalNow() },
+			state{ HttpStreamState::DISCONNECTED },
+			numServedRequests{ 0 },
+			isWriting{ false },
+			isReading{ false } {
+
+		}
+
+		uint32_t GetInFlightCount() const {
+			return static_cast<uint32_t>(writeQueue.size() + readQueue.size());
+		}
+
+		Timestamp GetIdleSince() const {
+			return idleSince;
+		}
+
+		bool IsClosed() const {
+			return state == HttpStreamState::CLOSED;
+		}
+
+		/*
+		 * pipelining is only allowed on streams that already proved to be keep-alive
+		 */
+		bool CanAccept(uint32_t maxPipelineDepth) const {
+			if(state == HttpStreamState::CLOSED) {
+				return false;
+			}
+
+			const uint32_t inFlight = GetInFlightCount();
+
+			if(inFlight == 0) {
+				return true;
+			}
+
+			return state == HttpStreamState::CONNECTED && numServedRequests > 0 && inFlight < maxPipelineDepth;
+		}
+
+		void Enqueue(Ref<Exchange> exchange) {
+			writeQueue.emplace_back(std::move(exchange));
+
+			if(state == HttpStreamState::DISCONNECTED) {
+				state = HttpStreamState::CONNECTING;
+				resolver.async_resolve(pool->host, pool->port, [this, lt = shared_from_this(), sl = session->shared_from_this()]
+					(const boost::system::error_code & ec, TcpResolver::results_type results) -> void {
+						OnResolved(ec, std::move(results));
+				});
+				return;
+			}
+
+			WriteNext();
+		}
+
+		/*
+		 * Closes the underlying socket, pending operations will complete with an error
+		 */
+		void Close() {
+			boost::system::error_code ec;
+			resolver.cancel();
+			stream.socket().close(ec);
+		}
+	};
+
+	HttpSession::HttpSession(boost::asio::io_context & ioc) : HttpSession{ ioc, HttpPoolConfig{} } {
+
 	}
 
-	void HttpSession::OnSentFirstTry(const boost::system::error_code & ec, size_t transferredBytes, std::string host, std::string port, CompletionToken<Response> token) {
-		// if the stream "is just timed out", then try reconnecting first
-		if(ec == boost::beast::error::timeout) {
-			Log::Debug("[Network][Http] Stream timed out, trying to reconnect");
-			stream.close();
-			isConnected = false;
-			resolver.async_resolve(host, port, [this, ct = std::move(token), lt = shared_from_this()]
-				(const boost::system::error_code & ec, TcpResolver::results_type results) mutable -> void {
-					OnResolved(ec, std::move(results), std::move(ct));
-			});
+	HttpSession::HttpSession(boost::asio::io_context & ioc, const HttpPoolConfig & config) :
+		ioc{ ioc },
+		strand{ boost::asio::make_strand(ioc) },
+		evictionTimer{ strand },
+		config{ config },
+		pools{},
+		isEvictionTimerArmed{ false },
+		isClosed{ false } {
+		this->config.maxConnectionsPerHost = std::max(this->config.maxConnectionsPerHost, 1u);
+		this->config.maxPipelineDepth = std::max(this->config.maxPipelineDepth, 1u);
+	}
+
+	void HttpSession::Dispatch(HostPool & pool) {
+		while(!pool.pending.empty()) {
+			Stream * candidate = nullptr;
+
+			// prefer the least loaded stream, idle streams are always accepted
+			for(const Ref<Stream> & s : pool.streams) {
+				if(s->CanAccept(config.maxPipelineDepth)) {
+					if(candidate == nullptr || s->GetInFlightCount() < candidate->GetInFlightCount()) {
+						candidate = s.get();
+					}
+				}
+			}
+
+			// open a new stream only if no idle stream is available
+			if((candidate == nullptr || candidate->GetInFlightCount() > 0) &&
+				pool.streams.size() < config.maxConnectionsPerHost) {
+				candidate = pool.streams.emplace_back(std::make_shared<Stream>(this, &pool)).get();
+			}
+
+			if(candidate == nullptr) {
+				return;
+			}
+
+			Ref<Exchange> ex = std::move(pool.pending.front());
+			pool.pending.pop_front();
+			candidate->Enqueue(std::move(ex));
+		}
+	}
+
+	void HttpSession::Requeue(HostPool & pool, Ref<Exchange> exchange) {
+		if(isClosed) {
+			exchange->Fail(boost::asio::error::operation_aborted);
 			return;
 		}
 
-		// on other errors, log for now
-		if(ec) {
-			Log::Error("[Network][Http] Failed to send HTTP request: {0}", ec.message());
-			response.result(http::status::client_closed_request);
-			response.SetErrorCode(ec);
-			token->Set(std::move(response));
+		exchange->response = Response{};
+		pool.pending.emplace_front(std::move(exchange));
+	}
+
+	void HttpSession::OnStreamIdle(HostPool & pool) {
+		Dispatch(pool);
+	}
+
+	void HttpSession::OnStreamClosed(HostPool & pool, Stream * stream) {
+		auto it = std::remove_if(std::begin(pool.streams), std::end(pool.streams), [stream](const Ref<Stream> & s) -> bool {
+			return s.get() == stream;
+		});
+
+		pool.streams.erase(it, std::end(pool.streams));
+
+		if(!isClosed) {
+			Dispatch(pool);
+		}
+	}
+
+	void HttpSession::ArmEvictionTimer() {
+		if(isEvictionTimerArmed || isClosed) {
 			return;
 		}
 
-		http::async_read(stream, readBuffer, response, [this, ct = std::move(token), lt = shared_from_this()]
-			(const boost::system::error_code & ec, size_t numBytes) mutable -> void{
-				OnReceive(ec, numBytes, std::move(ct));
+		isEvictionTimerArmed = true;
+		evictionTimer.expires_after(std::max<Duration>(config.idleTimeout / 2, std::chrono::seconds(1)));
+		evictionTimer.async_wait([this, lt = shared_from_this()](const boost::system::error_code & ec) -> void {
+			isEvictionTimerArmed = false;
+
+			if(ec || isClosed) {
+				return;
+			}
+
+			EvictIdleStreams();
 		});
 	}
 
-	HttpSession::HttpSession(boost::asio::io_context & ioc) : ioc{ ioc }, strand { boost::asio::make_strand(ioc) }, resolver{ strand }, stream{ strand }, readBuffer{}, response{}, isConnected{ false } {
+	void HttpSession::EvictIdleStreams() {
+		const Timestamp now = SystemClock::LocalNow();
+		bool hasStreams = false;
+
+		for(auto & [key, pool] : pools) {
+			for(const Ref<Stream> & s : pool.streams) {
+				if(s->GetInFlightCount() == 0 && (now - s->GetIdleSince()) > config.idleTimeout) {
+					NETCODE_LOG_DEBUG(32, "[Network][Http] Closing idle stream to {0}", key);
+					s->Close();
+				}
+			}
+
+			auto it = std::remove_if(std::begin(pool.streams), std::end(pool.streams), [&](const Ref<Stream> & s) -> bool {
+				return s->GetInFlightCount() == 0 && (now - s->GetIdleSince()) > config.idleTimeout;
+			});
+
+			pool.streams.erase(it, std::end(pool.streams));
+
+			hasStreams = hasStreams || !pool.streams.empty();
+		}
+
+		if(hasStreams) {
+			ArmEvictionTimer();
+		}
+	}
+
+	void HttpSession::Close() {
+		boost::asio::post(strand, [this, lt = shared_from_this()]() -> void {
+			isClosed = true;
+
+			boost::system::error_code ec;
+			evictionTimer.cancel(ec);
+
+			for(auto & [key, pool] : pools) {
+				for(Ref<Exchange> & ex : pool.pending) {
+					ex->Fail(boost::asio::error::operation_aborted);
+				}
+				pool.pending.clear();
 
+				for(const Ref<Stream> & s : pool.streams) {
+					s->Close();
+				}
+			}
+		});
 	}
 
 	CompletionToken<Response> HttpSession::MakeRequest(std::string host, std::string port, std::string path, http::verb method, std::string cookies, std::string body) {
 		CompletionToken<Response> token = std::make_shared<CompletionTokenType<Response>>(&ioc);
-		
 
-		request.clear();
-		request.body().clear();
+		Ref<Exchange> ex = std::make_shared<Exchange>();
+		ex->token = token;
+
+		http::request<http::string_body> & request = ex->request;
 		request.method(method);
 		request.target(path);
 		request.version(11);
@@ -132,20 +453,28 @@ namespace Netcode::Network {
 		if(!body.empty()) {
 			request.set(http::field::content_type, "Application/JSON");
 			request.set(http::field::content_length, body.size());
-			request.body() = body;
+			request.body() = std::move(body);
 		}
 
-		if(!isConnected) {
-			resolver.async_resolve(host, port, [this, ct = token, lt = shared_from_this()]
-				(const boost::system::error_code & ec, TcpResolver::results_type results) mutable -> void {
-					OnResolved(ec, std::move(results), std::move(ct));
-			});
-		} else {
-			http::async_write(stream, request, [this, ct = token, h = std::move(host), p = std::move(port), lt = shared_from_this()]
-				(const boost::system::error_code & ec, size_t numBytes) mutable -> void {
-					OnSentFirstTry(ec, numBytes, std::move(h), std::move(p), std::move(ct));
-			});
-		}
+		boost::asio::post(strand, [this, ex = std::move(ex), h = std::move(host), p = std::move(port), lt = shared_from_this()]() mutable -> void {
+			if(isClosed) {
+				ex->Fail(boost::asio::error::operation_aborted);
+				return;
+			}
+
+			std::string key = h + ":" + p;
+			HostPool & pool = pools[key];
+
+			if(pool.host.empty()) {
+				pool.host = std::move(h);
+				pool.port = std::move(p);
+			}
+
+			pool.pending.emplace_back(std::move(ex));
+
+			Dispatch(pool);
+			ArmEvictionTimer();
+		});
 
 		return token;
 	}
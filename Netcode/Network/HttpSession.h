@@ -2,10 +2,15 @@
 
 #include "NetworkDecl.h"
 #include <Netcode/HandleDecl.h>
+#include <Netcode/System/TimeTypes.h>
 
 #include <boost/asio.hpp>
 #include <boost/beast.hpp>
 
+#include <deque>
+#include <map>
+#include <vector>
+
 #include "Response.hpp"
 
 namespace Netcode::Network {
@@ -15,30 +20,72 @@ namespace Netcode::Network {
 	using TcpResolver = boost::asio::ip::tcp::resolver;
 	using TcpEndpoint = boost::asio::ip::tcp::endpoint;
 
+	struct HttpPoolConfig {
+		// upper limit of concurrently open keep-alive streams to a single host
+		uint32_t maxConnectionsPerHost;
+		// number of requests written to a stream before their responses arrive, 1 disables pipelining
+		uint32_t maxPipelineDepth;
+		// unused streams are closed after this duration
+		Duration idleTimeout;
+		// deadline for each connect, write and read operation
+		Duration requestTimeout;
+
+		HttpPoolConfig() :
+			maxConnectionsPerHost{ 4 },
+			maxPipelineDepth{ 1 },
+			idleTimeout{ std::chrono::seconds(30) },
+			requestTimeout{ std::chrono::seconds(5) } { }
+	};
+
+	/**
+	 * Keeps a pool of keep-alive streams for every host:port pair.
+	 * Requests that can not be assigned to a stream are queued per host and dispatched
+	 * in order as soon as a stream becomes available.
+	 * Every internal state change happens on the session's strand.
+	 */
 	class HttpSession : public std::enable_shared_from_this<HttpSession> {
+		class Stream;
+		struct Exchange;
+
+		struct HostPool {
+			std::string host;
+			std::string port;
+			std::vector<Ref<Stream>> streams;
+			std::deque<Ref<Exchange>> pending;
+		};
+
+		using TimerType = boost::asio::basic_waitable_timer<ClockType>;
 
 		boost::asio::io_context & ioc;
 		boost::asio::strand<boost::asio::io_context::executor_type> strand;
-		TcpResolver resolver;
-		boost::beast::tcp_stream stream;
-		boost::beast::flat_buffer readBuffer;
-		Response response;
-		http::request<http::string_body> request;
-		bool isConnected;
+		TimerType evictionTimer;
+		HttpPoolConfig config;
+		std::map<std::string, HostPool> pools;
+		bool isEvictionTimerArmed;
+		bool isClosed;
+
+		void Dispatch(HostPool & pool);
 
-		void OnReceive(const boost::system::error_code & ec, size_t transferredBytes, CompletionToken<Response> token);
+		void Requeue(HostPool & pool, Ref<Exchange> exchange);
 
-		void OnSent(const boost::system::error_code & ec, size_t transferredBytes, CompletionToken<Response> token);
+		void OnStreamIdle(HostPool & pool);
 
-		void OnConnected(boost::system::error_code ec, TcpEndpoint endpoint, CompletionToken<Response> token);
+		void OnStreamClosed(HostPool & pool, Stream * stream);
 
-		void OnResolved(const boost::system::error_code & ec, TcpResolver::results_type results, CompletionToken<Response> token);
+		void ArmEvictionTimer();
 
-		void OnSentFirstTry(const boost::system::error_code & ec, size_t transferredBytes, std::string host, std::string port, CompletionToken<Response> token);
+		void EvictIdleStreams();
 
 	public:
 		HttpSession(boost::asio::io_context & ioc);
 
+		HttpSession(boost::asio::io_context & ioc, const HttpPoolConfig & config);
+
+		/**
+		 * Closes every pooled stream and fails the queued requests, the session can not be used afterwards
+		 */
+		void Close();
+
 		CompletionToken<Response> MakeRequest(std::string host, std::string port, std::string path, http::verb method,  std::string cookies, std::string body);
 	};
 
@@ -0,0 +1,173 @@
+#include "LagCompensation.h"
+#include <NetcodeFoundation/Exceptions.h>
+#include <algorithm>
+#include <emmintrin.h>
+#include <limits>
+
+namespace Netcode::Network {
+
+	// rays nearly parallel to a capsule's axis only hit its spheres
+	constexpr static float PARALLEL_EPSILON = 1e-6f;
+
+	LagCompensation::LagCompensation(Duration duration) : tracks{}, historyDuration{ duration },
+		ax{}, ay{}, az{}, bx{}, by{}, bz{}, radii{}, owners{}, numRewound{ 0 } {
+
+	}
+
+	LagCompensation::Track * LagCompensation::FindTrack(int32_t ownerId) {
+		auto it = std::find_if(std::begin(tracks), std::end(tracks), [ownerId](const Track & t) -> bool {
+			return t.ownerId == ownerId;
+		});
+
+		return (it != std::end(tracks)) ? &(*it) : nullptr;
+	}
+
+	void LagCompensation::AddPlayer(int32_t ownerId, const HitboxShape & shape) {
+		UndefinedBehaviourAssertion(FindTrack(ownerId) == nullptr);
+
+		tracks.emplace_back(Track{ ownerId, shape, HistoryBuffer{ historyDuration } });
+	}
+
+	void LagCompensation::RemovePlayer(int32_t ownerId) {
+		auto it = std::remove_if(std::begin(tracks), std::end(tracks), [ownerId](const Track & t) -> bool {
+			return t.ownerId == ownerId;
+		});
+
+		tracks.erase(it, std::end(tracks));
+	}
+
+	void LagCompensation::Record(int32_t ownerId, Timestamp timestamp, const Float3 & footPosition, bool hittable) {
+		Track * track = FindTrack(ownerId);
+
+		if(track == nullptr) {
+			return;
+		}
+
+		track->history.Insert(timestamp, footPosition, Float4{ 0.0f, 0.0f, 0.0f, 1.0f }, hittable ? FLAG_HITTABLE : 0);
+	}
+
+	uint32_t LagCompensation::Rewind(Timestamp timestamp) {
+		const size_t paddedSize = (tracks.size() + 3) & ~static_cast<size_t>(3);
+
+		for(std::vector<float> * column : { &ax, &ay, &az, &bx, &by, &bz, &radii }) {
+			column->assign(paddedSize, 0.0f);
+		}
+		owners.assign(paddedSize, -1);
+		numRewound = 0;
+
+		HistorySample sample;
+		for(const Track & track : tracks) {
+			if(!track.history.Sample(timestamp, sample) || (sample.flags & FLAG_HITTABLE) == 0) {
+				continue;
+			}
+
+			const Float3 & foot = sample.position;
+			const float center = foot.y + track.shape.centerHeight;
+			ax[numRewound] = foot.x;
+			ay[numRewound] = center - track.shape.halfHeight;
+			az[numRewound] = foot.z;
+			bx[numRewound] = foot.x;
+			by[numRewound] = center + track.shape.halfHeight;
+			bz[numRewound] = foot.z;
+			radii[numRewound] = track.shape.radius;
+			owners[numRewound] = track.ownerId;
+			numRewound++;
+		}
+
+		return numRewound;
+	}
+
+	static inline __m128 Dot(__m128 x0, __m128 y0, __m128 z0, __m128 x1, __m128 y1, __m128 z1) {
+		return _mm_add_ps(_mm_add_ps(_mm_mul_ps(x0, x1), _mm_mul_ps(y0, y1)), _mm_mul_ps(z0, z1));
+	}
+
+	/*
+	 * Entry distance of the ray into spheres, +inf where they are missed or the ray starts inside
+	 */
+	static inline __m128 RaySpheres(__m128 ocx, __m128 ocy, __m128 ocz, __m128 dx, __m128 dy, __m128 dz, __m128 rr) {
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 b = Dot(dx, dy, dz, ocx, ocy, ocz);
+		const __m128 c = _mm_sub_ps(Dot(ocx, ocy, ocz, ocx, ocy, ocz), rr);
+		const __m128 h = _mm_sub_ps(_mm_mul_ps(b, b), c);
+		const __m128 t = _mm_sub_ps(_mm_sub_ps(zero, b), _mm_sqrt_ps(_mm_max_ps(h, zero)));
+		const __m128 valid = _mm_and_ps(_mm_cmpge_ps(h, zero), _mm_and_ps(_mm_cmpge_ps(t, zero), _mm_cmpgt_ps(c, zero)));
+		return _mm_or_ps(_mm_and_ps(valid, t), _mm_andnot_ps(valid, _mm_set1_ps(std::numeric_limits<float>::infinity())));
+	}
+
+	HitboxHit LagCompensation::Raycast(const Float3 & origin, const Float3 & direction, float maxDistance, int32_t ignoredOwnerId) const {
+		const __m128 zero = _mm_setzero_ps();
+		const __m128i ignored = _mm_set1_epi32(ignoredOwnerId);
+		const __m128 inf = _mm_set1_ps(std::numeric_limits<float>::infinity());
+		const __m128 ox = _mm_set1_ps(origin.x);
+		const __m128 oy = _mm_set1_ps(origin.y);
+		const __m128 oz = _mm_set1_ps(origin.z);
+		const __m128 dx = _mm_set1_ps(direction.x);
+		const __m128 dy = _mm_set1_ps(direction.y);
+		const __m128 dz = _mm_set1_ps(direction.z);
+
+		HitboxHit result;
+		float nearest = maxDistance;
+		alignas(16) float distances[4];
+
+		for(uint32_t i = 0; i < numRewound; i += 4) {
+			const __m128 pax = _mm_loadu_ps(ax.data() + i);
+			const __m128 pay = _mm_loadu_ps(ay.data() + i);
+			const __m128 paz = _mm_loadu_ps(az.data() + i);
+			const __m128 r = _mm_loadu_ps(radii.data() + i);
+			const __m128 rr = _mm_mul_ps(r, r);
+
+			const __m128 bax = _mm_sub_ps(_mm_loadu_ps(bx.data() + i), pax);
+			const __m128 bay = _mm_sub_ps(_mm_loadu_ps(by.data() + i), pay);
+			const __m128 baz = _mm_sub_ps(_mm_loadu_ps(bz.data() + i), paz);
+			const __m128 oax = _mm_sub_ps(ox, pax);
+			const __m128 oay = _mm_sub_ps(oy, pay);
+			const __m128 oaz = _mm_sub_ps(oz, paz);
+
+			const __m128 baba = Dot(bax, bay, baz, bax, bay, baz);
+			const __m128 bard = Dot(bax, bay, baz, dx, dy, dz);
+			const __m128 baoa = Dot(bax, bay, baz, oax, oay, oaz);
+			const __m128 rdoa = Dot(dx, dy, dz, oax, oay, oaz);
+			const __m128 oaoa = Dot(oax, oay, oaz, oax, oay, oaz);
+
+			// infinite cylinder around the segment, accepted only between the two ends
+			const __m128 a = _mm_sub_ps(baba, _mm_mul_ps(bard, bard));
+			const __m128 b = _mm_sub_ps(_mm_mul_ps(baba, rdoa), _mm_mul_ps(baoa, bard));
+			const __m128 c = _mm_sub_ps(_mm_sub_ps(_mm_mul_ps(baba, oaoa), _mm_mul_ps(baoa, baoa)), _mm_mul_ps(rr, baba));
+			const __m128 h = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(a, c));
+			const __m128 safeA = _mm_max_ps(a, _mm_set1_ps(PARALLEL_EPSILON));
+			const __m128 tBody = _mm_div_ps(_mm_sub_ps(_mm_sub_ps(zero, b), _mm_sqrt_ps(_mm_max_ps(h, zero))), safeA);
+			const __m128 y = _mm_add_ps(baoa, _mm_mul_ps(tBody, bard));
+			const __m128 bodyValid = _mm_and_ps(
+				_mm_and_ps(_mm_cmpge_ps(h, zero), _mm_cmpgt_ps(a, _mm_set1_ps(PARALLEL_EPSILON))),
+				_mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(y, zero), _mm_cmplt_ps(y, baba)), _mm_and_ps(_mm_cmpge_ps(tBody, zero), _mm_cmpgt_ps(c, zero))));
+			const __m128 body = _mm_or_ps(_mm_and_ps(bodyValid, tBody), _mm_andnot_ps(bodyValid, inf));
+
+			const __m128 capA = RaySpheres(oax, oay, oaz, dx, dy, dz, rr);
+			const __m128 capB = RaySpheres(_mm_sub_ps(oax, bax), _mm_sub_ps(oay, bay), _mm_sub_ps(oaz, baz), dx, dy, dz, rr);
+
+			// distance of the origin from the segment, a ray starting inside leaves the capsule without hitting it
+			const __m128 proj = _mm_min_ps(_mm_max_ps(_mm_div_ps(baoa, _mm_max_ps(baba, _mm_set1_ps(PARALLEL_EPSILON))), zero), _mm_set1_ps(1.0f));
+			const __m128 px = _mm_sub_ps(oax, _mm_mul_ps(bax, proj));
+			const __m128 py = _mm_sub_ps(oay, _mm_mul_ps(bay, proj));
+			const __m128 pz = _mm_sub_ps(oaz, _mm_mul_ps(baz, proj));
+			const __m128 outside = _mm_cmpgt_ps(Dot(px, py, pz, px, py, pz), rr);
+
+			// the padding has zero radius
+			const __m128 t = _mm_min_ps(body, _mm_min_ps(capA, capB));
+			const __m128 own = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(owners.data() + i)), ignored));
+			const __m128 lanes = _mm_andnot_ps(own, _mm_and_ps(_mm_cmpgt_ps(r, zero), outside));
+			_mm_store_ps(distances, _mm_or_ps(_mm_and_ps(lanes, t), _mm_andnot_ps(lanes, inf)));
+
+			for(uint32_t j = 0; j < 4; j++) {
+				if(distances[j] <= nearest) {
+					nearest = distances[j];
+					result.ownerId = owners[i + j];
+					result.distance = distances[j];
+				}
+			}
+		}
+
+		return result;
+	}
+
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "HistoryBuffer.h"
+
+namespace Netcode::Network {
+
+	/**
+	 * Vertical capsule of a player, positioned relative to the foot position
+	 */
+	struct HitboxShape {
+		float radius;
+		// half of the distance between the centers of the two spheres
+		float halfHeight;
+		// height of the capsule's center above the foot position
+		float centerHeight;
+
+		HitboxShape() : radius{ 0.0f }, halfHeight{ 0.0f }, centerHeight{ 0.0f } { }
+		HitboxShape(float radius, float halfHeight, float centerHeight) : radius{ radius }, halfHeight{ halfHeight }, centerHeight{ centerHeight } { }
+	};
+
+	struct HitboxHit {
+		// -1 if nothing was hit
+		int32_t ownerId;
+		float distance;
+
+		HitboxHit() : ownerId{ -1 }, distance{ 0.0f } { }
+	};
+
+	/**
+	 * Server side lag compensation without the physics scene: keeps a short history of every player's
+	 * hitbox and answers ray queries against the hitboxes as they were at a past time.
+	 * Rewind reconstructs every hitbox once into a structure of arrays, Raycast tests 4 capsules at a time with SSE.
+	 * Shots rewound to the same time share a single Rewind, each of them ignoring its own shooter.
+	 */
+	class LagCompensation {
+		constexpr static uint32_t FLAG_HITTABLE = 1;
+
+		struct Track {
+			int32_t ownerId;
+			HitboxShape shape;
+			HistoryBuffer history;
+		};
+
+		std::vector<Track> tracks;
+		Duration historyDuration;
+
+		// rewound capsules: segment endpoints and radius, padded to a multiple of 4 with zero radius
+		std::vector<float> ax, ay, az;
+		std::vector<float> bx, by, bz;
+		std::vector<float> radii;
+		std::vector<int32_t> owners;
+		uint32_t numRewound;
+
+		Track * FindTrack(int32_t ownerId);
+
+	public:
+		/**
+		 * @param duration how far back the hitboxes can be rewound
+		 */
+		LagCompensation(Duration duration);
+
+		void AddPlayer(int32_t ownerId, const HitboxShape & shape);
+
+		void RemovePlayer(int32_t ownerId);
+
+		/**
+		 * Appends a sample to the player's history, timestamps must not decrease
+		 */
+		void Record(int32_t ownerId, Timestamp timestamp, const Float3 & footPosition, bool hittable);
+
+		/**
+		 * Reconstructs the hitboxes at the given time by interpolating between the samples around it.
+		 * A player is left out if it has no samples on both sides or was not hittable in either of them.
+		 * @return the number of reconstructed hitboxes
+		 */
+		uint32_t Rewind(Timestamp timestamp);
+
+		/**
+		 * Nearest hit among the hitboxes of the last Rewind, rays starting inside a hitbox do not hit it
+		 * @param direction unit vector
+		 * @param ignoredOwnerId the hitbox of this player is not tested, usually the shooter
+		 */
+		HitboxHit Raycast(const Float3 & origin, const Float3 & direction, float maxDistance, int32_t ignoredOwnerId = -1) const;
+
+		uint32_t GetNumRewound() const {
+			return numRewound;
+		}
+	};
+
+}
@@ -0,0 +1,179 @@
+#include "MockDatabase.h"
+#include <algorithm>
+#include <thread>
+
+namespace Netcode::Network {
+
+	class MockDatabase::Connection : public DatabaseConnection {
+		Ref<MockDatabase> db;
+		// the sessions opened before the database went offline are lost
+		uint64_t generation;
+
+		bool IsLost() const {
+			std::unique_lock<std::mutex> lock{ db->mutex };
+			return !db->isOnline || generation != db->generation;
+		}
+
+	public:
+		Connection(Ref<MockDatabase> database) : db{ std::move(database) }, generation{ 0 } { }
+
+		ErrorCode Connect() override {
+			db->SimulateLatency();
+
+			std::unique_lock<std::mutex> lock{ db->mutex };
+
+			if(!db->isOnline) {
+				return Errc::make_error_code(Errc::host_unreachable);
+			}
+
+			generation = db->generation;
+			return Errc::make_error_code(Errc::success);
+		}
+
+		bool IsAlive() override {
+			return !IsLost();
+		}
+
+		QueryUserResult QueryUserByHash(const std::string & hash) override {
+			db->SimulateLatency();
+
+			QueryUserResult result;
+
+			if(IsLost()) {
+				result.errorCode = Errc::make_error_code(Errc::host_unreachable);
+				return result;
+			}
+
+			std::unique_lock<std::mutex> lock{ db->mutex };
+
+			auto it = db->usersByHash.find(hash);
+
+			if(it == db->usersByHash.end()) {
+				if(!db->acceptsUnknownHashes) {
+					result.errorCode = Errc::make_error_code(Errc::result_out_of_range);
+					return result;
+				}
+
+				const int userId = db->nextUserId++;
+				it = db->usersByHash.emplace(hash, PlayerDbDataRow{ userId, "mock_" + std::to_string(userId), hash, false }).first;
+			}
+
+			result.playerData = it->second;
+			result.errorCode = Errc::make_error_code(Errc::success);
+			return result;
+		}
+
+		ErrorCode RegisterServer(int ownerId, uint8_t playerSlots, uint32_t tickIntervalMs, const std::string & serverIp, uint16_t controlPort, uint16_t gamePort, uint64_t & serverId) override {
+			db->SimulateLatency();
+
+			if(IsLost()) {
+				return Errc::make_error_code(Errc::host_unreachable);
+			}
+
+			std::unique_lock<std::mutex> lock{ db->mutex };
+			serverId = db->nextServerId++;
+			db->gameServers.emplace(serverId, GameServerRow{ ownerId, playerSlots, false });
+			return Errc::make_error_code(Errc::success);
+		}
+
+		ErrorCode CloseServer(uint64_t serverId) override {
+			db->SimulateLatency();
+
+			if(IsLost()) {
+				return Errc::make_error_code(Errc::host_unreachable);
+			}
+
+			std::unique_lock<std::mutex> lock{ db->mutex };
+
+			auto it = db->gameServers.find(serverId);
+
+			if(it == db->gameServers.end() || it->second.isClosed) {
+				return Errc::make_error_code(Errc::result_out_of_range);
+			}
+
+			it->second.isClosed = true;
+
+			for(auto sessionIt = db->openGameSessions.begin(); sessionIt != db->openGameSessions.end();) {
+				if(sessionIt->first == serverId) {
+					sessionIt = db->openGameSessions.erase(sessionIt);
+				} else {
+					++sessionIt;
+				}
+			}
+
+			return Errc::make_error_code(Errc::success);
+		}
+
+		ErrorCode WriteGameSessions(uint64_t serverId, const GameSessionWrite * writes, size_t numWrites) override {
+			if(serverId == 0) {
+				return Errc::make_error_code(Errc::invalid_argument);
+			}
+
+			db->SimulateLatency();
+
+			if(IsLost()) {
+				return Errc::make_error_code(Errc::host_unreachable);
+			}
+
+			std::unique_lock<std::mutex> lock{ db->mutex };
+
+			for(size_t i = 0; i < numWrites; i++) {
+				if(writes[i].kind == GameSessionWrite::Kind::CREATE) {
+					db->openGameSessions.emplace(serverId, writes[i].playerId);
+				} else {
+					db->openGameSessions.erase(std::make_pair(serverId, writes[i].playerId));
+				}
+			}
+
+			return Errc::make_error_code(Errc::success);
+		}
+	};
+
+	MockDatabase::MockDatabase(Duration latency, bool acceptsUnknownHashes) :
+		mutex{},
+		usersByHash{},
+		gameServers{},
+		openGameSessions{},
+		nextServerId{ 1 },
+		nextUserId{ 1 },
+		generation{ 1 },
+		latency{ latency },
+		acceptsUnknownHashes{ acceptsUnknownHashes },
+		isOnline{ true } {
+
+	}
+
+	void MockDatabase::SimulateLatency() const {
+		if(latency > Duration::zero()) {
+			std::this_thread::sleep_for(latency);
+		}
+	}
+
+	void MockDatabase::AddUser(int id, std::string name, std::string hash, bool isBanned) {
+		std::unique_lock<std::mutex> lock{ mutex };
+		nextUserId = std::max(nextUserId, id + 1);
+		usersByHash[hash] = PlayerDbDataRow{ id, std::move(name), hash, isBanned };
+	}
+
+	void MockDatabase::SetOnline(bool online) {
+		std::unique_lock<std::mutex> lock{ mutex };
+
+		if(isOnline && !online) {
+			generation++;
+		}
+
+		isOnline = online;
+	}
+
+	size_t MockDatabase::GetOpenGameSessionCount() const {
+		std::unique_lock<std::mutex> lock{ mutex };
+		return openGameSessions.size();
+	}
+
+	DatabaseConnectionFactory MockDatabase::GetConnectionFactory() {
+		return [lt = shared_from_this()]() -> std::unique_ptr<DatabaseConnection> {
+			return std::make_unique<Connection>(lt);
+		};
+	}
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <set>
+
+#include "MysqlSession.h"
+
+namespace Netcode::Network {
+
+	/**
+	 * In-memory stand-in for the game database, every connection created by the factory shares this state.
+	 * Useful to load test the session pool and the login flow without a database server.
+	 */
+	class MockDatabase : public std::enable_shared_from_this<MockDatabase> {
+		class Connection;
+
+		struct GameServerRow {
+			int ownerId;
+			uint8_t playerSlots;
+			bool isClosed;
+		};
+
+		mutable std::mutex mutex;
+		std::map<std::string, PlayerDbDataRow> usersByHash;
+		std::map<uint64_t, GameServerRow> gameServers;
+		std::set<std::pair<uint64_t, int>> openGameSessions;
+		uint64_t nextServerId;
+		int nextUserId;
+		// incremented on every outage, invalidates the sessions opened before it
+		uint64_t generation;
+		// simulated round trip of every statement
+		Duration latency;
+		// unknown hashes resolve to a freshly created user instead of failing
+		bool acceptsUnknownHashes;
+		bool isOnline;
+
+		void SimulateLatency() const;
+
+	public:
+		MockDatabase(Duration latency, bool acceptsUnknownHashes);
+
+		void AddUser(int id, std::string name, std::string hash, bool isBanned);
+
+		/**
+		 * Simulates an outage: while offline every connect fails, the sessions open before it stay lost afterwards
+		 */
+		void SetOnline(bool online);
+
+		size_t GetOpenGameSessionCount() const;
+
+		DatabaseConnectionFactory GetConnectionFactory();
+	};
+
+}
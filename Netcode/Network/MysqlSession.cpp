@@ -1,16 +1,19 @@
 #include "MysqlSession.h"
+#include "MockDatabase.h"
 #include <Netcode/Config.h>
 #include <Netcode/Logger.h>
 #include <Netcode/Utility.h>
 #include <mysqlx/xdevapi.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
 
 namespace Netcode::Network {
 
-	struct MysqlSession::detail {
-		boost::asio::io_context & ioContext;
-		boost::asio::strand<boost::asio::io_context::executor_type> strand;
-		uint64_t serverId;
+	class MysqlConnection : public DatabaseConnection {
 		std::unique_ptr<mysqlx::Session> session;
 		std::unique_ptr<mysqlx::SqlStatement> queryUserByHash;
 		std::unique_ptr<mysqlx::SqlStatement> insertServer;
@@ -19,25 +22,154 @@ namespace Netcode::Network {
 		std::unique_ptr<mysqlx::SqlStatement> modifyGameSession;
 		std::unique_ptr<mysqlx::SqlStatement> closeRemainingGameSessions;
 		std::unique_ptr<mysqlx::SqlStatement> debugCleanup;
+		// set by a failed statement, the session is probed before it is trusted again
+		bool isSuspect;
 
-		detail(boost::asio::io_context & ioc) :
-			ioContext{ ioc },
-			strand{ boost::asio::make_strand(ioc) },
-			serverId{} {
-			
+		ErrorCode InsertGameSessions(uint64_t serverId, const GameSessionWrite * writes, size_t numWrites) {
+			uint64_t affectedRows = 0;
+
+			if(numWrites == 1) {
+				// (user_id, game_server_id)
+				insertGameSession->bind(writes[0].playerId, serverId);
+				affectedRows = insertGameSession->execute().getAffectedItemsCount();
+			} else {
+				std::string query = "INSERT INTO `game_sessions` (`user_id`, `game_server_id`, `joined_at`) VALUES (?, ?, NOW(6))";
+
+				for(size_t i = 1; i < numWrites; i++) {
+					query += ", (?, ?, NOW(6))";
+				}
+
+				mysqlx::SqlStatement statement = session->sql(query);
+
+				for(size_t i = 0; i < numWrites; i++) {
+					statement.bind(writes[i].playerId, serverId);
+				}
+
+				affectedRows = statement.execute().getAffectedItemsCount();
+			}
+
+			if(affectedRows != numWrites) {
+				return Errc::make_error_code(Errc::result_out_of_range);
+			}
+
+			return Errc::make_error_code(Errc::success);
 		}
 
-		CompletionToken<QueryUserResult> QueryUserByHash(std::string hash) {
-			CompletionToken<QueryUserResult> token = std::make_shared<CompletionTokenType<QueryUserResult>>(&ioContext);
+		ErrorCode CloseGameSessions(uint64_t serverId, const GameSessionWrite * writes, size_t numWrites) {
+			uint64_t affectedRows = 0;
 
-			boost::asio::post(strand, [this, h = std::move(hash), token]() mutable {
-				token->Set(QueryUserByHashUnsafe(std::move(h)));
-			});
+			if(numWrites == 1) {
+				modifyGameSession->bind(writes[0].playerId, serverId);
+				affectedRows = modifyGameSession->execute().getAffectedItemsCount();
+			} else {
+				std::string query = "UPDATE `game_sessions` SET `left_at` = NOW(6) WHERE `left_at` = 0 AND `game_server_id` = ? AND `user_id` IN (?";
 
-			return token;
+				for(size_t i = 1; i < numWrites; i++) {
+					query += ", ?";
+				}
+
+				query += ")";
+
+				mysqlx::SqlStatement statement = session->sql(query);
+				statement.bind(serverId);
+
+				for(size_t i = 0; i < numWrites; i++) {
+					statement.bind(writes[i].playerId);
+				}
+
+				affectedRows = statement.execute().getAffectedItemsCount();
+			}
+
+			// a missing row must not roll back the rest of the batch
+			if(affectedRows != numWrites) {
+				Log::Warn("[MySQL] CloseGameSession: some of the game sessions were already closed");
+			}
+
+			return Errc::make_error_code(Errc::success);
+		}
+
+	public:
+		MysqlConnection() : isSuspect{ true } { }
+
+		ErrorCode Connect() override {
+			isSuspect = true;
+
+			try {
+				mysqlx::SessionSettings settings(
+					mysqlx::SessionOption::USER, Config::Get<std::wstring>(L"network.database.username:string"),
+					mysqlx::SessionOption::PWD, Config::Get<std::wstring>(L"network.database.password:string"),
+					mysqlx::SessionOption::HOST, Config::Get<std::wstring>(L"network.database.hostname:string"),
+					mysqlx::SessionOption::PORT, Config::Get<uint16_t>(L"network.database.port:u16"),
+					mysqlx::SessionOption::DB, Config::Get<std::wstring>(L"network.database.schema:string"),
+					mysqlx::SessionOption::CONNECT_TIMEOUT, std::chrono::seconds(Config::Get<uint32_t>(L"network.database.timeout:u32"))
+				);
+
+				/*
+				 * select users.id, users.name, game_servers.owner_id, SUM(IF(game_servers.closed_at is null and owner_id is not null, 1, 0))
+				 * as test from users inner join sessions on users.id = sessions.user_id left join game_servers on users.id = game_servers.owner_id
+				 * group by users.id
+				 */
+
+				session = std::make_unique<mysqlx::Session>(settings);
+
+				insertServer = std::make_unique<mysqlx::SqlStatement>(
+					session->sql("INSERT INTO game_servers (`owner_id`, `max_players`, `interval`, `status`, `server_ip`, `control_port`, `game_port`, `created_at`, `version_major`, `version_minor`, `version_build`) "
+						"VALUES (?, ?, ?, ?, ?, ?, ?, NOW(6), ?, ?, ?)"));
+
+				modifyServer = std::make_unique<mysqlx::SqlStatement>(
+					session->sql("UPDATE `game_servers` SET `status` = ?, `closed_at` = NOW(6) WHERE `id` = ? LIMIT 1"));
+
+				insertGameSession = std::make_unique<mysqlx::SqlStatement>(
+					session->sql("INSERT INTO `game_sessions` (`user_id`, `game_server_id`, `joined_at`) "
+						"VALUES (?, ?, NOW(6))"));
+
+				modifyGameSession = std::make_unique<mysqlx::SqlStatement>(
+					session->sql("UPDATE `game_sessions` SET `left_at` = NOW(6) WHERE `user_id` = ? AND `left_at` = 0 AND `game_server_id` = ?"));
+
+				queryUserByHash = std::make_unique<mysqlx::SqlStatement>(
+					session->sql("SELECT `users`.`id`, `users`.`name`, `users`.`is_banned`, `sessions`.`hash` "
+						"FROM `users` "
+						"INNER JOIN `sessions` ON `sessions`.`user_id` = `users`.`id` "
+						"WHERE `sessions`.`hash` = ? AND `sessions`.`expires_at` > NOW(6)"));
+
+				closeRemainingGameSessions = std::make_unique<mysqlx::SqlStatement>(
+					session->sql("UPDATE `game_sessions` SET `game_sessions`.`left_at` = NOW(6) WHERE `game_sessions`.`left_at` = 0 AND `game_sessions`.`game_server_id` = ?"));
+
+#if defined (NETCODE_DEBUG)
+				debugCleanup = std::make_unique<mysqlx::SqlStatement>(
+					session->sql("UPDATE `game_sessions` SET `game_sessions`.`left_at` = NOW(6) WHERE `game_sessions`.`left_at` = 0"));
+#endif
+
+			} catch(mysqlx::Error & error) {
+				Log::Error("[MySQL] exception: {0}", error.what());
+				return Errc::make_error_code(Errc::host_unreachable);
+			}
+			isSuspect = false;
+			return Errc::make_error_code(Errc::success);
 		}
-		
-		QueryUserResult QueryUserByHashUnsafe(std::string hash) {
+
+		bool IsAlive() override {
+			if(session == nullptr) {
+				return false;
+			}
+
+			if(!isSuspect) {
+				return true;
+			}
+
+			// a failed statement does not mean a lost session, only a failed round trip does
+			try {
+				session->sql("SELECT 1").execute();
+			} catch(mysqlx::Error & error) {
+				Log::Warn("[MySQL] lost the session: {0}", error.what());
+				return false;
+			}
+
+			isSuspect = false;
+			return true;
+		}
+
+		QueryUserResult QueryUserByHash(const std::string & hash) override {
 			QueryUserResult result;
 			try {
 				queryUserByHash->bind(hash);
@@ -58,6 +190,7 @@ namespace Netcode::Network {
 				result.playerData = std::tie(userId, name, hash, isBanned);
 			} catch(mysqlx::Error & error) {
 				Log::Error("[MySQL] QueryUserByHash exception: {0}", error.what());
+				isSuspect = true;
 				result.errorCode = Errc::make_error_code(Errc::host_unreachable);
 				return result;
 			}
@@ -65,17 +198,7 @@ namespace Netcode::Network {
 			return result;
 		}
 
-		CompletionToken<ErrorCode> CloseServer() {
-			CompletionToken<ErrorCode> token = std::make_shared<CompletionTokenType<ErrorCode>>(&ioContext);
-
-			boost::asio::post(strand, [this, token]() mutable {
-				token->Set(CloseServerUnsafe());
-			});
-
-			return token;
-		}
-		
-		ErrorCode CloseServerUnsafe() {
+		ErrorCode CloseServer(uint64_t serverId) override {
 			if(serverId == 0) {
 				return Errc::make_error_code(Errc::invalid_argument);
 			}
@@ -92,52 +215,60 @@ namespace Netcode::Network {
 				}
 			} catch(mysqlx::Error & error) {
 				Log::Error("[MySQL] CloseServer exception: {0}", error.what());
+				isSuspect = true;
 				return Errc::make_error_code(Errc::invalid_argument);
 			}
 			return Errc::make_error_code(Errc::success);
 		}
-		
-		ErrorCode CreateGameSessionUnsafe(int playerId) {
+
+		ErrorCode WriteGameSessions(uint64_t serverId, const GameSessionWrite * writes, size_t numWrites) override {
 			if(serverId == 0) {
 				return Errc::make_error_code(Errc::invalid_argument);
 			}
 
+			ErrorCode ec;
+
 			try {
-				// (user_id, game_server_id)
-				insertGameSession->bind(playerId, serverId);
-				mysqlx::SqlResult result = insertGameSession->execute();
+				session->startTransaction();
 
-				if(result.getAffectedItemsCount() != 1) {
-					return Errc::make_error_code(Errc::result_out_of_range);
-				}
-			} catch(mysqlx::Error & error) {
-				Log::Error("[MySQL] CreateGameSession exception: {0}", error.what());
-				return Errc::make_error_code(Errc::invalid_argument);
-			}
-			return Errc::make_error_code(Errc::success);
-		}
-		ErrorCode CloseGameSessionUnsafe(int playerId) {
-			if(serverId == 0) {
-				return Errc::make_error_code(Errc::invalid_argument);
-			}
+				// consecutive writes of the same kind become a single statement, order is kept between the runs
+				for(size_t runBegin = 0; runBegin < numWrites && !ec;) {
+					size_t runEnd = runBegin + 1;
 
-			try {
-				modifyGameSession->bind(playerId, serverId);
-				mysqlx::SqlResult result = modifyGameSession->execute();
+					while(runEnd < numWrites && writes[runEnd].kind == writes[runBegin].kind) {
+						runEnd++;
+					}
 
-				if(result.getAffectedItemsCount() != 1) {
-					return Errc::make_error_code(Errc::result_out_of_range);
+					if(writes[runBegin].kind == GameSessionWrite::Kind::CREATE) {
+						ec = InsertGameSessions(serverId, writes + runBegin, runEnd - runBegin);
+					} else {
+						ec = CloseGameSessions(serverId, writes + runBegin, runEnd - runBegin);
+					}
+
+					runBegin = runEnd;
 				}
+
+				if(ec) {
+					session->rollback();
+					return ec;
+				}
+
+				session->commit();
 			} catch(mysqlx::Error & error) {
-				Log::Error("[MySQL] CloseGameSession exception: {0}", error.what());
+				Log::Error("[MySQL] WriteGameSessions exception: {0}", error.what());
+				isSuspect = true;
+
+				try {
+					session->rollback();
+				} catch(mysqlx::Error &) { }
+
 				return Errc::make_error_code(Errc::invalid_argument);
 			}
 			return Errc::make_error_code(Errc::success);
 		}
 
-		ErrorCode RegisterServerUnsafe(int ownerId, uint8_t playerSlots, uint32_t tickIntervalMs, std::string serverIp, uint16_t controlPort, uint16_t gamePort)
+		ErrorCode RegisterServer(int ownerId, uint8_t playerSlots, uint32_t tickIntervalMs, const std::string & serverIp, uint16_t controlPort, uint16_t gamePort, uint64_t & serverId) override
 		{
-
 			try {
 				// (owner_id, max_players, interval, status, server_ip, control_port, game_port, major, minor, build)
 				insertServer->bind(ownerId,
@@ -159,73 +290,481 @@ namespace Netcode::Network {
 #if defined(NETCODE_DEBUG)
 				debugCleanup->execute();
 #endif
-				
+
 			} catch(mysqlx::Error & error) {
 				Log::Error("[MySQL] RegisterServer exception: {0}", error.what());
+				isSuspect = true;
 				return Errc::make_error_code(Errc::invalid_argument);
 			}
 			return Errc::make_error_code(Errc::success);
 		}
+	};
 
-		ErrorCode ConnectUnsafe()
-		{
-			try {
-				mysqlx::SessionSettings settings(
-					mysqlx::SessionOption::USER, Config::Get<std::wstring>(L"network.database.username:string"),
-					mysqlx::SessionOption::PWD, Config::Get<std::wstring>(L"network.database.password:string"),
-					mysqlx::SessionOption::HOST, Config::Get<std::wstring>(L"network.database.hostname:string"),
-					mysqlx::SessionOption::PORT, Config::Get<uint16_t>(L"network.database.port:u16"),
-					mysqlx::SessionOption::DB, Config::Get<std::wstring>(L"network.database.schema:string"),
-					mysqlx::SessionOption::CONNECT_TIMEOUT, std::chrono::seconds(Config::Get<uint32_t>(L"network.database.timeout:u32"))
-				);
+	std::unique_ptr<DatabaseConnection> CreateMysqlConnection() {
+		return std::make_unique<MysqlConnection>();
+	}
 
-				/*
-				 * select users.id, users.name, game_servers.owner_id, SUM(IF(game_servers.closed_at is null and owner_id is not null, 1, 0))
-				 * as test from users inner join sessions on users.id = sessions.user_id left join game_servers on users.id = game_servers.owner_id
-				 * group by users.id
-				 */
+	static const ErrorCode & GetResultErrorCode(const ErrorCode & ec) {
+		return ec;
+	}
 
-				session = std::make_unique<mysqlx::Session>(settings);
+	static const ErrorCode & GetResultErrorCode(const QueryUserResult & result) {
+		return result.errorCode;
+	}
 
-				insertServer = std::make_unique<mysqlx::SqlStatement>(
-					session->sql("INSERT INTO game_servers (`owner_id`, `max_players`, `interval`, `status`, `server_ip`, `control_port`, `game_port`, `created_at`, `version_major`, `version_minor`, `version_build`) "
-						"VALUES (?, ?, ?, ?, ?, ?, ?, NOW(6), ?, ?, ?)"));
+	struct MysqlSession::detail {
+		/*
+		 * A job is invoked with nullptr as connection if the pool can not serve it,
+		 * in that case it must complete its token with an error
+		 */
+		struct Job {
+			Timestamp enqueuedAt;
+			std::function<void(DatabaseConnection * connection, Duration queueDelay)> work;
+		};
+
+		struct PendingWrite {
+			GameSessionWrite write;
+			Timestamp enqueuedAt;
+			CompletionToken<ErrorCode> token;
+		};
 
-				modifyServer = std::make_unique<mysqlx::SqlStatement>(
-					session->sql("UPDATE `game_servers` SET `status` = ?, `closed_at` = NOW(6) WHERE `id` = ? LIMIT 1"));
+		boost::asio::io_context & ioContext;
+		DatabasePoolConfig config;
+		DatabaseConnectionFactory factory;
+		std::atomic<uint64_t> serverId;
+
+		mutable std::mutex mutex;
+		std::condition_variable jobAvailable;
+		// wakes the reconnecting workers on shutdown, kept apart from jobAvailable so they do not swallow job notifications
+		std::condition_variable stopRequested;
+		std::deque<Job> jobs;
+		std::vector<PendingWrite> pendingWrites;
+		std::vector<std::thread> workers;
+		CompletionToken<ErrorCode> connectToken;
+		ErrorCode lastConnectError;
+		uint32_t numPendingConnects;
+		uint32_t numLiveWorkers;
+		bool isWriteInFlight;
+		bool isConnectFinished;
+		bool isStopping;
+
+		mutable std::mutex statsMutex;
+		DatabaseStats stats;
+		UserCache userCache;
+
+		detail(boost::asio::io_context & ioc, const DatabasePoolConfig & cfg, DatabaseConnectionFactory connectionFactory) :
+			ioContext{ ioc },
+			config{ cfg },
+			factory{ std::move(connectionFactory) },
+			serverId{ 0 },
+			numPendingConnects{ 0 },
+			numLiveWorkers{ 0 },
+			isWriteInFlight{ false },
+			isConnectFinished{ false },
+			isStopping{ false },
+			userCache{ cfg.userCache } {
+			config.poolSize = std::max(config.poolSize, 1u);
+			config.maxBatchSize = std::max(config.maxBatchSize, 1u);
+		}
 
-				insertGameSession = std::make_unique<mysqlx::SqlStatement>(
-					session->sql("INSERT INTO `game_sessions` (`user_id`, `game_server_id`, `joined_at`) "
-						"VALUES (?, ?, NOW(6))"));
+		~detail() {
+			{
+				std::unique_lock<std::mutex> lock{ mutex };
+				isStopping = true;
+			}
 
-				modifyGameSession = std::make_unique<mysqlx::SqlStatement>(
-					session->sql("UPDATE `game_sessions` SET `left_at` = NOW(6) WHERE `user_id` = ? AND `left_at` = 0 AND `game_server_id` = ?"));
+			jobAvailable.notify_all();
+			stopRequested.notify_all();
 
-				queryUserByHash = std::make_unique<mysqlx::SqlStatement>(
-					session->sql("SELECT `users`.`id`, `users`.`name`, `users`.`is_banned`, `sessions`.`hash` "
-						"FROM `users` "
-						"INNER JOIN `sessions` ON `sessions`.`user_id` = `users`.`id` "
-						"WHERE `sessions`.`hash` = ? AND `sessions`.`expires_at` > NOW(6)"));
+			for(std::thread & worker : workers) {
+				worker.join();
+			}
 
-				closeRemainingGameSessions = std::make_unique<mysqlx::SqlStatement>(
-					session->sql("UPDATE `game_sessions` SET `game_sessions`.`left_at` = NOW(6) WHERE `game_sessions`.`left_at` = 0 AND `game_sessions`.`game_server_id` = ?"));
+			CancelJobs(std::move(jobs));
+		}
 
-#if defined (NETCODE_DEBUG)
-				debugCleanup = std::make_unique<mysqlx::SqlStatement>(
-					session->sql("UPDATE `game_sessions` SET `game_sessions`.`left_at` = NOW(6) WHERE `game_sessions`.`left_at` = 0"));
-#endif
+		template<typename T>
+		CompletionToken<T> MakeToken() {
+			return std::make_shared<CompletionTokenType<T>>(&ioContext);
+		}
 
-			} catch(mysqlx::Error & error) {
-				Log::Error("[MySQL] exception: {0}", error.what());
-				return Errc::make_error_code(Errc::host_unreachable);
+		void Record(DatabaseStatement statement, Duration queueDelay, Duration latency, uint64_t rows, bool isFailed) {
+			std::unique_lock<std::mutex> lock{ statsMutex };
+			DatabaseStatementStats & s = stats[static_cast<size_t>(statement)];
+			s.executions++;
+			s.rows += rows;
+			s.errors += isFailed ? 1 : 0;
+			s.totalQueueDelay += queueDelay;
+			s.totalLatency += latency;
+			s.maxLatency = std::max(s.maxLatency, latency);
+		}
+
+		template<typename Functor>
+		auto Measure(DatabaseStatement statement, Duration queueDelay, uint64_t rows, Functor && f) -> decltype(f()) {
+			const Timestamp begin = ClockType::now();
+			auto result = f();
+			Record(statement, queueDelay, ClockType::now() - begin, rows, static_cast<bool>(GetResultErrorCode(result)));
+			return result;
+		}
+
+		static void CancelJobs(std::deque<Job> cancelled) {
+			for(Job & job : cancelled) {
+				job.work(nullptr, Duration{});
 			}
-			return Errc::make_error_code(Errc::success);
+		}
+
+		void Enqueue(Job job) {
+			{
+				std::unique_lock<std::mutex> lock{ mutex };
+
+				if(!isStopping && (!isConnectFinished || numLiveWorkers > 0)) {
+					jobs.emplace_back(std::move(job));
+					jobAvailable.notify_one();
+					return;
+				}
+			}
+
+			job.work(nullptr, Duration{});
+		}
+
+		void OnWorkerConnected(ErrorCode ec) {
+			CompletionToken<ErrorCode> token;
+			std::deque<Job> cancelled;
+			ErrorCode result;
+
+			{
+				std::unique_lock<std::mutex> lock{ mutex };
+
+				if(ec) {
+					lastConnectError = ec;
+				} else {
+					numLiveWorkers++;
+				}
+
+				if(--numPendingConnects > 0) {
+					return;
+				}
+
+				isConnectFinished = true;
+				token = std::move(connectToken);
+
+				if(numLiveWorkers > 0) {
+					result = Errc::make_error_code(Errc::success);
+				} else {
+					result = lastConnectError;
+					std::swap(cancelled, jobs);
+				}
+			}
+
+			CancelJobs(std::move(cancelled));
+			token->Set(result);
+		}
+
+		void OnWorkerLost() {
+			std::deque<Job> cancelled;
+
+			{
+				std::unique_lock<std::mutex> lock{ mutex };
+				numLiveWorkers--;
+
+				// the queued jobs would wait for the reconnect, fail them instead like a pool without sessions does
+				if(numLiveWorkers == 0 && isConnectFinished) {
+					std::swap(cancelled, jobs);
+				}
+			}
+
+			Log::Warn("[MySQL] a pooled session was lost, reconnecting");
+			CancelJobs(std::move(cancelled));
+		}
+
+		ErrorCode ConnectWorker(DatabaseConnection * connection) {
+			const Timestamp begin = ClockType::now();
+			ErrorCode ec = connection->Connect();
+			Record(DatabaseStatement::CONNECT, Duration{}, ClockType::now() - begin, 1, static_cast<bool>(ec));
+			return ec;
+		}
+
+		/*
+		 * Retries the connect with an exponential backoff, false if the pool stopped meanwhile
+		 */
+		bool ReconnectWorker(DatabaseConnection * connection) {
+			Duration delay = config.reconnectDelay;
+
+			for(;;) {
+				{
+					std::unique_lock<std::mutex> lock{ mutex };
+
+					if(stopRequested.wait_for(lock, delay, [this]() -> bool { return isStopping; })) {
+						return false;
+					}
+				}
+
+				if(!ConnectWorker(connection)) {
+					std::unique_lock<std::mutex> lock{ mutex };
+					numLiveWorkers++;
+					return true;
+				}
+
+				delay = std::min(delay * 2, config.maxReconnectDelay);
+			}
+		}
+
+		void WorkerMain(std::unique_ptr<DatabaseConnection> connection) {
+			ErrorCode ec = ConnectWorker(connection.get());
+			OnWorkerConnected(ec);
+
+			bool isConnected = !ec;
+
+			for(;;) {
+				if(!isConnected) {
+					if(!ReconnectWorker(connection.get())) {
+						return;
+					}
+
+					isConnected = true;
+				}
+
+				Job job;
+
+				{
+					std::unique_lock<std::mutex> lock{ mutex };
+					jobAvailable.wait(lock, [this]() -> bool { return isStopping || !jobs.empty(); });
+
+					if(isStopping) {
+						return;
+					}
+
+					job = std::move(jobs.front());
+					jobs.pop_front();
+				}
+
+				job.work(connection.get(), ClockType::now() - job.enqueuedAt);
+
+				if(!connection->IsAlive()) {
+					OnWorkerLost();
+					isConnected = false;
+				}
+			}
+		}
+
+		uint32_t GetLiveConnectionCount() const {
+			std::unique_lock<std::mutex> lock{ mutex };
+			return numLiveWorkers;
+		}
+
+		CompletionToken<ErrorCode> Connect() {
+			CompletionToken<ErrorCode> token = MakeToken<ErrorCode>();
+
+			{
+				std::unique_lock<std::mutex> lock{ mutex };
+
+				if(connectToken != nullptr || isConnectFinished || isStopping) {
+					lock.unlock();
+					token->Set(Errc::make_error_code(Errc::already_connected));
+					return token;
+				}
+
+				connectToken = token;
+				numPendingConnects = config.poolSize;
+			}
+
+			for(uint32_t i = 0; i < config.poolSize; i++) {
+				workers.emplace_back(&detail::WorkerMain, this, factory());
+			}
+
+			return token;
+		}
+
+		CompletionToken<QueryUserResult> QueryUserByHash(std::string hash) {
+			CompletionToken<QueryUserResult> token = MakeToken<QueryUserResult>();
+
+			if(userCache.Lookup(hash, token) != UserCacheLookup::MISS) {
+				return token;
+			}
+
+			// the token is registered as a waiter in the cache, completing the hash completes the token too
+			Enqueue(Job{ ClockType::now(), [this, h = std::move(hash)](DatabaseConnection * connection, Duration queueDelay) -> void {
+				if(connection == nullptr) {
+					QueryUserResult result;
+					result.errorCode = Errc::make_error_code(Errc::host_unreachable);
+					userCache.Complete(h, result);
+					return;
+				}
+
+				userCache.Complete(h, Measure(DatabaseStatement::QUERY_USER_BY_HASH, queueDelay, 1, [connection, &h]() -> QueryUserResult {
+					return connection->QueryUserByHash(h);
+				}));
+			} });
+
+			return token;
+		}
+
+		CompletionToken<ErrorCode> CloseServer() {
+			CompletionToken<ErrorCode> token = MakeToken<ErrorCode>();
+
+			Enqueue(Job{ ClockType::now(), [this, token](DatabaseConnection * connection, Duration queueDelay) -> void {
+				if(connection == nullptr) {
+					token->Set(Errc::make_error_code(Errc::host_unreachable));
+					return;
+				}
+
+				token->Set(Measure(DatabaseStatement::CLOSE_SERVER, queueDelay, 1, [this, connection]() -> ErrorCode {
+					return connection->CloseServer(serverId.load());
+				}));
+			} });
+
+			return token;
+		}
+
+		CompletionToken<ErrorCode> RegisterServer(int ownerId, uint8_t playerSlots, uint32_t tickIntervalMs, std::string serverIp, uint16_t controlPort, uint16_t gamePort) {
+			CompletionToken<ErrorCode> token = MakeToken<ErrorCode>();
+
+			Enqueue(Job{ ClockType::now(), [=, ip = std::move(serverIp)](DatabaseConnection * connection, Duration queueDelay) -> void {
+				if(connection == nullptr) {
+					token->Set(Errc::make_error_code(Errc::host_unreachable));
+					return;
+				}
+
+				token->Set(Measure(DatabaseStatement::REGISTER_SERVER, queueDelay, 1, [&]() -> ErrorCode {
+					uint64_t id = 0;
+					ErrorCode ec = connection->RegisterServer(ownerId, playerSlots, tickIntervalMs, ip, controlPort, gamePort, id);
+
+					if(!ec) {
+						serverId.store(id);
+					}
+
+					return ec;
+				}));
+			} });
+
+			return token;
+		}
+
+		/*
+		 * Only a single batch is in flight at any time so writes of the same player can not overtake each other,
+		 * everything submitted meanwhile is coalesced into the next batch
+		 */
+		CompletionToken<ErrorCode> WriteGameSession(GameSessionWrite::Kind kind, int playerId) {
+			CompletionToken<ErrorCode> token = MakeToken<ErrorCode>();
+			bool needsFlush = false;
+
+			{
+				std::unique_lock<std::mutex> lock{ mutex };
+				pendingWrites.push_back(PendingWrite{ GameSessionWrite{ kind, playerId }, ClockType::now(), token });
+
+				if(!isWriteInFlight) {
+					isWriteInFlight = true;
+					needsFlush = true;
+				}
+			}
+
+			if(needsFlush) {
+				EnqueueFlush();
+			}
+
+			return token;
+		}
+
+		void EnqueueFlush() {
+			Enqueue(Job{ ClockType::now(), [this](DatabaseConnection * connection, Duration) -> void {
+				FlushWrites(connection);
+			} });
+		}
+
+		void FlushWrites(DatabaseConnection * connection) {
+			std::vector<PendingWrite> batch;
+
+			{
+				std::unique_lock<std::mutex> lock{ mutex };
+
+				const size_t batchSize = (connection != nullptr) ? std::min<size_t>(pendingWrites.size(), config.maxBatchSize) : pendingWrites.size();
+
+				batch.assign(std::make_move_iterator(pendingWrites.begin()), std::make_move_iterator(pendingWrites.begin() + batchSize));
+				pendingWrites.erase(pendingWrites.begin(), pendingWrites.begin() + batchSize);
+
+				if(connection == nullptr) {
+					isWriteInFlight = false;
+				}
+			}
+
+			if(connection == nullptr) {
+				for(PendingWrite & w : batch) {
+					w.token->Set(Errc::make_error_code(Errc::host_unreachable));
+				}
+				return;
+			}
+
+			std::vector<GameSessionWrite> writes;
+			writes.reserve(batch.size());
+
+			for(const PendingWrite & w : batch) {
+				writes.push_back(w.write);
+			}
+
+			const ErrorCode ec = Measure(DatabaseStatement::WRITE_GAME_SESSIONS, ClockType::now() - batch.front().enqueuedAt, writes.size(), [&]() -> ErrorCode {
+				return connection->WriteGameSessions(serverId.load(), writes.data(), writes.size());
+			});
+
+			for(PendingWrite & w : batch) {
+				w.token->Set(ec);
+			}
+
+			bool needsFlush = false;
+
+			{
+				std::unique_lock<std::mutex> lock{ mutex };
+
+				if(pendingWrites.empty()) {
+					isWriteInFlight = false;
+				} else {
+					needsFlush = true;
+				}
+			}
+
+			if(needsFlush) {
+				EnqueueFlush();
+			}
+		}
+
+		DatabaseStats GetStatistics() const {
+			std::unique_lock<std::mutex> lock{ statsMutex };
+			return stats;
 		}
 	};
 
-	MysqlSession::MysqlSession(boost::asio::io_context& ioc)
+	static DatabasePoolConfig LoadDatabasePoolConfig() {
+		DatabasePoolConfig config;
+		config.poolSize = Config::GetOptional<uint32_t>(L"network.database.poolSize:u32", config.poolSize);
+		config.maxBatchSize = Config::GetOptional<uint32_t>(L"network.database.maxBatchSize:u32", config.maxBatchSize);
+		config.reconnectDelay = std::chrono::milliseconds(Config::GetOptional<uint32_t>(L"network.database.reconnectDelayMs:u32", 250u));
+		config.maxReconnectDelay = std::chrono::milliseconds(Config::GetOptional<uint32_t>(L"network.database.maxReconnectDelayMs:u32", 8000u));
+		config.userCache.ttl = std::chrono::milliseconds(Config::GetOptional<uint32_t>(L"network.database.userCache.ttlMs:u32", 60000u));
+		config.userCache.negativeTtl = std::chrono::milliseconds(Config::GetOptional<uint32_t>(L"network.database.userCache.negativeTtlMs:u32", 5000u));
+		config.userCache.maxEntries = Config::GetOptional<uint32_t>(L"network.database.userCache.maxEntries:u32", config.userCache.maxEntries);
+		config.userCache.numShards = Config::GetOptional<uint32_t>(L"network.database.userCache.shards:u32", config.userCache.numShards);
+		return config;
+	}
+
+	static DatabaseConnectionFactory LoadDatabaseConnectionFactory() {
+		const std::wstring backend = Config::GetOptional<std::wstring>(L"network.database.backend:string", L"mysql");
+
+		if(backend == L"mock") {
+			const Duration latency = std::chrono::milliseconds(Config::GetOptional<uint32_t>(L"network.database.mockLatencyMs:u32", 0u));
+			Log::Info("[MySQL] using the in-memory mock backend");
+			return std::make_shared<MockDatabase>(latency, true)->GetConnectionFactory();
+		}
+
+		return &CreateMysqlConnection;
+	}
+
+	MysqlSession::MysqlSession(boost::asio::io_context& ioc) :
+		MysqlSession(ioc, LoadDatabasePoolConfig(), LoadDatabaseConnectionFactory()) {
+
+	}
+
+	MysqlSession::MysqlSession(boost::asio::io_context & ioc, const DatabasePoolConfig & config, DatabaseConnectionFactory factory)
 	{
-		impl = std::make_unique<detail>(ioc);
+		impl = std::make_unique<detail>(ioc, config, std::move(factory));
 	}
 
 	MysqlSession::~MysqlSession()
@@ -238,6 +777,16 @@ namespace Netcode::Network {
 		return impl->QueryUserByHash(std::move(hash));
 	}
 
+	void MysqlSession::InvalidateUser(const std::string & hash)
+	{
+		impl->userCache.Invalidate(hash);
+	}
+
+	void MysqlSession::InvalidateUsers()
+	{
+		impl->userCache.InvalidateAll();
+	}
+
 	CompletionToken<ErrorCode> MysqlSession::CloseServer()
 	{
 		return impl->CloseServer();
@@ -245,25 +794,36 @@ namespace Netcode::Network {
 
 	CompletionToken<ErrorCode> MysqlSession::CreateGameSession(int playerId)
 	{
-		//return impl->CreateGameSession(playerId);
-		return nullptr;
+		return impl->WriteGameSession(GameSessionWrite::Kind::CREATE, playerId);
 	}
 
 	CompletionToken<ErrorCode> MysqlSession::CloseGameSession(int playerId)
 	{
-		//return impl->CloseGameSession(playerId);
-		return nullptr;
+		return impl->WriteGameSession(GameSessionWrite::Kind::CLOSE, playerId);
 	}
-	
+
 	CompletionToken<ErrorCode> MysqlSession::RegisterServer(int ownerId, uint8_t playerSlots, uint32_t tickIntervalMs, const std::string & serverIp, uint16_t controlPort, uint16_t gamePort)
 	{
-		//return impl->RegisterServer(ownerId, playerSlots, tickIntervalMs, serverIp, controlPort, gamePort);
-		return nullptr;
+		return impl->RegisterServer(ownerId, playerSlots, tickIntervalMs, serverIp, controlPort, gamePort);
 	}
-	
+
 	CompletionToken<ErrorCode> MysqlSession::Connect()
 	{
-		//return impl->Connect();
-		return nullptr;
+		return impl->Connect();
+	}
+
+	DatabaseStats MysqlSession::GetStatistics() const
+	{
+		return impl->GetStatistics();
+	}
+
+	uint32_t MysqlSession::GetLiveConnectionCount() const
+	{
+		return impl->GetLiveConnectionCount();
+	}
+
+	UserCacheStats MysqlSession::GetUserCacheStatistics() const
+	{
+		return impl->userCache.GetStatistics();
 	}
 }
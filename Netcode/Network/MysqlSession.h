@@ -1,29 +1,130 @@
 #pragma once
 
+#include <array>
+#include <functional>
 #include <memory>
 
+#include <Netcode/System/TimeTypes.h>
+
 #include "NetworkCommon.h"
 #include "CompletionToken.h"
+#include "UserCache.h"
 
 namespace Netcode::Network {
 
-	struct QueryUserResult {
-		ErrorCode errorCode;
-		PlayerDbDataRow playerData;
+	enum class DatabaseStatement : uint32_t {
+		CONNECT,
+		QUERY_USER_BY_HASH,
+		REGISTER_SERVER,
+		CLOSE_SERVER,
+		WRITE_GAME_SESSIONS,
+		COUNT
+	};
+
+	struct DatabaseStatementStats {
+		// number of executions, a batched write counts as one
+		uint64_t executions;
+		// number of logical operations served, greater than executions for batched writes
+		uint64_t rows;
+		uint64_t errors;
+		// time spent waiting in the work queue
+		Duration totalQueueDelay;
+		// time spent executing the statement
+		Duration totalLatency;
+		Duration maxLatency;
+
+		DatabaseStatementStats() : executions{ 0 }, rows{ 0 }, errors{ 0 }, totalQueueDelay{}, totalLatency{}, maxLatency{} { }
+
+		Duration GetAverageLatency() const {
+			return (executions > 0) ? (totalLatency / static_cast<Duration::rep>(executions)) : Duration{};
+		}
 	};
 
+	using DatabaseStats = std::array<DatabaseStatementStats, static_cast<size_t>(DatabaseStatement::COUNT)>;
+
+	struct DatabasePoolConfig {
+		// number of concurrently open database sessions, each is driven by its own worker thread
+		uint32_t poolSize;
+		// upper limit of game session writes coalesced into a single transaction
+		uint32_t maxBatchSize;
+		// a worker whose session was lost reconnects after this delay, doubled on every failed attempt
+		Duration reconnectDelay;
+		Duration maxReconnectDelay;
+		UserCacheConfig userCache;
+
+		DatabasePoolConfig() : poolSize{ 4 }, maxBatchSize{ 64 }, reconnectDelay{ std::chrono::milliseconds(250) }, maxReconnectDelay{ std::chrono::seconds(8) }, userCache{} { }
+	};
+
+	struct GameSessionWrite {
+		enum class Kind : uint32_t {
+			CREATE, CLOSE
+		};
+
+		Kind kind;
+		int playerId;
+	};
+
+	/**
+	 * A single blocking database session, only ever used by one worker thread at a time.
+	 */
+	class DatabaseConnection {
+	public:
+		virtual ~DatabaseConnection() = default;
+
+		/**
+		 * Opens the session, also used to reopen it once IsAlive() reported it lost
+		 */
+		virtual ErrorCode Connect() = 0;
+
+		/**
+		 * Checked by the worker after every job, false if the session was lost, eg. by a database restart
+		 */
+		virtual bool IsAlive() = 0;
+
+		virtual QueryUserResult QueryUserByHash(const std::string & hash) = 0;
+
+		virtual ErrorCode RegisterServer(int ownerId, uint8_t playerSlots, uint32_t tickIntervalMs, const std::string & serverIp, uint16_t controlPort, uint16_t gamePort, uint64_t & serverId) = 0;
+
+		virtual ErrorCode CloseServer(uint64_t serverId) = 0;
+
+		/**
+		 * Executes the writes in order as a single unit, either every write succeeds or none of them
+		 */
+		virtual ErrorCode WriteGameSessions(uint64_t serverId, const GameSessionWrite * writes, size_t numWrites) = 0;
+	};
+
+	using DatabaseConnectionFactory = std::function<std::unique_ptr<DatabaseConnection>()>;
+
+	/**
+	 * Pool of database sessions fed by a shared work queue.
+	 * Game session writes are coalesced while a previous batch is in flight and flushed in submission order.
+	 */
 	class MysqlSession  {
 
 		struct detail;
 
 		std::unique_ptr<detail> impl;
-		
+
 	public:
+		/**
+		 * Configures the pool and the backend from the network.database configuration
+		 */
 		MysqlSession(boost::asio::io_context& ioc);
+		MysqlSession(boost::asio::io_context& ioc, const DatabasePoolConfig & config, DatabaseConnectionFactory factory);
 		~MysqlSession();
 
+		/**
+		 * Served from the user cache when possible
+		 */
 		CompletionToken<QueryUserResult> QueryUserByHash(std::string hash);
 
+		/**
+		 * Forces the next QueryUserByHash of the hash to reach the database, eg. after a ban or logout
+		 */
+		void InvalidateUser(const std::string & hash);
+
+		void InvalidateUsers();
+
 		CompletionToken<ErrorCode> CloseServer();
 
 		CompletionToken<ErrorCode> CreateGameSession(int playerId);
@@ -32,7 +133,21 @@ namespace Netcode::Network {
 
 		CompletionToken<ErrorCode> RegisterServer(int ownerId, uint8_t playerSlots, uint32_t tickIntervalMs, const std::string & serverIp, uint16_t controlPort, uint16_t gamePort);
 
+		/**
+		 * Opens every session of the pool, succeeds if at least one of them is usable
+		 */
 		CompletionToken<ErrorCode> Connect();
+
+		DatabaseStats GetStatistics() const;
+
+		/**
+		 * Number of workers with an open session, the rest are reconnecting
+		 */
+		uint32_t GetLiveConnectionCount() const;
+
+		UserCacheStats GetUserCacheStatistics() const;
 	};
 
+	std::unique_ptr<DatabaseConnection> CreateMysqlConnection();
+
 }
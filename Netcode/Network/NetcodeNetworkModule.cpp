@@ -13,10 +13,23 @@
 
 namespace Netcode::Module {
 
+	static Network::HttpPoolConfig LoadHttpPoolConfig() {
+		Network::HttpPoolConfig config;
+		config.maxConnectionsPerHost = Config::GetOptional<uint32_t>(L"network.web.maxConnectionsPerHost:u32", config.maxConnectionsPerHost);
+		config.maxPipelineDepth = Config::GetOptional<uint32_t>(L"network.web.maxPipelineDepth:u32", config.maxPipelineDepth);
+		config.idleTimeout = std::chrono::milliseconds(Config::GetOptional<uint32_t>(L"network.web.idleTimeoutMs:u32", 30000u));
+		config.requestTimeout = std::chrono::milliseconds(Config::GetOptional<uint32_t>(L"network.web.requestTimeoutMs:u32", 5000u));
+		return config;
+	}
+
 	void NetcodeNetworkModule::Start(AApp * app) {
 	}
 
 	void NetcodeNetworkModule::Shutdown() {
+		if(httpSession != nullptr) {
+			httpSession->Close();
+			httpSession.reset();
+		}
 	}
 
 	Ref<Network::ServerSessionBase> NetcodeNetworkModule::CreateServer()
@@ -82,7 +95,7 @@ namespace Netcode::Module {
 	{
 		if(httpSession == nullptr) {
 			context.Start(Config::Get<uint32_t>(L"network.client.workerThreadCount:u32"));
-			httpSession = std::make_shared<Network::HttpSession>(context.GetImpl());
+			httpSession = std::make_shared<Network::HttpSession>(context.GetImpl(), LoadHttpPoolConfig());
 		}
 
 		json11::Json json = json11::Json::object{
@@ -100,7 +113,7 @@ namespace Netcode::Module {
 	{
 		if(httpSession == nullptr) {
 			context.Start(Config::Get<uint32_t>(L"network.client.workerThreadCount:u32"));
-			httpSession = std::make_shared<Network::HttpSession>(context.GetImpl());
+			httpSession = std::make_shared<Network::HttpSession>(context.GetImpl(), LoadHttpPoolConfig());
 		}
 
 		return httpSession->MakeRequest(Utility::ToNarrowString(Config::Get<std::wstring>(L"network.web.hostname:string")),
@@ -111,7 +124,7 @@ namespace Netcode::Module {
 	{
 		if(httpSession == nullptr) {
 			context.Start(Config::Get<uint32_t>(L"network.client.workerThreadCount:u32"));
-			httpSession = std::make_shared<Network::HttpSession>(context.GetImpl());
+			httpSession = std::make_shared<Network::HttpSession>(context.GetImpl(), LoadHttpPoolConfig());
 		}
 
 		return httpSession->MakeRequest(Utility::ToNarrowString(Config::Get<std::wstring>(L"network.web.hostname:string")),
@@ -121,7 +134,7 @@ namespace Netcode::Module {
 	Network::CompletionToken<Network::Response> NetcodeNetworkModule::Logout() {
 		if(httpSession == nullptr) {
 			context.Start(Config::Get<uint32_t>(L"network.client.workerThreadCount:u32"));
-			httpSession = std::make_shared<Network::HttpSession>(context.GetImpl());
+			httpSession = std::make_shared<Network::HttpSession>(context.GetImpl(), LoadHttpPoolConfig());
 		}
 
 		return httpSession->MakeRequest(Utility::ToNarrowString(Config::Get<std::wstring>(L"network.web.hostname:string")),
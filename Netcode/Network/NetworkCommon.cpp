@@ -2,6 +2,7 @@
 
 #include "NetworkCommon.h"
 #include "../Logger.h"
+#include "../System/Profiler.h"
 #include "Macros.h"
 #include <NetcodeFoundation/Exceptions.h>
 #include <string>
@@ -34,6 +35,7 @@ namespace Netcode::Network {
 
 		for(uint8_t i = 0; i < numThreads; ++i) {
 			workers.emplace_back([this]() -> void {
+				NETCODE_PROFILE_THREAD("Network I/O");
 				ioc.run();
 			});
 		}
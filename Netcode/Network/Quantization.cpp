@@ -0,0 +1,160 @@
+#include "Quantization.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace Netcode::Network {
+
+	// range of the three smaller components of a unit quaternion
+	constexpr static float SMALLEST_THREE_BOUND = 0.70710678118f;
+
+	static double GetMaxQuantizedValue(uint32_t numBits) {
+		return static_cast<double>((numBits >= 32) ? 0xFFFFFFFFu : ((1u << numBits) - 1u));
+	}
+
+	RangedFloatQuantizer::RangedFloatQuantizer(float minValue, float maxValue, uint32_t numBits) :
+		minValue{ std::min(minValue, maxValue) }, maxValue{ std::max(minValue, maxValue) }, numBits{ std::clamp(numBits, 1u, 32u) } {
+
+	}
+
+	uint32_t RangedFloatQuantizer::Quantize(float value) const {
+		const double range = static_cast<double>(maxValue) - static_cast<double>(minValue);
+		double t = (range > 0.0) ? ((static_cast<double>(value) - minValue) / range) : 0.0;
+
+		// also catches NaN
+		if(!(t >= 0.0)) {
+			t = 0.0;
+		}
+
+		t = std::min(t, 1.0);
+
+		return static_cast<uint32_t>(t * GetMaxQuantizedValue(numBits) + 0.5);
+	}
+
+	float RangedFloatQuantizer::Dequantize(uint32_t value) const {
+		const double range = static_cast<double>(maxValue) - static_cast<double>(minValue);
+		const double t = static_cast<double>(value) / GetMaxQuantizedValue(numBits);
+		return static_cast<float>(minValue + range * std::min(t, 1.0));
+	}
+
+	float RangedFloatQuantizer::GetMaxError() const {
+		const double halfStep = (static_cast<double>(maxValue) - minValue) / GetMaxQuantizedValue(numBits) / 2.0;
+		// the dequantized value is rounded to the nearest float
+		const double rounding = std::numeric_limits<float>::epsilon() * std::max(std::abs(minValue), std::abs(maxValue));
+		return static_cast<float>(halfStep + rounding);
+	}
+
+	void RangedFloatQuantizer::Write(BitWriter & writer, const float & value) const {
+		writer.Write(Quantize(value), numBits);
+	}
+
+	bool RangedFloatQuantizer::Read(BitReader & reader, float & value) const {
+		const uint32_t q = reader.Read(numBits);
+
+		if(reader.HasOverflowed()) {
+			return false;
+		}
+
+		value = Dequantize(q);
+		return true;
+	}
+
+	BoundedFloat3Quantizer::BoundedFloat3Quantizer(const Float3 & minValue, const Float3 & maxValue, uint32_t numBitsPerComponent) :
+		x{ minValue.x, maxValue.x, numBitsPerComponent },
+		y{ minValue.y, maxValue.y, numBitsPerComponent },
+		z{ minValue.z, maxValue.z, numBitsPerComponent } {
+
+	}
+
+	float BoundedFloat3Quantizer::GetMaxError() const {
+		return std::max(x.GetMaxError(), std::max(y.GetMaxError(), z.GetMaxError()));
+	}
+
+	void BoundedFloat3Quantizer::Write(BitWriter & writer, const Float3 & value) const {
+		x.Write(writer, value.x);
+		y.Write(writer, value.y);
+		z.Write(writer, value.z);
+	}
+
+	bool BoundedFloat3Quantizer::Read(BitReader & reader, Float3 & value) const {
+		Float3 v;
+
+		if(!x.Read(reader, v.x) || !y.Read(reader, v.y) || !z.Read(reader, v.z)) {
+			return false;
+		}
+
+		value = v;
+		return true;
+	}
+
+	QuaternionQuantizer::QuaternionQuantizer(uint32_t numBitsPerComponent) :
+		component{ -SMALLEST_THREE_BOUND, SMALLEST_THREE_BOUND, numBitsPerComponent } {
+
+	}
+
+	float QuaternionQuantizer::GetMaxError() const {
+		return component.GetMaxError();
+	}
+
+	void QuaternionQuantizer::Write(BitWriter & writer, const Float4 & value) const {
+		float q[4] = { value.x, value.y, value.z, value.w };
+
+		const float lengthSq = q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3];
+		const float invLength = (lengthSq > 0.0f) ? (1.0f / std::sqrt(lengthSq)) : 0.0f;
+
+		uint32_t largest = 0;
+		for(uint32_t i = 0; i < 4; i++) {
+			q[i] *= invLength;
+
+			if(std::abs(q[i]) > std::abs(q[largest])) {
+				largest = i;
+			}
+		}
+
+		const float sign = (q[largest] < 0.0f) ? -1.0f : 1.0f;
+
+		writer.Write(largest, 2);
+
+		for(uint32_t i = 0; i < 4; i++) {
+			if(i != largest) {
+				component.Write(writer, sign * q[i]);
+			}
+		}
+	}
+
+	bool QuaternionQuantizer::Read(BitReader & reader, Float4 & value) const {
+		const uint32_t largest = reader.Read(2);
+		float q[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		float sumSq = 0.0f;
+
+		for(uint32_t i = 0; i < 4; i++) {
+			if(i != largest) {
+				if(!component.Read(reader, q[i])) {
+					return false;
+				}
+				sumSq += q[i] * q[i];
+			}
+		}
+
+		q[largest] = std::sqrt(std::max(0.0f, 1.0f - sumSq));
+
+		value = Float4{ q[0], q[1], q[2], q[3] };
+		return true;
+	}
+
+	uint32_t VarUIntQuantizer::GetNumBits(const uint32_t & value) const {
+		uint32_t numGroups = 1;
+
+		for(uint32_t v = value >> 7; v != 0; v >>= 7) {
+			numGroups++;
+		}
+
+		return 8 * numGroups;
+	}
+
+	uint32_t VarIntQuantizer::GetNumBits(const int32_t & value) const {
+		const uint32_t u = static_cast<uint32_t>(value);
+		return VarUIntQuantizer{}.GetNumBits((u << 1) ^ static_cast<uint32_t>(value >> 31));
+	}
+
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <NetcodeFoundation/Math.h>
+#include "BitStream.h"
+
+namespace Netcode::Network {
+
+	/*
+	 * Quantizer concept, used by the quantized replication arguments
+	 *  - using ValueType = T;
+	 *  - uint32_t GetNumBits(const T & value) const;
+	 *  - void Write(BitWriter & writer, const T & value) const;
+	 *  - bool Read(BitReader & reader, T & value) const;
+	 */
+
+	/**
+	 * Fixed point float in the [minValue, maxValue] range, values outside of it are clamped
+	 */
+	class RangedFloatQuantizer {
+		float minValue;
+		float maxValue;
+		uint32_t numBits;
+
+	public:
+		using ValueType = float;
+
+		/**
+		 * @param numBits in the range [1, 32]
+		 */
+		RangedFloatQuantizer(float minValue, float maxValue, uint32_t numBits);
+
+		uint32_t Quantize(float value) const;
+
+		float Dequantize(uint32_t value) const;
+
+		/**
+		 * Largest absolute difference between an in range value and its round trip, including the float rounding
+		 */
+		float GetMaxError() const;
+
+		uint32_t GetNumBits(const float &) const {
+			return numBits;
+		}
+
+		void Write(BitWriter & writer, const float & value) const;
+
+		bool Read(BitReader & reader, float & value) const;
+	};
+
+	/**
+	 * Position inside an axis aligned box, every component is quantized on the same number of bits
+	 */
+	class BoundedFloat3Quantizer {
+		RangedFloatQuantizer x;
+		RangedFloatQuantizer y;
+		RangedFloatQuantizer z;
+
+	public:
+		using ValueType = Float3;
+
+		BoundedFloat3Quantizer(const Float3 & minValue, const Float3 & maxValue, uint32_t numBitsPerComponent);
+
+		/**
+		 * Largest error of a single component
+		 */
+		float GetMaxError() const;
+
+		uint32_t GetNumBits(const Float3 & value) const {
+			return x.GetNumBits(value.x) + y.GetNumBits(value.y) + z.GetNumBits(value.z);
+		}
+
+		void Write(BitWriter & writer, const Float3 & value) const;
+
+		bool Read(BitReader & reader, Float3 & value) const;
+	};
+
+	/**
+	 * Unit quaternion with the smallest three method: the index of the largest component is written on 2 bits,
+	 * the other three are in the [-1/sqrt(2), 1/sqrt(2)] range and the largest is reconstructed from them.
+	 * The sign is chosen so the largest component is positive, q and -q are the same rotation.
+	 */
+	class QuaternionQuantizer {
+		RangedFloatQuantizer component;
+
+	public:
+		using ValueType = Float4;
+
+		QuaternionQuantizer(uint32_t numBitsPerComponent);
+
+		/**
+		 * Largest error of one of the three written components
+		 */
+		float GetMaxError() const;
+
+		uint32_t GetNumBits(const Float4 & value) const {
+			return 2 + 3 * component.GetNumBits(value.x);
+		}
+
+		void Write(BitWriter & writer, const Float4 & value) const;
+
+		bool Read(BitReader & reader, Float4 & value) const;
+	};
+
+	/**
+	 * Variable length unsigned integer, 8 bits for values below 128
+	 */
+	class VarUIntQuantizer {
+	public:
+		using ValueType = uint32_t;
+
+		uint32_t GetNumBits(const uint32_t & value) const;
+
+		void Write(BitWriter & writer, const uint32_t & value) const {
+			writer.WriteVarUInt(value);
+		}
+
+		bool Read(BitReader & reader, uint32_t & value) const {
+			value = reader.ReadVarUInt();
+			return !reader.HasOverflowed();
+		}
+	};
+
+	/**
+	 * Variable length signed integer, 8 bits for values in [-64, 63]
+	 */
+	class VarIntQuantizer {
+	public:
+		using ValueType = int32_t;
+
+		uint32_t GetNumBits(const int32_t & value) const;
+
+		void Write(BitWriter & writer, const int32_t & value) const {
+			writer.WriteVarInt(value);
+		}
+
+		bool Read(BitReader & reader, int32_t & value) const {
+			value = reader.ReadVarInt();
+			return !reader.HasOverflowed();
+		}
+	};
+
+}
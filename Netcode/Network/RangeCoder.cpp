@@ -0,0 +1,287 @@
+#include "RangeCoder.h"
+#include "WireFormat.h"
+#include <algorithm>
+
+namespace Netcode::Network {
+
+	constexpr static uint32_t TOP_VALUE = 1u << 24;
+	constexpr static uint8_t MODEL_MAGIC[4] = { 'N', 'C', 'R', 'M' };
+	constexpr static uint8_t MODEL_VERSION = 1;
+	// trained probabilities are kept away from 0 and 1, an unseen bit must stay codable
+	constexpr static uint32_t MIN_PROBABILITY = 31;
+	constexpr static uint32_t MAX_PROBABILITY = RangeEncoder::PROBABILITY_ONE - MIN_PROBABILITY;
+
+	RangeEncoder::RangeEncoder(MutableArrayView<uint8_t> buffer) : data{ buffer.Data() }, size{ buffer.Size() }, offset{ 0 },
+		low{ 0 }, range{ 0xFFFFFFFFu }, cacheSize{ 1 }, cache{ 0 }, leadingByte{ true }, overflowed{ false } {
+
+	}
+
+	void RangeEncoder::WriteByte(uint8_t value) {
+		if(leadingByte) {
+			leadingByte = false;
+			return;
+		}
+
+		if(offset < size) {
+			data[offset++] = value;
+		} else {
+			overflowed = true;
+		}
+	}
+
+	void RangeEncoder::ShiftLow() {
+		if(static_cast<uint32_t>(low) < 0xFF000000u || (low >> 32) != 0) {
+			const uint8_t carry = static_cast<uint8_t>(low >> 32);
+			uint8_t temp = cache;
+
+			do {
+				WriteByte(static_cast<uint8_t>(temp + carry));
+				temp = 0xFF;
+			} while(--cacheSize != 0);
+
+			cache = static_cast<uint8_t>(low >> 24);
+		}
+
+		cacheSize++;
+		low = (low & 0x00FFFFFFu) << 8;
+	}
+
+	void RangeEncoder::EncodeBit(uint16_t & probability, uint32_t bit) {
+		const uint32_t bound = (range >> PROBABILITY_BITS) * probability;
+
+		if(bit == 0) {
+			range = bound;
+			probability += static_cast<uint16_t>((PROBABILITY_ONE - probability) >> ADAPTATION_SHIFT);
+		} else {
+			low += bound;
+			range -= bound;
+			probability -= static_cast<uint16_t>(probability >> ADAPTATION_SHIFT);
+		}
+
+		while(range < TOP_VALUE) {
+			range <<= 8;
+			ShiftLow();
+		}
+	}
+
+	void RangeEncoder::Flush() {
+		for(uint32_t i = 0; i < 5; i++) {
+			ShiftLow();
+		}
+
+		while(offset > 0 && data[offset - 1] == 0) {
+			offset--;
+		}
+	}
+
+	RangeDecoder::RangeDecoder(ArrayView<uint8_t> buffer) : data{ buffer.Data() }, size{ buffer.Size() }, offset{ 0 }, range{ 0xFFFFFFFFu }, code{ 0 } {
+		for(uint32_t i = 0; i < 4; i++) {
+			code = (code << 8) | ReadByte();
+		}
+	}
+
+	uint32_t RangeDecoder::DecodeBit(uint16_t & probability) {
+		const uint32_t bound = (range >> RangeEncoder::PROBABILITY_BITS) * probability;
+		uint32_t bit;
+
+		if(code < bound) {
+			range = bound;
+			probability += static_cast<uint16_t>((RangeEncoder::PROBABILITY_ONE - probability) >> RangeEncoder::ADAPTATION_SHIFT);
+			bit = 0;
+		} else {
+			code -= bound;
+			range -= bound;
+			probability -= static_cast<uint16_t>(probability >> RangeEncoder::ADAPTATION_SHIFT);
+			bit = 1;
+		}
+
+		while(range < TOP_VALUE) {
+			range <<= 8;
+			code = (code << 8) | ReadByte();
+		}
+
+		return bit;
+	}
+
+	ReplicationModel::ReplicationModel() : probabilities(NUM_PROBABILITIES, static_cast<uint16_t>(RangeEncoder::PROBABILITY_HALF)) {
+
+	}
+
+	uint32_t ReplicationModel::GetId() const {
+		// FNV-1a over the big endian probabilities
+		uint32_t hash = 2166136261u;
+
+		for(uint16_t p : probabilities) {
+			hash = (hash ^ static_cast<uint8_t>(p >> 8)) * 16777619u;
+			hash = (hash ^ static_cast<uint8_t>(p)) * 16777619u;
+		}
+
+		return hash;
+	}
+
+	std::vector<uint8_t> ReplicationModel::Serialize() const {
+		std::vector<uint8_t> data(sizeof(MODEL_MAGIC) + 1 + 2 + 2 * probabilities.size());
+		WireWriter writer{ MutableArrayView<uint8_t>{ data.data(), data.size() } };
+
+		for(uint8_t m : MODEL_MAGIC) {
+			writer.WriteU8(m);
+		}
+		writer.WriteU8(MODEL_VERSION);
+		writer.WriteU16(static_cast<uint16_t>(NUM_POSITIONS));
+
+		for(uint16_t p : probabilities) {
+			writer.WriteU16(p);
+		}
+
+		return data;
+	}
+
+	bool ReplicationModel::Deserialize(ArrayView<uint8_t> data) {
+		WireReader reader{ data };
+
+		for(uint8_t m : MODEL_MAGIC) {
+			if(reader.ReadU8() != m) {
+				return false;
+			}
+		}
+
+		if(reader.ReadU8() != MODEL_VERSION || reader.ReadU16() != NUM_POSITIONS) {
+			return false;
+		}
+
+		std::vector<uint16_t> values(NUM_PROBABILITIES);
+
+		for(uint16_t & p : values) {
+			p = reader.ReadU16();
+
+			if(p == 0 || p >= RangeEncoder::PROBABILITY_ONE) {
+				return false;
+			}
+		}
+
+		if(reader.HasOverflowed() || reader.GetRemainingSize() != 0) {
+			return false;
+		}
+
+		probabilities = std::move(values);
+		return true;
+	}
+
+	ReplicationModelTrainer::ReplicationModelTrainer() : zeros(ReplicationModel::NUM_PROBABILITIES, 0), ones(ReplicationModel::NUM_PROBABILITIES, 0), numBytes{ 0 } {
+
+	}
+
+	void ReplicationModelTrainer::Add(ArrayView<uint8_t> payload) {
+		uint8_t previous = 0;
+
+		for(size_t i = 0; i < payload.Size(); i++) {
+			const uint32_t base = ReplicationModel::GetContext(i, previous) * ReplicationModel::NUM_NODES;
+			const uint32_t value = payload[i];
+			uint32_t node = 1;
+
+			for(int32_t b = 7; b >= 0; b--) {
+				const uint32_t bit = (value >> b) & 1u;
+				uint32_t & counter = (bit == 0) ? zeros[base + node] : ones[base + node];
+				counter = std::min(counter + 1, 0x7FFFFFFFu);
+				node = (node << 1) | bit;
+			}
+
+			previous = payload[i];
+		}
+
+		numBytes += payload.Size();
+	}
+
+	ReplicationModel ReplicationModelTrainer::Build() const {
+		ReplicationModel model;
+
+		for(uint32_t i = 0; i < ReplicationModel::NUM_PROBABILITIES; i++) {
+			const double total = static_cast<double>(zeros[i]) + static_cast<double>(ones[i]);
+
+			if(total == 0.0) {
+				continue;
+			}
+
+			// additive smoothing keeps bits that were rarely seen codable
+			const double p0 = (static_cast<double>(zeros[i]) + 0.5) / (total + 1.0);
+			const uint32_t scaled = static_cast<uint32_t>(p0 * RangeEncoder::PROBABILITY_ONE + 0.5);
+			model.SetProbability(i, static_cast<uint16_t>(std::clamp(scaled, MIN_PROBABILITY, MAX_PROBABILITY)));
+		}
+
+		return model;
+	}
+
+	ReplicationCoder::ReplicationCoder(ReplicationModel trainedModel) : model{ std::move(trainedModel) }, working{}, touched{}, scratch{}, modelId{ 0 } {
+		working = model.GetProbabilities();
+		modelId = model.GetId();
+		touched.reserve(8 * MAX_PAYLOAD_SIZE);
+		scratch.resize(MAX_PAYLOAD_SIZE);
+	}
+
+	void ReplicationCoder::Restore() {
+		for(uint32_t index : touched) {
+			working[index] = model.GetProbability(index);
+		}
+		touched.clear();
+	}
+
+	ArrayView<uint8_t> ReplicationCoder::Encode(ArrayView<uint8_t> payload) {
+		if(payload.Size() == 0 || payload.Size() > MAX_PAYLOAD_SIZE) {
+			return ArrayView<uint8_t>{ nullptr, 0 };
+		}
+
+		// at least one byte smaller, otherwise it is sent as is
+		RangeEncoder encoder{ MutableArrayView<uint8_t>{ scratch.data(), payload.Size() - 1 } };
+		uint8_t previous = 0;
+
+		for(size_t i = 0; i < payload.Size(); i++) {
+			const uint32_t base = ReplicationModel::GetContext(i, previous) * ReplicationModel::NUM_NODES;
+			const uint32_t value = payload[i];
+			uint32_t node = 1;
+
+			for(int32_t b = 7; b >= 0; b--) {
+				const uint32_t bit = (value >> b) & 1u;
+				touched.push_back(base + node);
+				encoder.EncodeBit(working[base + node], bit);
+				node = (node << 1) | bit;
+			}
+
+			previous = payload[i];
+		}
+
+		encoder.Flush();
+		Restore();
+
+		if(encoder.HasOverflowed()) {
+			return ArrayView<uint8_t>{ nullptr, 0 };
+		}
+
+		return ArrayView<uint8_t>{ scratch.data(), encoder.GetSize() };
+	}
+
+	bool ReplicationCoder::Decode(ArrayView<uint8_t> coded, MutableArrayView<uint8_t> dst) {
+		if(dst.Size() > MAX_PAYLOAD_SIZE) {
+			return false;
+		}
+
+		RangeDecoder decoder{ coded };
+		uint8_t previous = 0;
+
+		for(size_t i = 0; i < dst.Size(); i++) {
+			const uint32_t base = ReplicationModel::GetContext(i, previous) * ReplicationModel::NUM_NODES;
+			uint32_t node = 1;
+
+			for(uint32_t b = 0; b < 8; b++) {
+				touched.push_back(base + node);
+				node = (node << 1) | decoder.DecodeBit(working[base + node]);
+			}
+
+			previous = static_cast<uint8_t>(node);
+			dst[i] = previous;
+		}
+
+		Restore();
+		return true;
+	}
+
+}
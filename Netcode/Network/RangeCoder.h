@@ -0,0 +1,176 @@
+#pragma once
+
+#include <NetcodeFoundation/ArrayView.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace Netcode::Network {
+
+	/**
+	 * Adaptive binary range encoder (LZMA style). Probabilities are 11 bit estimates of a bit being 0
+	 * and move towards the coded bits. Output is written into a caller owned buffer, running out of
+	 * space sets the overflow flag. The always zero leading byte and the trailing zeros are left out,
+	 * the decoder reads zeros past the end of its input.
+	 */
+	class RangeEncoder {
+		uint8_t * data;
+		size_t size;
+		size_t offset;
+		uint64_t low;
+		uint32_t range;
+		uint32_t cacheSize;
+		uint8_t cache;
+		bool leadingByte;
+		bool overflowed;
+
+		void WriteByte(uint8_t value);
+
+		void ShiftLow();
+
+	public:
+		constexpr static uint32_t PROBABILITY_BITS = 11;
+		constexpr static uint32_t PROBABILITY_ONE = 1u << PROBABILITY_BITS;
+		constexpr static uint32_t PROBABILITY_HALF = PROBABILITY_ONE / 2;
+		constexpr static uint32_t ADAPTATION_SHIFT = 5;
+
+		RangeEncoder(MutableArrayView<uint8_t> buffer);
+
+		void EncodeBit(uint16_t & probability, uint32_t bit);
+
+		/**
+		 * Writes the pending bytes, the encoder can not be used afterwards
+		 */
+		void Flush();
+
+		size_t GetSize() const {
+			return offset;
+		}
+
+		bool HasOverflowed() const {
+			return overflowed;
+		}
+	};
+
+	class RangeDecoder {
+		const uint8_t * data;
+		size_t size;
+		size_t offset;
+		uint32_t range;
+		uint32_t code;
+
+		uint8_t ReadByte() {
+			return (offset < size) ? data[offset++] : 0;
+		}
+
+	public:
+		RangeDecoder(ArrayView<uint8_t> buffer);
+
+		uint32_t DecodeBit(uint16_t & probability);
+	};
+
+	/**
+	 * Static byte model of replication payloads: every byte is coded MSB first through a bit tree,
+	 * the tree is selected by the position of the byte and whether the previous byte was zero.
+	 * Trained offline by ReplicationModelTrainer, the client and the server must use the same model.
+	 */
+	class ReplicationModel {
+		std::vector<uint16_t> probabilities;
+
+	public:
+		// bytes beyond the last position share its context
+		constexpr static uint32_t NUM_POSITIONS = 32;
+		constexpr static uint32_t NUM_CONTEXTS = NUM_POSITIONS * 2;
+		constexpr static uint32_t NUM_NODES = 256;
+		constexpr static uint32_t NUM_PROBABILITIES = NUM_CONTEXTS * NUM_NODES;
+
+		ReplicationModel();
+
+		static uint32_t GetContext(size_t position, uint8_t previousByte) {
+			const uint32_t pos = (position < NUM_POSITIONS) ? static_cast<uint32_t>(position) : (NUM_POSITIONS - 1);
+			return pos * 2 + ((previousByte == 0) ? 1 : 0);
+		}
+
+		uint16_t GetProbability(uint32_t index) const {
+			return probabilities[index];
+		}
+
+		void SetProbability(uint32_t index, uint16_t probability) {
+			probabilities[index] = probability;
+		}
+
+		const std::vector<uint16_t> & GetProbabilities() const {
+			return probabilities;
+		}
+
+		/**
+		 * Hash of the probabilities, sent along with coded updates to detect a model mismatch
+		 */
+		uint32_t GetId() const;
+
+		std::vector<uint8_t> Serialize() const;
+
+		/**
+		 * @return false if the data is not a model of this version, the model is left unchanged then
+		 */
+		bool Deserialize(ArrayView<uint8_t> data);
+	};
+
+	/**
+	 * Counts the bits of recorded replication payloads in the contexts of ReplicationModel
+	 */
+	class ReplicationModelTrainer {
+		std::vector<uint32_t> zeros;
+		std::vector<uint32_t> ones;
+		uint64_t numBytes;
+
+	public:
+		ReplicationModelTrainer();
+
+		void Add(ArrayView<uint8_t> payload);
+
+		uint64_t GetNumBytes() const {
+			return numBytes;
+		}
+
+		/**
+		 * Nodes that were never reached keep an even probability
+		 */
+		ReplicationModel Build() const;
+	};
+
+	/**
+	 * Codes replication payloads one by one. Every payload starts from the trained model and adapts
+	 * while it is coded, payloads are independent because the packets carrying them may be lost.
+	 */
+	class ReplicationCoder {
+		ReplicationModel model;
+		std::vector<uint16_t> working;
+		std::vector<uint32_t> touched;
+		std::vector<uint8_t> scratch;
+		uint32_t modelId;
+
+		void Restore();
+
+	public:
+		// larger payloads are not worth the scratch memory, they are sent as is
+		constexpr static uint32_t MAX_PAYLOAD_SIZE = 4096;
+
+		ReplicationCoder(ReplicationModel trainedModel);
+
+		uint32_t GetModelId() const {
+			return modelId;
+		}
+
+		/**
+		 * @return view into an internal buffer, valid until the next Encode. Empty if coding
+		 * would not make the payload smaller
+		 */
+		ArrayView<uint8_t> Encode(ArrayView<uint8_t> payload);
+
+		/**
+		 * Decodes exactly dst.Size() bytes
+		 */
+		bool Decode(ArrayView<uint8_t> coded, MutableArrayView<uint8_t> dst);
+	};
+
+}
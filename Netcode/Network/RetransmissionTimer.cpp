@@ -0,0 +1,81 @@
+#include "RetransmissionTimer.h"
+#include <Netcode/Sync/LockGuards.hpp>
+#include <algorithm>
+
+namespace Netcode::Network {
+
+	RetransmissionTimer::RetransmissionTimer() : srwLock{}, smoothedRtt{}, rttVariance{}, timeout{}, numSamples{ 0 } {
+
+	}
+
+	void RetransmissionTimer::AddSample(Duration rtt) {
+		if(rtt < Duration{}) {
+			return;
+		}
+
+		ScopedExclusiveLock<SlimReadWriteLock> scopedLock{ srwLock };
+
+		if(numSamples == 0) {
+			smoothedRtt = rtt;
+			rttVariance = rtt / 2;
+		} else {
+			const Duration error = (smoothedRtt > rtt) ? (smoothedRtt - rtt) : (rtt - smoothedRtt);
+
+			// beta = 1/4, alpha = 1/8, RTTVAR must be updated with the previous SRTT
+			rttVariance = (3 * rttVariance + error) / 4;
+			smoothedRtt = (7 * smoothedRtt + rtt) / 8;
+		}
+
+		timeout = smoothedRtt + std::max(GRANULARITY, 4 * rttVariance);
+		numSamples++;
+	}
+
+	void RetransmissionTimer::Reset() {
+		ScopedExclusiveLock<SlimReadWriteLock> scopedLock{ srwLock };
+
+		smoothedRtt = Duration{};
+		rttVariance = Duration{};
+		timeout = Duration{};
+		numSamples = 0;
+	}
+
+	bool RetransmissionTimer::HasSample() const {
+		ScopedSharedLock<SlimReadWriteLock> scopedLock{ srwLock };
+		return numSamples > 0;
+	}
+
+	uint32_t RetransmissionTimer::GetNumSamples() const {
+		ScopedSharedLock<SlimReadWriteLock> scopedLock{ srwLock };
+		return numSamples;
+	}
+
+	Duration RetransmissionTimer::GetSmoothedRtt() const {
+		ScopedSharedLock<SlimReadWriteLock> scopedLock{ srwLock };
+		return smoothedRtt;
+	}
+
+	Duration RetransmissionTimer::GetRttVariance() const {
+		ScopedSharedLock<SlimReadWriteLock> scopedLock{ srwLock };
+		return rttVariance;
+	}
+
+	Duration RetransmissionTimer::GetTimeout(Duration initialTimeout) const {
+		ScopedSharedLock<SlimReadWriteLock> scopedLock{ srwLock };
+		return (numSamples > 0) ? timeout : initialTimeout;
+	}
+
+	Duration RetransmissionTimer::GetTimeout(Duration initialTimeout, uint32_t attemptIndex, const RetransmissionConfig & config) const {
+		return Backoff(GetTimeout(initialTimeout), attemptIndex, config);
+	}
+
+	Duration RetransmissionTimer::Backoff(Duration baseTimeout, uint32_t attemptIndex, const RetransmissionConfig & config) {
+		Duration t = std::clamp(baseTimeout, config.minTimeout, config.maxTimeout);
+
+		for(uint32_t i = 0; i < attemptIndex && t < config.maxTimeout; i++) {
+			t *= 2;
+		}
+
+		return std::min(t, config.maxTimeout);
+	}
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <Netcode/System/TimeTypes.h>
+#include <Netcode/Sync/SlimReadWriteLock.h>
+
+namespace Netcode::Network {
+
+	struct RetransmissionConfig {
+		// lower bound of every computed timeout, protects against spurious resends on very low latency paths
+		Duration minTimeout;
+		// upper bound of every computed timeout, including the backed off ones
+		Duration maxTimeout;
+
+		RetransmissionConfig() :
+			minTimeout{ std::chrono::milliseconds(200) },
+			maxTimeout{ std::chrono::milliseconds(8000) } { }
+	};
+
+	/**
+	 * Round trip time estimator of a single path, computes the retransmission timeout as described in RFC 6298.
+	 * Only acknowledgements of messages that were sent exactly once should be sampled (Karn's algorithm),
+	 * the timeout of a retransmitted message is backed off exponentially instead.
+	 * Every member function is thread safe.
+	 */
+	class RetransmissionTimer {
+		constexpr static Duration GRANULARITY = std::chrono::milliseconds(1);
+
+		mutable SlimReadWriteLock srwLock;
+		Duration smoothedRtt;
+		Duration rttVariance;
+		Duration timeout;
+		uint32_t numSamples;
+
+	public:
+		RetransmissionTimer();
+
+		void AddSample(Duration rtt);
+
+		void Reset();
+
+		bool HasSample() const;
+
+		uint32_t GetNumSamples() const;
+
+		Duration GetSmoothedRtt() const;
+
+		Duration GetRttVariance() const;
+
+		/**
+		 * SRTT + max(G, 4 * RTTVAR), without clamping. Returns initialTimeout until the first sample arrives
+		 */
+		Duration GetTimeout(Duration initialTimeout) const;
+
+		/**
+		 * Timeout of the (attemptIndex + 1)th transmission, doubled after every retransmission and clamped to the configured bounds
+		 */
+		Duration GetTimeout(Duration initialTimeout, uint32_t attemptIndex, const RetransmissionConfig & config) const;
+
+		static Duration Backoff(Duration baseTimeout, uint32_t attemptIndex, const RetransmissionConfig & config);
+	};
+
+}
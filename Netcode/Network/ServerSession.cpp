@@ -80,12 +80,28 @@ namespace Netcode::Network {
 
 		service = std::make_shared<NetcodeService>(ioContext, std::move(gameSocket), static_cast<uint16_t>(iface.mtu), nullptr, std::move(serverCtx));
 		service->Host();
+
+		if(Config::GetOptional<bool>(L"network.database.enabled:bool", false)) {
+			database = std::make_unique<MysqlSession>(ioContext);
+			database->Connect();
+			database->RegisterServer(Config::Get<int32_t>(L"network.server.ownerId:i32"),
+				Config::Get<uint8_t>(L"network.server.playerSlots:u8"),
+				Config::Get<uint32_t>(L"network.server.tickIntervalMs:u32"),
+				selfAddr,
+				Config::Get<uint16_t>(L"network.server.controlPort:u16"),
+				static_cast<uint16_t>(gamePort))->Then([](const ErrorCode & ec) -> void {
+				if(ec) {
+					Log::Error("[Network] [Server] Failed to register the server: {0}", ec.message());
+				}
+			});
+		}
 	}
 
 	void ServerSession::Stop()
 	{
 		service->Close();
 		service.reset();
+		database.reset();
 	}
 
 }
@@ -13,6 +13,7 @@ namespace Netcode::Network {
 	class ServerSession : public ServerSessionBase {
 		boost::asio::io_context & ioContext;
 		Ref<NetcodeService> service;
+		std::unique_ptr<MysqlSession> database;
 		
 	public:
 		
@@ -31,6 +32,13 @@ namespace Netcode::Network {
 		Ref<NetcodeService> GetService() const {
 			return service;
 		}
+
+		/**
+		 * Null unless network.database.enabled is set, the logins are accepted without validation then
+		 */
+		MysqlSession * GetDatabase() const {
+			return database.get();
+		}
 	};
 
 }
@@ -1,5 +1,7 @@
 #include "Service.h"
 #include "NetworkErrorCode.h"
+#include "../System/Profiler.h"
+#include "../AsyncLog.h"
 #include <openssl/err.h>
 
 namespace Netcode::Network {
@@ -38,6 +40,14 @@ namespace Netcode::Network {
 	static bool NeedToAck(const Protocol::Control * control) {
 		return (control->type() & 0x1) == 0x1;
 	}
+
+	ProtocolConfig::ProtocolConfig() : retransmission{} {
+		const uint32_t minTimeoutMs = Config::GetOptional<uint32_t>(L"network.protocol.minRetransmissionTimeoutMs:u32", 200u);
+		const uint32_t maxTimeoutMs = Config::GetOptional<uint32_t>(L"network.protocol.maxRetransmissionTimeoutMs:u32", 8000u);
+
+		retransmission.minTimeout = std::chrono::milliseconds(minTimeoutMs);
+		retransmission.maxTimeout = std::chrono::milliseconds(std::max(minTimeoutMs, maxTimeoutMs));
+	}
 	
 	NetcodeService::ParseResult NetcodeService::HandleAuthenticatedMessage(NetAllocator * alloc, Ref<ConnectionBase> conn, UdpPacket * pkt) {
 		post(conn->strand, [this, c = conn, al = alloc->shared_from_this(), pkt]() mutable -> void {
@@ -111,7 +121,7 @@ namespace Netcode::Network {
 			AckClassification::EXTERNAL_INSECURE;
 		
 		if(control->type() == Protocol::MessageType::ACKNOWLEDGE) {
-			pendingTokenStorage.Ack(control->sequence(), pkt->GetEndpoint(), ackClass);
+			pendingTokenStorage.Ack(control->sequence(), pkt->GetEndpoint(), ackClass, pkt->GetTimestamp());
 			return nullptr;
 		}
 
@@ -211,6 +221,8 @@ namespace Netcode::Network {
 	}
 
 	NetcodeService::ParseResult NetcodeService::TryParseMessage(NetAllocator * alloc, UdpPacket * pkt) {
+		NETCODE_PROFILE_SCOPE("TryParseMessage");
+
 		if(pkt->GetSize() < 1) {
 			return ParseResult::FAILED;
 		}
@@ -284,7 +296,7 @@ namespace Netcode::Network {
 
 				// programmer or OpenSSL error
 				if(view.Size() < wouldBeDataOffset) {
-					Log::Debug("Invalid Record Layer?");
+					NETCODE_LOG_DEBUG(4, "Invalid Record Layer?");
 					if(token != nullptr) {
 						token->Set(TrResult{ make_error_code(NetworkErrc::BAD_MESSAGE) });
 					}
@@ -392,10 +404,12 @@ namespace Netcode::Network {
 		if((type & 0x1) == 0x1) {
 			AckClassification ackClass = (route == nullptr) ? AckClassification::EXTERNAL_INSECURE : AckClassification::EXTERNAL_SECURE;
 			WaitableTimer * timer = allocator->Make<WaitableTimer>(ioContext);
-			PendingTokenNode * node = allocator->Make<PendingTokenNode>(ct, timer, packet, ackClass);
+			RetransmissionTimer * retransmissionTimer = (route != nullptr) ? &route->retransmissionTimer : nullptr;
+			PendingTokenNode * node = allocator->Make<PendingTokenNode>(ct, timer, packet, ackClass, retransmissionTimer);
 
 			Ref<ResendContext<NetcodeSocketType>> rc = allocator->MakeShared<ResendContext<NetcodeSocketType>>(
-				&pendingTokenStorage, &socket, ct, serializedMessage, packet, route, timer, args.resendInterval, args.maxAttempts);
+				&pendingTokenStorage, &socket, ct, serializedMessage, packet, route, timer, node,
+				protocolConfig.GetRetransmissionConfig(), args.resendInterval, args.maxAttempts);
 
 			pendingTokenStorage.AddNode(node);
 
@@ -425,6 +439,8 @@ namespace Netcode::Network {
 
 	CompletionToken<TrResult> NetcodeService::Send(const GameMessage & gMsg, ConnectionBase * connection)
 	{
+		NETCODE_PROFILE_SCOPE("Send");
+
 		Ref<NetAllocator> allocator = gMsg.allocator;
 		const ArrayView<uint8_t> update = gMsg.content;
 		const uint32_t sequence = gMsg.sequence;
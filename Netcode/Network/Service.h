@@ -15,6 +15,7 @@
 namespace Netcode::Network {
 
 	struct ResendArgs {
+		// timeout of the first transmission until the route has a round trip estimate, also the base of unencrypted messages
 		Duration resendInterval;
 		uint32_t maxAttempts;
 
@@ -25,6 +26,8 @@ namespace Netcode::Network {
 	};
 
 	class ProtocolConfig {
+		RetransmissionConfig retransmission;
+
 		constexpr uint32_t GetIndexOf(Protocol::MessageType messageType) {
 			switch(messageType) {
 				default: return 0;
@@ -59,10 +62,18 @@ namespace Netcode::Network {
 			ResendArgs{ 500, 5 },
 		};
 	public:
+		/**
+		 * Reads the retransmission timeout bounds from the network.protocol configuration
+		 */
+		ProtocolConfig();
 
 		ResendArgs GetArgsFor(Protocol::MessageType messageType) {
 			return args[GetIndexOf(messageType)];
 		}
+
+		const RetransmissionConfig & GetRetransmissionConfig() const {
+			return retransmission;
+		}
 	};
 
 	/**
@@ -5,6 +5,7 @@
 #include <openssl/rand.h>
 #include <iomanip>
 #include <Netcode/Logger.h>
+#include <Netcode/AsyncLog.h>
 #include "MtuValue.hpp"
 #include "BasicPacket.hpp"
 #include <Netcode/Utility.h>
@@ -111,7 +112,7 @@ namespace Netcode::Network {
 	std::error_code SslReceive(SSL * ssl, MutableArrayView<uint8_t> & destBuffer, ArrayView<uint8_t> sourceBuffer) {
 		BIO * rbio = SSL_get_rbio(ssl);
 		if(rbio == nullptr) {
-			Log::Debug("Recv: SSL_get_rbio() returned null");
+			NETCODE_LOG_DEBUG(8, "Recv: SSL_get_rbio() returned null");
 			return make_error_code(NetworkErrc::SSL_ERROR);
 		}
 
@@ -225,7 +226,7 @@ namespace Netcode::Network {
 
 		ERR_print_errors(wbio);
 
-		Log::Debug("Err: {0}", s);
+		NETCODE_LOG_DEBUG(8, "Err: {0}", s);
 
 		BUF_MEM * dst = nullptr;
 		BIO_get_mem_ptr(wbio, &dst);
@@ -403,7 +404,7 @@ namespace Netcode::Network {
 	{
 		BIO * rbio = SSL_get_rbio(ssl);
 		if(rbio == nullptr) {
-			Log::Debug("SSL_get_rbio() returned null");
+			NETCODE_LOG_DEBUG(8, "SSL_get_rbio() returned null");
 			return make_error_code(NetworkErrc::SSL_ERROR);
 		}
 
@@ -426,7 +427,7 @@ namespace Netcode::Network {
 
 		if(accept == -1) {
 			int err = SSL_get_error(ssl, accept);
-			Log::Debug("?{0}", err);
+			NETCODE_LOG_DEBUG(8, "?{0}", err);
 		}
 
 		BUF_MEM * wb;
@@ -445,7 +446,7 @@ namespace Netcode::Network {
 			return std::error_code{};
 		}
 
-		Log::Debug("Unexpected SSL flow");
+		NETCODE_LOG_DEBUG(8, "Unexpected SSL flow");
 		return make_error_code(NetworkErrc::SSL_ERROR);
 	}
 	
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Netcode::Network {
+
+	/**
+	 * Winner tree of a k-way merge over sorted sources. The tree only stores source indices, the caller
+	 * owns the sources and compares their fronts: before(a, b) is true if the front of a goes first.
+	 * After the front of the winning source is consumed the tree is replayed along its path, so the next
+	 * winner is found in O(log k). Equal fronts are won by the lower source index, the merge is stable.
+	 */
+	class TournamentTree {
+		// 1-based heap layout, the leaves are [capacity, 2 * capacity)
+		std::vector<uint32_t> nodes;
+		uint32_t capacity;
+
+		template<typename F>
+		uint32_t Play(uint32_t left, uint32_t right, F & before) const {
+			if(left == NONE) {
+				return right;
+			}
+
+			if(right == NONE) {
+				return left;
+			}
+
+			return before(right, left) ? right : left;
+		}
+
+	public:
+		constexpr static uint32_t NONE = 0xFFFFFFFFu;
+
+		TournamentTree() : nodes{}, capacity{ 0 } { }
+
+		/**
+		 * Every source starts out empty, the previous storage is reused
+		 */
+		void Reset(uint32_t numSources) {
+			capacity = 1;
+			while(capacity < numSources) {
+				capacity *= 2;
+			}
+
+			nodes.assign(2 * capacity, NONE);
+		}
+
+		/**
+		 * Marks the source as having a front, takes effect on the next Build
+		 */
+		void SetLeaf(uint32_t source) {
+			nodes[capacity + source] = source;
+		}
+
+		/**
+		 * Plays every match, O(k)
+		 */
+		template<typename F>
+		void Build(F before) {
+			for(uint32_t i = capacity - 1; i > 0; i--) {
+				nodes[i] = Play(nodes[2 * i], nodes[2 * i + 1], before);
+			}
+		}
+
+		/**
+		 * @return the source with the first front, NONE if every source is empty
+		 */
+		uint32_t GetWinner() const {
+			// with a single leaf the root is the leaf itself
+			return nodes.empty() ? NONE : nodes[1];
+		}
+
+		/**
+		 * Replays the matches of the source after its front changed, O(log k)
+		 * @param hasFront false removes the source from the merge
+		 */
+		template<typename F>
+		void Replay(uint32_t source, bool hasFront, F before) {
+			uint32_t i = capacity + source;
+			nodes[i] = hasFront ? source : NONE;
+
+			for(i /= 2; i > 0; i /= 2) {
+				nodes[i] = Play(nodes[2 * i], nodes[2 * i + 1], before);
+			}
+		}
+	};
+
+}
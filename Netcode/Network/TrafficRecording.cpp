@@ -0,0 +1,143 @@
+#include "TrafficRecording.h"
+#include "../Logger.h"
+#include <NetcodeFoundation/Exceptions.h>
+
+namespace Netcode::Network {
+
+	constexpr static uint8_t RECORDING_MAGIC[4] = { 'N', 'C', 'T', 'R' };
+	constexpr static uint8_t RECORDING_VERSION = 1;
+	constexpr static size_t RECORDER_FLUSH_SIZE = 1 << 16;
+
+	static uint32_t GetRecordSize(const TrafficRecord & record) {
+		const uint32_t connectionIdSize = WireWriter::GetVarUIntSize(static_cast<uint32_t>(record.connectionId));
+		const uint32_t contentSize = WireWriter::GetBytesSize(static_cast<uint32_t>(record.content.Size()));
+
+		switch(record.type) {
+			case TrafficRecordType::TICK: return 1 + 8;
+			case TrafficRecordType::GAME_MESSAGE: return 1 + connectionIdSize + WireWriter::GetVarUIntSize(record.sequence) + contentSize;
+			case TrafficRecordType::CONTROL_MESSAGE: return 1 + connectionIdSize + contentSize;
+			case TrafficRecordType::CONNECT: return 1 + connectionIdSize;
+			default: return 0;
+		}
+	}
+
+	void TrafficRecordWriter::WriteHeader() {
+		buffer.insert(std::end(buffer), std::begin(RECORDING_MAGIC), std::end(RECORDING_MAGIC));
+		buffer.push_back(RECORDING_VERSION);
+	}
+
+	void TrafficRecordWriter::Write(const TrafficRecord & record) {
+		const uint32_t recordSize = GetRecordSize(record);
+
+		UndefinedBehaviourAssertion(recordSize > 0);
+
+		const size_t offset = buffer.size();
+		buffer.resize(offset + recordSize);
+
+		WireWriter writer{ MutableArrayView<uint8_t>{ buffer.data() + offset, recordSize } };
+		writer.WriteU8(static_cast<uint8_t>(record.type));
+
+		switch(record.type) {
+			case TrafficRecordType::TICK:
+				writer.WriteU64(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(record.timestamp - Timestamp{}).count()));
+				break;
+			case TrafficRecordType::GAME_MESSAGE:
+				writer.WriteVarUInt(static_cast<uint32_t>(record.connectionId));
+				writer.WriteVarUInt(record.sequence);
+				writer.WriteBytes(record.content);
+				break;
+			case TrafficRecordType::CONTROL_MESSAGE:
+				writer.WriteVarUInt(static_cast<uint32_t>(record.connectionId));
+				writer.WriteBytes(record.content);
+				break;
+			case TrafficRecordType::CONNECT:
+				writer.WriteVarUInt(static_cast<uint32_t>(record.connectionId));
+				break;
+		}
+
+		UndefinedBehaviourAssertion(!writer.HasOverflowed() && writer.GetOffset() == recordSize);
+	}
+
+	TrafficRecordReader::TrafficRecordReader(ArrayView<uint8_t> recording) : reader{ recording }, failed{ false } {
+		for(uint8_t m : RECORDING_MAGIC) {
+			if(reader.ReadU8() != m) {
+				failed = true;
+			}
+		}
+
+		if(reader.ReadU8() != RECORDING_VERSION || reader.HasOverflowed()) {
+			failed = true;
+		}
+	}
+
+	bool TrafficRecordReader::Next(TrafficRecord & record) {
+		if(failed || reader.GetRemainingSize() == 0) {
+			return false;
+		}
+
+		TrafficRecord r;
+		r.type = static_cast<TrafficRecordType>(reader.ReadU8());
+
+		switch(r.type) {
+			case TrafficRecordType::TICK:
+				r.timestamp = Timestamp{} + std::chrono::duration_cast<Duration>(std::chrono::nanoseconds{ reader.ReadU64() });
+				break;
+			case TrafficRecordType::GAME_MESSAGE:
+				r.connectionId = static_cast<int32_t>(reader.ReadVarUInt());
+				r.sequence = reader.ReadVarUInt();
+				r.content = reader.ReadBytes();
+				break;
+			case TrafficRecordType::CONTROL_MESSAGE:
+				r.connectionId = static_cast<int32_t>(reader.ReadVarUInt());
+				r.content = reader.ReadBytes();
+				break;
+			case TrafficRecordType::CONNECT:
+				r.connectionId = static_cast<int32_t>(reader.ReadVarUInt());
+				break;
+			default:
+				failed = true;
+				return false;
+		}
+
+		if(reader.HasOverflowed()) {
+			failed = true;
+			return false;
+		}
+
+		record = r;
+		return true;
+	}
+
+	TrafficRecorder::TrafficRecorder(std::wstring path) : file{ std::move(path) }, writer{} {
+		file.Open(IO::FileOpenMode::CREATE_OR_OVERWRITE | IO::FileOpenMode::WRITE_ONLY);
+		writer.WriteHeader();
+	}
+
+	TrafficRecorder::~TrafficRecorder() {
+		try {
+			Flush();
+		} catch(ExceptionBase & e) {
+			Log::Error("Failed to write the traffic recording: {0}", e.ToString());
+		}
+
+		file.Close();
+	}
+
+	void TrafficRecorder::Record(const TrafficRecord & record) {
+		writer.Write(record);
+
+		if(writer.GetBuffer().Size() >= RECORDER_FLUSH_SIZE) {
+			Flush();
+		}
+	}
+
+	void TrafficRecorder::Flush() {
+		const ArrayView<uint8_t> buffer = writer.GetBuffer();
+
+		if(buffer.Size() > 0) {
+			file.Write(buffer);
+			writer.Clear();
+		}
+	}
+
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <NetcodeFoundation/ArrayView.hpp>
+#include <Netcode/System/TimeTypes.h>
+#include <Netcode/IO/File.h>
+#include "WireFormat.h"
+#include <vector>
+
+namespace Netcode::Network {
+
+	enum class TrafficRecordType : uint8_t {
+		TICK = 1, GAME_MESSAGE = 2, CONTROL_MESSAGE = 3, CONNECT = 4
+	};
+
+	/**
+	 * One input of a server tick. A TICK record starts the inputs of a tick, the messages after it
+	 * were consumed by that tick and take its timestamp.
+	 */
+	struct TrafficRecord {
+		TrafficRecordType type;
+		// TICK only: local time of the tick, relative to the epoch of the server's clock
+		Timestamp timestamp;
+		int32_t connectionId;
+		// GAME_MESSAGE only
+		uint32_t sequence;
+		// post-decrypt message, control messages are serialized Protocol::Control
+		ArrayView<uint8_t> content;
+
+		TrafficRecord() : type{ TrafficRecordType::TICK }, timestamp{}, connectionId{ 0 }, sequence{ 0 }, content{ nullptr, 0 } { }
+	};
+
+	/*
+	 * Layout of a recording: u8[4] magic, u8 version, then records until the end:
+	 *  TICK:            u8 type, u64 timestamp in nanoseconds
+	 *  GAME_MESSAGE:    u8 type, VarUInt connectionId, VarUInt sequence, bytes content
+	 *  CONTROL_MESSAGE: u8 type, VarUInt connectionId, bytes content
+	 *  CONNECT:         u8 type, VarUInt connectionId
+	 */
+	class TrafficRecordWriter {
+		std::vector<uint8_t> buffer;
+
+	public:
+		void WriteHeader();
+
+		void Write(const TrafficRecord & record);
+
+		ArrayView<uint8_t> GetBuffer() const {
+			return ArrayView<uint8_t>{ buffer.data(), buffer.size() };
+		}
+
+		void Clear() {
+			buffer.clear();
+		}
+	};
+
+	/**
+	 * Reads a recording in place, content views point into the source
+	 */
+	class TrafficRecordReader {
+		WireReader reader;
+		bool failed;
+
+	public:
+		TrafficRecordReader(ArrayView<uint8_t> recording);
+
+		/**
+		 * @return false at the end of the recording or if a record is malformed
+		 */
+		bool Next(TrafficRecord & record);
+
+		/**
+		 * True if the header or a record was malformed, false if the reader simply reached the end
+		 */
+		bool HasFailed() const {
+			return failed;
+		}
+	};
+
+	/**
+	 * Appends records to a file, buffered. The buffer is written when it grows large and when the recorder is destroyed
+	 */
+	class TrafficRecorder {
+		IO::File file;
+		TrafficRecordWriter writer;
+
+	public:
+		/**
+		 * Creates or overwrites the file, throws an IOException on failure
+		 */
+		TrafficRecorder(std::wstring path);
+
+		~TrafficRecorder();
+
+		TrafficRecorder(const TrafficRecorder &) = delete;
+		TrafficRecorder & operator=(const TrafficRecorder &) = delete;
+
+		void Record(const TrafficRecord & record);
+
+		void Flush();
+	};
+
+}
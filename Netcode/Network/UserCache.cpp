@@ -0,0 +1,142 @@
+#include "UserCache.h"
+#include <algorithm>
+
+namespace Netcode::Network {
+
+	UserCache::UserCache(const UserCacheConfig & cfg) :
+		config{ cfg },
+		maxEntriesPerShard{},
+		shards{} {
+		config.numShards = std::max(config.numShards, 1u);
+		maxEntriesPerShard = std::max<size_t>(config.maxEntries / config.numShards, 1);
+		shards = std::make_unique<Shard[]>(config.numShards);
+	}
+
+	UserCache::Shard & UserCache::GetShard(const std::string & hash) {
+		return shards[std::hash<std::string>{}(hash) % config.numShards];
+	}
+
+	bool UserCache::IsCacheable(const QueryUserResult & result) {
+		// an unreachable database must not poison the cache
+		return !result.errorCode || result.errorCode == Errc::make_error_code(Errc::result_out_of_range);
+	}
+
+	UserCacheLookup UserCache::Lookup(const std::string & hash, const CompletionToken<QueryUserResult> & token) {
+		Shard & shard = GetShard(hash);
+		std::unique_lock<std::mutex> lock{ shard.mutex };
+
+		if(auto it = shard.entries.find(hash); it != shard.entries.end()) {
+			if(it->second->expiresAt > ClockType::now()) {
+				shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+
+				if(it->second->result.errorCode) {
+					shard.stats.negativeHits++;
+				} else {
+					shard.stats.hits++;
+				}
+
+				QueryUserResult result = it->second->result;
+				lock.unlock();
+				token->Set(std::move(result));
+				return UserCacheLookup::HIT;
+			}
+
+			shard.lru.erase(it->second);
+			shard.entries.erase(it);
+		}
+
+		if(auto it = shard.inFlight.find(hash); it != shard.inFlight.end()) {
+			it->second.waiters.push_back(token);
+			shard.stats.coalesced++;
+			return UserCacheLookup::JOINED;
+		}
+
+		InFlight & inFlight = shard.inFlight[hash];
+		inFlight.waiters.push_back(token);
+		inFlight.isInvalidated = false;
+		shard.stats.misses++;
+		return UserCacheLookup::MISS;
+	}
+
+	void UserCache::Complete(const std::string & hash, const QueryUserResult & result) {
+		Shard & shard = GetShard(hash);
+		std::vector<CompletionToken<QueryUserResult>> waiters;
+
+		{
+			std::unique_lock<std::mutex> lock{ shard.mutex };
+
+			auto it = shard.inFlight.find(hash);
+
+			if(it == shard.inFlight.end()) {
+				return;
+			}
+
+			waiters = std::move(it->second.waiters);
+			const bool isInvalidated = it->second.isInvalidated;
+			shard.inFlight.erase(it);
+
+			const Duration ttl = result.errorCode ? config.negativeTtl : config.ttl;
+
+			if(!isInvalidated && IsCacheable(result) && ttl > Duration::zero() && config.ttl > Duration::zero()) {
+				shard.lru.push_front(Entry{ hash, result, ClockType::now() + ttl });
+				shard.entries[hash] = shard.lru.begin();
+
+				while(shard.lru.size() > maxEntriesPerShard) {
+					shard.entries.erase(shard.lru.back().hash);
+					shard.lru.pop_back();
+					shard.stats.evictions++;
+				}
+			}
+		}
+
+		for(CompletionToken<QueryUserResult> & waiter : waiters) {
+			waiter->Set(result);
+		}
+	}
+
+	void UserCache::Invalidate(const std::string & hash) {
+		Shard & shard = GetShard(hash);
+		std::unique_lock<std::mutex> lock{ shard.mutex };
+
+		if(auto it = shard.entries.find(hash); it != shard.entries.end()) {
+			shard.lru.erase(it->second);
+			shard.entries.erase(it);
+		}
+
+		if(auto it = shard.inFlight.find(hash); it != shard.inFlight.end()) {
+			it->second.isInvalidated = true;
+		}
+	}
+
+	void UserCache::InvalidateAll() {
+		for(uint32_t i = 0; i < config.numShards; i++) {
+			Shard & shard = shards[i];
+			std::unique_lock<std::mutex> lock{ shard.mutex };
+
+			shard.lru.clear();
+			shard.entries.clear();
+
+			for(auto & kv : shard.inFlight) {
+				kv.second.isInvalidated = true;
+			}
+		}
+	}
+
+	UserCacheStats UserCache::GetStatistics() const {
+		UserCacheStats sum;
+
+		for(uint32_t i = 0; i < config.numShards; i++) {
+			Shard & shard = shards[i];
+			std::unique_lock<std::mutex> lock{ shard.mutex };
+
+			sum.hits += shard.stats.hits;
+			sum.negativeHits += shard.stats.negativeHits;
+			sum.misses += shard.stats.misses;
+			sum.coalesced += shard.stats.coalesced;
+			sum.evictions += shard.stats.evictions;
+		}
+
+		return sum;
+	}
+
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <Netcode/System/TimeTypes.h>
+
+#include "NetworkCommon.h"
+#include "CompletionToken.h"
+
+namespace Netcode::Network {
+
+	struct QueryUserResult {
+		ErrorCode errorCode;
+		PlayerDbDataRow playerData;
+	};
+
+	struct UserCacheConfig {
+		// lifetime of a resolved user, zero disables the cache
+		Duration ttl;
+		// lifetime of an unknown hash
+		Duration negativeTtl;
+		// upper limit of cached hashes, distributed evenly between the shards
+		uint32_t maxEntries;
+		uint32_t numShards;
+
+		UserCacheConfig() :
+			ttl{ std::chrono::seconds(60) },
+			negativeTtl{ std::chrono::seconds(5) },
+			maxEntries{ 4096 },
+			numShards{ 16 } { }
+	};
+
+	struct UserCacheStats {
+		uint64_t hits;
+		uint64_t negativeHits;
+		uint64_t misses;
+		// lookups that joined an already running query for the same hash
+		uint64_t coalesced;
+		uint64_t evictions;
+
+		UserCacheStats() : hits{ 0 }, negativeHits{ 0 }, misses{ 0 }, coalesced{ 0 }, evictions{ 0 } { }
+	};
+
+	enum class UserCacheLookup : uint32_t {
+		// the token was completed from the cache
+		HIT,
+		// the token will be completed by a query started earlier
+		JOINED,
+		// the caller must query the hash and report back with Complete()
+		MISS
+	};
+
+	/**
+	 * Sharded TTL + LRU cache of the session hash to user lookups.
+	 * Concurrent misses of the same hash are deduplicated: only the first one is sent to the database,
+	 * the rest wait for its result.
+	 */
+	class UserCache {
+		struct Entry {
+			std::string hash;
+			QueryUserResult result;
+			Timestamp expiresAt;
+		};
+
+		struct InFlight {
+			std::vector<CompletionToken<QueryUserResult>> waiters;
+			bool isInvalidated;
+		};
+
+		struct Shard {
+			std::mutex mutex;
+			// most recently used at the front
+			std::list<Entry> lru;
+			std::unordered_map<std::string, std::list<Entry>::iterator> entries;
+			std::unordered_map<std::string, InFlight> inFlight;
+			UserCacheStats stats;
+		};
+
+		UserCacheConfig config;
+		size_t maxEntriesPerShard;
+		std::unique_ptr<Shard[]> shards;
+
+		Shard & GetShard(const std::string & hash);
+
+		static bool IsCacheable(const QueryUserResult & result);
+
+	public:
+		UserCache(const UserCacheConfig & config);
+
+		UserCacheLookup Lookup(const std::string & hash, const CompletionToken<QueryUserResult> & token);
+
+		/**
+		 * Completes every token waiting for the hash and caches the result unless it was a transient error
+		 */
+		void Complete(const std::string & hash, const QueryUserResult & result);
+
+		/**
+		 * Drops the cached hash, a query in flight still completes its waiters but its result is not cached
+		 */
+		void Invalidate(const std::string & hash);
+
+		void InvalidateAll();
+
+		UserCacheStats GetStatistics() const;
+	};
+
+}
@@ -0,0 +1,207 @@
+#include "WireFormat.h"
+#include <cstring>
+
+namespace Netcode::Network {
+
+	constexpr static uint32_t MAX_VARINT_GROUPS = 5;
+
+	WireWriter::WireWriter(MutableArrayView<uint8_t> buffer) : data{ buffer.Data() }, size{ buffer.Size() }, offset{ 0 }, overflowed{ false } {
+
+	}
+
+	uint8_t * WireWriter::Reserve(size_t numBytes) {
+		if(overflowed || numBytes > (size - offset)) {
+			overflowed = true;
+			return nullptr;
+		}
+
+		uint8_t * ptr = data + offset;
+		offset += numBytes;
+		return ptr;
+	}
+
+	void WireWriter::WriteU8(uint8_t value) {
+		if(uint8_t * ptr = Reserve(1); ptr != nullptr) {
+			ptr[0] = value;
+		}
+	}
+
+	void WireWriter::WriteU16(uint16_t value) {
+		if(uint8_t * ptr = Reserve(2); ptr != nullptr) {
+			ptr[0] = static_cast<uint8_t>(value >> 8);
+			ptr[1] = static_cast<uint8_t>(value);
+		}
+	}
+
+	void WireWriter::WriteU32(uint32_t value) {
+		if(uint8_t * ptr = Reserve(4); ptr != nullptr) {
+			ptr[0] = static_cast<uint8_t>(value >> 24);
+			ptr[1] = static_cast<uint8_t>(value >> 16);
+			ptr[2] = static_cast<uint8_t>(value >> 8);
+			ptr[3] = static_cast<uint8_t>(value);
+		}
+	}
+
+	void WireWriter::WriteU64(uint64_t value) {
+		WriteU32(static_cast<uint32_t>(value >> 32));
+		WriteU32(static_cast<uint32_t>(value));
+	}
+
+	void WireWriter::WriteI32(int32_t value) {
+		WriteU32(static_cast<uint32_t>(value));
+	}
+
+	void WireWriter::WriteF32(float value) {
+		static_assert(sizeof(float) == sizeof(uint32_t));
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		WriteU32(bits);
+	}
+
+	void WireWriter::WriteVarUInt(uint32_t value) {
+		do {
+			const uint32_t group = value & 0x7Fu;
+			value >>= 7;
+			WriteU8(static_cast<uint8_t>(group | ((value != 0) ? 0x80u : 0u)));
+		} while(value != 0);
+	}
+
+	void WireWriter::WriteBytes(ArrayView<uint8_t> bytes) {
+		WriteVarUInt(static_cast<uint32_t>(bytes.Size()));
+
+		if(bytes.Size() == 0) {
+			return;
+		}
+
+		if(uint8_t * ptr = Reserve(bytes.Size()); ptr != nullptr) {
+			memcpy(ptr, bytes.Data(), bytes.Size());
+		}
+	}
+
+	void WireWriter::WriteRaw(ArrayView<uint8_t> bytes) {
+		if(bytes.Size() == 0) {
+			return;
+		}
+
+		if(uint8_t * ptr = Reserve(bytes.Size()); ptr != nullptr) {
+			memcpy(ptr, bytes.Data(), bytes.Size());
+		}
+	}
+
+	void WireWriter::PatchU16(size_t at, uint16_t value) {
+		if(overflowed || at + 2 > offset) {
+			overflowed = true;
+			return;
+		}
+
+		data[at] = static_cast<uint8_t>(value >> 8);
+		data[at + 1] = static_cast<uint8_t>(value);
+	}
+
+	uint32_t WireWriter::GetVarUIntSize(uint32_t value) {
+		uint32_t numBytes = 1;
+		while(value >= 0x80u) {
+			value >>= 7;
+			numBytes++;
+		}
+		return numBytes;
+	}
+
+	WireReader::WireReader(ArrayView<uint8_t> buffer) : data{ buffer.Data() }, size{ buffer.Size() }, offset{ 0 }, overflowed{ false } {
+
+	}
+
+	const uint8_t * WireReader::Consume(size_t numBytes) {
+		if(overflowed || numBytes > (size - offset)) {
+			overflowed = true;
+			return nullptr;
+		}
+
+		const uint8_t * ptr = data + offset;
+		offset += numBytes;
+		return ptr;
+	}
+
+	uint8_t WireReader::ReadU8() {
+		const uint8_t * ptr = Consume(1);
+		return (ptr != nullptr) ? ptr[0] : 0;
+	}
+
+	uint16_t WireReader::ReadU16() {
+		const uint8_t * ptr = Consume(2);
+
+		if(ptr == nullptr) {
+			return 0;
+		}
+
+		return static_cast<uint16_t>((static_cast<uint32_t>(ptr[0]) << 8) | ptr[1]);
+	}
+
+	uint32_t WireReader::ReadU32() {
+		const uint8_t * ptr = Consume(4);
+
+		if(ptr == nullptr) {
+			return 0;
+		}
+
+		return (static_cast<uint32_t>(ptr[0]) << 24) |
+			(static_cast<uint32_t>(ptr[1]) << 16) |
+			(static_cast<uint32_t>(ptr[2]) << 8) |
+			static_cast<uint32_t>(ptr[3]);
+	}
+
+	uint64_t WireReader::ReadU64() {
+		const uint64_t high = ReadU32();
+		return (high << 32) | ReadU32();
+	}
+
+	int32_t WireReader::ReadI32() {
+		return static_cast<int32_t>(ReadU32());
+	}
+
+	float WireReader::ReadF32() {
+		const uint32_t bits = ReadU32();
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	uint32_t WireReader::ReadVarUInt() {
+		uint32_t value = 0;
+
+		for(uint32_t i = 0; i < MAX_VARINT_GROUPS; i++) {
+			const uint32_t group = ReadU8();
+
+			if(overflowed) {
+				return 0;
+			}
+
+			value |= (group & 0x7Fu) << (7 * i);
+
+			if((group & 0x80u) == 0) {
+				return value;
+			}
+		}
+
+		// a sixth group can not be part of a 32 bit value
+		overflowed = true;
+		return 0;
+	}
+
+	ArrayView<uint8_t> WireReader::ReadBytes() {
+		const uint32_t numBytes = ReadVarUInt();
+
+		if(overflowed) {
+			return ArrayView<uint8_t>{ nullptr, 0 };
+		}
+
+		const uint8_t * ptr = Consume(numBytes);
+
+		if(ptr == nullptr) {
+			return ArrayView<uint8_t>{ nullptr, 0 };
+		}
+
+		return ArrayView<uint8_t>{ ptr, numBytes };
+	}
+
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <NetcodeFoundation/ArrayView.hpp>
+#include <cstdint>
+
+namespace Netcode::Network {
+
+	/**
+	 * Writes byte aligned values in network byte order directly into a caller owned buffer.
+	 * Writing past the end of the buffer sets the overflow flag and ignores the value,
+	 * so a frame can be written without checking every call.
+	 */
+	class WireWriter {
+		uint8_t * data;
+		size_t size;
+		size_t offset;
+		bool overflowed;
+
+		uint8_t * Reserve(size_t numBytes);
+
+	public:
+		WireWriter(MutableArrayView<uint8_t> buffer);
+
+		void WriteU8(uint8_t value);
+
+		void WriteU16(uint16_t value);
+
+		void WriteU32(uint32_t value);
+
+		void WriteU64(uint64_t value);
+
+		void WriteI32(int32_t value);
+
+		void WriteF32(float value);
+
+		/**
+		 * Groups of 7 bits with a continuation bit, least significant group first
+		 */
+		void WriteVarUInt(uint32_t value);
+
+		/**
+		 * Length prefixed (VarUInt) bytes
+		 */
+		void WriteBytes(ArrayView<uint8_t> bytes);
+
+		/**
+		 * Bytes without a length prefix, eg. values written by another writer earlier
+		 */
+		void WriteRaw(ArrayView<uint8_t> bytes);
+
+		/**
+		 * Overwrites a previously written U16, eg. an item count that is only known after the items
+		 */
+		void PatchU16(size_t at, uint16_t value);
+
+		size_t GetOffset() const {
+			return offset;
+		}
+
+		bool HasOverflowed() const {
+			return overflowed;
+		}
+
+		static uint32_t GetVarUIntSize(uint32_t value);
+
+		static uint32_t GetBytesSize(uint32_t numBytes) {
+			return GetVarUIntSize(numBytes) + numBytes;
+		}
+	};
+
+	/**
+	 * Reads the output of WireWriter in place. Every read is bounds checked, reading past the end
+	 * sets the overflow flag and returns zeros, byte views point into the source buffer.
+	 */
+	class WireReader {
+		const uint8_t * data;
+		size_t size;
+		size_t offset;
+		bool overflowed;
+
+		const uint8_t * Consume(size_t numBytes);
+
+	public:
+		WireReader(ArrayView<uint8_t> buffer);
+
+		uint8_t ReadU8();
+
+		uint16_t ReadU16();
+
+		uint32_t ReadU32();
+
+		uint64_t ReadU64();
+
+		int32_t ReadI32();
+
+		float ReadF32();
+
+		uint32_t ReadVarUInt();
+
+		ArrayView<uint8_t> ReadBytes();
+
+		size_t GetOffset() const {
+			return offset;
+		}
+
+		size_t GetRemainingSize() const {
+			return size - offset;
+		}
+
+		bool HasOverflowed() const {
+			return overflowed;
+		}
+	};
+
+}
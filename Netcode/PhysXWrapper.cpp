@@ -51,4 +51,9 @@ namespace Netcode::Physics {
 		foundation.Reset();
 	}
 
+	void StepScene(physx::PxScene * scene, Duration dt) {
+		scene->simulate(std::chrono::duration<float>(dt).count());
+		scene->fetchResults(true);
+	}
+
 }
@@ -2,6 +2,7 @@
 
 #include "Modules.h"
 #include "PxPtr.hpp"
+#include "System/TimeTypes.h"
 #include <physx/PxPhysicsAPI.h>
 #include <vector>
 #include <memory>
@@ -30,4 +31,9 @@ namespace Netcode::Physics {
 		void ReleaseResources();
 	};
 
+	/*
+	 * Advances the scene by dt and waits for the results. Different scenes of the same PhysX instance may be stepped concurrently
+	 */
+	void StepScene(physx::PxScene * scene, Duration dt);
+
 }
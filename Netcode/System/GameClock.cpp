@@ -4,7 +4,7 @@
 namespace Netcode {
 
 	GameClock::GameClock() : fixedUpdateInterval{ std::chrono::milliseconds(16) }, fixedUpdateCache{}, fixedUpdateAcc{},
-		deltaTime{}, deltaRtt{}, thetaClockOffset{}, totalTimeSinceEpoch{},
+		deltaTime{}, deltaRtt{}, thetaClockOffset{}, clockErrorBound{}, totalTimeSinceEpoch{},
 		epoch{}, localFrameTimestamp{}, globalFrameTimestamp{} {
 
 	}
@@ -21,6 +21,11 @@ namespace Netcode {
 		thetaClockOffset = theta;
 	}
 
+	void GameClock::SynchronizeClocks(Duration delta, Duration theta, Duration errorBound) {
+		SynchronizeClocks(delta, theta);
+		clockErrorBound = errorBound;
+	}
+
 	void GameClock::SetFixedUpdateInterval(Duration d) {
 		fixedUpdateInterval = d;
 	}
@@ -87,10 +92,12 @@ namespace Netcode {
 	}
 
 	void GameClock::Tick() {
-		const Timestamp newFrameTimestamp = SystemClock::LocalNow() - epoch;
+		Tick(SystemClock::LocalNow() - epoch);
+	}
 
-		deltaTime = newFrameTimestamp - localFrameTimestamp;
-		localFrameTimestamp = newFrameTimestamp;
+	void GameClock::Tick(Timestamp frameTimestamp) {
+		deltaTime = frameTimestamp - localFrameTimestamp;
+		localFrameTimestamp = frameTimestamp;
 		globalFrameTimestamp = localFrameTimestamp + deltaRtt / 2 + thetaClockOffset;
 
 		fixedUpdateCache = Duration{ };
@@ -11,6 +11,7 @@ namespace Netcode {
 		Duration deltaTime;
 		Duration deltaRtt;
 		Duration thetaClockOffset;
+		Duration clockErrorBound;
 		Duration totalTimeSinceEpoch;
 		Duration epoch;
 		Timestamp localFrameTimestamp;
@@ -28,6 +29,16 @@ namespace Netcode {
 		
 		void SynchronizeClocks(Duration delta, Duration theta);
 
+		void SynchronizeClocks(Duration delta, Duration theta, Duration errorBound);
+
+		/*
+		 * Estimated upper bound of the global time error, interpolation and lag compensation margins should not be tighter than this
+		 */
+		[[nodiscard]]
+		Duration GetClockErrorBound() const {
+			return clockErrorBound;
+		}
+
 		void SetFixedUpdateInterval(Duration d);
 
 		[[nodiscard]]
@@ -66,6 +77,12 @@ namespace Netcode {
 		double DGetTotalTime() const;
 
 		void Tick();
+
+		/**
+		 * Advances to a given frame instead of reading the system clock, eg. when replaying a recording
+		 * @param frameTimestamp local time of the frame, relative to the epoch
+		 */
+		void Tick(Timestamp frameTimestamp);
 	};
 	
 }
@@ -0,0 +1,358 @@
+#include "JobSystem.h"
+#include "Profiler.h"
+#include <NetcodeFoundation/Exceptions.h>
+#include <chrono>
+
+namespace Netcode {
+
+	static thread_local const JobSystem * currentSystem = nullptr;
+	static thread_local void * currentWorker = nullptr;
+
+	// spins before a worker without jobs goes to sleep
+	constexpr static uint32_t IDLE_SPIN_COUNT = 64;
+
+	JobDeque::JobDeque() : top{ 0 }, bottom{ 0 }, buffer{ std::make_unique<std::atomic<Job *>[]>(CAPACITY) } {
+
+	}
+
+	bool JobDeque::Push(Job * job) {
+		const int64_t b = bottom.load(std::memory_order_relaxed);
+		const int64_t t = top.load(std::memory_order_acquire);
+
+		if(b - t >= CAPACITY) {
+			return false;
+		}
+
+		buffer[b & MASK].store(job, std::memory_order_relaxed);
+		bottom.store(b + 1);
+		return true;
+	}
+
+	Job * JobDeque::Pop() {
+		const int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+		// sequentially consistent, a concurrent Steal either sees the reserved slot or loses the race for it
+		bottom.store(b);
+		int64_t t = top.load();
+
+		if(t > b) {
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		Job * job = buffer[b & MASK].load(std::memory_order_relaxed);
+
+		if(t == b) {
+			// last job, races with the thieves
+			if(!top.compare_exchange_strong(t, t + 1)) {
+				job = nullptr;
+			}
+			bottom.store(b + 1, std::memory_order_relaxed);
+		}
+
+		return job;
+	}
+
+	Job * JobDeque::Steal() {
+		int64_t t = top.load();
+		const int64_t b = bottom.load();
+
+		if(t >= b) {
+			return nullptr;
+		}
+
+		Job * job = buffer[t & MASK].load(std::memory_order_relaxed);
+
+		if(!top.compare_exchange_strong(t, t + 1)) {
+			return nullptr;
+		}
+
+		return job;
+	}
+
+	JobSystem::Worker::Worker(uint32_t seed) : deque{}, pool{ std::make_unique<Job[]>(JOB_POOL_SIZE) }, poolIndex{ 0 }, randomState{ seed * 2654435761u + 1 } {
+
+	}
+
+	JobSystem::JobSystem(uint32_t numThreads) : workers{}, threads{}, foreignWorker{ 0 }, injectedJobs{}, mainThreadJobs{}, queueMutex{},
+		numInjected{ 0 }, sleepMutex{}, wakeUp{}, numSleeping{ 0 }, stopping{ false } {
+		if(numThreads == 0) {
+			numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+		}
+
+		for(uint32_t i = 0; i < numThreads; i++) {
+			workers.emplace_back(std::make_unique<Worker>(i + 1));
+		}
+
+		currentSystem = this;
+		currentWorker = workers[0].get();
+
+		for(uint32_t i = 1; i < numThreads; i++) {
+			threads.emplace_back([this, i]() -> void { WorkerLoop(i); });
+		}
+	}
+
+	JobSystem::~JobSystem() {
+		stopping = true;
+
+		{
+			std::unique_lock<std::mutex> lock{ sleepMutex };
+			wakeUp.notify_all();
+		}
+
+		for(std::thread & t : threads) {
+			t.join();
+		}
+
+		if(currentSystem == this) {
+			currentSystem = nullptr;
+			currentWorker = nullptr;
+		}
+	}
+
+	JobSystem::Worker * JobSystem::GetCurrentWorker() const {
+		return (currentSystem == this) ? static_cast<Worker *>(currentWorker) : nullptr;
+	}
+
+	Job * JobSystem::Allocate() {
+		Worker * worker = GetCurrentWorker();
+		std::unique_lock<std::mutex> lock{ queueMutex, std::defer_lock };
+
+		if(worker == nullptr) {
+			lock.lock();
+			worker = &foreignWorker;
+		}
+
+		Job * job = &worker->pool[worker->poolIndex++ & (JOB_POOL_SIZE - 1)];
+
+		// the pool wrapped around while the job was still in flight
+		UndefinedBehaviourAssertion(job->numUnfinished.load(std::memory_order_acquire) == 0);
+
+		// finished, but the thread finishing it may still be reading it
+		while(!job->released.load(std::memory_order_acquire)) {
+			std::this_thread::yield();
+		}
+
+		return job;
+	}
+
+	void JobSystem::Initialize(Job * job, Job * parent, bool mainThread) {
+		if(parent != nullptr) {
+			parent->numUnfinished.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		job->function.Reset();
+		job->parent = parent;
+		job->numUnfinished.store(1, std::memory_order_relaxed);
+		// released by Run
+		job->numDependencies.store(1, std::memory_order_relaxed);
+		job->numContinuations = 0;
+		job->mainThread = mainThread;
+		job->released.store(false, std::memory_order_relaxed);
+	}
+
+	void JobSystem::AddDependency(JobHandle job, JobHandle dependency) {
+		UndefinedBehaviourAssertion(dependency->numContinuations < Job::MAX_CONTINUATIONS);
+
+		dependency->continuations[dependency->numContinuations++] = job;
+		job->numDependencies.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void JobSystem::Run(JobHandle job) {
+		if(job->numDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			Submit(job);
+		}
+	}
+
+	void JobSystem::Submit(Job * job) {
+		Worker * worker = GetCurrentWorker();
+
+		if(job->mainThread) {
+			std::unique_lock<std::mutex> lock{ queueMutex };
+			mainThreadJobs.push_back(job);
+			return;
+		}
+
+		if(worker == nullptr || !worker->deque.Push(job)) {
+			std::unique_lock<std::mutex> lock{ queueMutex };
+			injectedJobs.push_back(job);
+			numInjected.fetch_add(1);
+		}
+
+		if(numSleeping.load() > 0) {
+			std::unique_lock<std::mutex> lock{ sleepMutex };
+			wakeUp.notify_one();
+		}
+	}
+
+	void JobSystem::Execute(Job * job) {
+		job->function();
+		job->function.Reset();
+		Finish(job);
+	}
+
+	void JobSystem::Finish(Job * job) {
+		if(job->numUnfinished.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+			return;
+		}
+
+		Job * parent = job->parent;
+		const uint32_t numContinuations = job->numContinuations;
+		Job * continuations[Job::MAX_CONTINUATIONS];
+		std::copy(job->continuations, job->continuations + numContinuations, continuations);
+
+		job->released.store(true, std::memory_order_release);
+
+		for(uint32_t i = 0; i < numContinuations; i++) {
+			Run(continuations[i]);
+		}
+
+		if(parent != nullptr) {
+			Finish(parent);
+		}
+	}
+
+	Job * JobSystem::FindJob(Worker * worker) {
+		Job * job = worker->deque.Pop();
+
+		if(job != nullptr) {
+			return job;
+		}
+
+		if(numInjected.load(std::memory_order_relaxed) > 0) {
+			std::unique_lock<std::mutex> lock{ queueMutex };
+
+			if(!injectedJobs.empty()) {
+				job = injectedJobs.back();
+				injectedJobs.pop_back();
+				numInjected.fetch_sub(1);
+				return job;
+			}
+		}
+
+		const uint32_t numWorkers = static_cast<uint32_t>(workers.size());
+
+		if(numWorkers <= 1) {
+			return nullptr;
+		}
+
+		// xorshift, starting from a random victim spreads the thieves
+		worker->randomState ^= worker->randomState << 13;
+		worker->randomState ^= worker->randomState >> 17;
+		worker->randomState ^= worker->randomState << 5;
+		const uint32_t first = worker->randomState % numWorkers;
+
+		for(uint32_t i = 0; i < numWorkers; i++) {
+			Worker * victim = workers[(first + i) % numWorkers].get();
+
+			if(victim == worker) {
+				continue;
+			}
+
+			job = victim->deque.Steal();
+
+			if(job != nullptr) {
+				return job;
+			}
+		}
+
+		return nullptr;
+	}
+
+	bool JobSystem::RunMainThreadJob() {
+		Job * job = nullptr;
+
+		{
+			std::unique_lock<std::mutex> lock{ queueMutex };
+
+			if(mainThreadJobs.empty()) {
+				return false;
+			}
+
+			job = mainThreadJobs.front();
+			mainThreadJobs.erase(mainThreadJobs.begin());
+		}
+
+		Execute(job);
+		return true;
+	}
+
+	void JobSystem::RunMainThreadJobs() {
+		UndefinedBehaviourAssertion(GetCurrentWorker() == workers[0].get());
+
+		while(RunMainThreadJob()) { }
+	}
+
+	bool JobSystem::HasWork() const {
+		if(numInjected.load() > 0) {
+			return true;
+		}
+
+		for(const std::unique_ptr<Worker> & worker : workers) {
+			if(!worker->deque.IsEmpty()) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void JobSystem::Wait(JobHandle job) {
+		Worker * worker = GetCurrentWorker();
+		const bool isMainThread = (worker == workers[0].get());
+
+		while(!IsFinished(job)) {
+			if(isMainThread && RunMainThreadJob()) {
+				continue;
+			}
+
+			Job * next = (worker != nullptr) ? FindJob(worker) : nullptr;
+
+			if(next != nullptr) {
+				Execute(next);
+			} else {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	void JobSystem::WorkerLoop(uint32_t index) {
+		Worker * worker = workers[index].get();
+		currentSystem = this;
+		currentWorker = worker;
+
+		NETCODE_PROFILE_THREAD("Job worker");
+
+		uint32_t idleCount = 0;
+
+		while(!stopping.load(std::memory_order_relaxed)) {
+			Job * job = FindJob(worker);
+
+			if(job != nullptr) {
+				Execute(job);
+				idleCount = 0;
+				continue;
+			}
+
+			if(++idleCount < IDLE_SPIN_COUNT) {
+				std::this_thread::yield();
+				continue;
+			}
+
+			/*
+			 * Submit checks for sleepers after publishing its job, the sleeper checks for jobs after
+			 * announcing itself, one of them sees the other. The timeout is only a safety net.
+			 */
+			numSleeping.fetch_add(1);
+			{
+				std::unique_lock<std::mutex> lock{ sleepMutex };
+
+				if(!HasWork() && !stopping.load()) {
+					wakeUp.wait_for(lock, std::chrono::milliseconds(10));
+				}
+			}
+			numSleeping.fetch_sub(1);
+			idleCount = 0;
+		}
+	}
+
+}
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <Netcode/PlacedFunction.hpp>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Netcode {
+
+	class JobSystem;
+
+	/**
+	 * Unit of work of the JobSystem. A job counts itself and its unfinished children and is finished
+	 * when the count reaches zero. Continuations are the jobs depending on it, they are submitted
+	 * when their last dependency finishes.
+	 */
+	class Job {
+		friend class JobSystem;
+
+		constexpr static uint32_t MAX_CONTINUATIONS = 8;
+
+		PlacedFunction<120, void()> function;
+		Job * parent;
+		std::atomic<int32_t> numUnfinished;
+		std::atomic<int32_t> numDependencies;
+		// set once Finish no longer reads the job, the slot can be reused afterwards
+		std::atomic<bool> released;
+		uint32_t numContinuations;
+		bool mainThread;
+		Job * continuations[MAX_CONTINUATIONS];
+
+	public:
+		Job() : function{}, parent{ nullptr }, numUnfinished{ 0 }, numDependencies{ 0 }, released{ true }, numContinuations{ 0 }, mainThread{ false }, continuations{} { }
+	};
+
+	using JobHandle = Job *;
+
+	/**
+	 * Chase-Lev work stealing deque of a fixed capacity. The owner pushes and pops at the bottom,
+	 * the other threads steal from the top.
+	 */
+	class JobDeque {
+		constexpr static int64_t CAPACITY = 4096;
+		constexpr static int64_t MASK = CAPACITY - 1;
+
+		std::atomic<int64_t> top;
+		std::atomic<int64_t> bottom;
+		std::unique_ptr<std::atomic<Job *>[]> buffer;
+
+	public:
+		JobDeque();
+
+		/**
+		 * Owner only
+		 * @return false if the deque is full
+		 */
+		bool Push(Job * job);
+
+		/**
+		 * Owner only, the most recently pushed job
+		 */
+		Job * Pop();
+
+		/**
+		 * Any thread, the oldest job. Returns null if the deque is empty or another thread took the job
+		 */
+		Job * Steal();
+
+		bool IsEmpty() const {
+			return top.load() >= bottom.load();
+		}
+	};
+
+	/**
+	 * Fixed thread work stealing scheduler. The thread creating the system is its main thread, it runs
+	 * jobs while it waits for one and it is the only thread running the main thread affinity jobs.
+	 *
+	 * Jobs are created, optionally given children and dependencies, then submitted with Run.
+	 * A job is recycled after JOB_POOL_SIZE newer jobs were created on the same thread, its handle must not be used by then.
+	 * Jobs can be created and submitted from any thread, threads outside of the system do not run jobs while waiting.
+	 */
+	class JobSystem {
+	public:
+		constexpr static uint32_t JOB_POOL_SIZE = 4096;
+		// a ParallelFor is split into at most this many jobs
+		constexpr static uint32_t MAX_PARALLEL_FOR_JOBS = 256;
+
+	private:
+		struct Worker {
+			JobDeque deque;
+			std::unique_ptr<Job[]> pool;
+			uint32_t poolIndex;
+			uint32_t randomState;
+
+			Worker(uint32_t seed);
+		};
+
+		std::vector<std::unique_ptr<Worker>> workers;
+		std::vector<std::thread> threads;
+		// jobs of threads outside of the system, guarded by queueMutex
+		Worker foreignWorker;
+		std::vector<Job *> injectedJobs;
+		std::vector<Job *> mainThreadJobs;
+		std::mutex queueMutex;
+		std::atomic<uint32_t> numInjected;
+		std::mutex sleepMutex;
+		std::condition_variable wakeUp;
+		std::atomic<uint32_t> numSleeping;
+		std::atomic<bool> stopping;
+
+		Worker * GetCurrentWorker() const;
+
+		Job * Allocate();
+
+		void Initialize(Job * job, Job * parent, bool mainThread);
+
+		void Submit(Job * job);
+
+		void Execute(Job * job);
+
+		void Finish(Job * job);
+
+		Job * FindJob(Worker * worker);
+
+		bool RunMainThreadJob();
+
+		bool HasWork() const;
+
+		void WorkerLoop(uint32_t index);
+
+	public:
+		/**
+		 * @param numThreads threads running jobs including the calling thread, 0 uses every hardware thread
+		 */
+		JobSystem(uint32_t numThreads);
+
+		~JobSystem();
+
+		JobSystem(const JobSystem &) = delete;
+		JobSystem & operator=(const JobSystem &) = delete;
+
+		uint32_t GetNumThreads() const {
+			return static_cast<uint32_t>(workers.size());
+		}
+
+		template<typename F>
+		JobHandle Create(F && f) {
+			Job * job = Allocate();
+			Initialize(job, nullptr, false);
+			job->function = std::forward<F>(f);
+			return job;
+		}
+
+		/**
+		 * The parent is not finished until the child is, the parent must not be finished yet
+		 */
+		template<typename F>
+		JobHandle CreateChild(JobHandle parent, F && f) {
+			Job * job = Allocate();
+			Initialize(job, parent, false);
+			job->function = std::forward<F>(f);
+			return job;
+		}
+
+		/**
+		 * The job runs on the main thread, in RunMainThreadJobs or while the main thread waits
+		 */
+		template<typename F>
+		JobHandle CreateMainThread(F && f) {
+			Job * job = Allocate();
+			Initialize(job, nullptr, true);
+			job->function = std::forward<F>(f);
+			return job;
+		}
+
+		/**
+		 * The job is not started before the dependency is finished, neither of them may be submitted yet
+		 */
+		void AddDependency(JobHandle job, JobHandle dependency);
+
+		/**
+		 * Submits the job, it starts when its dependencies are finished
+		 */
+		void Run(JobHandle job);
+
+		/**
+		 * Runs other jobs until the job and its children are finished
+		 */
+		void Wait(JobHandle job);
+
+		bool IsFinished(JobHandle job) const {
+			return job->numUnfinished.load(std::memory_order_acquire) == 0;
+		}
+
+		/**
+		 * Main thread only, runs the main thread affinity jobs submitted so far
+		 */
+		void RunMainThreadJobs();
+
+		/**
+		 * Calls fn(first, last) over consecutive subranges of [begin, end) in parallel and waits for them.
+		 * The subranges are at least grainSize long except the last one.
+		 */
+		template<typename F>
+		void ParallelFor(uint32_t begin, uint32_t end, uint32_t grainSize, F fn) {
+			if(begin >= end) {
+				return;
+			}
+
+			const uint32_t count = end - begin;
+			const uint32_t minGrain = (count + MAX_PARALLEL_FOR_JOBS - 1) / MAX_PARALLEL_FOR_JOBS;
+			const uint32_t grain = std::max({ grainSize, minGrain, 1u });
+
+			if(count <= grain || workers.size() == 1) {
+				fn(begin, end);
+				return;
+			}
+
+			JobHandle root = Create([]() -> void { });
+
+			for(uint32_t first = begin; first < end; first += std::min(grain, end - first)) {
+				const uint32_t last = first + std::min(grain, end - first);
+				Run(CreateChild(root, [&fn, first, last]() -> void { fn(first, last); }));
+			}
+
+			Run(root);
+			Wait(root);
+		}
+	};
+
+}
@@ -0,0 +1,284 @@
+#include "Profiler.h"
+#include "SystemClock.h"
+#include <Netcode/Network/WireFormat.h>
+#include <algorithm>
+#include <sstream>
+#include <unordered_map>
+
+namespace Netcode {
+
+	constexpr static uint8_t PROFILE_MAGIC[4] = { 'N', 'P', 'R', 'F' };
+	constexpr static uint8_t PROFILE_VERSION = 1;
+	constexpr static uint32_t PROFILE_EVENT_SIZE = 1 + 2 + 4 + 8 + 8;
+
+	std::atomic<bool> Profiler::enabled{ false };
+	std::mutex Profiler::buffersMutex;
+	std::vector<std::unique_ptr<ProfileThreadBuffer>> Profiler::buffers;
+
+	static thread_local ProfileThreadBuffer * threadBuffer = nullptr;
+
+	ProfileThreadBuffer::ProfileThreadBuffer(uint32_t id) : events{ std::make_unique<ProfileEvent[]>(CAPACITY) },
+		writeIndex{ 0 }, readIndex{ 0 }, numDropped{ 0 }, numOpenScopes{ 0 }, droppedDepth{ 0 }, threadId{ id }, threadName{} {
+
+	}
+
+	ProfileThreadBuffer * Profiler::GetThreadBuffer() {
+		if(threadBuffer == nullptr) {
+			std::unique_lock<std::mutex> lock{ buffersMutex };
+			// the buffers outlive their threads, the events of a finished thread can still be collected
+			buffers.emplace_back(std::make_unique<ProfileThreadBuffer>(static_cast<uint32_t>(buffers.size()) + 1));
+			threadBuffer = buffers.back().get();
+		}
+
+		return threadBuffer;
+	}
+
+	void Profiler::Record(ProfileEventType type, const char * name, int64_t value) {
+		ProfileEvent event;
+		event.name = name;
+		event.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(SystemClock::LocalNow().time_since_epoch()).count();
+		event.value = value;
+		event.type = type;
+
+		GetThreadBuffer()->Push(event);
+	}
+
+	void Profiler::SetThreadName(const char * name) {
+		if(!IsEnabled()) {
+			return;
+		}
+
+		ProfileThreadBuffer * buffer = GetThreadBuffer();
+
+		std::unique_lock<std::mutex> lock{ buffersMutex };
+		buffer->threadName = name;
+	}
+
+	void Profiler::Collect(ProfileCapture & capture) {
+		std::unique_lock<std::mutex> lock{ buffersMutex };
+
+		std::unordered_map<std::string, uint32_t> nameIndices;
+		for(uint32_t i = 0; i < capture.names.size(); i++) {
+			nameIndices.emplace(capture.names[i], i);
+		}
+
+		// the same literal is looked up once per collect
+		std::unordered_map<const char *, uint32_t> literalIndices;
+
+		uint64_t numDropped = 0;
+
+		for(const std::unique_ptr<ProfileThreadBuffer> & buffer : buffers) {
+			auto threadIt = std::find_if(std::begin(capture.threads), std::end(capture.threads), [&buffer](const ProfileCapture::Thread & t) -> bool {
+				return t.id == buffer->threadId;
+			});
+
+			if(threadIt == std::end(capture.threads)) {
+				capture.threads.push_back(ProfileCapture::Thread{ buffer->threadId, buffer->threadName });
+				threadIt = std::prev(std::end(capture.threads));
+			}
+
+			threadIt->name = buffer->threadName;
+			const uint32_t threadIndex = static_cast<uint32_t>(std::distance(std::begin(capture.threads), threadIt));
+
+			buffer->Drain([&](const ProfileEvent & event) -> void {
+				auto literalIt = literalIndices.find(event.name);
+
+				if(literalIt == std::end(literalIndices)) {
+					auto [nameIt, inserted] = nameIndices.emplace(event.name, static_cast<uint32_t>(capture.names.size()));
+
+					if(inserted) {
+						capture.names.emplace_back(event.name);
+					}
+
+					literalIt = literalIndices.emplace(event.name, nameIt->second).first;
+				}
+
+				capture.events.push_back(ProfileCapture::Event{ event.type, threadIndex, literalIt->second, event.timestamp, event.value });
+			});
+
+			numDropped += buffer->GetNumDropped();
+		}
+
+		capture.numDropped = numDropped;
+	}
+
+	static void WriteJsonString(std::ostringstream & oss, const std::string & str) {
+		oss << '"';
+		for(char c : str) {
+			if(c == '"' || c == '\\') {
+				oss << '\\' << c;
+			} else if(static_cast<unsigned char>(c) < 0x20) {
+				oss << ' ';
+			} else {
+				oss << c;
+			}
+		}
+		oss << '"';
+	}
+
+	std::string ProfileCapture::ToChromeTrace() const {
+		std::ostringstream oss;
+		oss << "{\"traceEvents\":[";
+
+		bool first = true;
+		const auto separate = [&]() -> void {
+			if(!first) {
+				oss << ",\n";
+			}
+			first = false;
+		};
+
+		for(const Thread & thread : threads) {
+			if(thread.name.empty()) {
+				continue;
+			}
+
+			separate();
+			oss << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << thread.id << R"(,"args":{"name":)";
+			WriteJsonString(oss, thread.name);
+			oss << "}}";
+		}
+
+		// microseconds with the nanoseconds as fraction
+		const auto writeTimestamp = [&oss](int64_t ns) -> void {
+			oss << (ns / 1000) << '.';
+			const int64_t fraction = ns % 1000;
+			oss << static_cast<char>('0' + fraction / 100) << static_cast<char>('0' + (fraction / 10) % 10) << static_cast<char>('0' + fraction % 10);
+		};
+
+		for(const Event & event : events) {
+			separate();
+			oss << "{\"name\":";
+			WriteJsonString(oss, names[event.nameIndex]);
+			oss << ",\"pid\":1,\"tid\":" << threads[event.threadIndex].id << ",\"ts\":";
+			writeTimestamp(event.timestamp);
+
+			switch(event.type) {
+				case ProfileEventType::BEGIN: oss << R"(,"ph":"B"})"; break;
+				case ProfileEventType::END: oss << R"(,"ph":"E"})"; break;
+				case ProfileEventType::COUNTER: oss << R"(,"ph":"C","args":{"value":)" << event.value << "}}"; break;
+				case ProfileEventType::FRAME: oss << R"(,"ph":"i","s":"g"})"; break;
+			}
+		}
+
+		oss << "],\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":" << numDropped << "}}";
+
+		return oss.str();
+	}
+
+	std::vector<uint8_t> ProfileCapture::ToBinary() const {
+		uint32_t size = sizeof(PROFILE_MAGIC) + 1 + 3 * 4 + static_cast<uint32_t>(events.size()) * PROFILE_EVENT_SIZE;
+
+		for(const Thread & thread : threads) {
+			size += 4 + Network::WireWriter::GetBytesSize(static_cast<uint32_t>(thread.name.size()));
+		}
+
+		for(const std::string & name : names) {
+			size += Network::WireWriter::GetBytesSize(static_cast<uint32_t>(name.size()));
+		}
+
+		std::vector<uint8_t> binary(size);
+		Network::WireWriter writer{ MutableArrayView<uint8_t>{ binary.data(), binary.size() } };
+
+		const auto toBytes = [](const std::string & str) -> ArrayView<uint8_t> {
+			return ArrayView<uint8_t>{ reinterpret_cast<const uint8_t *>(str.data()), str.size() };
+		};
+
+		writer.WriteRaw(ArrayView<uint8_t>{ PROFILE_MAGIC, sizeof(PROFILE_MAGIC) });
+		writer.WriteU8(PROFILE_VERSION);
+
+		writer.WriteU32(static_cast<uint32_t>(threads.size()));
+		for(const Thread & thread : threads) {
+			writer.WriteU32(thread.id);
+			writer.WriteBytes(toBytes(thread.name));
+		}
+
+		writer.WriteU32(static_cast<uint32_t>(names.size()));
+		for(const std::string & name : names) {
+			writer.WriteBytes(toBytes(name));
+		}
+
+		writer.WriteU32(static_cast<uint32_t>(events.size()));
+		for(const Event & event : events) {
+			writer.WriteU8(static_cast<uint8_t>(event.type));
+			writer.WriteU16(static_cast<uint16_t>(event.threadIndex));
+			writer.WriteU32(event.nameIndex);
+			writer.WriteU64(static_cast<uint64_t>(event.timestamp));
+			writer.WriteU64(static_cast<uint64_t>(event.value));
+		}
+
+		return binary;
+	}
+
+	bool ProfileCapture::FromBinary(ArrayView<uint8_t> binary) {
+		Network::WireReader reader{ binary };
+
+		for(uint8_t m : PROFILE_MAGIC) {
+			if(reader.ReadU8() != m) {
+				return false;
+			}
+		}
+
+		if(reader.ReadU8() != PROFILE_VERSION) {
+			return false;
+		}
+
+		ProfileCapture read;
+
+		const auto toString = [](ArrayView<uint8_t> bytes) -> std::string {
+			return std::string{ reinterpret_cast<const char *>(bytes.Data()), bytes.Size() };
+		};
+
+		const uint32_t numThreads = reader.ReadU32();
+		for(uint32_t i = 0; i < numThreads && !reader.HasOverflowed(); i++) {
+			const uint32_t id = reader.ReadU32();
+			read.threads.push_back(Thread{ id, toString(reader.ReadBytes()) });
+		}
+
+		const uint32_t numNames = reader.ReadU32();
+		for(uint32_t i = 0; i < numNames && !reader.HasOverflowed(); i++) {
+			read.names.push_back(toString(reader.ReadBytes()));
+		}
+
+		const uint32_t numEvents = reader.ReadU32();
+
+		if(reader.HasOverflowed() || static_cast<uint64_t>(numEvents) * PROFILE_EVENT_SIZE != reader.GetRemainingSize()) {
+			return false;
+		}
+
+		read.events.reserve(numEvents);
+
+		for(uint32_t i = 0; i < numEvents; i++) {
+			Event event;
+			const uint8_t type = reader.ReadU8();
+			event.threadIndex = reader.ReadU16();
+			event.nameIndex = reader.ReadU32();
+			event.timestamp = static_cast<int64_t>(reader.ReadU64());
+			event.value = static_cast<int64_t>(reader.ReadU64());
+
+			if(type < static_cast<uint8_t>(ProfileEventType::BEGIN) || type > static_cast<uint8_t>(ProfileEventType::FRAME) ||
+				event.threadIndex >= read.threads.size() || event.nameIndex >= read.names.size()) {
+				return false;
+			}
+
+			event.type = static_cast<ProfileEventType>(type);
+			read.events.push_back(event);
+		}
+
+		// indices of the read capture are shifted behind the existing ones
+		const uint32_t threadOffset = static_cast<uint32_t>(threads.size());
+		const uint32_t nameOffset = static_cast<uint32_t>(names.size());
+
+		threads.insert(std::end(threads), std::begin(read.threads), std::end(read.threads));
+		names.insert(std::end(names), std::begin(read.names), std::end(read.names));
+
+		for(Event & event : read.events) {
+			event.threadIndex += threadOffset;
+			event.nameIndex += nameOffset;
+			events.push_back(event);
+		}
+
+		return true;
+	}
+
+}
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <NetcodeFoundation/ArrayView.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Netcode {
+
+	enum class ProfileEventType : uint8_t {
+		BEGIN = 1, END = 2, COUNTER = 3, FRAME = 4
+	};
+
+	/**
+	 * The name must outlive the profiler, the macros take string literals
+	 */
+	struct ProfileEvent {
+		const char * name;
+		// nanoseconds, the clock of SystemClock::LocalNow
+		int64_t timestamp;
+		// COUNTER only
+		int64_t value;
+		ProfileEventType type;
+	};
+
+	/**
+	 * Single producer single consumer ring of the events of a thread. The owner thread pushes without
+	 * locking, a full buffer drops the event and counts it. Scopes are kept whole: an admitted BEGIN
+	 * reserves the slot of its END, a dropped BEGIN drops its END and every scope nested in it.
+	 */
+	class ProfileThreadBuffer {
+	public:
+		constexpr static uint32_t CAPACITY = 1 << 16;
+
+	private:
+		constexpr static uint32_t MASK = CAPACITY - 1;
+
+		std::unique_ptr<ProfileEvent[]> events;
+		std::atomic<uint64_t> writeIndex;
+		std::atomic<uint64_t> readIndex;
+		std::atomic<uint64_t> numDropped;
+		// owner only: admitted scopes waiting for their END, and the depth inside a dropped scope
+		uint32_t numOpenScopes;
+		uint32_t droppedDepth;
+
+		bool Drop() {
+			numDropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+	public:
+		uint32_t threadId;
+		std::string threadName;
+
+		ProfileThreadBuffer(uint32_t id);
+
+		/**
+		 * Owner only, false if the event was dropped
+		 */
+		bool Push(const ProfileEvent & event) {
+			const uint64_t w = writeIndex.load(std::memory_order_relaxed);
+			const uint64_t numFree = CAPACITY - (w - readIndex.load(std::memory_order_acquire));
+
+			if(event.type == ProfileEventType::BEGIN) {
+				// itself and its END on top of the ENDs already reserved
+				if(droppedDepth > 0 || numFree < numOpenScopes + 2ull) {
+					droppedDepth++;
+					return Drop();
+				}
+
+				numOpenScopes++;
+			} else if(event.type == ProfileEventType::END && droppedDepth > 0) {
+				droppedDepth--;
+				return Drop();
+			} else if(event.type == ProfileEventType::END && numOpenScopes > 0) {
+				// the slot was reserved by the BEGIN
+				numOpenScopes--;
+			} else if(numFree < numOpenScopes + 1ull) {
+				return Drop();
+			}
+
+			events[w & MASK] = event;
+			writeIndex.store(w + 1, std::memory_order_release);
+			return true;
+		}
+
+		/**
+		 * Consumer only, calls f(const ProfileEvent &) with every event pushed so far
+		 */
+		template<typename F>
+		void Drain(F f) {
+			const uint64_t w = writeIndex.load(std::memory_order_acquire);
+			uint64_t r = readIndex.load(std::memory_order_relaxed);
+
+			for(; r < w; r++) {
+				f(events[r & MASK]);
+			}
+
+			readIndex.store(r, std::memory_order_release);
+		}
+
+		uint64_t GetNumDropped() const {
+			return numDropped.load(std::memory_order_relaxed);
+		}
+	};
+
+	/**
+	 * Events collected from the threads. Names are deduplicated into a table, the events refer to it by index
+	 */
+	struct ProfileCapture {
+		struct Thread {
+			uint32_t id;
+			std::string name;
+		};
+
+		struct Event {
+			ProfileEventType type;
+			uint32_t threadIndex;
+			uint32_t nameIndex;
+			int64_t timestamp;
+			int64_t value;
+		};
+
+		std::vector<Thread> threads;
+		std::vector<std::string> names;
+		std::vector<Event> events;
+		uint64_t numDropped;
+
+		ProfileCapture() : threads{}, names{}, events{}, numDropped{ 0 } { }
+
+		/**
+		 * Chrome trace event JSON, opened by chrome://tracing or Perfetto
+		 */
+		std::string ToChromeTrace() const;
+
+		/*
+		 * Layout of the binary capture, integers are in network byte order, strings are VarUInt length prefixed:
+		 *  header:  u8[4] magic, u8 version
+		 *  threads: u32 count, { u32 id, bytes name }
+		 *  names:   u32 count, { bytes name }
+		 *  events:  u32 count, { u8 type, u16 threadIndex, u32 nameIndex, u64 timestamp, u64 value }
+		 */
+		std::vector<uint8_t> ToBinary() const;
+
+		/**
+		 * Reads the output of ToBinary, appending to the capture
+		 * @return false if the input is malformed, the capture is left unchanged then
+		 */
+		bool FromBinary(ArrayView<uint8_t> binary);
+	};
+
+	/**
+	 * Collects scopes, counters and frame markers from every thread. Recording is off until enabled,
+	 * a disabled scope costs a relaxed atomic load. Compiled out by NETCODE_NO_PROFILER.
+	 */
+	class Profiler {
+		static std::atomic<bool> enabled;
+		static std::mutex buffersMutex;
+		static std::vector<std::unique_ptr<ProfileThreadBuffer>> buffers;
+
+		static ProfileThreadBuffer * GetThreadBuffer();
+
+		static void Record(ProfileEventType type, const char * name, int64_t value);
+
+	public:
+		static void SetEnabled(bool value) {
+			enabled.store(value, std::memory_order_relaxed);
+		}
+
+		static bool IsEnabled() {
+			return enabled.load(std::memory_order_relaxed);
+		}
+
+		/**
+		 * Names the calling thread in the exports, ignored while disabled so idle threads allocate no buffer
+		 */
+		static void SetThreadName(const char * name);
+
+		static void Begin(const char * name) {
+			Record(ProfileEventType::BEGIN, name, 0);
+		}
+
+		static void End(const char * name) {
+			Record(ProfileEventType::END, name, 0);
+		}
+
+		static void Counter(const char * name, int64_t value) {
+			Record(ProfileEventType::COUNTER, name, value);
+		}
+
+		static void Frame(const char * name) {
+			Record(ProfileEventType::FRAME, name, 0);
+		}
+
+		/**
+		 * Moves the events recorded so far into the capture, one collector at a time.
+		 * Called periodically, the thread buffers drop events while they are full
+		 */
+		static void Collect(ProfileCapture & capture);
+	};
+
+	class ProfileScope {
+		const char * name;
+		bool active;
+
+	public:
+		ProfileScope(const char * scopeName) : name{ scopeName }, active{ Profiler::IsEnabled() } {
+			if(active) {
+				Profiler::Begin(name);
+			}
+		}
+
+		~ProfileScope() {
+			if(active) {
+				Profiler::End(name);
+			}
+		}
+
+		ProfileScope(const ProfileScope &) = delete;
+		ProfileScope & operator=(const ProfileScope &) = delete;
+	};
+
+}
+
+#define NETCODE_PROFILE_CONCAT_IMPL(a, b) a##b
+#define NETCODE_PROFILE_CONCAT(a, b) NETCODE_PROFILE_CONCAT_IMPL(a, b)
+
+#if defined(NETCODE_NO_PROFILER)
+#define NETCODE_PROFILE_SCOPE(name)
+#define NETCODE_PROFILE_COUNTER(name, value)
+#define NETCODE_PROFILE_FRAME(name)
+#define NETCODE_PROFILE_THREAD(name)
+#else
+#define NETCODE_PROFILE_SCOPE(name) ::Netcode::ProfileScope NETCODE_PROFILE_CONCAT(profileScope_, __LINE__){ name }
+#define NETCODE_PROFILE_COUNTER(name, value) do { if(::Netcode::Profiler::IsEnabled()) { ::Netcode::Profiler::Counter(name, static_cast<int64_t>(value)); } } while(false)
+#define NETCODE_PROFILE_FRAME(name) do { if(::Netcode::Profiler::IsEnabled()) { ::Netcode::Profiler::Frame(name); } } while(false)
+#define NETCODE_PROFILE_THREAD(name) ::Netcode::Profiler::SetThreadName(name)
+#endif
@@ -71,5 +71,25 @@ namespace Netcode {
 			tmp = SystemClock::LocalNow() - t;
 		}
 	}
+
+	Duration ThreadCpuTime() {
+		FILETIME creationTime;
+		FILETIME exitTime;
+		FILETIME kernelTime;
+		FILETIME userTime;
+
+		if(!GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime)) {
+			return Duration{};
+		}
+
+		const auto toTicks = [](const FILETIME & ft) -> uint64_t {
+			return (static_cast<uint64_t>(ft.dwHighDateTime) << 32) | static_cast<uint64_t>(ft.dwLowDateTime);
+		};
+
+		// FILETIME is in [100ns] metric
+		const std::chrono::duration<uint64_t, std::ratio<1, 10000000>> cpuTime{ toTicks(kernelTime) + toTicks(userTime) };
+
+		return std::chrono::duration_cast<Duration>(cpuTime);
+	}
 	
 }
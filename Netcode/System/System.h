@@ -11,6 +11,12 @@ namespace Netcode {
 	*/
 	void SleepFor(const Duration & duration);
 
+	/*
+	 * CPU time the calling thread has spent so far, user and kernel time included.
+	 * On Windows it is advanced by the scheduler ticks, short intervals are only accurate on average
+	 */
+	Duration ThreadCpuTime();
+
 
 	/*
 	 * wait for time to pass while doing something on the side
@@ -6,6 +6,8 @@
 
 #include <Netcode/Input/Key.h>
 #include <Netcode/Config.h>
+#include <Netcode/Utility.h>
+#include <Netcode/AsyncLog.h>
 
 using Netcode::Graphics::DisplayMode;
 
@@ -311,6 +313,12 @@ namespace Netcode::Module {
 #else 
 		Log::Setup(false);
 #endif
+
+		const std::wstring binaryLogPath = Config::GetOptional<std::wstring>(L"system.log.binaryOutput:string", std::wstring{});
+
+		if(!binaryLogPath.empty() && !Log::AsyncLog::SetBinaryOutput(binaryLogPath)) {
+			Log::Error("Failed to open the binary log: {0}", Utility::ToNarrowString(binaryLogPath));
+		}
 		
 		const Int2 windowPosition = Config::GetOptional<Int2>(L"window.position:Int2", Int2{ CW_USEDEFAULT, CW_USEDEFAULT });
 		const Int2 windowSize = Config::GetOptional<Int2>(L"window.size:Int2", Int2{ CW_USEDEFAULT, CW_USEDEFAULT });
@@ -21,6 +21,7 @@
 #include <Netcode/System/TimeTypes.h>
 #include <Netcode/Network/Connection.h>
 #include "Network/ReplDesc.h"
+#include "Network/RedundancyRing.hpp"
 #include <variant>
 
 namespace nn = Netcode::Network;
@@ -143,7 +144,9 @@ enum class CommandType {
 	PLAYER_TIMEDOUT = 5,
 	SERVER_CLOSED = 6,
 	CREATE_OBJECT = 7,
-	REMOVE_OBJECT = 8
+	REMOVE_OBJECT = 8,
+	// the object left the relevant set of the client, it is shown again by its next replication
+	HIDE_OBJECT = 9
 };
 
 struct ServerCommand {
@@ -200,129 +203,55 @@ public:
 
 struct RedundancyItem {
 	uint32_t sequence;
+	// number of updates the item was sent in
+	uint32_t numSends;
 	std::variant<ClientAction, ServerReconciliation> storage;
+	// the item in the flat ServerUpdate format, encoded on its first send
+	std::vector<uint8_t> wireData;
 };
 
 /*
- * Mitigation for packetloss. This includes every action or result that is not handled yet
+ * Mitigation for packetloss. This includes every action or result that is not handled yet.
  */
 class RedundancyBuffer {
-	std::vector<RedundancyItem> items;
+	RedundancyRing<RedundancyItem> ring;
+
+	RedundancyItem & Push(uint32_t localSequence) {
+		RedundancyItem & item = ring.Push(localSequence);
+		item.numSends = 0;
+		item.wireData.clear();
+		return item;
+	}
 	
 public:
 	void Add(uint32_t localSequence, ClientAction action) {
-		RedundancyItem item = {};
-		item.sequence = localSequence;
-		item.storage.emplace<ClientAction>(action);
-		items.push_back(item);
+		Push(localSequence).storage.emplace<ClientAction>(action);
 	}
 
 	void Add(uint32_t localSequence, ServerReconciliation reconciliation) {
-		RedundancyItem item = {};
-		item.sequence = localSequence;
-		item.storage.emplace<ServerReconciliation>(std::move(reconciliation));
-		items.push_back(item);
+		Push(localSequence).storage.emplace<ServerReconciliation>(std::move(reconciliation));
 	}
 
-	const std::vector<RedundancyItem> & GetBuffer() const {
-		return items;
-	}
-
-	// remove objects that are implicitly confirmed by the remoteSequence.
-	void Confirm(uint32_t confirmedSequence) {
-		if(items.empty())
-			return;
-		
-		auto it = std::remove_if(std::begin(items), std::end(items), [confirmedSequence](const RedundancyItem & i) -> bool {
-			return i.sequence <= confirmedSequence;
-		});
-		
-		items.erase(it, std::end(items));
-	}
-};
-
-template<typename T>
-struct HistoryItem {
-	Netcode::Timestamp timestamp;
-	T value;
-};
-
-template<typename T>
-class HistoryBuffer {
-
-	std::unique_ptr<HistoryItem<T>[]> data;
-	int32_t index;
-	int32_t size;
-	int32_t capacity;
-
-	int32_t Increment() {
-		const int32_t idx = index;
-		index++;
-		if(index >= capacity) {
-			index = 0;
-		}
-
-		if(size < capacity) {
-			size += 1;
-		}
-		return idx;
-	}
-	
-public:
-	HistoryBuffer(int32_t numElements) : data{}, index { 0 }, capacity{ numElements }, size{ 0 } {
-		data = std::make_unique<HistoryItem<T>[]>(numElements);
-	}
-	
-	void Insert(Netcode::Timestamp timestamp, const T& value) {
-		const int32_t idx = Increment();
-		
-		data[idx] = HistoryItem<T>{
-			timestamp,
-			value
-		};
+	uint32_t GetCount() const {
+		return ring.GetCount();
 	}
 
 	/*
-	 * Possible return values:
-	 * - no intersection: { nullptr, nullptr }
-	 * - only newer items: { ptr, nullptr }
-	 * - has expected intersection: { ptr, ptr }
-	 *
-	 * should never return: { nullptr, ptr }
+	 * Oldest item first
 	 */
-	std::pair<const HistoryItem<T>*, const HistoryItem<T> *> FindAt(const Netcode::Timestamp& timestamp) {
-		const HistoryItem<T> * first = nullptr;
-		const HistoryItem<T> * last = nullptr;
-
-		if(size > 0) {
-
-			int32_t idx = index - 1;
-			for(int32_t i = 0; i < size; i++, idx--) {
-				// underflow case
-				if(idx < 0) {
-					idx += capacity;
-				}
-
-				const HistoryItem<T> * bufferItem = data.get() + idx;
+	template<typename F>
+	void Foreach(F f) {
+		ring.Foreach(f);
+	}
 
-				if(bufferItem->timestamp > timestamp) {
-					first = bufferItem;
-				}
-				
-				if(bufferItem->timestamp <= timestamp) {
-					last = bufferItem;
-					// even the first item is older, therefore nothing was found
-					if(first == nullptr) {
-						last = nullptr;
-					}
-					// older ones down the road, no reason to keep searching
-					break;
-				}
-			}
-			
-		}
+	template<typename F>
+	void Foreach(F f) const {
+		ring.Foreach(f);
+	}
 
-		return std::pair<const HistoryItem<T> *, const HistoryItem<T>*>{ first, last };
+	// remove objects that are implicitly confirmed by the remoteSequence.
+	void Confirm(uint32_t confirmedSequence) {
+		ring.Confirm(confirmedSequence);
 	}
 };
 
@@ -36,6 +36,57 @@ GameObject * GameScene::CloneWithHierarchy(GameObject * src)
 	return pThis;
 }
 
+void GameScene::CloneColliders(GameScene * source) {
+	physx::PxPhysics & physics = pxScene->getPhysics();
+
+	source->Foreach([&](GameObject * src) -> void {
+		if(src->IsDeletable() || !src->HasComponent<Collider>()) {
+			return;
+		}
+
+		Collider * srcCollider = src->GetComponent<Collider>();
+		physx::PxRigidActor * srcActor = (srcCollider->actor.Get() != nullptr) ? srcCollider->actor->is<physx::PxRigidActor>() : nullptr;
+
+		if(srcActor == nullptr) {
+			return;
+		}
+
+		physx::PxRigidActor * actor = nullptr;
+
+		if(physx::PxRigidStatic * rigidStatic = srcActor->is<physx::PxRigidStatic>(); rigidStatic != nullptr) {
+			actor = physx::PxCloneStatic(physics, srcActor->getGlobalPose(), *rigidStatic);
+		} else if(physx::PxRigidDynamic * rigidDynamic = srcActor->is<physx::PxRigidDynamic>(); rigidDynamic != nullptr) {
+			actor = physx::PxCloneDynamic(physics, srcActor->getGlobalPose(), *rigidDynamic);
+		}
+
+		if(actor == nullptr) {
+			return;
+		}
+
+		GameObject * obj = Create();
+		obj->name = src->name;
+
+		if(src->HasComponent<Transform>()) {
+			*obj->AddComponent<Transform>() = *src->GetComponent<Transform>();
+		}
+
+		Collider * dstCollider = obj->AddComponent<Collider>();
+		dstCollider->shapes = srcCollider->shapes;
+
+		// the shapes are cloned in order, their descriptions are the copies of this object
+		physx::PxShape * shape = nullptr;
+		for(uint32_t i = 0; i < actor->getNbShapes() && i < dstCollider->shapes.size(); i++) {
+			actor->getShapes(&shape, 1, i);
+			shape->userData = &dstCollider->shapes[i];
+		}
+
+		actor->userData = obj;
+		dstCollider->actor.Reset(actor);
+
+		Spawn(obj);
+	});
+}
+
 void GameScene::RemoveWithHierarchy(GameObject * obj) {
 	for(GameObject * child : obj->Children()) {
 		RemoveWithHierarchy(child);
@@ -117,6 +117,12 @@ public:
 
 	GameObject * CloneWithHierarchy(GameObject * src);
 
+	/*
+	 * Copies the colliders of the source into this scene and spawns them. The copied actors have shapes
+	 * of their own, but the cooked meshes and the materials are shared with the source
+	 */
+	void CloneColliders(GameScene * source);
+
 	void RemoveWithHierarchy(GameObject * obj);
 
 	GameObject * Clone(GameObject * src);
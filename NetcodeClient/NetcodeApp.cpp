@@ -6,6 +6,8 @@
 #include "Scripts/LocalPlayerScript.h"
 #include "Scripts/GunScript.h"
 #include "Snippets.h"
+#include "Network/ServerReplay.h"
+#include "Network/ServerBenchmark.h"
 #include <NetcodeAssetLib/JsonUtility.h>
 #include <Netcode/UI/Button.h>
 #include <Netcode/UI/TextBox.h>
@@ -14,9 +16,55 @@
 #include <Netcode/Network/Cookie.h>
 #include <Netcode/Network/NetworkErrorCode.h>
 #include <Netcode/System/SecureString.h>
+#include <Netcode/IO/File.h>
 #include "Scripts/LocalPlayerWeaponScript.h"
 #include <iomanip>
 
+void GameApp::WriteProfile(const std::wstring & path) {
+	const std::string trace = profileCapture.ToChromeTrace();
+	const std::vector<uint8_t> binary = profileCapture.ToBinary();
+
+	try {
+		Netcode::IO::File traceFile{ path + L".json" };
+		traceFile.Open(Netcode::IO::FileOpenMode::CREATE_OR_OVERWRITE | Netcode::IO::FileOpenMode::WRITE_ONLY);
+		traceFile.Write(Netcode::ArrayView<uint8_t>{ reinterpret_cast<const uint8_t *>(trace.data()), trace.size() });
+		traceFile.Close();
+
+		Netcode::IO::File binaryFile{ path + L".nprf" };
+		binaryFile.Open(Netcode::IO::FileOpenMode::CREATE_OR_OVERWRITE | Netcode::IO::FileOpenMode::WRITE_ONLY);
+		binaryFile.Write(Netcode::ArrayView<uint8_t>{ binary.data(), binary.size() });
+		binaryFile.Close();
+
+		Log::Info("Profile saved: {0} events, {1} dropped", static_cast<uint64_t>(profileCapture.events.size()), profileCapture.numDropped);
+	} catch(Netcode::ExceptionBase & e) {
+		Log::Error("Failed to save the profile: {0}", e.ToString());
+	}
+}
+
+void GameApp::FlushProfile() {
+	WriteProfile(profileOutput + L"_" + std::to_wstring(numProfileParts++));
+
+	// the threads and the names are kept, the events of the next part refer to them
+	profileCapture.events.clear();
+}
+
+void GameApp::SaveProfile() {
+	if(profileOutput.empty()) {
+		return;
+	}
+
+	Netcode::Profiler::SetEnabled(false);
+	Netcode::Profiler::Collect(profileCapture);
+
+	if(numProfileParts > 0) {
+		FlushProfile();
+	} else {
+		WriteProfile(profileOutput);
+	}
+
+	profileOutput.clear();
+}
+
 void GameApp::ReloadMap() {
 	GameSceneManager * gsm = Service::Get<GameSceneManager>();
 	gsm->CloseScene();
@@ -34,6 +82,8 @@ void GameApp::LoadMap(const Netcode::URI::Model & path)
 }
 
 void GameApp::Render() {
+	NETCODE_PROFILE_SCOPE("Render");
+
 	graphics->frame->Prepare();
 
 	auto cfgBuilder = graphics->CreateFrameGraphBuilder();
@@ -84,6 +134,8 @@ void GameApp::Render() {
 }
 
 void GameApp::Simulate() {
+	NETCODE_PROFILE_SCOPE("Simulate");
+
 	movCtrl.Update();
 
 	const float dt = gameClock.FGetDeltaTime();
@@ -93,8 +145,7 @@ void GameApp::Simulate() {
 	Netcode::Duration fixedUpdate = gameClock.GetFixedDeltaTime();
 
 	if(fixedUpdate > Netcode::Duration{}) {
-		gameScene->GetPhysXScene()->simulate(std::chrono::duration<float>(fixedUpdate).count());
-		gameScene->GetPhysXScene()->fetchResults(true);
+		Netcode::Physics::StepScene(gameScene->GetPhysXScene(), fixedUpdate);
 
 		gameScene->Foreach([this](GameObject * gameObject)->void {
 			if(gameObject->IsDeletable()) {
@@ -127,6 +178,7 @@ void GameApp::LoadServices() {
 	Service::Init<Netcode::Physics::PhysX>();
 	Service::Init<Netcode::Module::IGraphicsModule *>(graphics.get());
 	Service::Init<GameApp *>(this);
+	Service::Init<Netcode::JobSystem>(Netcode::Config::GetOptional<uint32_t>(L"system.jobThreads:u32", 0u));
 
 	pxService = Service::Get<Netcode::Physics::PhysX>();
 	pxService->CreateResources();
@@ -253,7 +305,34 @@ void GameApp::CreateUI() {
 
 	hostMode = Netcode::Config::Get<HostMode>(L"game.hostMode");
 
-	if(hostMode == HostMode::LISTEN || hostMode == HostMode::DEDICATED) {
+	const std::wstring replayPath = Netcode::Config::GetOptional<std::wstring>(L"network.server.replay:string", std::wstring{});
+
+	if(!replayPath.empty()) {
+		ServerReplay replay{ &gameServer };
+		exitCode = replay.Run(replayPath) ? 0 : 1;
+
+		// the replayed server has no network, the main loop must not tick it
+		hostMode = HostMode::CLIENT;
+		window->Shutdown();
+		return;
+	}
+
+	const std::wstring benchmarkPlayers = Netcode::Config::GetOptional<std::wstring>(L"network.server.benchmark.players:string", std::wstring{});
+
+	if(!benchmarkPlayers.empty()) {
+		ServerBenchmark benchmark{ benchmarkPlayers, Netcode::Config::GetOptional<uint32_t>(L"network.server.benchmark.ticks:u32", 600u) };
+		exitCode = benchmark.Run(Service::Get<GameSceneManager>()->GetScene()) ? 0 : 1;
+
+		hostMode = HostMode::CLIENT;
+		window->Shutdown();
+		return;
+	}
+
+	const uint32_t numMatches = Netcode::Config::GetOptional<uint32_t>(L"network.server.matchHost.matches:u32", 0u);
+
+	if(hostMode == HostMode::DEDICATED && numMatches > 0) {
+		matchHost.Start(network.get(), numMatches);
+	} else if(hostMode == HostMode::LISTEN || hostMode == HostMode::DEDICATED) {
 		gameServer.Start(network.get());
 	}
 	
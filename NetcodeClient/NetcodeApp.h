@@ -25,11 +25,14 @@
 #include <Netcode/System/FpsCounter.h>
 #include <Netcode/System/SystemClock.h>
 #include <Netcode/System/System.h>
+#include <Netcode/System/Profiler.h>
+#include <Netcode/Config.h>
 
 #include <Netcode/Network/ClientSession.h>
 
 #include "Network/GameServer.h"
 #include "Network/GameClient.h"
+#include "Network/MatchHost.h"
 
 using Netcode::Graphics::ResourceType;
 using Netcode::Graphics::ResourceState;
@@ -55,6 +58,7 @@ public:
 	GameScene * gameScene;
 	Ref<AnimationSet> ybotAnimationSet;
 	GameServer gameServer;
+	MatchHost matchHost;
 	GameClient gameClient;
 	Netcode::URI::Model mapAsset;
 	Netcode::FrameCounter fpsCounter;
@@ -62,6 +66,13 @@ public:
 	std::wstring fpsValue;
 	UserData user;
 	HostMode hostMode;
+	Netcode::ProfileCapture profileCapture;
+	std::wstring profileOutput;
+	// the collected events are written to a numbered part when the capture reaches the limit
+	uint32_t profileMaxEvents = 0;
+	uint32_t numProfileParts = 0;
+	// non-zero if a replay or a benchmark failed, returned by the process
+	int exitCode = 0;
 
 	void LoadSystems();
 
@@ -83,6 +94,12 @@ public:
 
 	void CreateLocalAvatar();
 
+	void WriteProfile(const std::wstring & path);
+
+	void FlushProfile();
+
+	void SaveProfile();
+
 	virtual void OnResized(int w, int h) override {
 		float asp = graphics->GetAspectRatio();
 		if(GameObject * cameraObj = gameScene->GetCamera(); cameraObj != nullptr) {
@@ -105,6 +122,14 @@ public:
 	Initialize modules
 	*/
 	virtual void Setup(Netcode::Module::IModuleFactory * factory) override {
+		// before the modules start, their threads name themselves only while the profiler is enabled
+		if(Netcode::Config::GetOptional<bool>(L"system.profiler.enabled:bool", false)) {
+			profileOutput = Netcode::Config::GetOptional<std::wstring>(L"system.profiler.output:string", L"profile");
+			profileMaxEvents = Netcode::Config::GetOptional<uint32_t>(L"system.profiler.maxEvents:u32", 1u << 20);
+			Netcode::Profiler::SetEnabled(true);
+			NETCODE_PROFILE_THREAD("Main");
+		}
+
 		events = std::make_unique<Netcode::Module::AppEventSystem>();
 
 		window = factory->CreateWindowModule(this, 0);
@@ -139,6 +164,8 @@ public:
 		while(window->KeepRunning()) {
 			auto st = Netcode::SystemClock::LocalNow();
 			
+			NETCODE_PROFILE_FRAME("Frame");
+
 			gameClock.Tick();
 			
 			window->ProcessMessages();
@@ -149,6 +176,8 @@ public:
 			const bool isNetworkTick = gameClient.IncludeNetworkTick();
 			
 			if(isNetworkTick) {
+				NETCODE_PROFILE_SCOPE("Receive");
+
 				if(gameClient.IsConnected())
 					gameClient.Receive();
 			}
@@ -163,13 +192,27 @@ public:
 			if(isNetworkTick && hostMode == HostMode::LISTEN) {
 				gameServer.Tick();
 			}
+
+			if(matchHost.IsRunning()) {
+				matchHost.Tick();
+			}
 			
 			Render();
 			
 			mainThreadDispatcher.Run();
 
+			Service::Get<Netcode::JobSystem>()->RunMainThreadJobs();
+
 			window->CompleteFrame();
 
+			if(Netcode::Profiler::IsEnabled()) {
+				Netcode::Profiler::Collect(profileCapture);
+
+				if(profileCapture.events.size() >= profileMaxEvents) {
+					FlushProfile();
+				}
+			}
+
 			Sleep(2);
 			
 			fpsCounter.Update(Netcode::SystemClock::LocalNow() - st);
@@ -182,6 +225,9 @@ public:
 	virtual void Exit() override {
 		renderer.ui_Input = nullptr;
 		pageManager.Destruct();
+		gameServer.Shutdown();
+		matchHost.Shutdown();
+		SaveProfile();
 		Service::Clear();
 		ShutdownModule(network.get());
 		ShutdownModule(audio.get());
@@ -1,4 +1,5 @@
 #include "GameClient.h"
+#include "ServerUpdateFrame.h"
 #include <Netcode/Network/Service.h>
 #include "../Services.h"
 #include "../Asset/ClientConverters.h"
@@ -6,21 +7,25 @@
 #include <Netcode/MovementController.h>
 
 
+/*
+ * Feeds every clock sync response into the discipline,
+ * the token is completed once the initial burst of samples arrived, the filter keeps running afterwards
+ */
 class ClockSyncResponseFilter : public nn::FilterBase {
 	nn::CompletionToken<nn::ClockSyncResult> completionToken;
 	Netcode::GameClock * clock;
+	nn::ClockDiscipline * clockDiscipline;
 	Netcode::Timestamp createdAt;
-	nn::NtpClockFilter clockFilter;
 	uint32_t numUpdates;
+	bool isInitialized;
 public:
-	ClockSyncResponseFilter(Netcode::GameClock* clock, nn::CompletionToken<nn::ClockSyncResult> tce) :
-		completionToken{ std::move(tce) }, clock{ clock }, createdAt{ Netcode::SystemClock::LocalNow() }, clockFilter{} {
+	ClockSyncResponseFilter(Netcode::GameClock* clock, nn::ClockDiscipline * discipline, nn::CompletionToken<nn::ClockSyncResult> tce) :
+		completionToken{ std::move(tce) }, clock{ clock }, clockDiscipline{ discipline }, createdAt{ Netcode::SystemClock::LocalNow() }, numUpdates{ 0 }, isInitialized{ false } {
 		state = nn::FilterState::RUNNING;
-		numUpdates = 0;
 	}
 
 	bool CheckTimeout(Netcode::Timestamp checkAt) override {
-		if((checkAt - createdAt) > std::chrono::seconds(10)) {
+		if(!isInitialized && (checkAt - createdAt) > std::chrono::seconds(10)) {
 			state = nn::FilterState::COMPLETED;
 			nn::ClockSyncResult csr;
 			csr.errorCode = make_error_code(Netcode::NetworkErrc::RESPONSE_TIMEOUT);
@@ -46,23 +51,33 @@ public:
 		np::TimeSync * timeSync = control->mutable_time_sync();
 		timeSync->set_client_resp_reception(Netcode::ConvertTimestampToUInt64(cm.packet->GetTimestamp() - clock->GetEpoch()));
 
-		clockFilter.Update(*timeSync);
+		clockDiscipline->Update(*timeSync);
 
 		numUpdates++;
 
-		if(numUpdates >= 8) {
+		if(!isInitialized && numUpdates >= 8) {
+			const Netcode::Timestamp receivedAt = Netcode::ConvertUInt64ToTimestamp(timeSync->client_resp_reception());
+
 			nn::ClockSyncResult csr;
 			csr.errorCode = make_error_code(Netcode::NetworkErrc::SUCCESS);
-			csr.delay = clockFilter.GetDelay();
-			csr.offset = clockFilter.GetOffset();
+			csr.delay = nn::ClockDiscipline::DurationToDouble(clockDiscipline->GetDelay());
+			csr.offset = nn::ClockDiscipline::DurationToDouble(clockDiscipline->GetOffset(receivedAt));
 			completionToken->Set(csr);
-			state = nn::FilterState::COMPLETED;
+			isInitialized = true;
 		}
 
 		return nn::FilterResult::CONSUMED;
 	}
 };
 
+static void SetActiveWithHierarchy(GameObject * obj, bool value) {
+	obj->SetActive(value);
+
+	for(GameObject * child : obj->Children()) {
+		SetActiveWithHierarchy(child, value);
+	}
+}
+
 static bool ConvertServerReconciliation(ServerReconciliation& dst, const np::ServerCommand& command) {
 	ServerReconciliation sr = {};
 	sr.type = ReconciliationType::COMMAND;
@@ -111,7 +126,7 @@ GameObject* GameClient::ClientCreateRemoteAvatar(int32_t playerId, uint32_t objI
 	AssetManager * assetManager = Service::Get<AssetManager>();
 	GameScene * scene = Service::Get<GameSceneManager>()->GetScene();
 	
-	GameObject * avatarCtrl = CreateRemoteAvatar(playerConnection->tickInterval, scene->GetControllerManager());
+	GameObject * avatarCtrl = CreateRemoteAvatar(scene, playerConnection->tickInterval, scene->GetControllerManager());
 	GameObject * rifleOrigin = scene->Create("remoteRifleOrigin");
 	GameObject * rifle = scene->Create("remoteRifle");
 	
@@ -152,50 +167,76 @@ void GameClient::FetchUpdate() {
 		connection->gameObject->HasComponent<Transform>());
 
 	for(NodeIter<nn::GameMessage> it = head; it != nullptr; it++) {
-		np::ServerUpdate * serverUpdate = it->allocator->MakeProto<np::ServerUpdate>();
-
 		if(it->sequence <= connection->remoteGameSequence) {
 			//Log::Debug("Dropping packed because its sequence is too low");
 			continue;
 		}
-		
-		if(!serverUpdate->ParseFromArray(it->content.Data(), static_cast<int32_t>(it->content.Size()))) {
+
+		uint32_t receivedId = 0;
+
+		if(ServerUpdateReader::IsFrame(it->content)) {
+			const size_t firstReconciliation = reconciliations.size();
+
+			if(!ServerUpdateReader::Read(it->content, it->sequence, receivedId, reconciliations, replicationData, replicationCoder.get())) {
+				Log::Debug("Failed to read server update frame");
+				continue;
+			}
+
+			auto alreadyHandled = std::remove_if(std::begin(reconciliations) + firstReconciliation, std::end(reconciliations), [connection](const ServerReconciliation & sr) -> bool {
+				return sr.id <= ((sr.type == ReconciliationType::COMMAND) ? connection->remoteCommandIndex : connection->remoteActionIndex);
+			});
+			reconciliations.erase(alreadyHandled, std::end(reconciliations));
+		} else if(!ParseServerUpdate(it->allocator.get(), it->content, it->sequence, receivedId)) {
 			Log::Debug("Failed to parse from array");
 			continue;
 		}
 
-		for(const np::ActionResult & ar : serverUpdate->action_results()) {
-			ServerReconciliation sr;
-			if(ConvertServerReconciliation(sr, ar)) {
-				if(sr.id > connection->remoteActionIndex) {
-					reconciliations.push_back(sr);
-				}
+		connection->dtlsRoute->lastReceivedAt = Netcode::SystemClock::LocalNow();
+		
+		connection->redundancyBuffer.Confirm(receivedId);
+		connection->remoteGameSequence = std::max(connection->remoteGameSequence, it->sequence);
+	}
+}
+
+bool GameClient::ParseServerUpdate(nn::NetAllocator * allocator, Netcode::ArrayView<uint8_t> content, uint32_t sequence, uint32_t & receivedId) {
+	Connection * connection = playerConnection.get();
+	np::ServerUpdate * serverUpdate = allocator->MakeProto<np::ServerUpdate>();
+
+	if(!serverUpdate->ParseFromArray(content.Data(), static_cast<int32_t>(content.Size()))) {
+		return false;
+	}
+
+	for(const np::ActionResult & ar : serverUpdate->action_results()) {
+		ServerReconciliation sr;
+		if(ConvertServerReconciliation(sr, ar)) {
+			if(sr.id > connection->remoteActionIndex) {
+				reconciliations.push_back(sr);
 			}
 		}
+	}
 
-		for(const np::ServerCommand & cmd : serverUpdate->commands()) {
-			ServerReconciliation sr;
-			if(ConvertServerReconciliation(sr, cmd)) {
-				if(sr.id > connection->remoteCommandIndex) {
-					reconciliations.push_back(sr);
-				}
+	for(const np::ServerCommand & cmd : serverUpdate->commands()) {
+		ServerReconciliation sr;
+		if(ConvertServerReconciliation(sr, cmd)) {
+			if(sr.id > connection->remoteCommandIndex) {
+				reconciliations.push_back(sr);
 			}
 		}
+	}
 
-		google::protobuf::RepeatedPtrField<np::ReplData>* ptrField = serverUpdate->mutable_replications();
-
-		for(np::ReplData& replData : *ptrField) {
-			ReplData rd;
-			rd.objectId = replData.object_id();
-			rd.content = std::move(*replData.mutable_data());
-			replicationData.emplace_back(std::move(rd));
-		}
+	google::protobuf::RepeatedPtrField<np::ReplData>* ptrField = serverUpdate->mutable_replications();
 
-		connection->dtlsRoute->lastReceivedAt = Netcode::SystemClock::LocalNow();
-		
-		connection->redundancyBuffer.Confirm(serverUpdate->received_id());
-		connection->remoteGameSequence = std::max(connection->remoteGameSequence, it->sequence);
+	for(np::ReplData& replData : *ptrField) {
+		ReplData rd;
+		rd.objectId = replData.object_id();
+		rd.sequence = sequence;
+		rd.baselineId = replData.baseline_id();
+		rd.content = std::move(*replData.mutable_data());
+		replicationData.emplace_back(std::move(rd));
 	}
+
+	receivedId = serverUpdate->received_id();
+	return true;
 }
 
 void GameClient::ProcessUpdate() {
@@ -221,22 +262,86 @@ void GameClient::ProcessUpdate() {
 
 	reconciliations.clear();
 
-	for(ReplData replData : replicationData) {
-		for(GameObject * remoteObj : remoteObjects) {
-			Network * network = remoteObj->GetComponent<Network>();
+	Ref<ReplSnapshot> snapshot = nullptr;
+	uint32_t snapshotSequence = 0;
+	bool isSnapshotComplete = false;
 
-			if(network->id == replData.objectId) {
-				if(network->owner != playerConnection->id) {
-					ReplicateRead(remoteObj, network, replData.content, clock, connection->id, ActorType::CLIENT);
-				}
-				break;
+	const auto finishSnapshot = [&]() -> void {
+		if(snapshot != nullptr) {
+			connection->baselines.Store(snapshotSequence, std::move(snapshot));
+
+			if(isSnapshotComplete) {
+				connection->baselines.Acknowledge(snapshotSequence);
 			}
 		}
+	};
+
+	for(ReplData & replData : replicationData) {
+		if(snapshot == nullptr || snapshotSequence != replData.sequence) {
+			finishSnapshot();
+
+			snapshot = std::make_shared<ReplSnapshot>();
+			snapshotSequence = replData.sequence;
+			isSnapshotComplete = true;
+		}
+
+		GameObject * replObj = FindReplicatedObject(replData.objectId);
+
+		if(replData.baselineId != 0) {
+			const ReplSnapshot * baseline = connection->baselines.Find(replData.baselineId);
+			Netcode::ArrayView<uint8_t> baselineContent{ nullptr, 0 };
+			std::string content;
+
+			const ReplDesc * replDesc = (replObj != nullptr) ? &replObj->GetComponent<Network>()->replDesc : nullptr;
+
+			if(replDesc == nullptr || *replDesc == nullptr || baseline == nullptr || !baseline->Find(replData.objectId, baselineContent) ||
+				!ReplicateDeltaRead(**replDesc, baselineContent, ToArrayView(replData.content), content)) {
+				// the server keeps using an older baseline until it ages out and the full state is sent
+				isSnapshotComplete = false;
+				continue;
+			}
+
+			replData.content = std::move(content);
+		}
+
+		// the local avatar is only looked up to keep the baselines complete, its state is predicted
+		if(replObj != nullptr && replObj != playerConnection->gameObject) {
+			Network * network = replObj->GetComponent<Network>();
+
+			// hidden when it left the relevant set, replicated again once it is back in
+			if(!replObj->IsActive() && !replObj->IsSpawnable()) {
+				SetActiveWithHierarchy(replObj, true);
+			}
+
+			if(network->owner != playerConnection->id) {
+				ReplicateRead(replObj, network, replData.content, clock, connection->id, ActorType::CLIENT);
+			}
+		}
+
+		snapshot->Add(replData.objectId, ToArrayView(replData.content));
 	}
 
+	finishSnapshot();
+
 	replicationData.clear();
 }
 
+GameObject * GameClient::FindReplicatedObject(uint32_t objectId) const {
+	for(GameObject * remoteObj : remoteObjects) {
+		if(remoteObj->GetComponent<Network>()->id == objectId) {
+			return remoteObj;
+		}
+	}
+
+	GameObject * localObj = playerConnection->gameObject;
+
+	if(localObj != nullptr && localObj->GetComponent<Network>()->id == objectId) {
+		return localObj;
+	}
+
+	return nullptr;
+}
+
 void GameClient::ProcessCommand(const ServerReconciliation & sr) {
 
 	if(sr.type == ReconciliationType::COMMAND) {
@@ -245,6 +350,14 @@ void GameClient::ProcessCommand(const ServerReconciliation & sr) {
 			RemoveRemoteObjectsByOwner(sr.command.subject);
 		}
 
+		if(sr.command.type == CommandType::HIDE_OBJECT) {
+			GameObject * obj = FindReplicatedObject(sr.command.objectId);
+
+			if(obj != nullptr && obj != playerConnection->gameObject) {
+				SetActiveWithHierarchy(obj, false);
+			}
+		}
+
 		if(sr.command.type == CommandType::CREATE_OBJECT) {
 			GameScene * scene = Service::Get<GameSceneManager>()->GetScene();
 			
@@ -277,7 +390,7 @@ void GameClient::ProcessCommand(const ServerReconciliation & sr) {
 				if(sr.command.objectType == REPL_TYPE_SCOREBOARD) {
 					if(scoreboard == nullptr) {
 						Log::Debug("Create scoreboard: {0}", (int)sr.command.objectId);
-						GameObject* sco = CreateScoreboard(sr.command.objectId);
+						GameObject* sco = CreateScoreboard(scene, sr.command.objectId);
 
 						scoreboard = sco->GetComponent<Script>()
 										->GetScript<ScoreboardScript>(0);
@@ -361,8 +474,20 @@ bool GameClient::IncludeNetworkTick() {
 	return true;
 }
 
+void GameClient::ApplyClockDiscipline() {
+	if(playerConnection->state != nn::ConnectionState::ESTABLISHED || !clockDiscipline.IsSynchronized()) {
+		return;
+	}
+
+	const Netcode::Timestamp now = clock->GetLocalTime();
+	playerConnection->clockOffset = clockDiscipline.GetOffset(now);
+	clock->SynchronizeClocks(playerConnection->rtt, playerConnection->clockOffset, clockDiscipline.GetErrorBound(now));
+}
+
 void GameClient::Receive() {
 
+	ApplyClockDiscipline();
+
 	FetchUpdate();
 
 	ProcessUpdate();
@@ -390,35 +515,48 @@ static void AddAction(np::ClientUpdate* update, const RedundancyItem& item) {
 	}
 }
 
+void GameClient::SendClockSyncRequest() {
+	Ref<nn::NetAllocator> alloc = service->MakeAllocator(1024);
+
+	np::Control * control = alloc->MakeProto<np::Control>();
+	control->set_sequence(playerConnection->localControlSequence++);
+	control->set_type(np::MessageType::CLOCK_SYNC_REQUEST);
+	np::TimeSync* ts = control->mutable_time_sync();
+	ts->set_client_req_transmission(Netcode::ConvertTimestampToUInt64(clock->GetLocalTime()));
+
+	nn::ControlMessage cm;
+	cm.allocator = std::move(alloc);
+	cm.control = control;
+	cm.packet = nullptr;
+
+	service->Send(cm, playerConnection->dtlsRoute);
+
+	lastClockSyncAt = clock->GetLocalTime();
+}
+
 void GameClient::Send() {
-	Ref<nn::NetAllocator> alloc = service->MakeAllocator(4096);
-	
 	if(playerConnection->state == nn::ConnectionState::SYNCHRONIZING) {
-		np::Control * control = alloc->MakeProto<np::Control>();
-		control->set_sequence(playerConnection->localControlSequence++);
-		control->set_type(np::MessageType::CLOCK_SYNC_REQUEST);
-		np::TimeSync* ts = control->mutable_time_sync();
-		ts->set_client_req_transmission(Netcode::ConvertTimestampToUInt64(clock->GetLocalTime()));
-
-		nn::ControlMessage cm;
-		cm.allocator = std::move(alloc);
-		cm.control = control;
-		cm.packet = nullptr;
-		
-		service->Send(cm, playerConnection->dtlsRoute);
+		SendClockSyncRequest();
 	} else {
+		// keep feeding the clock discipline so the drift is tracked for the whole session
+		if((clock->GetLocalTime() - lastClockSyncAt) >= clockSyncInterval) {
+			SendClockSyncRequest();
+		}
+
+		Ref<nn::NetAllocator> alloc = service->MakeAllocator(4096);
 		np::ClientUpdate * update = alloc->MakeProto<np::ClientUpdate>();
 
 		update->set_received_id(playerConnection->remoteGameSequence);
+		update->set_baseline_id(playerConnection->baselines.GetAcknowledgedSequence());
 
-		for(const RedundancyItem & item : playerConnection->redundancyBuffer.GetBuffer()) {
+		playerConnection->redundancyBuffer.Foreach([update](const RedundancyItem & item) -> void {
 			AddAction(update, item);
-		}
+		});
 
 		GameObject * gameObj = playerConnection->gameObject;
 		Network * network = gameObj->GetComponent<Network>();
 		
-		if(!network->replDesc.empty()) {
+		if(network->replDesc != nullptr) {
 			std::string binary = ReplicateWrite(gameObj, network);
 
 			if(!binary.empty()) {
@@ -472,7 +610,8 @@ void GameClient::SendDebug() {
 nn::CompletionToken<nn::ClockSyncResult> GameClient::Synchronize() {
 	nn::CompletionToken<nn::ClockSyncResult> ct = std::make_shared<nn::CompletionTokenType<nn::ClockSyncResult>>(&clientSession->GetIOContext());
 
-	service->AddFilter(std::make_unique<ClockSyncResponseFilter>(clock, ct));
+	clockDiscipline.Reset();
+	service->AddFilter(std::make_unique<ClockSyncResponseFilter>(clock, &clockDiscipline, ct));
 	
 	return ct;
 }
@@ -492,6 +631,7 @@ nn::CompletionToken<nn::TrResult> GameClient::ConnectionDone() {
 
 void GameClient::Start(Netcode::Module::INetworkModule * network, Netcode::GameClock* gameClock) {
 	clientSession = std::dynamic_pointer_cast<nn::ClientSession>(network->CreateClient());
+	clientSession->SetSessionHash(network->GetCookie("netcode-auth").GetValue());
 	playerConnection = std::make_shared<Connection>(clientSession->GetIOContext());
 	scoreboard = nullptr;
 
@@ -505,6 +645,10 @@ void GameClient::Start(Netcode::Module::INetworkModule * network, Netcode::GameC
 	
 	const uint32_t intervalMs = Netcode::Config::GetOptional<uint32_t>(L"network.client.tickIntervalMs:u32", 250u);
 	playerConnection->tickInterval.store(std::chrono::milliseconds{ intervalMs }, std::memory_order_release);
+
+	clockSyncInterval = std::chrono::milliseconds{ Netcode::Config::GetOptional<uint32_t>(L"network.client.clockSyncIntervalMs:u32", 1000u) };
+
+	replicationCoder = LoadReplicationCoder(Netcode::Config::GetOptional<std::wstring>(L"network.protocol.replicationModel:string", std::wstring{}));
 	
 	clientSession->Connect(playerConnection, "localhost", 8889)->Then([this](const Netcode::ErrorCode & ec) -> void {
 		if(ec) {
@@ -520,9 +664,10 @@ void GameClient::Start(Netcode::Module::INetworkModule * network, Netcode::GameC
 				return;
 			}
 			
-			playerConnection->rtt = nn::NtpClockFilter::DoubleToDuration(csr.delay);
-			playerConnection->clockOffset = nn::NtpClockFilter::DoubleToDuration(csr.offset);
-			clock->SynchronizeClocks(playerConnection->rtt, playerConnection->clockOffset);
+			playerConnection->rtt = nn::ClockDiscipline::DoubleToDuration(csr.delay);
+			playerConnection->clockOffset = nn::ClockDiscipline::DoubleToDuration(csr.offset);
+			clock->SynchronizeClocks(playerConnection->rtt, playerConnection->clockOffset, clockDiscipline.GetErrorBound(clock->GetLocalTime()));
+			lastClockSyncAt = clock->GetLocalTime();
 
 			ConnectionDone()->Then([this](const nn::TrResult & tr) -> void {
 				if(tr.errorCode) {
@@ -10,7 +10,12 @@ class GameClient {
 	std::vector<ServerReconciliation> reconciliations;
 	std::vector<GameObject *> remoteObjects;
 	std::vector<ReplData> replicationData;
+	// decodes entropy coded replications, null if no model is configured
+	std::unique_ptr<nn::ReplicationCoder> replicationCoder;
 	Netcode::GameClock * clock;
+	nn::ClockDiscipline clockDiscipline;
+	Netcode::Timestamp lastClockSyncAt;
+	Netcode::Duration clockSyncInterval;
 	ScoreboardScript * scoreboard;
 	LocalPlayerScript * localPlayerScript;
 	GameScene * gameScene;
@@ -18,6 +23,11 @@ class GameClient {
 
 	void FetchUpdate();
 
+	/**
+	 * Fallback for servers that send protobuf encoded updates
+	 */
+	bool ParseServerUpdate(nn::NetAllocator * allocator, Netcode::ArrayView<uint8_t> content, uint32_t sequence, uint32_t & receivedId);
+
 	void ProcessUpdate();
 
 	void ProcessCommand(const ServerReconciliation & sr);
@@ -25,9 +35,12 @@ class GameClient {
 	void ProcessResult(const ServerReconciliation & sr);
 
 	void RemoveRemoteObjectsByOwner(int32_t ownerId);
+	GameObject * FindReplicatedObject(uint32_t objectId) const;
 	GameObject* ClientCreateRemoteAvatar(int32_t playerId, uint32_t objId);
 
 	nn::CompletionToken<nn::ClockSyncResult> Synchronize();
+	void SendClockSyncRequest();
+	void ApplyClockDiscipline();
 	nn::CompletionToken<nn::TrResult> ConnectionDone();
 	
 public:
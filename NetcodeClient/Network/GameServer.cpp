@@ -1,9 +1,12 @@
 #include "GameServer.h"
+#include "ServerReplay.h"
 #include "../Services.h"
 #include "../GameScene.h"
 #include <Netcode/Network/Service.h>
 #include <Netcode/Network/ClientSession.h>
 #include <Netcode/Stopwatch.h>
+#include <Netcode/System/Profiler.h>
+#include <google/protobuf/io/coded_stream.h>
 #include <sstream>
 #include <fstream>
 
@@ -11,73 +14,194 @@ using Netcode::Float3;
 using Netcode::Vector3;
 using Netcode::Quaternion;
 
-static PerfData perfCurrent{};
-
 class ServerConnRequestFilter : public nn::FilterBase {
-public:
-	GameServer * server;
+	/*
+	 * A connect request waiting for its session hash to be resolved by the database pool.
+	 * The result is stored by the pool and picked up by the thread of the filters.
+	 */
+	struct PendingLogin {
+		nn::DtlsRoute * route;
+		nn::UdpEndpoint endpoint;
+		uint32_t remoteSequence;
+		np::ConnectType type;
+		nn::QueryUserResult result;
+		std::atomic<bool> isCompleted;
+
+		PendingLogin() : route{ nullptr }, endpoint{}, remoteSequence{ 0 }, type{}, result{}, isCompleted{ false } { }
+	};
 
-	ServerConnRequestFilter(GameServer * srv) : server{srv} {}
-	
-	nn::FilterResult Run(Ptr<nn::NetcodeService> service, Ptr<nn::DtlsRoute> route, nn::ControlMessage & cm) override {
-		const np::Control * peerControl = cm.control;
-		if(peerControl->type() != np::CONNECT_REQUEST || !peerControl->has_connect_request()) {
-			return nn::FilterResult::IGNORED;
-		}
+	nn::NetcodeService * service;
+	std::vector<std::shared_ptr<PendingLogin>> pendingLogins;
 
-		const np::ConnectRequest * connReq = &peerControl->connect_request();
+	void Respond(nn::DtlsRoute * route, np::ConnectType type, Netcode::NetworkErrc error) {
+		Ref<nn::NetAllocator> alloc = service->MakeAllocator(1024);
+		np::Control * localControl = alloc->MakeProto<np::Control>();
+		localControl->set_sequence(1);
+		localControl->set_type(np::MessageType::CONNECT_RESPONSE);
+		np::ConnectResponse * connResp = localControl->mutable_connect_response();
+		connResp->set_type(type);
+		connResp->set_error_code(static_cast<int32_t>(error));
 
-		if(route == nullptr || route->state != nn::DtlsRouteState::ESTABLISHED) {
-			return nn::FilterResult::CONSUMED;
-		}
+		nn::ControlMessage localCm;
+		localCm.control = localControl;
+		localCm.allocator = alloc;
 
-		nn::ConnectionStorage * connections = service->GetConnections();
+		service->Send(alloc, alloc->MakeCompletionToken<nn::TrResult>(), route, localCm, route->endpoint, nn::MtuValue{ route->mtu }, nn::ResendArgs{ 1000, 3 });
+	}
 
-		if(connections->GetConnectionByEndpoint(cm.packet->endpoint) != nullptr) {
-			return nn::FilterResult::CONSUMED;
+	void Accept(nn::DtlsRoute * route, np::ConnectType type, uint32_t remoteSequence, int userId) {
+		GameServer * server = selectServer();
+
+		if(server == nullptr) {
+			Respond(route, type, Netcode::NetworkErrc::SERVER_FULL);
+			return;
 		}
 
+		nn::ConnectionStorage * connections = service->GetConnections();
+
 		std::string nonce = nn::GenerateNonce();
 
 		if(nonce.empty()) {
 			Log::Error("Failed to generate nonce");
 		}
 
-		// for now accept everything
 		Ref<nn::NetAllocator> alloc = service->MakeAllocator(1024);
 		np::Control * localControl = alloc->MakeProto<np::Control>();
 		localControl->set_sequence(1);
 		localControl->set_type(np::MessageType::CONNECT_RESPONSE);
 		np::ConnectResponse * connResp = localControl->mutable_connect_response();
-		connResp->set_type(connReq->type());
+		connResp->set_type(type);
 		connResp->set_current_map("mat_test_map");
 		connResp->set_nonce(std::move(nonce));
 		connResp->set_error_code(0);
 
+		nn::ControlMessage localCm;
+		localCm.control = localControl;
+		localCm.allocator = alloc;
+
 		static int32_t idGen = 1;
 
 		Ref<Connection> conn = std::make_shared<Connection>(service->GetIOContext());
 		conn->id = idGen++;
+		conn->userId = userId;
 		conn->dtlsRoute = route;
 		conn->pmtu = nn::MtuValue{ route->mtu };
 		conn->endpoint = route->endpoint;
 		conn->remoteGameSequence = 0;
 		conn->localControlSequence = 1;
 		conn->localGameSequence = 1;
-		conn->remoteControlSequence = peerControl->sequence();
+		conn->remoteControlSequence = remoteSequence;
 		conn->state = nn::ConnectionState::SYNCHRONIZING;
 		conn->tickInterval = std::chrono::milliseconds(Netcode::Config::Get<uint32_t>(L"network.client.tickIntervalMs:u32"));
 		
 		connResp->set_player_id(conn->id);
-		
-		nn::ControlMessage localCm;
-		localCm.control = localControl;
-		localCm.allocator = alloc;
 
 		server->OnPlayerConnected(conn.get());
 		connections->AddConnection(conn);
 
+		// a match keeps its own connections besides the ones of the shared service
+		if(server->connections != connections) {
+			server->connections->AddConnection(conn);
+		}
+
+		if(database != nullptr) {
+			database->CreateGameSession(userId);
+		}
+
 		service->Send(alloc, alloc->MakeCompletionToken<nn::TrResult>(), conn->dtlsRoute, localCm, conn->endpoint, conn->pmtu, nn::ResendArgs{ 1000, 3 });
+	}
+
+	void CompleteLogin(const PendingLogin & login) {
+		// the route was reused or closed while the query was in flight
+		if(login.route->endpoint != login.endpoint || login.route->state != nn::DtlsRouteState::ESTABLISHED) {
+			return;
+		}
+
+		if(service->GetConnections()->GetConnectionByEndpoint(login.endpoint) != nullptr) {
+			return;
+		}
+
+		if(login.result.errorCode) {
+			Log::Info("Rejected a login: {0}", login.result.errorCode.message());
+			Respond(login.route, login.type, Netcode::NetworkErrc::UNAUTHORIZED);
+			return;
+		}
+
+		// (id, name, hash, is_banned)
+		if(std::get<3>(login.result.playerData)) {
+			Respond(login.route, login.type, Netcode::NetworkErrc::CLIENT_BANNED);
+			return;
+		}
+
+		Accept(login.route, login.type, login.remoteSequence, std::get<0>(login.result.playerData));
+	}
+
+public:
+	// picks the server of a new connection, null if every server is full
+	std::function<GameServer *()> selectServer;
+	// validates the session hash of the request when set, otherwise every request is accepted
+	nn::MysqlSession * database;
+
+	ServerConnRequestFilter(std::function<GameServer *()> select, nn::MysqlSession * db) :
+		service{ nullptr }, pendingLogins{}, selectServer{ std::move(select) }, database{ db } {}
+
+	/*
+	 * Invoked on every run of the filters, completes the logins resolved since the last run
+	 */
+	bool CheckTimeout(Netcode::Timestamp checkAt) override {
+		for(auto it = pendingLogins.begin(); it != pendingLogins.end();) {
+			if((*it)->isCompleted.load(std::memory_order_acquire)) {
+				CompleteLogin(**it);
+				it = pendingLogins.erase(it);
+			} else {
+				++it;
+			}
+		}
+
+		return false;
+	}
+	
+	nn::FilterResult Run(Ptr<nn::NetcodeService> svc, Ptr<nn::DtlsRoute> route, nn::ControlMessage & cm) override {
+		const np::Control * peerControl = cm.control;
+		if(peerControl->type() != np::CONNECT_REQUEST || !peerControl->has_connect_request()) {
+			return nn::FilterResult::IGNORED;
+		}
+
+		const np::ConnectRequest * connReq = &peerControl->connect_request();
+
+		if(route == nullptr || route->state != nn::DtlsRouteState::ESTABLISHED) {
+			return nn::FilterResult::CONSUMED;
+		}
+
+		service = svc;
+
+		if(service->GetConnections()->GetConnectionByEndpoint(cm.packet->endpoint) != nullptr) {
+			return nn::FilterResult::CONSUMED;
+		}
+
+		if(database == nullptr) {
+			Accept(route, connReq->type(), peerControl->sequence(), 0);
+			return nn::FilterResult::CONSUMED;
+		}
+
+		// the resent requests of a login in flight are dropped
+		for(const std::shared_ptr<PendingLogin> & login : pendingLogins) {
+			if(login->endpoint == cm.packet->endpoint) {
+				return nn::FilterResult::CONSUMED;
+			}
+		}
+
+		std::shared_ptr<PendingLogin> login = std::make_shared<PendingLogin>();
+		login->route = route;
+		login->endpoint = cm.packet->endpoint;
+		login->remoteSequence = peerControl->sequence();
+		login->type = connReq->type();
+		pendingLogins.push_back(login);
+
+		database->QueryUserByHash(connReq->query())->Then([login](const nn::QueryUserResult & result) -> void {
+			login->result = result;
+			login->isCompleted.store(true, std::memory_order_release);
+		});
 
 		return nn::FilterResult::CONSUMED;
 	}
@@ -110,15 +234,16 @@ class ServerClockSyncRequestFilter : public nn::FilterBase {
 public:
 	ServerClockSyncRequestFilter(GameServer * srv, Connection * conn) :
 		clock{ &srv->gameClock }, server{ srv }, connection{ conn }, isDone{false} {
-		startedAt = Netcode::SystemClock::LocalNow();
+		startedAt = srv->Now();
 	}
 
 	bool CheckTimeout(Netcode::Timestamp checkAt) override {
-		return (checkAt - startedAt) > std::chrono::seconds(10);
+		return !isDone && (checkAt - startedAt) > std::chrono::seconds(10);
 	}
 
+	// stays installed after the handshake to answer the periodic clock sync requests of the client
 	bool IsCompleted() const override {
-		return isDone;
+		return false;
 	}
 	
 	nn::FilterResult Run(Ptr<nn::NetcodeService> service, Ptr<nn::DtlsRoute> route, nn::ControlMessage & cm) override {
@@ -135,6 +260,10 @@ public:
 
 		if(route == nullptr)
 			return nn::FilterResult::IGNORED;
+
+		// a replayed request has no one to answer to
+		if(service == nullptr)
+			return nn::FilterResult::CONSUMED;
 		
 		Ref<nn::ConnectionBase> conn = service->GetConnections()->GetConnectionByEndpointUnsafe(route->endpoint);
 
@@ -199,7 +328,7 @@ static bool ConvertAction(ExtClientAction& dst, const np::ActionPrediction& pred
 
 void GameServer::OnPlayerConnected(Connection* connection) {
 	
-	GameObject* gameObj = CreateRemoteAvatar(connection->tickInterval, controllerManager.Get());
+	GameObject* gameObj = CreateRemoteAvatar(gameScene, connection->tickInterval, controllerManager.Get());
 	Network* network = gameObj->GetComponent<Network>();
 	network->replDesc = CreateRemoteAvatarReplDesc();
 	network->owner = connection->id;
@@ -213,12 +342,27 @@ void GameServer::OnPlayerConnected(Connection* connection) {
 	Netcode::UndefinedBehaviourAssertion(actor->getScene() == pxScene);
 	
 	pxScene->removeActor(*actor);
-	rps->serverHistory = std::make_unique<HistoryBuffer<ServerFrameData>>(128);
+
+	physx::PxController * controller = rps->GetController();
+	physx::PxShape * shape = nullptr;
+	physx::PxCapsuleGeometry capsule;
+	controller->getActor()->getShapes(&shape, 1);
+	Netcode::UndefinedBehaviourAssertion(shape != nullptr && shape->getCapsuleGeometry(capsule));
+
+	const float centerHeight = static_cast<float>(controller->getPosition().y - controller->getFootPosition().y);
+	lagCompensation.AddPlayer(connection->id, nn::HitboxShape{ capsule.radius, capsule.halfHeight, centerHeight });
 
 	
 	connection->gameObject = gameObj;
 	connection->remotePlayerScript = rps;
 	connection->filters.emplace_back(std::make_unique<ServerClockSyncRequestFilter>(this, connection));
+
+	if(trafficRecorder != nullptr) {
+		nn::TrafficRecord record;
+		record.type = nn::TrafficRecordType::CONNECT;
+		record.connectionId = connection->id;
+		trafficRecorder->Record(record);
+	}
 }
 
 void GameServer::OnPlayerJoined(Connection * connection) {
@@ -247,9 +391,108 @@ void GameServer::OnPlayerJoined(Connection * connection) {
 	connection->redundancyBuffer.Add(connection->localGameSequence, sr);
 }
 
+/*
+ * The actions of a client arrive almost in order, the place of a new one is searched from the back
+ */
+static void InsertPendingAction(std::vector<ExtClientAction> & pendingActions, const ExtClientAction & action) {
+	auto it = std::end(pendingActions);
+
+	while(it != std::begin(pendingActions) && action.timestamp < std::prev(it)->timestamp) {
+		--it;
+	}
+
+	pendingActions.insert(it, action);
+}
+
+void GameServer::RejectAction(const ExtClientAction & action) {
+	Connection * connection = action.owner;
+
+	ServerReconciliation sr = {};
+	sr.id = action.id;
+	sr.actionType = action.type;
+	sr.type = ReconciliationType::REJECTED;
+
+	// the client is corrected to where the server has it
+	if(action.type == ActionType::MOVEMENT) {
+		sr.movementCorrection.position = connection->gameObject->GetComponent<Transform>()->position;
+	}
+
+	connection->redundancyBuffer.Add(connection->localGameSequence, std::move(sr));
+}
+
+void GameServer::MergeActions() {
+	const Netcode::Timestamp serverTimestamp = gameClock.GetGlobalTime();
+
+	actionSources.clear();
+	actionCursors.clear();
+
+	connections->ForeachUnsafe<Connection>([&](Connection * conn) -> void {
+		if(!conn->pendingActions.empty()) {
+			actionSources.push_back(conn);
+			actionCursors.push_back(0);
+		}
+	});
+
+	const uint32_t numSources = static_cast<uint32_t>(actionSources.size());
+
+	// skips the late actions of the source, false if it has nothing left for this tick
+	const auto hasFront = [&](uint32_t source) -> bool {
+		const std::vector<ExtClientAction> & pendingActions = actionSources[source]->pendingActions;
+		uint32_t & cursor = actionCursors[source];
+
+		for(; cursor < pendingActions.size(); cursor++) {
+			const ExtClientAction & action = pendingActions[cursor];
+
+			// dated for a later tick, so are the ones after it
+			if(action.timestamp - serverTimestamp > tickInterval) {
+				return false;
+			}
+
+			if(serverTimestamp - action.timestamp <= maxActionDelay) {
+				return true;
+			}
+
+			Log::Debug("rejecting action because it arrived too late");
+			RejectAction(action);
+		}
+
+		return false;
+	};
+
+	const auto before = [this](uint32_t a, uint32_t b) -> bool {
+		return actionSources[a]->pendingActions[actionCursors[a]].timestamp <
+			actionSources[b]->pendingActions[actionCursors[b]].timestamp;
+	};
+
+	actionMerge.Reset(numSources);
+
+	for(uint32_t source = 0; source < numSources; source++) {
+		if(hasFront(source)) {
+			actionMerge.SetLeaf(source);
+		}
+	}
+
+	actionMerge.Build(before);
+
+	for(uint32_t source = actionMerge.GetWinner(); source != nn::TournamentTree::NONE; source = actionMerge.GetWinner()) {
+		actions.push_back(actionSources[source]->pendingActions[actionCursors[source]]);
+		actionCursors[source]++;
+		actionMerge.Replay(source, hasFront(source), before);
+	}
+
+	for(uint32_t source = 0; source < numSources; source++) {
+		std::vector<ExtClientAction> & pendingActions = actionSources[source]->pendingActions;
+		pendingActions.erase(std::begin(pendingActions), std::begin(pendingActions) + actionCursors[source]);
+	}
+}
+
 void GameServer::FetchActions() {
+	NETCODE_PROFILE_SCOPE("FetchActions");
+
 	Netcode::Stopwatch sw;
 	sw.Start();
+
+	const Netcode::Timestamp serverTimestamp = gameClock.GetGlobalTime();
 	
 	connections->ForeachUnsafe<Connection>([&](Connection * conn) -> void {
 		nn::Node<nn::GameMessage> * nodes = conn->sharedQueue.ConsumeAll();
@@ -258,6 +501,15 @@ void GameServer::FetchActions() {
 			return;
 
 		for(NodeIter<nn::GameMessage> it = nodes; it != nullptr; it++) {
+			if(trafficRecorder != nullptr) {
+				nn::TrafficRecord record;
+				record.type = nn::TrafficRecordType::GAME_MESSAGE;
+				record.connectionId = conn->id;
+				record.sequence = it->sequence;
+				record.content = it->content;
+				trafficRecorder->Record(record);
+			}
+
 			Netcode::Stopwatch perfUpdateSw;
 			perfUpdateSw.Start();
 			np::ClientUpdate * update = ParseClientUpdate(it.operator->());
@@ -287,8 +539,15 @@ void GameServer::FetchActions() {
 				maxActionIndex = std::max(maxActionIndex, ca.id);
 				
 				ca.owner = conn;
-				actions.emplace_back(ca);
 				conn->remoteActionIndex = maxActionIndex;
+
+				if(ca.timestamp - serverTimestamp > maxActionLead) {
+					Log::Debug("rejecting action because it is dated too far ahead");
+					RejectAction(ca);
+					continue;
+				}
+
+				InsertPendingAction(conn->pendingActions, ca);
 			}
 
 			for(const np::ReplData& rd : update->replications()) {
@@ -299,18 +558,18 @@ void GameServer::FetchActions() {
 			}
 			
 			conn->redundancyBuffer.Confirm(update->received_id());
+			// the baselines may still be in use by the updates of the previous tick
+			baselineAcks.emplace_back(conn, update->baseline_id());
 			conn->remoteGameSequence = std::max(conn->remoteGameSequence, it->sequence);
 
 			if(maxActionIndex > 0) {
-				conn->dtlsRoute->lastReceivedAt = std::max(conn->dtlsRoute->lastReceivedAt, Netcode::SystemClock::LocalNow());
+				conn->dtlsRoute->lastReceivedAt = std::max(conn->dtlsRoute->lastReceivedAt, Now());
 				conn->remoteActionIndex = std::max(conn->remoteActionIndex, maxActionIndex);
 			}
 		}
 	});
 
-	std::sort(std::begin(actions), std::end(actions), [](const ExtClientAction & a, const ExtClientAction & b) -> bool {
-		return (a.timestamp < b.timestamp);
-	});
+	MergeActions();
 
 	sw.Stop();
 	perfCurrent.receiveTime = sw.GetElapsedDuration();
@@ -381,13 +640,9 @@ void GameServer::HandleMovementAction(const ExtClientAction& action) {
 }
 
 void GameServer::HandleFireAction(const ExtClientAction & action) {
-
-	Netcode::Stopwatch perfReconSw; perfReconSw.Start();
 	Connection * connection = action.owner;
 	GameObject * gameObject = connection->gameObject;
-	Transform * transform = gameObject->GetComponent<Transform>();
 	Network * network = gameObject->GetComponent<Network>();
-	physx::PxController * shooterCtrl = connection->remotePlayerScript->GetController();
 	
 	const Vector3 rayOrigin = action.fireActionData.position;
 	const Vector3 dir = action.fireActionData.direction;
@@ -424,120 +679,85 @@ void GameServer::HandleFireAction(const ExtClientAction & action) {
 		return;
 
 	Netcode::Timestamp reconstructionTime = globalTime - delta - td;
-	pxScene->removeActor(*shooterCtrl->getActor());
-	network->state = PlayerState::DISABLED;
-	
-	connections->ForeachUnsafe<Connection>([&](Connection * conn) -> void {
-		if(connection == conn)
-			return;
 
-		Network * netw = conn->gameObject->GetComponent<Network>();
-		RemotePlayerScript * rps = conn->remotePlayerScript;
-		physx::PxController * ctrl = rps->GetController();
-
-		if(netw->state != PlayerState::ALIVE && netw->state != PlayerState::DISABLED)
-			return;
-
-		Netcode::Stopwatch perfPosCalcSw; perfPosCalcSw.Start();
-
-		auto [p1, p0] = rps->serverHistory->FindAt(reconstructionTime);
+	if(shotRewindBucket > Netcode::Duration{}) {
+		const Netcode::Duration sinceEpoch = reconstructionTime - Netcode::Timestamp{};
+		reconstructionTime -= ((sinceEpoch % shotRewindBucket) + shotRewindBucket) % shotRewindBucket;
+	}
 
-		if((p0 == nullptr || p0->value.state == PlayerState::DEAD) || (p1 == nullptr || p1->value.state == PlayerState::DEAD)) {
-			netw->state = PlayerState::DISABLED;
-			Netcode::Stopwatch perfManipSw; perfManipSw.Start();
-			pxScene->removeActor(*ctrl->getActor());
-			perfManipSw.Stop();
-			perfCurrent.numPxManip++;
-			perfCurrent.pxSceneManipTime += perfManipSw.GetElapsedDuration();
-			return;
-		}
+	PendingShot shot;
+	shot.owner = connection;
+	shot.origin = rayOrigin;
+	shot.direction = rayDir;
+	shot.rewindTime = reconstructionTime;
+	shot.playerHit = nn::HitboxHit{};
+	shots.push_back(shot);
+}
 
-		if(netw->state == PlayerState::DISABLED) {
-			netw->state = PlayerState::ALIVE;
-			Netcode::Stopwatch perfManipSw; perfManipSw.Start();
-			pxScene->addActor(*ctrl->getActor());
-			perfManipSw.Stop();
-			perfCurrent.numPxManip++;
-			perfCurrent.pxSceneManipTime += perfManipSw.GetElapsedDuration();
-			return;
-		}
+void GameServer::ResolveShots() {
+	if(shots.empty()) {
+		return;
+	}
 
-		Netcode::Timestamp t1 = p1->timestamp;
-		Netcode::Timestamp t0 = p0->timestamp;
+	Netcode::Stopwatch perfReconSw; perfReconSw.Start();
 
-		Netcode::Duration frameDuration = t1 - t0;
-		Netcode::Duration relativeDuration = reconstructionTime - t0;
+	shotOrder.resize(shots.size());
+	for(uint32_t i = 0; i < static_cast<uint32_t>(shots.size()); i++) {
+		shotOrder[i] = i;
+	}
 
-		const float lerpArg = std::clamp(std::chrono::duration<float>(relativeDuration).count() /
-			std::chrono::duration<float>(frameDuration).count(),
-			0.0f,
-			1.0f);
+	std::sort(std::begin(shotOrder), std::end(shotOrder), [this](uint32_t lhs, uint32_t rhs) -> bool {
+		return shots[lhs].rewindTime < shots[rhs].rewindTime;
+	});
 
-		const Float3 reconstructedPos = Vector3::Lerp(p0->value.position, p1->value.position, lerpArg);
+	// one rewind per distinct time, every shot of the group is tested against the same state
+	for(size_t begin = 0; begin < shotOrder.size();) {
+		const Netcode::Timestamp rewindTime = shots[shotOrder[begin]].rewindTime;
 
+		Netcode::Stopwatch perfPosCalcSw; perfPosCalcSw.Start();
+		const uint32_t numRewound = lagCompensation.Rewind(rewindTime);
 		perfPosCalcSw.Stop();
-	
-		perfCurrent.numPosCalc++;
-		perfCurrent.posCalcTime += perfPosCalcSw.GetElapsedDuration();
-
-		Netcode::Stopwatch perfPoseSw; perfPoseSw.Start();
-		ctrl->setFootPosition(Netcode::ToPxExtVec3(reconstructedPos));
-		perfPoseSw.Stop();
 
-		perfCurrent.numPxPose++;
-		perfCurrent.pxScenePoseTime += perfPoseSw.GetElapsedDuration();
-	});
+		perfCurrent.numRewinds++;
+		perfCurrent.numPosCalc += numRewound;
+		perfCurrent.posCalcTime += perfPosCalcSw.GetElapsedDuration();
 
-	physx::PxRaycastBuffer hit;
-	physx::PxQueryFilterData fd;
-	fd.flags |= physx::PxQueryFlag::eANY_HIT;
-	fd.data.word0 = PHYSX_COLLIDER_TYPE_LOCAL_HITBOX;
-	fd.data.word1 = PHYSX_COLLIDER_TYPE_WORLD | PHYSX_COLLIDER_TYPE_SERVER_HITBOX;
-	fd.data.word2 = 0;
-	fd.data.word3 = 0;
+		size_t end = begin;
+		for(; end < shotOrder.size() && shots[shotOrder[end]].rewindTime == rewindTime; end++) {
+			PendingShot & shot = shots[shotOrder[end]];
+			shot.playerHit = lagCompensation.Raycast(shot.origin, shot.direction, 10000.0f, shot.owner->id);
+		}
 
-	if(!pxScene->raycast(ToPxVec3(rayOrigin), ToPxVec3(rayDir), 10000.0f, hit, physx::PxHitFlag::eDEFAULT, fd)) {
-		//Log::Debug("SRV: missed everything");
-	} else {
-		if(hit.hasBlock) {
-			physx::PxFilterData hitFilter = hit.block.shape->getQueryFilterData();
+		begin = end;
+	}
 
-			if(hitFilter.word0 & PHYSX_COLLIDER_TYPE_WORLD) {
-				//Log::Debug("SRV: environment hit");
-			} else {
-				//Log::Debug("SRV: player hit");
-			}
+	// outcomes are applied in the order the shots arrived
+	for(const PendingShot & shot : shots) {
+		// only the static world is queried in the scene, the hitboxes of the players are not in it
+		physx::PxRaycastBuffer hit;
+		physx::PxQueryFilterData fd;
+		fd.flags |= physx::PxQueryFlag::eANY_HIT;
+		fd.data.word0 = PHYSX_COLLIDER_TYPE_LOCAL_HITBOX;
+		fd.data.word1 = PHYSX_COLLIDER_TYPE_WORLD;
+		fd.data.word2 = 0;
+		fd.data.word3 = 0;
+
+		const float maxDistance = (shot.playerHit.ownerId >= 0) ? shot.playerHit.distance : 10000.0f;
+
+		if(pxScene->raycast(ToPxVec3(shot.origin), ToPxVec3(shot.direction), maxDistance, hit, physx::PxHitFlag::eDEFAULT, fd) && hit.hasBlock) {
+			//Log::Debug("SRV: environment hit");
+		} else if(shot.playerHit.ownerId >= 0) {
+			//Log::Debug("SRV: player hit {0}", shot.playerHit.ownerId);
+		} else {
+			//Log::Debug("SRV: missed everything");
 		}
 	}
 
-	/* restore physx scene */
-	pxScene->addActor(*shooterCtrl->getActor());
-	
-
-	connections->ForeachUnsafe<Connection>([&](Connection * conn) -> void {
-		Network * netw = conn->gameObject->GetComponent<Network>();
-		Transform * tr = conn->gameObject->GetComponent<Transform>();
-		physx::PxController * remCtrl = conn->remotePlayerScript->GetController();
-
-		if(netw->state == PlayerState::DISABLED) {
-			netw->state = PlayerState::ALIVE;
-			perfCurrent.numPxManip++;
-			Netcode::Stopwatch addSw; addSw.Start();
-			pxScene->addActor(*remCtrl->getActor());
-			addSw.Stop();
-			perfCurrent.pxSceneManipTime += addSw.GetElapsedDuration();
-		}
-
-		perfCurrent.numPxPose++;
-		Netcode::Stopwatch manipSw; manipSw.Start();
-		remCtrl->setFootPosition(ToPxExtVec3(tr->position));
-		manipSw.Stop();
-		perfCurrent.pxScenePoseTime += manipSw.GetElapsedDuration();
-	});
-
 	perfReconSw.Stop();
-	perfCurrent.numShots++;
+	perfCurrent.numShots += static_cast<uint32_t>(shots.size());
 	perfCurrent.reconstrTime += perfReconSw.GetElapsedDuration();
+
+	shots.clear();
 }
 
 void GameServer::HandleSpawnAction(const ExtClientAction& action) {
@@ -573,7 +793,8 @@ void GameServer::HandleSpawnAction(const ExtClientAction& action) {
 		networkComponent->id = csr.command.objectId;
 		rps->serverLastUpdate = gameClock.GetGlobalTime();
 
-		int value = (int)connections->GetConnectionCount();
+		// more players than spawn points share them
+		const size_t value = connections->GetConnectionCount() % spawnPoints.size();
 
 		const SpawnPoint sp = spawnPoints[value];
 		transform->position = sp.position;
@@ -594,6 +815,16 @@ void GameServer::DisconnectPlayer(Connection * connection) {
 	
 	connections->RemoveConnection(lifetime);
 
+	if(isMatch) {
+		service->GetConnections()->RemoveConnection(lifetime);
+	}
+
+	lagCompensation.RemovePlayer(connection->id);
+
+	if(database != nullptr) {
+		database->CloseGameSession(connection->userId);
+	}
+
 	pxScene->removeActor(*connection->remotePlayerScript->GetController()->getActor());
 	gameScene->RemoveWithHierarchy(connection->gameObject);
 	connection->gameObject = nullptr;
@@ -602,6 +833,8 @@ void GameServer::DisconnectPlayer(Connection * connection) {
 }
 
 void GameServer::ProcessActions() {
+	NETCODE_PROFILE_SCOPE("ProcessActions");
+
 	Netcode::Stopwatch sw;
 	sw.Start();
 	Netcode::Timestamp serverTimestamp = gameClock.GetGlobalTime();
@@ -643,6 +876,8 @@ void GameServer::ProcessActions() {
 		}
 	}
 
+	ResolveShots();
+
 	actions.clear();
 
 	sw.Stop();
@@ -655,33 +890,92 @@ void GameServer::FetchControlMessages() {
 }
 
 void GameServer::ProcessControlMessages() {
-	Netcode::Timestamp timestamp = Netcode::SystemClock::LocalNow();
+	NETCODE_PROFILE_SCOPE("ProcessControlMessages");
+
+	std::string recordContent;
 	
 	connections->ForeachUnsafe<Connection>([&](Connection * conn) -> void {
 		nn::Node<nn::ControlMessage> * node = conn->sharedControlQueue.ConsumeAll();
 		
 		for(NodeIter<nn::ControlMessage> it = node; it != nullptr; it++) {
-			service->ApplyFilters(conn->filters, conn->dtlsRoute, *it.operator->());
+			if(trafficRecorder != nullptr && it->control->SerializeToString(&recordContent)) {
+				nn::TrafficRecord record;
+				record.type = nn::TrafficRecordType::CONTROL_MESSAGE;
+				record.connectionId = conn->id;
+				record.content = ToArrayView(recordContent);
+				trafficRecorder->Record(record);
+			}
+
+			ApplyFilters(conn, *it.operator->());
 		}
 
+		CheckFilterCompletion(conn);
+	});
+}
+
+void GameServer::ApplyFilters(Connection * conn, nn::ControlMessage & cm) {
+	if(service != nullptr) {
+		service->ApplyFilters(conn->filters, conn->dtlsRoute, cm);
+		return;
+	}
+
+	// replaying: the filters run without a service, as NetcodeService::ApplyFilters would run them
+	for(const std::unique_ptr<nn::FilterBase> & f : conn->filters) {
+		if(!f->IsCompleted() && f->Run(nullptr, conn->dtlsRoute, cm) == nn::FilterResult::CONSUMED) {
+			break;
+		}
+	}
+}
+
+void GameServer::CheckFilterCompletion(Connection * conn) {
+	if(service != nullptr) {
 		service->CheckFilterCompletion(conn->filters);
+		return;
+	}
+
+	const Netcode::Timestamp timestamp = Now();
+
+	auto it = std::remove_if(std::begin(conn->filters), std::end(conn->filters), [timestamp](const std::unique_ptr<nn::FilterBase> & f) -> bool {
+		return f->IsCompleted() || f->CheckTimeout(timestamp);
 	});
+
+	conn->filters.erase(it, std::end(conn->filters));
+}
+
+Netcode::Timestamp GameServer::Now() const {
+	if(replay != nullptr) {
+		// the same clock as SystemClock::LocalNow, stopped at the replayed frame
+		return gameClock.GetLocalTime() + gameClock.GetEpoch();
+	}
+
+	return Netcode::SystemClock::LocalNow();
+}
+
+Ref<nn::NetAllocator> GameServer::MakeAllocator(uint32_t blockSize) const {
+	if(replay != nullptr) {
+		return replay->MakeAllocator(blockSize);
+	}
+
+	return service->MakeAllocator(blockSize);
 }
 
 void GameServer::SaveState() {
+	NETCODE_PROFILE_SCOPE("SaveState");
+
 	Netcode::Timestamp serverTime = gameClock.GetGlobalTime();
 
 	connections->ForeachUnsafe<Connection>([&](Connection * conn) -> void {
 		GameObject* obj = conn->gameObject;
 		Transform * transform = obj->GetComponent<Transform>();
 		Network * netw = obj->GetComponent<Network>();
-		conn->remotePlayerScript->serverHistory->Insert(serverTime,
-			ServerFrameData{ transform->position, netw->state });
+		lagCompensation.Record(conn->id, serverTime, transform->position, netw->state == PlayerState::ALIVE);
 	});
 }
 
 void GameServer::CheckTimeouts() {
-	Netcode::Timestamp timestamp = Netcode::SystemClock::LocalNow();
+	NETCODE_PROFILE_SCOPE("CheckTimeouts");
+
+	Netcode::Timestamp timestamp = Now();
 
 	std::vector<Connection *> timeouts;
 	
@@ -752,80 +1046,465 @@ static void AddActionResult(np::ServerUpdate* su, const RedundancyItem& item) {
 	}
 }
 
-static void ReplicateGameObject(np::ServerUpdate* su, GameObject* obj) {
-	Network * network = obj->GetComponent<Network>();
+/*
+ * Replications of a tick encoded against a single baseline snapshot.
+ * Objects are encoded on demand and shared between the clients that use the same baseline for them
+ */
+struct ReplEncoding {
+	const ReplSnapshot * baseline;
+	// for every object of the tick: 0 if not encoded yet, 1 if the delta is in deltas, 2 if the full state must be sent
+	std::vector<uint8_t> state;
+	std::vector<uint32_t> deltaIndices;
+	ReplSnapshot deltas;
+	std::string delta;
+};
 
-	std::string binary = ReplicateWrite(obj, network);
+/*
+ * Upper bound of the bytes a replication takes in the ServerUpdate with its content, the flat frame is sized with it.
+ * In the protobuf fallback a ReplData is a length delimited field of the update, its object_id and baseline_id
+ * are fixed32 fields and its data is length delimited, every tag is a single byte.
+ */
+static uint32_t GetReplicationSizeBound(bool isFlat, uint32_t contentSize) {
+	if(isFlat) {
+		return ServerUpdateWriter::GetReplicationSize(contentSize);
+	}
 
-	if(binary.empty())
-		return;
+	using google::protobuf::io::CodedOutputStream;
 
-	np::ReplData * replData = su->add_replications();
-	replData->set_object_id(network->id);
-	replData->set_data(std::move(binary));
+	const uint32_t replDataSize = 2 * (1 + 4) + 1 + CodedOutputStream::VarintSize32(contentSize) + contentSize;
+	return 1 + CodedOutputStream::VarintSize32(replDataSize) + replDataSize;
 }
 
-void GameServer::BuildServerUpdates() {
-	
+static ReplEncoding * GetReplEncoding(std::vector<std::unique_ptr<ReplEncoding>> & encodings, size_t numObjects, const ReplSnapshot * baseline) {
+	for(const std::unique_ptr<ReplEncoding> & enc : encodings) {
+		if(enc->baseline == baseline) {
+			return enc.get();
+		}
+	}
+
+	std::unique_ptr<ReplEncoding> encoding = std::make_unique<ReplEncoding>();
+	encoding->baseline = baseline;
+	encoding->state.resize(numObjects, 0);
+	encoding->deltaIndices.resize(numObjects, 0);
+
+	encodings.emplace_back(std::move(encoding));
+	return encodings.back().get();
+}
+
+static bool GetReplDelta(ReplEncoding & encoding,
+	const ReplSnapshot & tickSnapshot,
+	const std::vector<const ReplDescBase *> & replDescs,
+	size_t index,
+	Netcode::ArrayView<uint8_t> & content) {
+	if(encoding.state[index] == 0) {
+		const uint32_t objectId = tickSnapshot.GetObjectId(index);
+		Netcode::ArrayView<uint8_t> baselineContent{ nullptr, 0 };
+
+		if(encoding.baseline->Find(objectId, baselineContent, index) &&
+			ReplicateDeltaWrite(*replDescs[index], baselineContent, tickSnapshot.GetContent(index), encoding.delta)) {
+			encoding.state[index] = 1;
+			encoding.deltaIndices[index] = static_cast<uint32_t>(encoding.deltas.GetNumObjects());
+			encoding.deltas.Add(objectId, ToArrayView(encoding.delta));
+		} else {
+			encoding.state[index] = 2;
+		}
+	}
+
+	if(encoding.state[index] == 1) {
+		content = encoding.deltas.GetContent(encoding.deltaIndices[index]);
+		return true;
+	}
+
+	return false;
+}
+
+void GameServer::CaptureServerUpdates() {
+	NETCODE_PROFILE_SCOPE("CaptureServerUpdates");
+
+	Netcode::Stopwatch sw;
+	sw.Start();
+
+	UpdateStage & stage = updateStage;
+
+	// every object is serialized once per tick, the clients' baseline histories share the result
+	stage.snapshot = std::make_shared<ReplSnapshot>();
+	stage.replDescs.clear();
+	stage.isSpatial.clear();
+	stage.positions.clear();
+	stage.numTargets = 0;
+	stage.dtInSeconds = std::chrono::duration<float>(gameClock.GetDeltaTime()).count();
+	stage.tickStartedAt = tickStartedAt;
+
+	const auto replicate = [&](GameObject * obj, bool spatial) -> void {
+		Network * network = obj->GetComponent<Network>();
+
+		if(ReplicateWrite(obj, network, *stage.snapshot) > 0) {
+			const Netcode::Float3 position = spatial ? obj->GetComponent<Transform>()->position : Netcode::Float3{};
+
+			stage.replDescs.push_back(network->replDesc.get());
+			stage.isSpatial.push_back(spatial);
+			stage.positions.push_back(position);
+
+			if(spatial) {
+				interestGrid.Add(network->id, position);
+			}
+		}
+	};
+
+	interestGrid.Clear();
+
 	connections->ForeachUnsafe<Connection>([&](Connection * conn) -> void {
-		const uint32_t sequence = conn->localGameSequence++;
+		replicate(conn->gameObject, true);
+	});
 
-		Ref<nn::NetAllocator> allocator = service->MakeAllocator(2048);
-		np::ServerUpdate* su = allocator->MakeProto<np::ServerUpdate>();
+	if(scoreboardReplInterval < Netcode::Duration{}) {
+		if(!scoreboard->stats.empty()) {
+			replicate(scoreboardObject, false);
+			scoreboardReplInterval = std::chrono::seconds(1);
+		}
+	}
 
-		su->set_received_id(conn->remoteGameSequence);
-		
-		for(const RedundancyItem& item : conn->redundancyBuffer.GetBuffer()) {
-			AddActionResult(su, item);
+	interestGrid.Build();
+
+	connections->ForeachUnsafe<Connection>([&](Connection * conn) -> void {
+		if(stage.numTargets == stage.targets.size()) {
+			stage.targets.emplace_back();
 		}
 
-		connections->ForeachUnsafe<Connection>([&](Connection * inner) -> void {
-			ReplicateGameObject(su, inner->gameObject);
+		UpdateTarget & target = stage.targets[stage.numTargets++];
+		target.connection = std::static_pointer_cast<Connection>(conn->shared_from_this());
+		target.sequence = conn->localGameSequence++;
+		target.receivedId = conn->remoteGameSequence;
+		target.viewer = conn->gameObject->GetComponent<Transform>()->position;
+		target.viewerObjectId = conn->gameObject->GetComponent<Network>()->id;
+		target.reconciliations.Clear();
+		target.reconciliationItems.clear();
+
+		interestGrid.UpdateInterest(conn->interestSet, target.sequence, target.viewer, target.viewerObjectId);
+
+		perfCurrent.numInterestEvents += static_cast<uint32_t>(conn->interestSet.GetEntered().size() + conn->interestSet.GetLeft().size());
+
+		// the replications of a left object stop, the client hides it until it is replicated again
+		for(uint32_t objectId : conn->interestSet.GetLeft()) {
+			ServerReconciliation csr = {};
+			csr.id = conn->localCommandIndex++;
+			csr.type = ReconciliationType::COMMAND;
+			csr.actionType = ActionType::NOOP;
+			csr.command.type = CommandType::HIDE_OBJECT;
+			csr.command.objectId = objectId;
+			conn->redundancyBuffer.Add(target.sequence, std::move(csr));
+		}
+
+		conn->redundancyBuffer.Foreach([&](RedundancyItem & item) -> void {
+			const ServerReconciliation & recon = std::get<ServerReconciliation>(item.storage);
+
+			// a result is only useful while the client still predicts the action
+			if(maxResultSends != 0 && recon.type != ReconciliationType::COMMAND && item.numSends >= maxResultSends) {
+				return;
+			}
+
+			item.numSends++;
+
+			if(flatServerUpdates) {
+				target.reconciliations.Add(item);
+			} else {
+				target.reconciliationItems.push_back(item);
+			}
 		});
+	});
+
+	sw.Stop();
+	stage.capturedAt = Netcode::SystemClock::LocalNow();
+	perfCurrent.captureTime = sw.GetElapsedDuration();
+	perfCurrent.numReplBytes = static_cast<uint32_t>(stage.snapshot->GetSizeInBytes());
+	perfCurrent.numReplicatedObjects = static_cast<uint32_t>(stage.replDescs.size());
+}
+
+void GameServer::BuildServerUpdates(UpdateStage & stage) {
+	NETCODE_PROFILE_SCOPE("BuildServerUpdates");
+
+	Netcode::Stopwatch sw;
+	sw.Start();
+
+	stage.perf.queueTime = Netcode::SystemClock::LocalNow() - stage.capturedAt;
+
+	const ReplSnapshot & tickSnapshot = *stage.snapshot;
+	std::vector<std::unique_ptr<ReplEncoding>> encodings;
+
+	// per connection scratch, indexed by the candidates. Deltas are looked up again when written,
+	// encoding further objects may reallocate the buffer they are stored in
+	std::vector<PriorityCandidate> candidates;
+	std::vector<uint32_t> candidateIndices;
+	std::vector<ReplEncoding *> candidateEncodings;
+	std::vector<uint32_t> candidateBaselines;
+	std::vector<uint32_t> sentObjectIds;
 
-		if(scoreboardReplInterval < Netcode::Duration{}) {
-			if(!scoreboard->stats.empty()) {
-				ReplicateGameObject(su, scoreboardObject);
-				scoreboardReplInterval = std::chrono::seconds(1);
+	for(uint32_t targetIndex = 0; targetIndex < stage.numTargets; targetIndex++) {
+		UpdateTarget & target = stage.targets[targetIndex];
+		Connection * conn = target.connection.get();
+		const uint32_t sequence = target.sequence;
+
+		Ref<nn::NetAllocator> allocator = MakeAllocator(2048);
+		np::ServerUpdate* su = nullptr;
+
+		if(!flatServerUpdates) {
+			su = allocator->MakeProto<np::ServerUpdate>();
+			su->set_received_id(target.receivedId);
+
+			for(const RedundancyItem & item : target.reconciliationItems) {
+				AddActionResult(su, item);
+			}
+		}
+
+		candidates.clear();
+		candidateIndices.clear();
+		candidateEncodings.clear();
+		candidateBaselines.clear();
+
+		for(size_t i = 0; i < tickSnapshot.GetNumObjects(); i++) {
+			const uint32_t objectId = tickSnapshot.GetObjectId(i);
+
+			if(stage.isSpatial[i] && !conn->interestSet.IsRelevant(objectId)) {
+				continue;
 			}
+
+			Netcode::ArrayView<uint8_t> content = tickSnapshot.GetContent(i);
+			uint32_t baselineSequence = 0;
+			const ReplSnapshot * baseline = conn->baselines.FindBaseline(sequence, objectId, baselineSequence);
+			ReplEncoding * encoding = (baseline != nullptr) ? GetReplEncoding(encodings, stage.replDescs.size(), baseline) : nullptr;
+
+			if(encoding == nullptr || !GetReplDelta(*encoding, tickSnapshot, stage.replDescs, i, content)) {
+				encoding = nullptr;
+				baselineSequence = 0;
+			}
+
+			float importance = priorityConfig.globalImportance;
+			float distance = 0.0f;
+
+			if(stage.isSpatial[i]) {
+				importance = (objectId == target.viewerObjectId) ? priorityConfig.ownImportance : 1.0f;
+				distance = (Netcode::Vector3{ stage.positions[i] } - target.viewer).Length();
+			}
+
+			const float priority = conn->priorities.Accumulate(objectId, priorityConfig.Evaluate(importance, distance, stage.dtInSeconds));
+
+			candidates.push_back(PriorityCandidate{ static_cast<uint32_t>(candidateIndices.size()),
+				GetReplicationSizeBound(su == nullptr, static_cast<uint32_t>(content.Size())), priority });
+			candidateIndices.push_back(static_cast<uint32_t>(i));
+			candidateEncodings.push_back(encoding);
+			candidateBaselines.push_back(baselineSequence);
+		}
+
+		conn->priorities.RemoveStale();
+
+		const uint32_t usedBytes = (su != nullptr) ? static_cast<uint32_t>(su->ByteSizeLong()) :
+			(ServerUpdateWriter::FIXED_SIZE + target.reconciliations.GetSize());
+		const uint32_t budget = (priorityConfig.budgetInBytes > usedBytes) ? (priorityConfig.budgetInBytes - usedBytes) : 0;
+		const uint32_t numSelected = SelectByPriority(candidates, budget);
+
+		// the flat frame is written once into a buffer sized by the candidates' upper bounds
+		Netcode::MutableArrayView<uint8_t> frame{ nullptr, 0 };
+
+		if(su == nullptr) {
+			size_t frameSize = usedBytes;
+			for(uint32_t i = 0; i < numSelected; i++) {
+				frameSize += candidates[i].sizeInBytes;
+			}
+			frame = Netcode::MutableArrayView<uint8_t>{ allocator->MakeArray<uint8_t>(frameSize), frameSize };
+		}
+
+		ServerUpdateWriter writer{ frame, replicationCoder.get() };
+
+		if(su == nullptr) {
+			writer.WriteReconciliations(target.receivedId, target.reconciliations);
+			writer.BeginReplications();
+		}
+
+		sentObjectIds.clear();
+
+		for(uint32_t i = 0; i < numSelected; i++) {
+			const uint32_t idx = candidates[i].index;
+			const uint32_t objectIndex = candidateIndices[idx];
+			const uint32_t objectId = tickSnapshot.GetObjectId(objectIndex);
+			Netcode::ArrayView<uint8_t> content = tickSnapshot.GetContent(objectIndex);
+
+			if(candidateEncodings[idx] != nullptr) {
+				GetReplDelta(*candidateEncodings[idx], tickSnapshot, stage.replDescs, objectIndex, content);
+			}
+
+			if(su != nullptr) {
+				np::ReplData * replData = su->add_replications();
+				replData->set_object_id(objectId);
+				replData->set_baseline_id(candidateBaselines[idx]);
+				replData->set_data(content.Data(), content.Size());
+			} else {
+				writer.AddReplication(objectId, candidateBaselines[idx], content);
+			}
+
+			if(replicationTrainer != nullptr) {
+				replicationTrainer->Add(content);
+			}
+
+			conn->priorities.Reset(objectId);
+			sentObjectIds.push_back(objectId);
+		}
+
+		stage.perf.numReplDeferred += static_cast<uint32_t>(candidates.size()) - numSelected;
+
+		if(su == nullptr) {
+			writer.EndReplications();
+
+			Netcode::UndefinedBehaviourAssertion(!writer.HasOverflowed());
+
+			target.message.content = Netcode::ArrayView<uint8_t>{ frame.Data(), writer.GetSize() };
 		}
+
+		conn->baselines.Store(sequence, stage.snapshot, sentObjectIds);
 		
-		conn->serverUpdate = su;
-		conn->message.allocator = std::move(allocator);
-		conn->message.sequence = sequence;
-	});
+		target.serverUpdate = su;
+		target.message.allocator = std::move(allocator);
+		target.message.sequence = sequence;
+	}
+
+	sw.Stop();
+	stage.perf.replicationTime = sw.GetElapsedDuration();
+	stage.perf.numReplEncodings = static_cast<uint32_t>(encodings.size());
 }
 
-void GameServer::SendServerUpdates() {
-	connections->ForeachUnsafe<Connection>([&](Connection * conn) -> void {
-		size_t contentSize = conn->serverUpdate->ByteSizeLong();
-		uint8_t * content = conn->message.allocator->MakeArray<uint8_t>(contentSize);
+void GameServer::SendServerUpdates(UpdateStage & stage) {
+	NETCODE_PROFILE_SCOPE("SendServerUpdates");
 
-		if(conn->serverUpdate->SerializeToArray(content, static_cast<int32_t>(contentSize))) {
-			conn->message.content = Netcode::ArrayView<uint8_t>{ content, contentSize };
+	Netcode::Stopwatch sw;
+	sw.Start();
+
+	for(uint32_t targetIndex = 0; targetIndex < stage.numTargets; targetIndex++) {
+		UpdateTarget & target = stage.targets[targetIndex];
+
+		// flat frames are already in the message, the protobuf fallback is serialized here
+		if(target.serverUpdate != nullptr) {
+			size_t contentSize = target.serverUpdate->ByteSizeLong();
+			uint8_t * content = target.message.allocator->MakeArray<uint8_t>(contentSize);
+
+			if(target.serverUpdate->SerializeToArray(content, static_cast<int32_t>(contentSize))) {
+				target.message.content = Netcode::ArrayView<uint8_t>{ content, contentSize };
+			}
 		}
+
+		stage.perf.numUpdateBytes += static_cast<uint32_t>(target.message.content.Size());
 		
-		service->Send(conn->message, conn);
+		// a replay builds the updates for the tick times, but has no one to send them to
+		if(service != nullptr) {
+			service->Send(target.message, target.connection.get());
+		}
+
+		target.message.allocator.reset();
+		target.message.sequence = 0;
+		target.message.content = Netcode::ArrayView<uint8_t>{};
+		target.serverUpdate = nullptr;
+	}
+
+	sw.Stop();
+	stage.perf.sendTime = sw.GetElapsedDuration();
+	stage.perf.updateLatency = Netcode::SystemClock::LocalNow() - stage.tickStartedAt;
+
+	NETCODE_PROFILE_COUNTER("UpdateBytes", stage.perf.numUpdateBytes);
+}
 
-		conn->message.allocator.reset();
-		conn->message.sequence = 0;
-		conn->message.content = Netcode::ArrayView<uint8_t>{};
+void GameServer::LaunchServerUpdates() {
+	updateStage.perf = PerfData{};
+	hasPendingUpdates = true;
+
+	if(!pipelinedUpdates) {
+		BuildServerUpdates(updateStage);
+		SendServerUpdates(updateStage);
+		return;
+	}
+
+	Netcode::JobSystem * jobSystem = Service::Get<Netcode::JobSystem>();
+
+	updateJob = jobSystem->Create([this]() -> void {
+		BuildServerUpdates(updateStage);
+		SendServerUpdates(updateStage);
 	});
+
+	jobSystem->Run(updateJob);
 }
 
-GameServer::GameServer() : serverSession{}, actions{}, service{}, connections{}, gameClock{}, nextGameObjectId{ 1 } {
+void GameServer::WaitServerUpdates() {
+	NETCODE_PROFILE_SCOPE("WaitServerUpdates");
+
+	if(updateJob != nullptr) {
+		Netcode::Stopwatch sw;
+		sw.Start();
+		Service::Get<Netcode::JobSystem>()->Wait(updateJob);
+		sw.Stop();
+
+		updateStage.tickPerf.stallTime = sw.GetElapsedDuration();
+		updateJob = nullptr;
+	}
+
+	for(const std::pair<Connection *, uint32_t> & ack : baselineAcks) {
+		ack.first->baselines.Acknowledge(ack.second);
+	}
+
+	baselineAcks.clear();
+
+	if(!hasPendingUpdates) {
+		return;
+	}
+
+	hasPendingUpdates = false;
+
+	// the tick releases the connections, a disconnected one is destroyed with the last reference
+	for(uint32_t i = 0; i < updateStage.numTargets; i++) {
+		updateStage.targets[i].connection.reset();
+	}
+
+	if(!updateStage.recordPerf) {
+		return;
+	}
+
+	PerfData row = updateStage.tickPerf;
+	row.queueTime = updateStage.perf.queueTime;
+	row.replicationTime = updateStage.perf.replicationTime;
+	row.sendTime = updateStage.perf.sendTime;
+	row.updateLatency = updateStage.perf.updateLatency;
+	row.numReplEncodings = updateStage.perf.numReplEncodings;
+	row.numReplDeferred = updateStage.perf.numReplDeferred;
+	row.numUpdateBytes = updateStage.perf.numUpdateBytes;
+	perf.emplace_back(row);
+}
+
+GameServer::GameServer() : serverSession{}, actions{}, actionMerge{}, actionSources{}, actionCursors{}, maxActionDelay{}, maxActionLead{}, tickInterval{}, service{}, database{ nullptr }, connections{}, gameClock{}, perf{}, perfCurrent{}, perfPath{ "perf.csv" }, perfWritten{ false }, flatServerUpdates{ true }, maxResultSends{ 0 }, replicationCoder{}, replicationTrainer{}, replicationModelOutput{},
+	lagCompensation{ std::chrono::seconds(2) }, shots{}, shotOrder{}, shotRewindBucket{}, trafficRecorder{}, replay{ nullptr }, nextGameObjectId{ 1 },
+	pipelinedUpdates{ false }, tickStartedAt{}, updateStage{}, updateJob{ nullptr }, hasPendingUpdates{ false }, baselineAcks{}, isMatch{ false } {
 }
 
 void GameServer::Tick() {
 	gameClock.Tick();
+
+	RunTick();
+}
+
+void GameServer::RunTick() {
+	NETCODE_PROFILE_SCOPE("GameServer::Tick");
+
 	Netcode::Duration dt = gameClock.GetDeltaTime();
 	scoreboardReplInterval -= dt;
 
 	perfCurrent.timestamp = gameClock.GetGlobalTime();
 
+	if(trafficRecorder != nullptr) {
+		nn::TrafficRecord record;
+		record.type = nn::TrafficRecordType::TICK;
+		record.timestamp = gameClock.GetLocalTime();
+		trafficRecorder->Record(record);
+	}
+
 	Netcode::Stopwatch sw;
 	
 	sw.Start();
+	tickStartedAt = Netcode::SystemClock::LocalNow();
 	
 	FetchActions();
 
@@ -833,82 +1512,205 @@ void GameServer::Tick() {
 
 	SaveState();
 
+	// the updates of the previous tick were built and sent while this tick simulated
+	WaitServerUpdates();
+
 	FetchControlMessages();
 
 	ProcessControlMessages();
 
 	CheckTimeouts();
 
-	BuildServerUpdates();
+	CaptureServerUpdates();
 
-	SendServerUpdates();
+	// control messages are sent before the job starts encrypting on the same routes,
+	// the filters of a match are run by its host before the matches tick
+	if(service != nullptr && !isMatch) {
+		service->RunFilters();
+	}
 
-	service->RunFilters();
+	LaunchServerUpdates();
 
 	sw.Stop();
 
-	static bool written = false;
-
 	perfCurrent.frameTime = sw.GetElapsedDuration();
-	if((gameClock.GetLocalTime() - Netcode::Timestamp{}) > std::chrono::seconds(10)) {
-		if(!written) {
-			perf.emplace_back(perfCurrent);
-		}
-	}
 
+	NETCODE_PROFILE_COUNTER("Connections", connections->GetConnectionCount());
+
+	// a replay keeps every tick, ServerReplay saves them when the recording ends
+	updateStage.recordPerf = (replay != nullptr) ||
+		(!perfWritten && (gameClock.GetLocalTime() - Netcode::Timestamp{}) > std::chrono::seconds(10));
+	updateStage.tickPerf = perfCurrent;
 	perfCurrent = PerfData{};
-	if(!written && (gameClock.GetLocalTime() - Netcode::Timestamp{} > std::chrono::seconds(130))) {
-		std::ofstream ofs{ "perf.csv" };
-		
-		const uint32_t intervalMs = Netcode::Config::GetOptional<uint32_t>(L"network.client.tickIntervalMs:u32", 250u);
 
-		ofs << R"("timestamp","players","interval[ms]","frametime[ns]","recv[ns]","parse[ns]","proc[ns]","move[ns]","reconst[ns]",)";
-		ofs << R"("numPosCalc","sumPosCalc[ns]","numPxManip","sumPxManip[ns]","numPxPose","sumPxPose[ns]")" << std::endl;
-		
-		for(const PerfData& p : perf) {
-			ofs << std::chrono::duration<double>(p.timestamp - Netcode::Timestamp{}).count() << ",";
-			ofs << connections->GetConnectionCount() << ",";
-			ofs << std::chrono::milliseconds{ intervalMs }.count() << ",";
-			ofs << p.frameTime.count() << ",";
-			ofs << p.receiveTime.count() << ",";
-			ofs << p.parseTime.count() << ",";
-			ofs << p.processTime.count() << ",";
-			ofs << p.movementTime.count() << ",";
-			ofs << p.reconstrTime.count() << ",";
-			ofs << p.numPosCalc << ",";
-			ofs << p.posCalcTime.count() << ",";
-			ofs << p.numPxManip << ",";
-			ofs << p.pxSceneManipTime.count() << ",";
-			ofs << p.numPxPose << ",";
-			ofs << p.pxScenePoseTime.count() << std::endl;
+	if(replay != nullptr) {
+		return;
+	}
+
+	if(!perfWritten && (gameClock.GetLocalTime() - Netcode::Timestamp{} > std::chrono::seconds(130))) {
+		SavePerfData(perfPath);
+
+		if(replicationTrainer != nullptr) {
+			SaveReplicationModel(replicationModelOutput, replicationTrainer->Build());
+			Log::Debug("Replication model trained on {0} bytes", replicationTrainer->GetNumBytes());
 		}
 
-		ofs.close();
+		perfWritten = true;
+	}
+}
+
+void GameServer::SavePerfData(const std::string & path) {
+	// completes the row of the last tick
+	WaitServerUpdates();
 
-		Log::Debug("CSV saved");
-		written = true;
+	std::ofstream ofs{ path };
+	
+	const uint32_t intervalMs = Netcode::Config::GetOptional<uint32_t>(L"network.client.tickIntervalMs:u32", 250u);
+
+	ofs << R"("timestamp","players","interval[ms]","frametime[ns]","recv[ns]","parse[ns]","proc[ns]","move[ns]","reconst[ns]","numShots","numRewinds",)";
+	ofs << R"("numPosCalc","sumPosCalc[ns]","numPxManip","sumPxManip[ns]","numPxPose","sumPxPose[ns]",)";
+	ofs << R"("repl[ns]","numReplEncodings","replBytes","numReplObjects","numInterestEvents","numReplDeferred","send[ns]","updateBytes",)";
+	ofs << R"("capture[ns]","queue[ns]","stall[ns]","updateLatency[ns]")" << std::endl;
+	
+	for(const PerfData& p : perf) {
+		ofs << std::chrono::duration<double>(p.timestamp - Netcode::Timestamp{}).count() << ",";
+		ofs << connections->GetConnectionCount() << ",";
+		ofs << std::chrono::milliseconds{ intervalMs }.count() << ",";
+		ofs << p.frameTime.count() << ",";
+		ofs << p.receiveTime.count() << ",";
+		ofs << p.parseTime.count() << ",";
+		ofs << p.processTime.count() << ",";
+		ofs << p.movementTime.count() << ",";
+		ofs << p.reconstrTime.count() << ",";
+		ofs << p.numShots << ",";
+		ofs << p.numRewinds << ",";
+		ofs << p.numPosCalc << ",";
+		ofs << p.posCalcTime.count() << ",";
+		ofs << p.numPxManip << ",";
+		ofs << p.pxSceneManipTime.count() << ",";
+		ofs << p.numPxPose << ",";
+		ofs << p.pxScenePoseTime.count() << ",";
+		ofs << p.replicationTime.count() << ",";
+		ofs << p.numReplEncodings << ",";
+		ofs << p.numReplBytes << ",";
+		ofs << p.numReplicatedObjects << ",";
+		ofs << p.numInterestEvents << ",";
+		ofs << p.numReplDeferred << ",";
+		ofs << p.sendTime.count() << ",";
+		ofs << p.numUpdateBytes << ",";
+		ofs << p.captureTime.count() << ",";
+		ofs << p.queueTime.count() << ",";
+		ofs << p.stallTime.count() << ",";
+		ofs << p.updateLatency.count() << std::endl;
 	}
+
+	ofs.close();
+
+	Log::Debug("CSV saved");
 }
 
 void GameServer::Start(Netcode::Module::INetworkModule* network) {
 	gameClock.SetEpoch(Netcode::SystemClock::LocalNow() - Netcode::Timestamp{});
-
-	perf.reserve(16384);
 	
 	serverSession = std::dynamic_pointer_cast<nn::ServerSession>(network->CreateServer());
 	serverSession->Start();
 	
 	service = serverSession->GetService();
-	service->AddFilter(std::make_unique<ServerConnRequestFilter>(this));
+	database = serverSession->GetDatabase();
+	service->AddFilter(CreateConnRequestFilter([this]() -> GameServer * { return this; }, database));
 	
 	connections = service->GetConnections();
+	gameScene = Service::Get<GameSceneManager>()->GetScene();
+
+	Initialize();
+
+	const std::wstring recordPath = Netcode::Config::GetOptional<std::wstring>(L"network.server.recordTraffic:string", std::wstring{});
 
-	scoreboardObject = CreateScoreboard(nextGameObjectId++);
+	if(!recordPath.empty()) {
+		try {
+			trafficRecorder = std::make_unique<nn::TrafficRecorder>(recordPath);
+			Log::Info("Recording traffic to {0}", Netcode::Utility::ToNarrowString(recordPath));
+		} catch(Netcode::ExceptionBase & e) {
+			Log::Error("Failed to start traffic recording: {0}", e.ToString());
+		}
+	}
+}
+
+void GameServer::Shutdown() {
+	WaitServerUpdates();
+}
+
+void GameServer::StartReplay(ServerReplay * serverReplay, GameScene * scene) {
+	gameClock.SetEpoch(Netcode::SystemClock::LocalNow() - Netcode::Timestamp{});
+
+	replay = serverReplay;
+	connections = replay->GetConnections();
+	gameScene = (scene != nullptr) ? scene : Service::Get<GameSceneManager>()->GetScene();
+
+	Initialize();
+}
+
+void GameServer::StartMatch(Ref<nn::NetcodeService> sharedService, nn::MysqlSession * sharedDatabase, GameScene * scene, nn::ConnectionStorage * matchConnections, uint32_t matchId) {
+	gameClock.SetEpoch(Netcode::SystemClock::LocalNow() - Netcode::Timestamp{});
+
+	service = std::move(sharedService);
+	database = sharedDatabase;
+	gameScene = scene;
+	connections = matchConnections;
+	isMatch = true;
+	perfPath = "perf_match" + std::to_string(matchId) + ".csv";
+
+	Initialize();
+}
+
+std::unique_ptr<nn::FilterBase> GameServer::CreateConnRequestFilter(std::function<GameServer *()> route, nn::MysqlSession * database) {
+	return std::make_unique<ServerConnRequestFilter>(std::move(route), database);
+}
+
+void GameServer::Initialize() {
+	perf.reserve(16384);
+
+	scoreboardObject = CreateScoreboard(gameScene, nextGameObjectId++);
 	scoreboard = scoreboardObject->GetComponent<Script>()->GetScript<ScoreboardScript>(0);
 	scoreboardReplInterval = std::chrono::seconds(1);
 
-	gameScene = Service::Get<GameSceneManager>()->GetScene();
+	InterestConfig interestConfig;
+	interestConfig.cellSize = Netcode::Config::GetOptional<float>(L"network.server.interest.cellSize:float", interestConfig.cellSize);
+	interestConfig.relevanceRadius = Netcode::Config::GetOptional<float>(L"network.server.interest.relevanceRadius:float", interestConfig.relevanceRadius);
+	interestGrid = InterestGrid{ interestConfig };
+
+	priorityConfig.budgetInBytes = Netcode::Config::GetOptional<uint32_t>(L"network.server.priority.budgetBytes:u32", priorityConfig.budgetInBytes);
+	priorityConfig.distanceFalloff = Netcode::Config::GetOptional<float>(L"network.server.priority.distanceFalloff:float", priorityConfig.distanceFalloff);
+	priorityConfig.globalImportance = Netcode::Config::GetOptional<float>(L"network.server.priority.globalImportance:float", priorityConfig.globalImportance);
+	priorityConfig.ownImportance = Netcode::Config::GetOptional<float>(L"network.server.priority.ownImportance:float", priorityConfig.ownImportance);
+
+	flatServerUpdates = Netcode::Config::GetOptional<bool>(L"network.server.flatServerUpdates:bool", true);
+	maxResultSends = Netcode::Config::GetOptional<uint32_t>(L"network.server.maxResultSends:u32", 0u);
+
+	if(flatServerUpdates && Netcode::Config::GetOptional<bool>(L"network.server.entropyCoding:bool", false)) {
+		replicationCoder = LoadReplicationCoder(Netcode::Config::GetOptional<std::wstring>(L"network.protocol.replicationModel:string", std::wstring{}));
+	}
+
+	// the matches of a host would overwrite each other's model
+	if(!isMatch) {
+		replicationModelOutput = Netcode::Config::GetOptional<std::wstring>(L"network.server.replicationModelOutput:string", std::wstring{});
+	}
+
+	maxActionDelay = std::chrono::milliseconds(Netcode::Config::GetOptional<uint32_t>(L"network.server.maxActionDelayMs:u32", 1000u));
+	maxActionLead = std::chrono::milliseconds(Netcode::Config::GetOptional<uint32_t>(L"network.server.maxActionLeadMs:u32", 1000u));
+	tickInterval = std::chrono::milliseconds(Netcode::Config::Get<uint32_t>(L"network.server.tickIntervalMs:u32"));
+
+	shotRewindBucket = std::chrono::milliseconds(Netcode::Config::GetOptional<uint32_t>(L"network.server.shotRewindBucketMs:u32", 1u));
+
+	if(!replicationModelOutput.empty()) {
+		replicationTrainer = std::make_unique<nn::ReplicationModelTrainer>();
+	}
+
 	pxScene = gameScene->GetPhysXScene();
+
+	pipelinedUpdates = !isMatch && Netcode::Config::GetOptional<bool>(L"network.server.pipelinedUpdates:bool", false) &&
+		Service::Get<Netcode::JobSystem>()->GetNumThreads() > 1;
+
 	controllerManager = PxCreateControllerManager(*pxScene);
 	
 	/*
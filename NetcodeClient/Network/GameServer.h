@@ -5,16 +5,35 @@
 #include <Netcode/Network/Service.h>
 #include <Netcode/Network/ServerSession.h>
 #include "NetwUtil.h"
+#include "ServerUpdateFrame.h"
+#include <Netcode/Network/TrafficRecording.h>
+#include <Netcode/Network/LagCompensation.h>
+#include <Netcode/Network/TournamentTree.hpp>
+#include <Netcode/System/JobSystem.h>
+#include <functional>
 #include <random>
 
 class ServerClockSyncRequestFilter;
 class ServerConnRequestFilter;
+class ServerReplay;
+class ServerBenchmark;
 
 struct SpawnPoint {
 	Netcode::Float3 position;
 	Netcode::Float4 rotation;
 };
 
+/*
+ * Fire action waiting for the shot resolution at the end of the tick
+ */
+struct PendingShot {
+	Connection * owner;
+	Netcode::Float3 origin;
+	Netcode::Float3 direction;
+	Netcode::Timestamp rewindTime;
+	nn::HitboxHit playerHit;
+};
+
 struct PerfData {
 	Netcode::Timestamp timestamp;
 	Netcode::Duration frameTime;
@@ -26,22 +45,105 @@ struct PerfData {
 	Netcode::Duration posCalcTime;
 	Netcode::Duration pxSceneManipTime;
 	Netcode::Duration pxScenePoseTime;
+	// serializing the tick snapshot and copying the state the ServerUpdates are built from, on the tick thread
+	Netcode::Duration captureTime;
+	// from the capture until the ServerUpdates started to be built
+	Netcode::Duration queueTime;
+	// building every client's ServerUpdate
+	Netcode::Duration replicationTime;
+	// serializing the protobuf fallback and handing the updates to the service, which encrypts them
+	Netcode::Duration sendTime;
+	// the next tick waiting for the ServerUpdates of this one
+	Netcode::Duration stallTime;
+	// from the start of the tick until its last ServerUpdate was sent
+	Netcode::Duration updateLatency;
 	uint32_t numShots;
+	// distinct rewinds the shots of the tick were resolved with
+	uint32_t numRewinds;
 	uint32_t numPxManip;
 	uint32_t numPxPose;
 	uint32_t numPosCalc;
+	// number of distinct baselines the tick was delta encoded against
+	uint32_t numReplEncodings;
+	uint32_t numReplBytes;
+	uint32_t numReplicatedObjects;
+	// objects entering or leaving the clients' relevant sets
+	uint32_t numInterestEvents;
+	// relevant objects left out of the updates by the byte budget
+	uint32_t numReplDeferred;
+	// sum of the sizes of the ServerUpdates sent
+	uint32_t numUpdateBytes;
 
 	PerfData() : timestamp{}, frameTime{}, receiveTime{}, parseTime{}, processTime{}, movementTime{}, reconstrTime{},
-		posCalcTime{}, pxSceneManipTime{}, pxScenePoseTime{}, numShots{}, numPxManip{}, numPxPose{}, numPosCalc{} {
+		posCalcTime{}, pxSceneManipTime{}, pxScenePoseTime{}, captureTime{}, queueTime{}, replicationTime{}, sendTime{}, stallTime{}, updateLatency{}, numShots{}, numRewinds{}, numPxManip{}, numPxPose{}, numPosCalc{},
+		numReplEncodings{}, numReplBytes{}, numReplicatedObjects{}, numInterestEvents{}, numReplDeferred{}, numUpdateBytes{} {
 		
 	}
 };
 
+/*
+ * Client of a captured tick, with the state of its connection the ServerUpdate is built from
+ */
+struct UpdateTarget {
+	Ref<Connection> connection;
+	uint32_t sequence;
+	uint32_t receivedId;
+	uint32_t viewerObjectId;
+	Netcode::Float3 viewer;
+	ReconciliationSections reconciliations;
+	// copies of the items for the protobuf fallback
+	std::vector<RedundancyItem> reconciliationItems;
+	// cache members, handed from building the update to sending it
+	nn::GameMessage message;
+	np::ServerUpdate * serverUpdate;
+
+	UpdateTarget() : connection{}, sequence{ 0 }, receivedId{ 0 }, viewerObjectId{ 0 }, viewer{}, reconciliations{}, reconciliationItems{}, message{}, serverUpdate{ nullptr } { }
+};
+
+/*
+ * Second buffer of the tick state, the ServerUpdates are built from it. The next tick simulates on the
+ * live state meanwhile. Of the connections, the job building the updates touches the baselines and the
+ * priorities and reads the interest sets of the capture, the tick leaves them alone until it waits for the job.
+ */
+struct UpdateStage {
+	Ref<ReplSnapshot> snapshot;
+	std::vector<const ReplDescBase *> replDescs;
+	// objects without a position (eg. the scoreboard) are relevant to everyone
+	std::vector<uint8_t> isSpatial;
+	std::vector<Netcode::Float3> positions;
+	std::vector<UpdateTarget> targets;
+	uint32_t numTargets;
+	float dtInSeconds;
+	// start of the captured tick
+	Netcode::Timestamp tickStartedAt;
+	Netcode::Timestamp capturedAt;
+	// stages of the tick thread, the stages of the job are merged into it when the job is waited for
+	PerfData tickPerf;
+	PerfData perf;
+	bool recordPerf;
+
+	UpdateStage() : snapshot{}, replDescs{}, isSpatial{}, positions{}, targets{}, numTargets{ 0 }, dtInSeconds{ 0.0f },
+		tickStartedAt{}, capturedAt{}, tickPerf{}, perf{}, recordPerf{ false } { }
+};
+
 class GameServer {
 	Ref<nn::ServerSession> serverSession;
+	// actions of the tick in the order of their timestamps
 	std::vector<ExtClientAction> actions;
+	// merges the pending actions of the connections into the actions of the tick
+	nn::TournamentTree actionMerge;
+	std::vector<Connection *> actionSources;
+	// index of the front action in the pending actions of each source
+	std::vector<uint32_t> actionCursors;
+	// older actions are rejected, the lag compensation does not reach back that far
+	Netcode::Duration maxActionDelay;
+	// actions dated further ahead are rejected, the ones ahead by more than a tick wait for their tick
+	Netcode::Duration maxActionLead;
+	Netcode::Duration tickInterval;
 	std::vector<SpawnPoint> spawnPoints;
 	Ref<nn::NetcodeService> service;
+	// the game sessions of the players are written through it, null without a database
+	nn::MysqlSession * database;
 	Netcode::PxPtr<physx::PxControllerManager> controllerManager;
 	GameScene * gameScene;
 	physx::PxScene * pxScene;
@@ -53,7 +155,43 @@ class GameServer {
 	std::mt19937 mersenneTwister;
 	std::uniform_int_distribution<int> uniformIntDistribution;
 	std::vector<PerfData> perf;
+	PerfData perfCurrent;
+	std::string perfPath;
+	bool perfWritten;
+	InterestGrid interestGrid;
+	PriorityConfig priorityConfig;
+	// false sends the ServerUpdates as protobuf messages
+	bool flatServerUpdates;
+	// action results are left out of the updates after this many sends, commands are resent until acknowledged
+	uint32_t maxResultSends;
+	// entropy codes the replications of flat ServerUpdates if a model is configured
+	std::unique_ptr<nn::ReplicationCoder> replicationCoder;
+	// collects the sent replications to train a model, saved with the perf data
+	std::unique_ptr<nn::ReplicationModelTrainer> replicationTrainer;
+	std::wstring replicationModelOutput;
+	// hitbox history of the players, shots are tested against it instead of the physics scene
+	nn::LagCompensation lagCompensation;
+	// fire actions of the tick in the order they were processed
+	std::vector<PendingShot> shots;
+	std::vector<uint32_t> shotOrder;
+	// rewind times are rounded down to this, shots in the same bucket share a rewind, 0 keeps them exact
+	Netcode::Duration shotRewindBucket;
+	// records the received messages of every tick if configured
+	std::unique_ptr<nn::TrafficRecorder> trafficRecorder;
+	// not null while a recording is replayed, the server has no service then
+	ServerReplay * replay;
 	uint32_t nextGameObjectId;
+	// builds and sends the ServerUpdates of a tick on the job system while the next tick simulates
+	bool pipelinedUpdates;
+	// start of the running tick, handed to the stage by the capture, the job may still read the previous one
+	Netcode::Timestamp tickStartedAt;
+	UpdateStage updateStage;
+	Netcode::JobHandle updateJob;
+	bool hasPendingUpdates;
+	// baselines acknowledged while the job of the previous tick was running, applied when it is finished
+	std::vector<std::pair<Connection *, uint32_t>> baselineAcks;
+	// one of the matches of a MatchHost, the service, its filters and its connections are shared with the other matches
+	bool isMatch;
 
 	void OnPlayerJoined(Connection * connection);
 	void OnPlayerConnected(Connection * connection);
@@ -63,7 +201,16 @@ class GameServer {
 	void HandleSpawnAction(const ExtClientAction & action);
 	void DisconnectPlayer(Connection * connection);
 
+	void ResolveShots();
+
 	void FetchActions();
+
+	/*
+	 * k-way merge of the pending actions of the connections, the late ones are rejected on the way
+	 */
+	void MergeActions();
+
+	void RejectAction(const ExtClientAction & action);
 	
 	void ProcessActions();
 
@@ -75,9 +222,41 @@ class GameServer {
 
 	void CheckTimeouts();
 
-	void BuildServerUpdates();
+	/*
+	 * Tick thread, copies the state of the tick into the update stage
+	 */
+	void CaptureServerUpdates();
+
+	/*
+	 * Builds and sends the updates of the stage on the job system, or in place if the updates are not pipelined
+	 */
+	void LaunchServerUpdates();
+
+	/*
+	 * Waits for the updates of the previous tick and completes its perf row
+	 */
+	void WaitServerUpdates();
+
+	void BuildServerUpdates(UpdateStage & stage);
 
-	void SendServerUpdates();
+	void SendServerUpdates(UpdateStage & stage);
+
+	void ApplyFilters(Connection * conn, nn::ControlMessage & cm);
+
+	void CheckFilterCompletion(Connection * conn);
+
+	/*
+	 * System time, or the time of the replayed tick
+	 */
+	Netcode::Timestamp Now() const;
+
+	Ref<nn::NetAllocator> MakeAllocator(uint32_t blockSize) const;
+
+	void Initialize();
+
+	void RunTick();
+
+	void SavePerfData(const std::string & path);
 	
 public:
 
@@ -87,6 +266,36 @@ public:
 
 	void Start(Netcode::Module::INetworkModule * network);
 
+	/*
+	 * Starts the server without a network, the ticks are driven by the replay.
+	 * The server runs on the scene, on the loaded scene if it is null
+	 */
+	void StartReplay(ServerReplay * serverReplay, GameScene * scene);
+
+	/*
+	 * Starts the server as a match of a MatchHost. The match has a scene and connections of its own,
+	 * the host routes the new connections to it and runs the filters of the shared service.
+	 * The match is ticked as a single job, it does not run jobs of its own.
+	 */
+	void StartMatch(Ref<nn::NetcodeService> sharedService, nn::MysqlSession * sharedDatabase, GameScene * scene, nn::ConnectionStorage * matchConnections, uint32_t matchId);
+
+	uint32_t GetPlayerCount() const {
+		return connections->GetConnectionCount();
+	}
+
+	/*
+	 * Waits for the ServerUpdates in flight, the job system must still be alive
+	 */
+	void Shutdown();
+
+	/*
+	 * Accepts the connection requests of a service. The route picks the server of a new connection,
+	 * it returns null if every server is full. With a database the session hash of the request is validated first
+	 */
+	static std::unique_ptr<nn::FilterBase> CreateConnRequestFilter(std::function<GameServer *()> route, nn::MysqlSession * database);
+
 	friend class ServerConnRequestFilter;
 	friend class ServerClockSyncRequestFilter;
+	friend class ServerReplay;
+	friend class ServerBenchmark;
 };
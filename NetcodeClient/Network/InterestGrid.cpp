@@ -0,0 +1,203 @@
+#include "InterestGrid.h"
+#include <algorithm>
+#include <cmath>
+
+static uint32_t HashCell(int32_t x, int32_t y, int32_t z, uint32_t numBuckets) {
+	const uint32_t h = (static_cast<uint32_t>(x) * 73856093u) ^
+		(static_cast<uint32_t>(y) * 19349663u) ^
+		(static_cast<uint32_t>(z) * 83492791u);
+	return h & (numBuckets - 1);
+}
+
+static float DistanceSq(const Netcode::Float3 & a, const Netcode::Float3 & b) {
+	const float dx = a.x - b.x;
+	const float dy = a.y - b.y;
+	const float dz = a.z - b.z;
+	return dx * dx + dy * dy + dz * dz;
+}
+
+const InterestSet::Entry * InterestSet::Find(uint32_t objectId) const {
+	auto it = std::lower_bound(std::begin(relevant), std::end(relevant), objectId, [](const Entry & e, uint32_t id) -> bool {
+		return e.objectId < id;
+	});
+
+	if(it != std::end(relevant) && it->objectId == objectId) {
+		return &(*it);
+	}
+
+	return nullptr;
+}
+
+uint32_t InterestSet::GetRelevantSince(uint32_t objectId) const {
+	const Entry * entry = Find(objectId);
+	return (entry != nullptr) ? entry->relevantSince : 0;
+}
+
+void InterestSet::Clear() {
+	relevant.clear();
+	next.clear();
+	entered.clear();
+	left.clear();
+}
+
+InterestGrid::InterestGrid() : InterestGrid{ InterestConfig{} } {
+
+}
+
+InterestGrid::InterestGrid(const InterestConfig & config) : config{ config }, pvsFunction{}, objects{}, bucketStart{}, bucketItems{}, queryResult{} {
+	if(this->config.cellSize <= 0.0f) {
+		this->config.cellSize = InterestConfig{}.cellSize;
+	}
+
+	bucketStart.resize(NUM_BUCKETS + 1, 0);
+}
+
+void InterestGrid::SetPvsFunction(InterestPvsFunction function) {
+	pvsFunction = std::move(function);
+}
+
+void InterestGrid::ComputeCell(const Netcode::Float3 & position, int32_t * cell) const {
+	cell[0] = static_cast<int32_t>(std::floor(position.x / config.cellSize));
+	cell[1] = static_cast<int32_t>(std::floor(position.y / config.cellSize));
+	cell[2] = static_cast<int32_t>(std::floor(position.z / config.cellSize));
+}
+
+void InterestGrid::Clear() {
+	objects.clear();
+	bucketItems.clear();
+	std::fill(std::begin(bucketStart), std::end(bucketStart), 0);
+}
+
+void InterestGrid::Add(uint32_t objectId, const Netcode::Float3 & position) {
+	Object obj;
+	obj.objectId = objectId;
+	obj.position = position;
+	ComputeCell(position, obj.cell);
+	objects.push_back(obj);
+}
+
+void InterestGrid::Build() {
+	std::fill(std::begin(bucketStart), std::end(bucketStart), 0);
+
+	for(const Object & obj : objects) {
+		bucketStart[HashCell(obj.cell[0], obj.cell[1], obj.cell[2], NUM_BUCKETS) + 1]++;
+	}
+
+	for(uint32_t i = 1; i <= NUM_BUCKETS; i++) {
+		bucketStart[i] += bucketStart[i - 1];
+	}
+
+	bucketItems.resize(objects.size());
+
+	// bucketStart[b] is used as the insertion cursor of bucket b - 1, it ends up as the start of bucket b
+	for(uint32_t i = 0; i < static_cast<uint32_t>(objects.size()); i++) {
+		const Object & obj = objects[i];
+		const uint32_t bucket = HashCell(obj.cell[0], obj.cell[1], obj.cell[2], NUM_BUCKETS);
+		bucketItems[bucketStart[bucket]++] = i;
+	}
+
+	for(uint32_t i = NUM_BUCKETS; i > 0; i--) {
+		bucketStart[i] = bucketStart[i - 1];
+	}
+	bucketStart[0] = 0;
+}
+
+void InterestGrid::Query(const Netcode::Float3 & center, float radius, std::vector<uint32_t> & objectIndices) const {
+	const float radiusSq = radius * radius;
+
+	int32_t minCell[3];
+	int32_t maxCell[3];
+	ComputeCell(Netcode::Float3{ center.x - radius, center.y - radius, center.z - radius }, minCell);
+	ComputeCell(Netcode::Float3{ center.x + radius, center.y + radius, center.z + radius }, maxCell);
+
+	const double numCells =
+		(static_cast<double>(maxCell[0]) - minCell[0] + 1.0) *
+		(static_cast<double>(maxCell[1]) - minCell[1] + 1.0) *
+		(static_cast<double>(maxCell[2]) - minCell[2] + 1.0);
+
+	if(numCells > static_cast<double>(objects.size())) {
+		for(uint32_t i = 0; i < static_cast<uint32_t>(objects.size()); i++) {
+			if(DistanceSq(objects[i].position, center) <= radiusSq) {
+				objectIndices.push_back(i);
+			}
+		}
+		return;
+	}
+
+	for(int32_t x = minCell[0]; x <= maxCell[0]; x++) {
+		for(int32_t y = minCell[1]; y <= maxCell[1]; y++) {
+			for(int32_t z = minCell[2]; z <= maxCell[2]; z++) {
+				const uint32_t bucket = HashCell(x, y, z, NUM_BUCKETS);
+
+				for(uint32_t i = bucketStart[bucket]; i < bucketStart[bucket + 1]; i++) {
+					const uint32_t idx = bucketItems[i];
+					const Object & obj = objects[idx];
+
+					// other cells may share the bucket, visit every object only from its own cell
+					if(obj.cell[0] != x || obj.cell[1] != y || obj.cell[2] != z) {
+						continue;
+					}
+
+					if(DistanceSq(obj.position, center) <= radiusSq) {
+						objectIndices.push_back(idx);
+					}
+				}
+			}
+		}
+	}
+}
+
+void InterestGrid::UpdateInterest(InterestSet & interestSet, uint32_t sequence, const Netcode::Float3 & viewer, uint32_t viewerObjectId) const {
+	queryResult.clear();
+	Query(viewer, config.relevanceRadius, queryResult);
+
+	std::vector<InterestSet::Entry> & next = interestSet.next;
+	next.clear();
+
+	for(uint32_t idx : queryResult) {
+		const Object & obj = objects[idx];
+
+		if(obj.objectId != viewerObjectId && pvsFunction && !pvsFunction(viewer, obj.position)) {
+			continue;
+		}
+
+		next.push_back(InterestSet::Entry{ obj.objectId, sequence });
+	}
+
+	if(std::none_of(std::begin(next), std::end(next), [viewerObjectId](const InterestSet::Entry & e) -> bool { return e.objectId == viewerObjectId; })) {
+		if(std::any_of(std::begin(objects), std::end(objects), [viewerObjectId](const Object & o) -> bool { return o.objectId == viewerObjectId; })) {
+			next.push_back(InterestSet::Entry{ viewerObjectId, sequence });
+		}
+	}
+
+	std::sort(std::begin(next), std::end(next), [](const InterestSet::Entry & a, const InterestSet::Entry & b) -> bool {
+		return a.objectId < b.objectId;
+	});
+
+	interestSet.entered.clear();
+	interestSet.left.clear();
+
+	// merge the sorted sets: kept objects inherit the sequence they became relevant in
+	auto prevIt = std::begin(interestSet.relevant);
+	const auto prevEnd = std::end(interestSet.relevant);
+
+	for(InterestSet::Entry & entry : next) {
+		while(prevIt != prevEnd && prevIt->objectId < entry.objectId) {
+			interestSet.left.push_back(prevIt->objectId);
+			++prevIt;
+		}
+
+		if(prevIt != prevEnd && prevIt->objectId == entry.objectId) {
+			entry.relevantSince = prevIt->relevantSince;
+			++prevIt;
+		} else {
+			interestSet.entered.push_back(entry.objectId);
+		}
+	}
+
+	for(; prevIt != prevEnd; ++prevIt) {
+		interestSet.left.push_back(prevIt->objectId);
+	}
+
+	std::swap(interestSet.relevant, next);
+}
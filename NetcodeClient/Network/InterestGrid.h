@@ -0,0 +1,121 @@
+#pragma once
+
+#include <NetcodeFoundation/Math.h>
+#include <functional>
+#include <vector>
+
+struct InterestConfig {
+	// edge length of a grid cell, around the relevance radius a query visits at most 3x3x3 cells
+	float cellSize;
+	// objects farther than this from the viewer are not replicated to it
+	float relevanceRadius;
+
+	InterestConfig() : cellSize{ 10000.0f }, relevanceRadius{ 10000.0f } { }
+};
+
+/**
+ * Optional visibility test on top of the radius check, eg. a potentially visible set lookup
+ */
+using InterestPvsFunction = std::function<bool(const Netcode::Float3 & viewer, const Netcode::Float3 & subject)>;
+
+/**
+ * Objects relevant to a single client, sorted by their id
+ */
+class InterestSet {
+	friend class InterestGrid;
+
+	struct Entry {
+		uint32_t objectId;
+		// sequence of the game update in which the object became relevant
+		uint32_t relevantSince;
+	};
+
+	std::vector<Entry> relevant;
+	std::vector<Entry> next;
+	std::vector<uint32_t> entered;
+	std::vector<uint32_t> left;
+
+	const Entry * Find(uint32_t objectId) const;
+
+public:
+	bool IsRelevant(uint32_t objectId) const {
+		return Find(objectId) != nullptr;
+	}
+
+	/**
+	 * @return 0 if the object is not relevant
+	 */
+	uint32_t GetRelevantSince(uint32_t objectId) const;
+
+	/**
+	 * Objects that became relevant in the last update
+	 */
+	const std::vector<uint32_t> & GetEntered() const {
+		return entered;
+	}
+
+	/**
+	 * Objects that stopped being relevant in the last update
+	 */
+	const std::vector<uint32_t> & GetLeft() const {
+		return left;
+	}
+
+	void Clear();
+};
+
+/**
+ * Uniform grid over the positions of the replicated objects, rebuilt every tick.
+ * Cells are hashed into a fixed number of buckets so the world does not need to be bounded,
+ * the objects are bucketed with a counting sort.
+ */
+class InterestGrid {
+	struct Object {
+		uint32_t objectId;
+		int32_t cell[3];
+		Netcode::Float3 position;
+	};
+
+	constexpr static uint32_t NUM_BUCKETS = 1024;
+
+	InterestConfig config;
+	InterestPvsFunction pvsFunction;
+	std::vector<Object> objects;
+	std::vector<uint32_t> bucketStart;
+	std::vector<uint32_t> bucketItems;
+	mutable std::vector<uint32_t> queryResult;
+
+	void ComputeCell(const Netcode::Float3 & position, int32_t * cell) const;
+
+public:
+	InterestGrid();
+
+	InterestGrid(const InterestConfig & config);
+
+	void SetPvsFunction(InterestPvsFunction function);
+
+	const InterestConfig & GetConfig() const {
+		return config;
+	}
+
+	void Clear();
+
+	void Add(uint32_t objectId, const Netcode::Float3 & position);
+
+	/**
+	 * Buckets the objects added since the last Clear
+	 */
+	void Build();
+
+	/**
+	 * Collects the indices of the objects within the radius, in no particular order
+	 * @note falls back to a linear scan if the sphere covers more cells than there are objects
+	 */
+	void Query(const Netcode::Float3 & center, float radius, std::vector<uint32_t> & objectIndices) const;
+
+	/**
+	 * Replaces the relevant set of a client and records the enter and leave events.
+	 * The viewer's own object is always relevant, the PVS test is not applied to it.
+	 */
+	void UpdateInterest(InterestSet & interestSet, uint32_t sequence, const Netcode::Float3 & viewer, uint32_t viewerObjectId) const;
+};
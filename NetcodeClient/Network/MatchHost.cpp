@@ -0,0 +1,126 @@
+#include "MatchHost.h"
+#include "../Services.h"
+#include "../GameScene.h"
+#include <Netcode/Config.h>
+#include <Netcode/System/System.h>
+#include <Netcode/System/SystemClock.h>
+
+MatchHost::Match::Match() : id{ 0 }, scene{}, connections{}, server{} {
+
+}
+
+MatchHost::MatchHost() : serverSession{}, service{}, matches{}, playerCounts{}, schedule{}, tickInterval{}, maxPlayers{ 0 } {
+
+}
+
+MatchHost::~MatchHost() = default;
+
+void MatchHost::Start(Netcode::Module::INetworkModule * network, uint32_t numMatches) {
+	tickInterval = std::chrono::milliseconds(Netcode::Config::Get<uint32_t>(L"network.server.tickIntervalMs:u32"));
+	maxPlayers = Netcode::Config::GetOptional<uint8_t>(L"network.server.playerSlots:u8", 8);
+	const Netcode::Duration reportInterval = std::chrono::milliseconds(Netcode::Config::GetOptional<uint32_t>(L"network.server.matchHost.reportIntervalMs:u32", 10000u));
+
+	serverSession = std::dynamic_pointer_cast<nn::ServerSession>(network->CreateServer());
+	serverSession->Start();
+
+	service = serverSession->GetService();
+
+	GameScene * loadedScene = Service::Get<GameSceneManager>()->GetScene();
+	const Netcode::Timestamp now = Netcode::SystemClock::LocalNow();
+
+	matches.resize(numMatches);
+	playerCounts.resize(numMatches);
+
+	for(uint32_t i = 0; i < numMatches; i++) {
+		Match & match = matches[i];
+		match.id = i;
+		match.scene = std::make_unique<GameScene>();
+		match.scene->CloneColliders(loadedScene);
+		match.connections = std::make_unique<nn::ConnectionStorage>();
+		match.server = std::make_unique<GameServer>();
+		match.server->StartMatch(service, serverSession->GetDatabase(), match.scene.get(), match.connections.get(), i);
+	}
+
+	schedule.Start(numMatches, tickInterval, reportInterval, now);
+
+	service->AddFilter(GameServer::CreateConnRequestFilter([this]() -> GameServer * { return RouteConnection(); }, serverSession->GetDatabase()));
+
+	Log::Info("Hosting {0} matches of {1} players", numMatches, maxPlayers);
+}
+
+GameServer * MatchHost::RouteConnection() {
+	for(uint32_t i = 0; i < static_cast<uint32_t>(matches.size()); i++) {
+		playerCounts[i] = matches[i].server->GetPlayerCount();
+	}
+
+	const uint32_t selected = SelectMatch(playerCounts, maxPlayers);
+
+	return (selected < matches.size()) ? matches[selected].server.get() : nullptr;
+}
+
+void MatchHost::TickMatch(Match & match) {
+	const Netcode::Duration startedAt = Netcode::ThreadCpuTime();
+
+	// the scene of a match is stepped only by its own ticks, before the server ticks like the scene of the app
+	Netcode::Physics::StepScene(match.scene->GetPhysXScene(), tickInterval);
+
+	match.server->Tick();
+
+	schedule.AccountTick(match.id, Netcode::ThreadCpuTime() - startedAt);
+}
+
+void MatchHost::Tick() {
+	if(matches.empty()) {
+		return;
+	}
+
+	// connection requests are routed before the matches tick, the matches are not running meanwhile
+	service->RunFilters();
+
+	const Netcode::Timestamp now = Netcode::SystemClock::LocalNow();
+	const std::vector<uint32_t> & dueMatches = schedule.CollectDue(now);
+
+	Service::Get<Netcode::JobSystem>()->ParallelFor(0, static_cast<uint32_t>(dueMatches.size()), 1, [this, &dueMatches](uint32_t first, uint32_t last) -> void {
+		for(uint32_t i = first; i < last; i++) {
+			TickMatch(matches[dueMatches[i]]);
+		}
+	});
+
+	if(schedule.IsReportDue(now)) {
+		ReportCpuTime(now);
+	}
+}
+
+void MatchHost::ReportCpuTime(Netcode::Timestamp now) {
+	const double elapsedMs = std::chrono::duration<double, std::milli>(now - schedule.GetReportedAt()).count();
+
+	for(const Match & match : matches) {
+		const MatchLoad & load = schedule.GetLoad(match.id);
+		const double cpuMs = std::chrono::duration<double, std::milli>(load.cpuTime).count();
+		const double maxTickMs = std::chrono::duration<double, std::milli>(load.maxTickCpuTime).count();
+
+		Log::Info("Match #{0}: {1} players, {2} ticks, {3:.1f}ms CPU ({4:.1f}% of a core), max tick {5:.2f}ms",
+			match.id, match.server->GetPlayerCount(), load.numTicks, cpuMs, 100.0 * cpuMs / elapsedMs, maxTickMs);
+	}
+
+	schedule.ResetLoads(now);
+}
+
+void MatchHost::Shutdown() {
+	for(Match & match : matches) {
+		match.server->Shutdown();
+		match.scene->Clear();
+		match.server.reset();
+		match.scene.reset();
+	}
+
+	matches.clear();
+	playerCounts.clear();
+	schedule.Clear();
+	service.reset();
+
+	if(serverSession != nullptr) {
+		serverSession->Stop();
+		serverSession.reset();
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "GameServer.h"
+#include "MatchSchedule.h"
+
+class GameScene;
+
+/*
+ * Hosts many matches in one process over a single service. Every match is a GameServer with a scene
+ * and connections of its own, the matches share the socket, the DTLS routes and the cooked colliders.
+ * New connections are routed to the match with the fewest players, the due matches are ticked in
+ * parallel on the job system, one job per match, and the CPU time of each match is accounted.
+ * A tick of a match steps the PhysX scene of the match by the tick interval before its server ticks.
+ */
+class MatchHost {
+	struct Match {
+		uint32_t id;
+		std::unique_ptr<GameScene> scene;
+		std::unique_ptr<nn::ConnectionStorage> connections;
+		std::unique_ptr<GameServer> server;
+
+		Match();
+	};
+
+	Ref<nn::ServerSession> serverSession;
+	Ref<nn::NetcodeService> service;
+	std::vector<Match> matches;
+	std::vector<uint32_t> playerCounts;
+	MatchSchedule schedule;
+	Netcode::Duration tickInterval;
+	uint32_t maxPlayers;
+
+	/*
+	 * The match with the fewest players, null if every match is full
+	 */
+	GameServer * RouteConnection();
+
+	void TickMatch(Match & match);
+
+	void ReportCpuTime(Netcode::Timestamp now);
+
+public:
+	MatchHost();
+
+	~MatchHost();
+
+	bool IsRunning() const {
+		return !matches.empty();
+	}
+
+	/*
+	 * The matches copy the colliders of the currently loaded scene
+	 */
+	void Start(Netcode::Module::INetworkModule * network, uint32_t numMatches);
+
+	/*
+	 * Runs the filters of the service and ticks the matches that are due, returns when they are done
+	 */
+	void Tick();
+
+	/*
+	 * Stops the matches, the job system must still be alive
+	 */
+	void Shutdown();
+};
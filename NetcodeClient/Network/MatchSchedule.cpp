@@ -0,0 +1,78 @@
+#include "MatchSchedule.h"
+#include <algorithm>
+
+uint32_t SelectMatch(const std::vector<uint32_t> & playerCounts, uint32_t maxPlayers) {
+	const uint32_t numMatches = static_cast<uint32_t>(playerCounts.size());
+	uint32_t selected = numMatches;
+	uint32_t fewestPlayers = maxPlayers;
+
+	for(uint32_t i = 0; i < numMatches; i++) {
+		if(playerCounts[i] < fewestPlayers) {
+			fewestPlayers = playerCounts[i];
+			selected = i;
+		}
+	}
+
+	return selected;
+}
+
+MatchSchedule::MatchSchedule() : nextTickAt{}, loads{}, dueMatches{}, tickInterval{}, reportInterval{}, reportedAt{} {
+
+}
+
+void MatchSchedule::Start(uint32_t numMatches, Netcode::Duration interval, Netcode::Duration loadReportInterval, Netcode::Timestamp now) {
+	tickInterval = interval;
+	reportInterval = loadReportInterval;
+	reportedAt = now;
+
+	nextTickAt.resize(numMatches);
+	loads.assign(numMatches, MatchLoad{});
+	dueMatches.clear();
+	dueMatches.reserve(numMatches);
+
+	// staggered so the ticks of the matches are spread over the interval
+	for(uint32_t i = 0; i < numMatches; i++) {
+		nextTickAt[i] = now + (tickInterval * i) / numMatches;
+	}
+}
+
+const std::vector<uint32_t> & MatchSchedule::CollectDue(Netcode::Timestamp now) {
+	dueMatches.clear();
+
+	for(uint32_t i = 0; i < static_cast<uint32_t>(nextTickAt.size()); i++) {
+		Netcode::Timestamp & tickAt = nextTickAt[i];
+
+		if(tickAt > now) {
+			continue;
+		}
+
+		tickAt += tickInterval;
+
+		// a match fallen behind by more than a tick skips the missed ones instead of bursting through them
+		if(tickAt <= now) {
+			tickAt = now + tickInterval;
+		}
+
+		dueMatches.push_back(i);
+	}
+
+	return dueMatches;
+}
+
+void MatchSchedule::AccountTick(uint32_t matchIndex, Netcode::Duration tickCpuTime) {
+	MatchLoad & load = loads[matchIndex];
+	load.cpuTime += tickCpuTime;
+	load.maxTickCpuTime = std::max(load.maxTickCpuTime, tickCpuTime);
+	load.numTicks++;
+}
+
+void MatchSchedule::ResetLoads(Netcode::Timestamp now) {
+	std::fill(std::begin(loads), std::end(loads), MatchLoad{});
+	reportedAt = now;
+}
+
+void MatchSchedule::Clear() {
+	nextTickAt.clear();
+	loads.clear();
+	dueMatches.clear();
+}
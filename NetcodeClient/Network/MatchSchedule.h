@@ -0,0 +1,73 @@
+#pragma once
+
+#include <Netcode/System/TimeTypes.h>
+#include <cstdint>
+#include <vector>
+
+/**
+ * CPU time of the ticks of a match since the last report
+ */
+struct MatchLoad {
+	Netcode::Duration cpuTime;
+	Netcode::Duration maxTickCpuTime;
+	uint32_t numTicks;
+
+	MatchLoad() : cpuTime{}, maxTickCpuTime{}, numTicks{ 0 } { }
+};
+
+/**
+ * @return the index of the match with the fewest players, the first one on a tie, or the number of matches if every match is full
+ */
+uint32_t SelectMatch(const std::vector<uint32_t> & playerCounts, uint32_t maxPlayers);
+
+/**
+ * Tick times and CPU accounting of the matches of a MatchHost, kept apart from the matches themselves.
+ * The first ticks of the matches are staggered over the tick interval, a due match is scheduled a tick
+ * later, a match fallen behind by more than a tick skips the missed ones instead of bursting through them.
+ */
+class MatchSchedule {
+	std::vector<Netcode::Timestamp> nextTickAt;
+	std::vector<MatchLoad> loads;
+	std::vector<uint32_t> dueMatches;
+	Netcode::Duration tickInterval;
+	Netcode::Duration reportInterval;
+	Netcode::Timestamp reportedAt;
+
+public:
+	MatchSchedule();
+
+	void Start(uint32_t numMatches, Netcode::Duration interval, Netcode::Duration loadReportInterval, Netcode::Timestamp now);
+
+	/**
+	 * @return the indices of the matches due at now in the order of the matches, their next ticks are scheduled
+	 */
+	const std::vector<uint32_t> & CollectDue(Netcode::Timestamp now);
+
+	Netcode::Timestamp GetNextTickAt(uint32_t matchIndex) const {
+		return nextTickAt[matchIndex];
+	}
+
+	/**
+	 * Matches are accounted from their own jobs, distinct matches can be accounted concurrently
+	 */
+	void AccountTick(uint32_t matchIndex, Netcode::Duration tickCpuTime);
+
+	const MatchLoad & GetLoad(uint32_t matchIndex) const {
+		return loads[matchIndex];
+	}
+
+	bool IsReportDue(Netcode::Timestamp now) const {
+		return (now - reportedAt) >= reportInterval;
+	}
+
+	Netcode::Timestamp GetReportedAt() const {
+		return reportedAt;
+	}
+
+	/**
+	 * Starts a new report period, the loads are cleared
+	 */
+	void ResetLoads(Netcode::Timestamp now);
+
+	void Clear();
+};
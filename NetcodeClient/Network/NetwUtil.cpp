@@ -2,6 +2,7 @@
 #include "../Services.h"
 #include "ReplArguments.hpp"
 #include "../Asset/ClientConverters.h"
+#include <Netcode/IO/File.h>
 
 np::ClientUpdate * ParseClientUpdate(nn::GameMessage * message) {
 	if(message == nullptr) {
@@ -27,8 +28,7 @@ void ConvertFloat3(np::Float3 * dst, const Netcode::Float3 & src) {
 	dst->set_z(src.z);
 }
 
-GameObject * CreateScoreboard(uint32_t id) {
-	GameScene * scene = Service::Get<GameSceneManager>()->GetScene();
+GameObject * CreateScoreboard(GameScene * scene, uint32_t id) {
 	GameObject * object = scene->Create("Scoreboard");
 	Network * networkComponent = object->AddComponent<Network>();
 	Script * script = object->AddComponent<Script>();
@@ -40,9 +40,7 @@ GameObject * CreateScoreboard(uint32_t id) {
 	return object;
 }
 
-GameObject * CreateRemoteAvatar(Netcode::Duration interpDelay, physx::PxControllerManager * controllerManager) {
-	GameScene * gameScene = Service::Get<GameSceneManager>()->GetScene();
-	
+GameObject * CreateRemoteAvatar(GameScene * gameScene, Netcode::Duration interpDelay, physx::PxControllerManager * controllerManager) {
 	GameObject * avatarController = gameScene->Create("remoteAvatarCtrl");
 	
 	auto [ctrlTransform, ctrlScript, ctrlNetwork, ctrlCamera] = avatarController->AddComponents<Transform, Script, Network, Camera>();
@@ -64,10 +62,10 @@ GameObject * CreateRemoteAvatar(Netcode::Duration interpDelay, physx::PxControll
 }
 
 std::string ReplicateWrite(GameObject * gameObject, Network * networkComponent) {
-	uint32_t requiredSize = 0;
-	for(std::unique_ptr<ReplArgumentBase> & arg : networkComponent->replDesc) {
-		requiredSize += arg->GetReplicatedSize(gameObject);
-	}
+	if(networkComponent->replDesc == nullptr)
+		return std::string{};
+
+	const uint32_t requiredSize = networkComponent->replDesc->GetReplicatedSize(gameObject);
 
 	if(requiredSize == 0)
 		return std::string{};
@@ -79,82 +77,116 @@ std::string ReplicateWrite(GameObject * gameObject, Network * networkComponent)
 		reinterpret_cast<uint8_t *>(binary.data()),
 		binary.size()
 	};
-	
-	for(std::unique_ptr<ReplArgumentBase> & arg : networkComponent->replDesc) {
-		const uint32_t writtenSize = arg->Write(gameObject, view);
 
-		if(writtenSize == 0)
-			throw Netcode::UndefinedBehaviourException{ "Failed to write replication data" };
-
-		view = view.Offset(writtenSize);
-	}
+	if(networkComponent->replDesc->Write(gameObject, view) != requiredSize)
+		throw Netcode::UndefinedBehaviourException{ "Failed to write replication data" };
 
 	return binary;
 }
 
+uint32_t ReplicateWrite(GameObject * gameObject, Network * networkComponent, ReplSnapshot & snapshot) {
+	if(networkComponent->replDesc == nullptr)
+		return 0;
+
+	const uint32_t requiredSize = networkComponent->replDesc->GetReplicatedSize(gameObject);
+
+	if(requiredSize == 0)
+		return 0;
+
+	Netcode::MutableArrayView<uint8_t> view = snapshot.Allocate(networkComponent->id, requiredSize);
+
+	if(networkComponent->replDesc->Write(gameObject, view) != requiredSize)
+		throw Netcode::UndefinedBehaviourException{ "Failed to write replication data" };
+
+	return requiredSize;
+}
+
 void ReplicateRead(GameObject* gameObject, Network * networkComponent, const std::string & content, Netcode::GameClock * clock, int32_t connectionId, ActorType actor) {
-	if(content.empty())
+	if(content.empty() || networkComponent->replDesc == nullptr)
 		return;
 	
 	Netcode::ArrayView<uint8_t> src{ reinterpret_cast<const uint8_t *>(content.data()), content.size() };
 
-	for(std::unique_ptr<ReplArgumentBase> & arg : networkComponent->replDesc) {
-		const uint32_t replicatedSize = arg->QueryReplicatedSize(src);
-		const ReplType type = arg->GetType();
-
-		if(replicatedSize == 0)
-			throw Netcode::UndefinedBehaviourException{ "Failed to read from replication data" };
-
-		/**
-		 * Client predicted values are rejected by the server regardless of the owner
-		 */
-		if(actor == ActorType::SERVER && type == ReplType::CLIENT_PREDICTED) {
-			src = src.Offset(replicatedSize);
-			continue;
-		}
-
-		/**
-		 * The owner client rejects the replication because it is the one predicting it
-		 */
-		if(actor == ActorType::CLIENT && type == ReplType::CLIENT_PREDICTED && connectionId == networkComponent->owner) {
-			src = src.Offset(replicatedSize);
-			continue;
-		}
-		
-		const uint32_t readSize = arg->Read(gameObject, src);
-
-		networkComponent->updatedAt = clock->GetLocalTime();
-
-		if(replicatedSize != readSize)
-			throw Netcode::UndefinedBehaviourException{ "Replication failed due to mismatching sizes" };
-		
-		src = src.Offset(readSize);
+	/**
+	 * Client predicted values are rejected by the server regardless of the owner,
+	 * the owner client rejects them because it is the one predicting them
+	 */
+	const bool rejectPredicted = (actor == ActorType::SERVER) ||
+		(actor == ActorType::CLIENT && connectionId == networkComponent->owner);
+
+	const uint32_t readSize = networkComponent->replDesc->Read(gameObject, src, rejectPredicted);
+
+	if(readSize == 0)
+		throw Netcode::UndefinedBehaviourException{ "Failed to read from replication data" };
+
+	networkComponent->updatedAt = clock->GetLocalTime();
+}
+
+std::unique_ptr<nn::ReplicationCoder> LoadReplicationCoder(const std::wstring & modelPath) {
+	if(modelPath.empty()) {
+		return nullptr;
+	}
+
+	std::vector<uint8_t> data;
+
+	try {
+		Netcode::IO::File modelFile{ modelPath };
+		Netcode::IO::FileReader<Netcode::IO::File> reader{ modelFile };
+		data.resize(reader->GetSize());
+		data.resize(reader->Read(Netcode::MutableArrayView<uint8_t>{ data.data(), data.size() }));
+	} catch(Netcode::ExceptionBase & e) {
+		Log::Error("Failed to read the replication model: {0}", e.ToString());
+		return nullptr;
+	}
+
+	nn::ReplicationModel model;
+
+	if(!model.Deserialize(Netcode::ArrayView<uint8_t>{ data.data(), data.size() })) {
+		Log::Error("Invalid replication model: {0}", Netcode::Utility::ToNarrowString(modelPath));
+		return nullptr;
 	}
+
+	return std::make_unique<nn::ReplicationCoder>(std::move(model));
+}
+
+void SaveReplicationModel(const std::wstring & modelPath, const nn::ReplicationModel & model) {
+	const std::vector<uint8_t> data = model.Serialize();
+
+	try {
+		Netcode::IO::File modelFile{ modelPath };
+		Netcode::IO::FileWriter<Netcode::IO::File> writer{ modelFile };
+		writer->Write(Netcode::ArrayView<uint8_t>{ data.data(), data.size() });
+	} catch(Netcode::ExceptionBase & e) {
+		Log::Error("Failed to save the replication model: {0}", e.ToString());
+	}
+}
+
+/*
+ * The view direction is a unit vector, 16 bits per component keep the error of it below 2e-5
+ */
+static nn::BoundedFloat3Quantizer CreateDirectionQuantizer() {
+	return nn::BoundedFloat3Quantizer{ Netcode::Float3{ -1.0f, -1.0f, -1.0f }, Netcode::Float3{ 1.0f, 1.0f, 1.0f }, 16 };
 }
 
 ReplDesc CreateLocalAvatarReplDesc(Camera* cameraComponent) {
-	ReplDesc replDesc;
-	replDesc.emplace_back(ReplicateAsIsFromComponent(ReplType::CLIENT_PREDICTED, &Transform::position));
-	replDesc.emplace_back(ReplicateAsIsFromState(ReplType::DEFAULT, cameraComponent, &Camera::ahead));
-	return replDesc;
+	return MakeReplDesc(
+		ReplFromComponent<ReplType::CLIENT_PREDICTED, &Transform::position>(),
+		ReplQuantizedFromState<ReplType::DEFAULT, &Camera::ahead>(cameraComponent, CreateDirectionQuantizer()));
 }
 
 ReplDesc CreateScoreboardReplDesc(ScoreboardScript * scoreboard) {
-	ReplDesc replDesc;
-	replDesc.emplace_back(ReplicateAsIsFromState(ReplType::DEFAULT, scoreboard, &ScoreboardScript::stats));
-	return replDesc;
+	return MakeReplDesc(
+		ReplFromState<ReplType::DEFAULT, &ScoreboardScript::stats>(scoreboard));
 }
 
 ReplDesc ClientCreateRemoteAvatarReplDesc(RemotePlayerScript * rps) {
-	ReplDesc replDesc;
-	replDesc.emplace_back(ReplicateAsIsFromState(ReplType::CLIENT_PREDICTED, rps, &RemotePlayerScript::IND_position));
-	replDesc.emplace_back(ReplicateAsIsFromState(ReplType::DEFAULT, rps, &RemotePlayerScript::IND_ahead));
-	return replDesc;
+	return MakeReplDesc(
+		ReplFromState<ReplType::CLIENT_PREDICTED, &RemotePlayerScript::IND_position>(rps),
+		ReplQuantizedFromState<ReplType::DEFAULT, &RemotePlayerScript::IND_ahead>(rps, CreateDirectionQuantizer()));
 }
 
 ReplDesc CreateRemoteAvatarReplDesc() {
-	ReplDesc replDesc;
-	replDesc.emplace_back(ReplicateAsIsFromComponent(ReplType::CLIENT_PREDICTED, &Transform::position));
-	replDesc.emplace_back(ReplicateAsIsFromComponent(ReplType::DEFAULT, &Camera::ahead));
-	return replDesc;
+	return MakeReplDesc(
+		ReplFromComponent<ReplType::CLIENT_PREDICTED, &Transform::position>(),
+		ReplQuantizedFromComponent<ReplType::DEFAULT, &Camera::ahead>(CreateDirectionQuantizer()));
 }
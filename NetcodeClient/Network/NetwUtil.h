@@ -3,15 +3,34 @@
 #include "../GameObject.h"
 #include "../Scripts/RemotePlayerScript.h"
 #include "NetwDecl.h"
+#include "ReplBaseline.h"
+#include "InterestGrid.h"
+#include "PriorityAccumulator.h"
+#include <Netcode/Network/RangeCoder.h>
+
+class GameScene;
 
 enum class HostMode : uint32_t {
 	CLIENT, LISTEN, DEDICATED
 };
 
+struct Connection;
+
+struct ExtClientAction : public ClientAction {
+	Connection * owner;
+};
+
 struct Connection : public nn::ConnectionBase {
 	RedundancyBuffer redundancyBuffer;
+	// received actions not processed yet, sorted by their timestamps
+	std::vector<ExtClientAction> pendingActions;
+	ReplBaselineHistory baselines;
+	InterestSet interestSet;
+	PriorityAccumulator priorities;
 	GameObject * gameObject;
 	RemotePlayerScript * remotePlayerScript;
+	// database id of the logged in user, zero if the server runs without a database
+	int userId;
 	uint32_t localActionIndex;
 	uint32_t remoteActionIndex;
 	uint32_t localCommandIndex;
@@ -23,15 +42,11 @@ struct Connection : public nn::ConnectionBase {
 
 
 	Connection(boost::asio::io_context & ioc) : nn::ConnectionBase{ ioc },
-		redundancyBuffer{}, gameObject{ nullptr }, remotePlayerScript{ nullptr },
+		redundancyBuffer{}, pendingActions{}, baselines{ 2 * ReplBaselineHistory::BASELINE_WINDOW }, interestSet{}, priorities{}, gameObject{ nullptr }, remotePlayerScript{ nullptr }, userId{ 0 },
 		localActionIndex{ 1 }, remoteActionIndex{ 0 }, localCommandIndex{ 1 },
 		remoteCommandIndex{ 0 }, filters{}, message{}, serverUpdate{ nullptr } { }
 };
 
-struct ExtClientAction : public ClientAction {
-	Connection * owner;
-};
-
 template<typename T>
 class NodeIter {
 	nn::Node<T> * current;
@@ -58,12 +73,13 @@ public:
 constexpr static uint32_t REPL_TYPE_REMOTE_AVATAR = 16;
 constexpr static uint32_t REPL_TYPE_SCOREBOARD = 17;
 
-struct ReplData {
-	uint32_t objectId;
-	std::string content;
-};
-
 std::string ReplicateWrite(GameObject * gameObject, Network * networkComponent);
+
+/**
+ * Serializes the object at the end of the snapshot
+ * @return the number of bytes written, 0 if the object has nothing to replicate
+ */
+uint32_t ReplicateWrite(GameObject * gameObject, Network * networkComponent, ReplSnapshot & snapshot);
 void ReplicateRead(GameObject * gameObject, Network * networkComponent, const std::string & content, Netcode::GameClock* clock, int32_t connectionId, ActorType actor);
 
 struct ScoreboardScript : public ScriptBase {
@@ -81,9 +97,17 @@ Netcode::Float3 ConvertFloat3(const np::Float3 & f3);
 
 void ConvertFloat3(np::Float3 * dst, const Netcode::Float3 & src);
 
-GameObject * CreateScoreboard(uint32_t id);
+GameObject * CreateScoreboard(GameScene * scene, uint32_t id);
+
+/**
+ * Loads a model saved by SaveReplicationModel
+ * @return nullptr if the path is empty or the file is not a valid model, the reason is logged
+ */
+std::unique_ptr<nn::ReplicationCoder> LoadReplicationCoder(const std::wstring & modelPath);
+
+void SaveReplicationModel(const std::wstring & modelPath, const nn::ReplicationModel & model);
 
 /*
  * 
  */
-GameObject * CreateRemoteAvatar(Netcode::Duration interpDelay, physx::PxControllerManager * controllerManager);
+GameObject * CreateRemoteAvatar(GameScene * gameScene, Netcode::Duration interpDelay, physx::PxControllerManager * controllerManager);
@@ -0,0 +1,81 @@
+#include "PriorityAccumulator.h"
+#include <algorithm>
+
+float PriorityConfig::Evaluate(float importance, float distance, float dtInSeconds) const {
+	const float falloff = (distanceFalloff > 0.0f) ? (distanceFalloff / (distanceFalloff + std::max(distance, 0.0f))) : 1.0f;
+	return importance * falloff * dtInSeconds;
+}
+
+uint32_t SelectByPriority(std::vector<PriorityCandidate> & candidates, uint32_t budgetInBytes) {
+	std::sort(std::begin(candidates), std::end(candidates), [](const PriorityCandidate & a, const PriorityCandidate & b) -> bool {
+		return a.priority > b.priority;
+	});
+
+	uint32_t numSelected = 0;
+	uint32_t usedBytes = 0;
+
+	for(size_t i = 0; i < candidates.size(); i++) {
+		const uint32_t size = candidates[i].sizeInBytes;
+
+		if(numSelected > 0 && (usedBytes + size) > budgetInBytes) {
+			continue;
+		}
+
+		usedBytes += size;
+		std::swap(candidates[numSelected++], candidates[i]);
+	}
+
+	return numSelected;
+}
+
+PriorityAccumulator::Entry * PriorityAccumulator::Find(uint32_t objectId) {
+	auto it = std::lower_bound(std::begin(entries), std::end(entries), objectId, [](const Entry & e, uint32_t id) -> bool {
+		return e.objectId < id;
+	});
+
+	if(it != std::end(entries) && it->objectId == objectId) {
+		return &(*it);
+	}
+
+	return nullptr;
+}
+
+float PriorityAccumulator::Accumulate(uint32_t objectId, float priority) {
+	Entry * entry = Find(objectId);
+
+	if(entry == nullptr) {
+		auto it = std::lower_bound(std::begin(entries), std::end(entries), objectId, [](const Entry & e, uint32_t id) -> bool {
+			return e.objectId < id;
+		});
+
+		entry = &(*entries.insert(it, Entry{ objectId, 0.0f, false }));
+	}
+
+	entry->priority += priority;
+	entry->accumulated = true;
+	return entry->priority;
+}
+
+void PriorityAccumulator::Reset(uint32_t objectId) {
+	Entry * entry = Find(objectId);
+
+	if(entry != nullptr) {
+		entry->priority = 0.0f;
+	}
+}
+
+void PriorityAccumulator::RemoveStale() {
+	auto it = std::remove_if(std::begin(entries), std::end(entries), [](const Entry & e) -> bool {
+		return !e.accumulated;
+	});
+
+	entries.erase(it, std::end(entries));
+
+	for(Entry & e : entries) {
+		e.accumulated = false;
+	}
+}
+
+void PriorityAccumulator::Clear() {
+	entries.clear();
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+struct PriorityConfig {
+	// upper bound of a ServerUpdate in bytes, the highest priority object is sent even if it alone exceeds it
+	uint32_t budgetInBytes;
+	// distance at which the priority of an object halves
+	float distanceFalloff;
+	// weight of the objects that are relevant regardless of their position
+	float globalImportance;
+	// weight of the client's own avatar, its replicated state is predicted on the client
+	float ownImportance;
+
+	PriorityConfig() : budgetInBytes{ 1200 }, distanceFalloff{ 2000.0f }, globalImportance{ 0.25f }, ownImportance{ 0.1f } { }
+
+	/**
+	 * Priority gained by an object over a tick
+	 */
+	float Evaluate(float importance, float distance, float dtInSeconds) const;
+};
+
+struct PriorityCandidate {
+	uint32_t index;
+	uint32_t sizeInBytes;
+	float priority;
+};
+
+/**
+ * Sorts the candidates by their priority and greedily packs them into the budget.
+ * Candidates that do not fit are skipped so smaller ones can still fill the remaining space.
+ * @return the number of selected candidates, they are moved to the front of the vector
+ */
+uint32_t SelectByPriority(std::vector<PriorityCandidate> & candidates, uint32_t budgetInBytes);
+
+/**
+ * Priorities of the objects relevant to a single client, sorted by their id.
+ * Priorities grow every tick an object is not sent and are reset when it is.
+ */
+class PriorityAccumulator {
+	struct Entry {
+		uint32_t objectId;
+		float priority;
+		bool accumulated;
+	};
+
+	std::vector<Entry> entries;
+
+	Entry * Find(uint32_t objectId);
+
+public:
+	/**
+	 * @return the accumulated priority of the object
+	 */
+	float Accumulate(uint32_t objectId, float priority);
+
+	void Reset(uint32_t objectId);
+
+	/**
+	 * Drops the objects that were not accumulated since the last call, eg. the ones that stopped being relevant
+	 */
+	void RemoveStale();
+
+	void Clear();
+};
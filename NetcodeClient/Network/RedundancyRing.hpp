@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/*
+ * Ring of items in the order of their sequences, the storage of the RedundancyBuffer.
+ * Acknowledgements are cumulative so a confirm pops the front. The slots are reused,
+ * the ring only grows while the remote is not acknowledging.
+ * T needs a default constructor, move assignment and a uint32_t sequence member.
+ */
+template<typename T>
+class RedundancyRing {
+	std::vector<T> slots;
+	uint32_t head;
+	uint32_t count;
+
+	uint32_t GetMask() const {
+		return static_cast<uint32_t>(slots.size()) - 1;
+	}
+
+	void Grow() {
+		std::vector<T> grown(2 * slots.size());
+
+		for(uint32_t i = 0; i < count; i++) {
+			grown[i] = std::move(slots[(head + i) & GetMask()]);
+		}
+
+		slots = std::move(grown);
+		head = 0;
+	}
+
+public:
+	// power of 2
+	constexpr static uint32_t INITIAL_CAPACITY = 32;
+
+	RedundancyRing() : slots(INITIAL_CAPACITY), head{ 0 }, count{ 0 } { }
+
+	/*
+	 * The slot keeps the members of its previous item except the sequence, the caller resets them
+	 */
+	T & Push(uint32_t sequence) {
+		if(count == slots.size()) {
+			Grow();
+		}
+
+		T & item = slots[(head + count) & GetMask()];
+		item.sequence = sequence;
+		count++;
+		return item;
+	}
+
+	uint32_t GetCount() const {
+		return count;
+	}
+
+	uint32_t GetCapacity() const {
+		return static_cast<uint32_t>(slots.size());
+	}
+
+	/*
+	 * Oldest item first
+	 */
+	template<typename F>
+	void Foreach(F f) {
+		for(uint32_t i = 0; i < count; i++) {
+			f(slots[(head + i) & GetMask()]);
+		}
+	}
+
+	template<typename F>
+	void Foreach(F f) const {
+		for(uint32_t i = 0; i < count; i++) {
+			f(slots[(head + i) & GetMask()]);
+		}
+	}
+
+	// remove objects that are implicitly confirmed by the remoteSequence.
+	void Confirm(uint32_t confirmedSequence) {
+		while(count > 0 && slots[head].sequence <= confirmedSequence) {
+			head = (head + 1) & GetMask();
+			count--;
+		}
+	}
+};
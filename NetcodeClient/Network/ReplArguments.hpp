@@ -1,7 +1,8 @@
 #pragma once
 
+#include "../GameObject.h"
 #include "ReplDesc.h"
-#include "Replicator.hpp"
+#include "ReplLayout.hpp"
 
 template<typename Component, typename TValueType>
 struct ComponentValueAccessor {
@@ -148,3 +149,53 @@ auto ReplicateTransformedFromState(ReplType type, BaseType * state, ValueType Ba
 		fInvTransform
 	};
 }
+
+/*
+ * Bit packs the value with a quantizer, see QuantizedCodec
+ */
+template<typename AccessorType, typename Quantizer>
+struct QuantizedReplArgument : public ReplArgumentBase {
+	using PrimaryType = typename AccessorType::ValueType;
+
+	static_assert(std::is_same_v<PrimaryType, typename Quantizer::ValueType>, "Quantizer must operate on the replicated type");
+
+	AccessorType accessor;
+	QuantizedCodec<Quantizer> codec;
+
+	QuantizedReplArgument(ReplType type, const AccessorType & accessor, const Quantizer & quantizer) : ReplArgumentBase{ type },
+		accessor{ accessor }, codec{ quantizer } {
+
+	}
+
+	virtual uint32_t QueryReplicatedSize(Netcode::ArrayView<uint8_t> view) const override {
+		return codec.QueryReplicatedSize(view);
+	}
+
+	virtual uint32_t GetReplicatedSize(GameObject * gameObject) const override {
+		return codec.GetReplicatedSize(accessor.Read(gameObject));
+	}
+
+	virtual uint32_t Write(GameObject * gameObject, Netcode::MutableArrayView<uint8_t> dst) const override {
+		return codec.Write(dst, accessor.Read(gameObject));
+	}
+
+	virtual uint32_t Read(GameObject * gameObject, Netcode::ArrayView<uint8_t> src) override {
+		return codec.Read(accessor.Write(gameObject), src);
+	}
+};
+
+template<typename Component, typename ValueType, typename Quantizer>
+auto ReplicateQuantizedFromComponent(ReplType type, ValueType Component::* memPtr, const Quantizer & quantizer) {
+	return new QuantizedReplArgument<ComponentValueAccessor<Component, ValueType>, Quantizer>{ type,
+		ComponentValueAccessor<Component, ValueType>{ memPtr },
+		quantizer
+	};
+}
+
+template<typename BaseType, typename ValueType, typename Quantizer>
+auto ReplicateQuantizedFromState(ReplType type, BaseType * state, ValueType BaseType::* memPtr, const Quantizer & quantizer) {
+	return new QuantizedReplArgument<StatefulValueAccessor<BaseType, ValueType>, Quantizer>{ type,
+		StatefulValueAccessor<BaseType, ValueType>{ state, memPtr },
+		quantizer
+	};
+}
@@ -0,0 +1,235 @@
+#include "ReplBaseline.h"
+#include <algorithm>
+#include <cstring>
+
+void ReplSnapshot::Clear() {
+	entries.clear();
+	bytes.clear();
+}
+
+Netcode::MutableArrayView<uint8_t> ReplSnapshot::Allocate(uint32_t objectId, uint32_t numBytes) {
+	const uint32_t offset = static_cast<uint32_t>(bytes.size());
+
+	bytes.resize(bytes.size() + numBytes);
+	entries.push_back(Entry{ objectId, offset, numBytes });
+
+	return Netcode::MutableArrayView<uint8_t>{ bytes.data() + offset, numBytes };
+}
+
+void ReplSnapshot::Add(uint32_t objectId, Netcode::ArrayView<uint8_t> content) {
+	const uint32_t offset = static_cast<uint32_t>(bytes.size());
+
+	bytes.insert(std::end(bytes), content.begin(), content.end());
+	entries.push_back(Entry{ objectId, offset, static_cast<uint32_t>(content.Size()) });
+}
+
+bool ReplSnapshot::Find(uint32_t objectId, Netcode::ArrayView<uint8_t> & content, size_t hint) const {
+	const size_t numEntries = entries.size();
+
+	for(size_t i = 0; i < numEntries; i++) {
+		const size_t idx = (hint + i) % numEntries;
+
+		if(entries[idx].objectId == objectId) {
+			content = GetContent(idx);
+			return true;
+		}
+	}
+	return false;
+}
+
+ReplBaselineHistory::ReplBaselineHistory(uint32_t numSnapshots) : slots{}, objectBaselines{}, mergeBuffer{}, nextIndex{ 0 }, acknowledgedSequence{ 0 } {
+	slots.resize(std::max(numSnapshots, 1u), Slot{ 0, nullptr, {} });
+}
+
+void ReplBaselineHistory::Store(uint32_t sequence, Ref<const ReplSnapshot> snapshot) {
+	Slot & slot = slots[nextIndex];
+	nextIndex = (nextIndex + 1) % static_cast<uint32_t>(slots.size());
+
+	slot.sequence = sequence;
+	slot.objectIds.clear();
+
+	if(snapshot != nullptr) {
+		for(size_t i = 0; i < snapshot->GetNumObjects(); i++) {
+			slot.objectIds.push_back(snapshot->GetObjectId(i));
+		}
+	}
+
+	std::sort(std::begin(slot.objectIds), std::end(slot.objectIds));
+	slot.snapshot = std::move(snapshot);
+}
+
+void ReplBaselineHistory::Store(uint32_t sequence, Ref<const ReplSnapshot> snapshot, const std::vector<uint32_t> & sentObjectIds) {
+	Slot & slot = slots[nextIndex];
+	nextIndex = (nextIndex + 1) % static_cast<uint32_t>(slots.size());
+
+	slot.sequence = sequence;
+	slot.snapshot = std::move(snapshot);
+	slot.objectIds.assign(std::begin(sentObjectIds), std::end(sentObjectIds));
+	std::sort(std::begin(slot.objectIds), std::end(slot.objectIds));
+}
+
+const ReplBaselineHistory::Slot * ReplBaselineHistory::FindSlot(uint32_t sequence) const {
+	if(sequence == 0) {
+		return nullptr;
+	}
+
+	for(const Slot & slot : slots) {
+		if(slot.sequence == sequence) {
+			return &slot;
+		}
+	}
+
+	return nullptr;
+}
+
+const ReplSnapshot * ReplBaselineHistory::Find(uint32_t sequence) const {
+	const Slot * slot = FindSlot(sequence);
+	return (slot != nullptr) ? slot->snapshot.get() : nullptr;
+}
+
+const ReplSnapshot * ReplBaselineHistory::FindBaseline(uint32_t sequence, uint32_t objectId, uint32_t & baselineSequence) const {
+	auto it = std::lower_bound(std::begin(objectBaselines), std::end(objectBaselines), objectId, [](const ObjectBaseline & ob, uint32_t id) -> bool {
+		return ob.objectId < id;
+	});
+
+	if(it == std::end(objectBaselines) || it->objectId != objectId) {
+		return nullptr;
+	}
+
+	if(it->sequence >= sequence || (sequence - it->sequence) > BASELINE_WINDOW) {
+		return nullptr;
+	}
+
+	baselineSequence = it->sequence;
+	return Find(it->sequence);
+}
+
+void ReplBaselineHistory::Acknowledge(uint32_t sequence) {
+	if(sequence <= acknowledgedSequence) {
+		return;
+	}
+
+	acknowledgedSequence = sequence;
+
+	const Slot * slot = FindSlot(sequence);
+
+	if(slot == nullptr) {
+		return;
+	}
+
+	// both lists are sorted by the object id, objects that aged out of the window are dropped while merging
+	const auto isUsable = [this](const ObjectBaseline & ob) -> bool {
+		return (acknowledgedSequence - ob.sequence) <= BASELINE_WINDOW;
+	};
+
+	mergeBuffer.clear();
+
+	auto oldIt = std::begin(objectBaselines);
+	const auto oldEnd = std::end(objectBaselines);
+
+	for(uint32_t objectId : slot->objectIds) {
+		for(; oldIt != oldEnd && oldIt->objectId < objectId; ++oldIt) {
+			if(isUsable(*oldIt)) {
+				mergeBuffer.push_back(*oldIt);
+			}
+		}
+
+		if(oldIt != oldEnd && oldIt->objectId == objectId) {
+			++oldIt;
+		}
+
+		mergeBuffer.push_back(ObjectBaseline{ objectId, sequence });
+	}
+
+	for(; oldIt != oldEnd; ++oldIt) {
+		if(isUsable(*oldIt)) {
+			mergeBuffer.push_back(*oldIt);
+		}
+	}
+
+	std::swap(objectBaselines, mergeBuffer);
+}
+
+static void Append(std::string & dst, Netcode::ArrayView<uint8_t> src, uint32_t numBytes) {
+	dst.append(reinterpret_cast<const char *>(src.Data()), numBytes);
+}
+
+bool ReplicateDeltaWrite(const ReplDescBase & replDesc, Netcode::ArrayView<uint8_t> baseline, Netcode::ArrayView<uint8_t> current, std::string & delta) {
+	const size_t maskSize = (replDesc.GetNumFields() + 7) / 8;
+	bool hasChanges = false;
+
+	delta.assign(maskSize, '\0');
+
+	for(uint32_t i = 0; i < replDesc.GetNumFields(); i++) {
+		const uint32_t baseSize = replDesc.QueryFieldSize(i, baseline);
+		const uint32_t currentSize = replDesc.QueryFieldSize(i, current);
+
+		if(baseSize == 0 || currentSize == 0) {
+			return false;
+		}
+
+		if(baseSize != currentSize || memcmp(baseline.Data(), current.Data(), currentSize) != 0) {
+			delta[i / 8] |= static_cast<char>(1 << (i % 8));
+			Append(delta, current, currentSize);
+			hasChanges = true;
+		}
+
+		baseline = baseline.Offset(baseSize);
+		current = current.Offset(currentSize);
+	}
+
+	if(baseline.Size() != 0 || current.Size() != 0) {
+		return false;
+	}
+
+	if(!hasChanges) {
+		delta.clear();
+	}
+
+	return true;
+}
+
+bool ReplicateDeltaRead(const ReplDescBase & replDesc, Netcode::ArrayView<uint8_t> baseline, Netcode::ArrayView<uint8_t> delta, std::string & current) {
+	current.clear();
+
+	if(delta.Size() == 0) {
+		Append(current, baseline, static_cast<uint32_t>(baseline.Size()));
+		return true;
+	}
+
+	const size_t maskSize = (replDesc.GetNumFields() + 7) / 8;
+
+	if(delta.Size() < maskSize) {
+		return false;
+	}
+
+	const uint8_t * mask = delta.Data();
+	delta = delta.Offset(maskSize);
+
+	current.reserve(baseline.Size() + delta.Size());
+
+	for(uint32_t i = 0; i < replDesc.GetNumFields(); i++) {
+		const uint32_t baseSize = replDesc.QueryFieldSize(i, baseline);
+
+		if(baseSize == 0) {
+			return false;
+		}
+
+		if((mask[i / 8] & (1 << (i % 8))) != 0) {
+			const uint32_t changedSize = replDesc.QueryFieldSize(i, delta);
+
+			if(changedSize == 0) {
+				return false;
+			}
+
+			Append(current, delta, changedSize);
+			delta = delta.Offset(changedSize);
+		} else {
+			Append(current, baseline, baseSize);
+		}
+
+		baseline = baseline.Offset(baseSize);
+	}
+
+	return baseline.Size() == 0 && delta.Size() == 0;
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "ReplDesc.h"
+#include <Netcode/HandleDecl.h>
+#include <string>
+#include <vector>
+
+struct ReplData {
+	uint32_t objectId;
+	// sequence of the game update that carried this replication
+	uint32_t sequence;
+	// 0 if content is a full state, otherwise content is a delta against the referenced game update
+	uint32_t baselineId;
+	std::string content;
+
+	ReplData() : objectId{ 0 }, sequence{ 0 }, baselineId{ 0 }, content{} { }
+};
+
+inline Netcode::ArrayView<uint8_t> ToArrayView(const std::string & str) {
+	return Netcode::ArrayView<uint8_t>{ reinterpret_cast<const uint8_t *>(str.data()), str.size() };
+}
+
+/**
+ * Replicated states of objects stored back to back in a single buffer.
+ * The server serializes every object once per tick into one and shares it between the clients.
+ */
+class ReplSnapshot {
+	struct Entry {
+		uint32_t objectId;
+		uint32_t offset;
+		uint32_t size;
+	};
+
+	std::vector<Entry> entries;
+	std::vector<uint8_t> bytes;
+
+public:
+	ReplSnapshot() : entries{}, bytes{} { }
+
+	void Clear();
+
+	/**
+	 * Reserves space for the object at the end of the buffer, the view is invalidated by the next Allocate or Add
+	 */
+	Netcode::MutableArrayView<uint8_t> Allocate(uint32_t objectId, uint32_t numBytes);
+
+	void Add(uint32_t objectId, Netcode::ArrayView<uint8_t> content);
+
+	/**
+	 * @param hint index to start the search from, snapshots of consecutive ticks usually share the order of the objects
+	 */
+	bool Find(uint32_t objectId, Netcode::ArrayView<uint8_t> & content, size_t hint = 0) const;
+
+	size_t GetNumObjects() const {
+		return entries.size();
+	}
+
+	uint32_t GetObjectId(size_t index) const {
+		return entries[index].objectId;
+	}
+
+	Netcode::ArrayView<uint8_t> GetContent(size_t index) const {
+		return Netcode::ArrayView<uint8_t>{ bytes.data() + entries[index].offset, entries[index].size };
+	}
+
+	size_t GetSizeInBytes() const {
+		return bytes.size();
+	}
+};
+
+/**
+ * Ring of the snapshots of the most recent game updates of a connection.
+ * On the server these are the states sent to the client, on the client the states received from the server.
+ * The acknowledged sequence is the newest snapshot that is known to be complete on both sides.
+ * Not every update carries every object, so the baseline of an object is the newest acknowledged update that contained it.
+ */
+class ReplBaselineHistory {
+	struct Slot {
+		uint32_t sequence;
+		Ref<const ReplSnapshot> snapshot;
+		// sorted ids of the objects the update carried
+		std::vector<uint32_t> objectIds;
+	};
+
+	struct ObjectBaseline {
+		uint32_t objectId;
+		uint32_t sequence;
+	};
+
+	std::vector<Slot> slots;
+	std::vector<ObjectBaseline> objectBaselines;
+	std::vector<ObjectBaseline> mergeBuffer;
+	uint32_t nextIndex;
+	uint32_t acknowledgedSequence;
+
+	const Slot * FindSlot(uint32_t sequence) const;
+
+public:
+	// the server falls back to full states when the acknowledged snapshot is older than this many updates
+	constexpr static uint32_t BASELINE_WINDOW = 32;
+
+	ReplBaselineHistory(uint32_t numSnapshots);
+
+	/**
+	 * Stores the snapshot of the update by replacing the oldest one, the update carried every object of the snapshot
+	 */
+	void Store(uint32_t sequence, Ref<const ReplSnapshot> snapshot);
+
+	/**
+	 * Stores a snapshot that is shared between connections, only the listed objects were sent in the update
+	 */
+	void Store(uint32_t sequence, Ref<const ReplSnapshot> snapshot, const std::vector<uint32_t> & sentObjectIds);
+
+	const ReplSnapshot * Find(uint32_t sequence) const;
+
+	/**
+	 * @param baselineSequence receives the sequence of the returned snapshot
+	 * @return the snapshot the object can be delta encoded against in the update with the given sequence, or nullptr
+	 */
+	const ReplSnapshot * FindBaseline(uint32_t sequence, uint32_t objectId, uint32_t & baselineSequence) const;
+
+	void Acknowledge(uint32_t sequence);
+
+	uint32_t GetAcknowledgedSequence() const {
+		return acknowledgedSequence;
+	}
+};
+
+/**
+ * Field level delta between two full states of the same object, fields are delimited by the ReplDesc.
+ * The format is a bitmask of the changed arguments followed by the changed arguments as they appear in the full state,
+ * an empty delta means that nothing changed.
+ * @return false if the states could not be split by the description, in this case the full state must be sent
+ */
+bool ReplicateDeltaWrite(const ReplDescBase & replDesc, Netcode::ArrayView<uint8_t> baseline, Netcode::ArrayView<uint8_t> current, std::string & delta);
+
+/**
+ * Reconstructs the full state from a baseline and the output of ReplicateDeltaWrite
+ * @return false if the baseline or the delta is malformed
+ */
+bool ReplicateDeltaRead(const ReplDescBase & replDesc, Netcode::ArrayView<uint8_t> baseline, Netcode::ArrayView<uint8_t> delta, std::string & current);
@@ -2,6 +2,8 @@
 
 #include <NetcodeFoundation/ArrayView.hpp>
 #include <Netcode/Network/NetworkCommon.h>
+#include <memory>
+#include <vector>
 
 class GameObject;
 
@@ -60,4 +62,111 @@ public:
 	virtual uint32_t Read(GameObject * gameObject, Netcode::ArrayView<uint8_t> view) = 0;
 };
 
-using ReplDesc = std::vector<std::unique_ptr<ReplArgumentBase>>;
+/**
+ * Describes the replicated state of an object type as a sequence of fields.
+ * The delta encoding compares states field by field, so the descriptor must be able to delimit them.
+ */
+class ReplDescBase {
+public:
+	virtual ~ReplDescBase() = default;
+
+	virtual uint32_t GetNumFields() const = 0;
+
+	virtual ReplType GetFieldType(uint32_t index) const = 0;
+
+	/**
+	 * @return the number of bytes the field consumes from the front of the view, 0 means failure
+	 */
+	virtual uint32_t QueryFieldSize(uint32_t index, Netcode::ArrayView<uint8_t> view) const = 0;
+
+	/**
+	 * @return the number of bytes required to replicate every field
+	 */
+	virtual uint32_t GetReplicatedSize(GameObject * gameObject) const = 0;
+
+	/**
+	 * Serializes every field into the buffer
+	 * @return the number of bytes written, 0 means failure
+	 */
+	virtual uint32_t Write(GameObject * gameObject, Netcode::MutableArrayView<uint8_t> view) const = 0;
+
+	/**
+	 * Deserializes every field from the buffer
+	 * @param rejectPredicted if set, CLIENT_PREDICTED fields are skipped instead of being read
+	 * @return the number of bytes consumed, 0 means failure
+	 */
+	virtual uint32_t Read(GameObject * gameObject, Netcode::ArrayView<uint8_t> view, bool rejectPredicted) const = 0;
+};
+
+using ReplDesc = std::unique_ptr<ReplDescBase>;
+
+/**
+ * Descriptor composed at runtime from arguments, every field is a virtual call.
+ * Prefer the compile time layouts of ReplLayout.hpp, this is for descriptors that are only known at runtime.
+ */
+class ReplArgumentDesc : public ReplDescBase {
+	std::vector<std::unique_ptr<ReplArgumentBase>> arguments;
+
+public:
+	ReplArgumentDesc(std::vector<std::unique_ptr<ReplArgumentBase>> args) : arguments{ std::move(args) } { }
+
+	virtual uint32_t GetNumFields() const override {
+		return static_cast<uint32_t>(arguments.size());
+	}
+
+	virtual ReplType GetFieldType(uint32_t index) const override {
+		return arguments[index]->GetType();
+	}
+
+	virtual uint32_t QueryFieldSize(uint32_t index, Netcode::ArrayView<uint8_t> view) const override {
+		return arguments[index]->QueryReplicatedSize(view);
+	}
+
+	virtual uint32_t GetReplicatedSize(GameObject * gameObject) const override {
+		uint32_t requiredSize = 0;
+		for(const std::unique_ptr<ReplArgumentBase> & arg : arguments) {
+			requiredSize += arg->GetReplicatedSize(gameObject);
+		}
+		return requiredSize;
+	}
+
+	virtual uint32_t Write(GameObject * gameObject, Netcode::MutableArrayView<uint8_t> view) const override {
+		uint32_t writtenSize = 0;
+
+		for(const std::unique_ptr<ReplArgumentBase> & arg : arguments) {
+			const uint32_t numBytes = arg->Write(gameObject, view);
+
+			if(numBytes == 0) {
+				return 0;
+			}
+
+			view = view.Offset(numBytes);
+			writtenSize += numBytes;
+		}
+
+		return writtenSize;
+	}
+
+	virtual uint32_t Read(GameObject * gameObject, Netcode::ArrayView<uint8_t> view, bool rejectPredicted) const override {
+		uint32_t readSize = 0;
+
+		for(const std::unique_ptr<ReplArgumentBase> & arg : arguments) {
+			const uint32_t replicatedSize = arg->QueryReplicatedSize(view);
+
+			if(replicatedSize == 0) {
+				return 0;
+			}
+
+			if(!rejectPredicted || arg->GetType() != ReplType::CLIENT_PREDICTED) {
+				if(arg->Read(gameObject, view) != replicatedSize) {
+					return 0;
+				}
+			}
+
+			view = view.Offset(replicatedSize);
+			readSize += replicatedSize;
+		}
+
+		return readSize;
+	}
+};
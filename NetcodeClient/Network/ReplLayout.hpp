@@ -0,0 +1,350 @@
+#pragma once
+
+#include "ReplDesc.h"
+#include "Replicator.hpp"
+#include <Netcode/Network/Quantization.h>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+/*
+ * Compile time replication descriptors.
+ * A layout is a list of fields known at compile time, the per field loops are fold expressions over them,
+ * so reading and writing an object is inlined down to the Replicator calls. If every field has a
+ * REPLICATED_SIZE the size of the whole state is a constant.
+ *
+ * Usage:
+ *  MakeReplDesc(
+ *    ReplFromComponent<ReplType::CLIENT_PREDICTED, &Transform::position>(),
+ *    ReplFromState<ReplType::DEFAULT, &ScoreboardScript::stats>(scoreboard));
+ */
+
+namespace Detail {
+
+	template<typename>
+	struct MemberPointerTraits;
+
+	template<typename C, typename V>
+	struct MemberPointerTraits<V C:: *> {
+		using ClassType = C;
+		using ValueType = V;
+	};
+
+	template<auto MEMBER>
+	using MemberOwnerType = typename MemberPointerTraits<decltype(MEMBER)>::ClassType;
+
+	template<auto MEMBER>
+	using MemberValueType = typename MemberPointerTraits<decltype(MEMBER)>::ValueType;
+
+	template<typename T, typename = void>
+	struct ReplicatorFixedSize {
+		constexpr static uint32_t VALUE = 0;
+	};
+
+	template<typename T>
+	struct ReplicatorFixedSize<T, std::void_t<decltype(Replicator<T>::REPLICATED_SIZE)>> {
+		constexpr static uint32_t VALUE = Replicator<T>::REPLICATED_SIZE;
+	};
+
+}
+
+/*
+ * Codecs convert a field value to bytes. FIXED_SIZE is 0 if the size depends on the value
+ */
+template<typename T>
+struct ReplicatorCodec {
+	using ValueType = T;
+
+	constexpr static uint32_t FIXED_SIZE = Detail::ReplicatorFixedSize<T>::VALUE;
+
+	uint32_t GetReplicatedSize(const T & value) const {
+		return Replicator<T>::GetReplicatedSize(value);
+	}
+
+	uint32_t QueryReplicatedSize(Netcode::ArrayView<uint8_t> src) const {
+		return Replicator<T>::QueryReplicatedSize(src);
+	}
+
+	uint32_t Write(Netcode::MutableArrayView<uint8_t> dst, const T & value) const {
+		return Replicator<T>::Replicate(dst, value);
+	}
+
+	uint32_t Read(T & value, Netcode::ArrayView<uint8_t> src) const {
+		return Replicator<T>::Replicate(value, src);
+	}
+};
+
+/*
+ * Bit packs the value with a quantizer (see Netcode/Network/Quantization.h), the field is padded to whole bytes
+ */
+template<typename Quantizer>
+struct QuantizedCodec {
+	using ValueType = typename Quantizer::ValueType;
+
+	constexpr static uint32_t FIXED_SIZE = 0;
+
+	Quantizer quantizer;
+
+	uint32_t GetReplicatedSize(const ValueType & value) const {
+		return (quantizer.GetNumBits(value) + 7) / 8;
+	}
+
+	uint32_t QueryReplicatedSize(Netcode::ArrayView<uint8_t> src) const {
+		Netcode::Network::BitReader reader{ src };
+		ValueType value;
+
+		if(!quantizer.Read(reader, value)) {
+			return 0;
+		}
+
+		return static_cast<uint32_t>(reader.GetNumBytes());
+	}
+
+	uint32_t Write(Netcode::MutableArrayView<uint8_t> dst, const ValueType & value) const {
+		Netcode::Network::BitWriter writer{ dst };
+		quantizer.Write(writer, value);
+
+		if(writer.HasOverflowed()) {
+			return 0;
+		}
+
+		return static_cast<uint32_t>(writer.GetNumBytes());
+	}
+
+	uint32_t Read(ValueType & value, Netcode::ArrayView<uint8_t> src) const {
+		Netcode::Network::BitReader reader{ src };
+		ValueType v;
+
+		if(!quantizer.Read(reader, v)) {
+			return 0;
+		}
+
+		value = v;
+		return static_cast<uint32_t>(reader.GetNumBytes());
+	}
+};
+
+/*
+ * Owners locate the object the field is a member of
+ */
+template<typename Owner>
+struct ComponentOwner {
+	template<typename Subject>
+	Owner * Resolve(Subject * subject) const {
+		return subject->template GetComponent<Owner>();
+	}
+};
+
+template<typename Owner>
+struct StateOwner {
+	Owner * state;
+
+	template<typename Subject>
+	Owner * Resolve(Subject *) const {
+		return state;
+	}
+};
+
+template<ReplType TYPE, auto MEMBER, template<typename> typename OwnerPolicy, typename Codec>
+struct ReplField {
+	using OwnerType = Detail::MemberOwnerType<MEMBER>;
+	using ValueType = Detail::MemberValueType<MEMBER>;
+
+	static_assert(std::is_same_v<ValueType, typename Codec::ValueType>, "Codec must operate on the type of the member");
+
+	constexpr static ReplType REPL_TYPE = TYPE;
+	constexpr static uint32_t FIXED_SIZE = Codec::FIXED_SIZE;
+
+	OwnerPolicy<OwnerType> owner;
+	Codec codec;
+
+	template<typename Subject>
+	uint32_t GetReplicatedSize(Subject * subject) const {
+		if constexpr(FIXED_SIZE > 0) {
+			return FIXED_SIZE;
+		} else {
+			return codec.GetReplicatedSize(owner.Resolve(subject)->*MEMBER);
+		}
+	}
+
+	uint32_t QueryReplicatedSize(Netcode::ArrayView<uint8_t> src) const {
+		if constexpr(FIXED_SIZE > 0) {
+			return (src.Size() >= FIXED_SIZE) ? FIXED_SIZE : 0;
+		} else {
+			return codec.QueryReplicatedSize(src);
+		}
+	}
+
+	template<typename Subject>
+	uint32_t Write(Subject * subject, Netcode::MutableArrayView<uint8_t> dst) const {
+		return codec.Write(dst, owner.Resolve(subject)->*MEMBER);
+	}
+
+	template<typename Subject>
+	uint32_t Read(Subject * subject, Netcode::ArrayView<uint8_t> src) const {
+		return codec.Read(owner.Resolve(subject)->*MEMBER, src);
+	}
+};
+
+template<ReplType TYPE, auto MEMBER>
+auto ReplFromComponent() {
+	using V = Detail::MemberValueType<MEMBER>;
+	return ReplField<TYPE, MEMBER, ComponentOwner, ReplicatorCodec<V>>{};
+}
+
+template<ReplType TYPE, auto MEMBER>
+auto ReplFromState(Detail::MemberOwnerType<MEMBER> * state) {
+	using O = Detail::MemberOwnerType<MEMBER>;
+	using V = Detail::MemberValueType<MEMBER>;
+	return ReplField<TYPE, MEMBER, StateOwner, ReplicatorCodec<V>>{ StateOwner<O>{ state }, ReplicatorCodec<V>{} };
+}
+
+template<ReplType TYPE, auto MEMBER, typename Quantizer>
+auto ReplQuantizedFromComponent(const Quantizer & quantizer) {
+	using O = Detail::MemberOwnerType<MEMBER>;
+	return ReplField<TYPE, MEMBER, ComponentOwner, QuantizedCodec<Quantizer>>{ ComponentOwner<O>{}, QuantizedCodec<Quantizer>{ quantizer } };
+}
+
+template<ReplType TYPE, auto MEMBER, typename Quantizer>
+auto ReplQuantizedFromState(Detail::MemberOwnerType<MEMBER> * state, const Quantizer & quantizer) {
+	using O = Detail::MemberOwnerType<MEMBER>;
+	return ReplField<TYPE, MEMBER, StateOwner, QuantizedCodec<Quantizer>>{ StateOwner<O>{ state }, QuantizedCodec<Quantizer>{ quantizer } };
+}
+
+template<typename Subject, typename ... Fields>
+class ReplLayout {
+	static_assert(sizeof...(Fields) > 0, "Layout must have at least one field");
+
+	std::tuple<Fields...> fields;
+
+	template<typename Field>
+	static bool WriteField(const Field & field, Subject * subject, Netcode::MutableArrayView<uint8_t> & dst, uint32_t & writtenSize) {
+		const uint32_t numBytes = field.Write(subject, dst);
+
+		if(numBytes == 0) {
+			return false;
+		}
+
+		dst = dst.Offset(numBytes);
+		writtenSize += numBytes;
+		return true;
+	}
+
+	template<typename Field>
+	static bool ReadField(const Field & field, Subject * subject, Netcode::ArrayView<uint8_t> & src, bool rejectPredicted, uint32_t & readSize) {
+		uint32_t numBytes;
+
+		if(rejectPredicted && Field::REPL_TYPE == ReplType::CLIENT_PREDICTED) {
+			numBytes = field.QueryReplicatedSize(src);
+		} else {
+			numBytes = field.Read(subject, src);
+		}
+
+		if(numBytes == 0) {
+			return false;
+		}
+
+		src = src.Offset(numBytes);
+		readSize += numBytes;
+		return true;
+	}
+
+	template<size_t ... I>
+	uint32_t QueryFieldSizeImpl(uint32_t index, Netcode::ArrayView<uint8_t> src, std::index_sequence<I...>) const {
+		uint32_t numBytes = 0;
+		((I == index && ((numBytes = std::get<I>(fields).QueryReplicatedSize(src)), true)) || ...);
+		return numBytes;
+	}
+
+public:
+	constexpr static uint32_t NUM_FIELDS = sizeof...(Fields);
+
+	// 0 if the size of any of the fields depends on its value
+	constexpr static uint32_t FIXED_SIZE = ((Fields::FIXED_SIZE > 0) && ...) ? (Fields::FIXED_SIZE + ...) : 0;
+
+	constexpr static ReplType FIELD_TYPES[] = { Fields::REPL_TYPE... };
+
+	explicit ReplLayout(Fields ... f) : fields{ std::move(f)... } { }
+
+	uint32_t GetReplicatedSize(Subject * subject) const {
+		if constexpr(FIXED_SIZE > 0) {
+			return FIXED_SIZE;
+		} else {
+			return std::apply([subject](const Fields & ... f) -> uint32_t {
+				return (f.GetReplicatedSize(subject) + ...);
+			}, fields);
+		}
+	}
+
+	uint32_t QueryFieldSize(uint32_t index, Netcode::ArrayView<uint8_t> src) const {
+		return QueryFieldSizeImpl(index, src, std::index_sequence_for<Fields...>{});
+	}
+
+	uint32_t Write(Subject * subject, Netcode::MutableArrayView<uint8_t> dst) const {
+		if constexpr(FIXED_SIZE > 0) {
+			if(dst.Size() < FIXED_SIZE) {
+				return 0;
+			}
+		}
+
+		uint32_t writtenSize = 0;
+
+		const bool succeeded = std::apply([&](const Fields & ... f) -> bool {
+			return (WriteField(f, subject, dst, writtenSize) && ...);
+		}, fields);
+
+		return succeeded ? writtenSize : 0;
+	}
+
+	uint32_t Read(Subject * subject, Netcode::ArrayView<uint8_t> src, bool rejectPredicted) const {
+		uint32_t readSize = 0;
+
+		const bool succeeded = std::apply([&](const Fields & ... f) -> bool {
+			return (ReadField(f, subject, src, rejectPredicted, readSize) && ...);
+		}, fields);
+
+		return succeeded ? readSize : 0;
+	}
+};
+
+/**
+ * Type erased compile time layout, one virtual call per object instead of one per field
+ */
+template<typename ... Fields>
+class StaticReplDesc : public ReplDescBase {
+	ReplLayout<GameObject, Fields...> layout;
+
+	using LayoutType = ReplLayout<GameObject, Fields...>;
+
+public:
+	explicit StaticReplDesc(Fields ... fields) : layout{ std::move(fields)... } { }
+
+	virtual uint32_t GetNumFields() const override {
+		return LayoutType::NUM_FIELDS;
+	}
+
+	virtual ReplType GetFieldType(uint32_t index) const override {
+		return LayoutType::FIELD_TYPES[index];
+	}
+
+	virtual uint32_t QueryFieldSize(uint32_t index, Netcode::ArrayView<uint8_t> view) const override {
+		return layout.QueryFieldSize(index, view);
+	}
+
+	virtual uint32_t GetReplicatedSize(GameObject * gameObject) const override {
+		return layout.GetReplicatedSize(gameObject);
+	}
+
+	virtual uint32_t Write(GameObject * gameObject, Netcode::MutableArrayView<uint8_t> view) const override {
+		return layout.Write(gameObject, view);
+	}
+
+	virtual uint32_t Read(GameObject * gameObject, Netcode::ArrayView<uint8_t> view, bool rejectPredicted) const override {
+		return layout.Read(gameObject, view, rejectPredicted);
+	}
+};
+
+template<typename ... Fields>
+ReplDesc MakeReplDesc(Fields ... fields) {
+	return std::make_unique<StaticReplDesc<Fields...>>(std::move(fields)...);
+}
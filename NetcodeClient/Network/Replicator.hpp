@@ -1,8 +1,13 @@
 #pragma once
 
 #include <NetcodeFoundation/Math.h>
-#include "../GameObject.h"
+#include <NetcodeFoundation/ArrayView.hpp>
+#include <Netcode/Network/NetworkCommon.h>
 #include "NetwDecl.h"
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
 
 /**
  * Replicator concept
@@ -11,12 +16,16 @@
  *  - static uint32_t Replicate(T & dst, ArrayView<uint8_t> src);
  *  - static uint32_t GetReplicatedSize(const T & src);
  *  - static uint32_t QueryReplicatedSize(ArrayView<uint8_t> src);
+ * Types that always replicate to the same number of bytes also define:
+ *  - constexpr static uint32_t REPLICATED_SIZE;
  */
 template<typename>
 struct Replicator;
 
 template<>
 struct Replicator<uint32_t> {
+	constexpr static uint32_t REPLICATED_SIZE = sizeof(uint32_t);
+
 	constexpr static uint32_t GetReplicatedSize(const uint32_t &) {
 		return sizeof(uint32_t);
 	}
@@ -48,6 +57,8 @@ struct Replicator<uint32_t> {
 
 template<>
 struct Replicator<int32_t> {
+	constexpr static uint32_t REPLICATED_SIZE = sizeof(int32_t);
+
 	constexpr static uint32_t GetReplicatedSize(const int32_t &) {
 		return sizeof(int32_t);
 	}
@@ -79,6 +90,8 @@ struct Replicator<int32_t> {
 
 template<>
 struct Replicator<float> {
+	constexpr static uint32_t REPLICATED_SIZE = sizeof(float);
+
 	constexpr static uint32_t GetReplicatedSize(const float &) {
 		return sizeof(float);
 	}
@@ -112,6 +125,8 @@ struct Replicator<float> {
 
 template<>
 struct Replicator<Netcode::Float2> {
+	constexpr static uint32_t REPLICATED_SIZE = 2 * sizeof(float);
+
 	constexpr static uint32_t GetReplicatedSize(const Netcode::Float2 &) {
 		return 2 * sizeof(float);
 	}
@@ -136,6 +151,8 @@ struct Replicator<Netcode::Float2> {
 
 template<>
 struct Replicator<Netcode::Float3> {
+	constexpr static uint32_t REPLICATED_SIZE = 3 * sizeof(float);
+
 	constexpr static uint32_t GetReplicatedSize(const Netcode::Float3 &) {
 		return 3 * sizeof(float);
 	}
@@ -0,0 +1,206 @@
+#include "ServerBenchmark.h"
+#include "ServerReplay.h"
+#include "../GameScene.h"
+#include <Netcode/Config.h>
+#include <Netcode/Utility.h>
+#include <Netcode/System/SystemClock.h>
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+// the players connect in the first tick, finish the handshake in the second and spawn in the third
+constexpr static uint32_t BENCHMARK_JOIN_TICKS = 3;
+
+ServerBenchmark::ServerBenchmark(const std::wstring & counts, uint32_t ticks) : playerCounts{}, numTicks{ ticks }, tickInterval{} {
+	std::wistringstream wiss{ counts };
+	std::wstring count;
+
+	while(std::getline(wiss, count, L',')) {
+		try {
+			const unsigned long value = std::stoul(count);
+
+			if(value > 0) {
+				playerCounts.push_back(static_cast<uint32_t>(value));
+			}
+		} catch(std::exception &) {
+			Log::Error("Benchmark: invalid player count: {0}", Netcode::Utility::ToNarrowString(count));
+		}
+	}
+
+	tickInterval = std::chrono::milliseconds(Netcode::Config::Get<uint32_t>(L"network.server.tickIntervalMs:u32"));
+}
+
+std::vector<uint8_t> ServerBenchmark::BuildRecording(uint32_t numPlayers) const {
+	nn::TrafficRecordWriter writer;
+	writer.WriteHeader();
+
+	std::string content;
+	nn::TrafficRecord record;
+
+	const auto writeTick = [&](uint32_t tick) -> Netcode::Timestamp {
+		record = nn::TrafficRecord{};
+		record.type = nn::TrafficRecordType::TICK;
+		record.timestamp = Netcode::Timestamp{} + tickInterval * (tick + 1);
+		writer.Write(record);
+		return record.timestamp;
+	};
+
+	const auto writeContent = [&](nn::TrafficRecordType type, int32_t connectionId, uint32_t sequence) -> void {
+		record = nn::TrafficRecord{};
+		record.type = type;
+		record.connectionId = connectionId;
+		record.sequence = sequence;
+		record.content = Netcode::ArrayView<uint8_t>{ reinterpret_cast<const uint8_t *>(content.data()), content.size() };
+		writer.Write(record);
+	};
+
+	writeTick(0);
+
+	for(uint32_t i = 0; i < numPlayers; i++) {
+		record = nn::TrafficRecord{};
+		record.type = nn::TrafficRecordType::CONNECT;
+		record.connectionId = static_cast<int32_t>(i + 1);
+		writer.Write(record);
+	}
+
+	writeTick(1);
+
+	np::Control control;
+	control.set_type(np::MessageType::CONNECT_DONE);
+	control.set_sequence(1);
+	control.mutable_connect_done()->set_measured_rtt(std::chrono::duration_cast<Netcode::Duration>(std::chrono::milliseconds(50)).count());
+	control.SerializeToString(&content);
+
+	for(uint32_t i = 0; i < numPlayers; i++) {
+		writeContent(nn::TrafficRecordType::CONTROL_MESSAGE, static_cast<int32_t>(i + 1), 0);
+	}
+
+	// the players walk on a circle, spread evenly so every player is relevant to every other
+	constexpr float radius = 1500.0f;
+	constexpr float speed = 300.0f;
+	const float dt = std::chrono::duration<float>(tickInterval).count();
+
+	np::ClientUpdate update;
+
+	for(uint32_t tick = 2; tick < BENCHMARK_JOIN_TICKS + numTicks; tick++) {
+		const Netcode::Timestamp timestamp = writeTick(tick);
+
+		// the update of a tick has the tick's index as its sequence, the client received it a tick later
+		const uint32_t receivedId = (tick > 2) ? (tick - 2) : 0;
+
+		for(uint32_t i = 0; i < numPlayers; i++) {
+			update.Clear();
+			update.set_id(tick - 1);
+			update.set_received_id(receivedId);
+			update.set_baseline_id(receivedId);
+
+			np::ActionPrediction * prediction = update.add_predictions();
+			prediction->set_id(tick - 1);
+			prediction->set_timestamp(Netcode::ConvertTimestampToUInt64(timestamp - tickInterval / 2));
+
+			if(tick == 2) {
+				prediction->set_type(np::ActionType::SPAWN);
+			} else {
+				const float angle = 6.2831853f * static_cast<float>(i) / static_cast<float>(numPlayers) + speed / radius * dt * static_cast<float>(tick);
+				prediction->set_type(np::ActionType::MOVEMENT);
+				ConvertFloat3(prediction->mutable_action_position(), Netcode::Float3{ radius * std::cos(angle), 200.0f, radius * std::sin(angle) });
+			}
+
+			update.SerializeToString(&content);
+			writeContent(nn::TrafficRecordType::GAME_MESSAGE, static_cast<int32_t>(i + 1), tick - 1);
+		}
+	}
+
+	const Netcode::ArrayView<uint8_t> buffer = writer.GetBuffer();
+	return std::vector<uint8_t>{ buffer.Data(), buffer.Data() + buffer.Size() };
+}
+
+void ServerBenchmark::LogResults(uint32_t numPlayers, const GameServer & server) const {
+	std::vector<Netcode::Duration> frameTimes;
+	Netcode::Duration replicationTime{};
+	Netcode::Duration captureTime{};
+	uint64_t updateBytes = 0;
+
+	// the ticks of the joins are not representative
+	for(size_t i = BENCHMARK_JOIN_TICKS; i < server.perf.size(); i++) {
+		const PerfData & p = server.perf[i];
+		frameTimes.push_back(p.frameTime);
+		replicationTime += p.replicationTime;
+		captureTime += p.captureTime;
+		updateBytes += p.numUpdateBytes;
+	}
+
+	if(frameTimes.empty()) {
+		return;
+	}
+
+	std::sort(std::begin(frameTimes), std::end(frameTimes));
+
+	const double numSamples = static_cast<double>(frameTimes.size());
+
+	const auto toMicros = [](Netcode::Duration d) -> double {
+		return std::chrono::duration<double, std::micro>(d).count();
+	};
+
+	const auto percentile = [&](double p) -> double {
+		return toMicros(frameTimes[std::min(frameTimes.size() - 1, static_cast<size_t>(p * numSamples))]);
+	};
+
+	Netcode::Duration frameTimeSum{};
+	for(Netcode::Duration d : frameTimes) {
+		frameTimeSum += d;
+	}
+
+	const double replicationPerTick = toMicros(replicationTime) / numSamples;
+
+	Log::Info("Benchmark: {0} players, {1} ticks, frame time [us] avg: {2} p50: {3} p99: {4}, capture [us]: {5}, replication [us]: {6}, per player: {7}, update bytes per tick: {8}",
+		numPlayers, static_cast<uint32_t>(frameTimes.size()), toMicros(frameTimeSum) / numSamples, percentile(0.5), percentile(0.99),
+		toMicros(captureTime) / numSamples, replicationPerTick, replicationPerTick / static_cast<double>(numPlayers),
+		static_cast<double>(updateBytes) / numSamples);
+}
+
+bool ServerBenchmark::CheckUpdateLatency(uint32_t numPlayers, const GameServer & server) const {
+	/*
+	 * The update of a tick is sent after the tick captured it. With the pipelined updates the job of a tick
+	 * runs into the next tick, a latency shorter than the capture was measured from the start of a later tick
+	 */
+	for(size_t i = BENCHMARK_JOIN_TICKS; i < server.perf.size(); i++) {
+		const PerfData & p = server.perf[i];
+
+		if(p.updateLatency < p.captureTime) {
+			Log::Error("Benchmark: {0} players, the update latency of tick {1} is shorter than its capture", numPlayers, static_cast<uint32_t>(i));
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool ServerBenchmark::Replay(uint32_t numPlayers, GameScene * loadedScene, Netcode::ArrayView<uint8_t> recording) const {
+	std::unique_ptr<GameScene> scene = std::make_unique<GameScene>();
+	scene->CloneColliders(loadedScene);
+
+	std::unique_ptr<GameServer> server = std::make_unique<GameServer>();
+	ServerReplay replay{ server.get(), scene.get() };
+
+	const bool isComplete = replay.RunTicks(recording) && CheckUpdateLatency(numPlayers, *server);
+
+	server->SavePerfData("benchmark_perf" + std::to_string(numPlayers) + ".csv");
+	LogResults(numPlayers, *server);
+
+	return isComplete;
+}
+
+bool ServerBenchmark::Run(GameScene * loadedScene) {
+	bool isComplete = true;
+
+	for(uint32_t numPlayers : playerCounts) {
+		const std::vector<uint8_t> recording = BuildRecording(numPlayers);
+
+		if(!Replay(numPlayers, loadedScene, Netcode::ArrayView<uint8_t>{ recording.data(), recording.size() })) {
+			isComplete = false;
+		}
+	}
+
+	return isComplete;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "GameServer.h"
+
+/*
+ * Measures the cost of a server tick against the number of players. For every player count a recording
+ * of synthesized clients is built: the players connect, spawn and keep moving on a circle while they
+ * acknowledge the updates of the server as a client with a tick of latency would. Every count is replayed
+ * on a fresh GameServer with a copy of the loaded colliders, the perf data of a count is saved to
+ * benchmark_perf<count>.csv and the frame and replication times are logged per count.
+ * The update latency of every tick is checked against its own capture, the pipelined updates must not
+ * mix up their ticks.
+ */
+class ServerBenchmark {
+	std::vector<uint32_t> playerCounts;
+	uint32_t numTicks;
+	Netcode::Duration tickInterval;
+
+	std::vector<uint8_t> BuildRecording(uint32_t numPlayers) const;
+
+	void LogResults(uint32_t numPlayers, const GameServer & server) const;
+
+	bool CheckUpdateLatency(uint32_t numPlayers, const GameServer & server) const;
+
+	bool Replay(uint32_t numPlayers, GameScene * loadedScene, Netcode::ArrayView<uint8_t> recording) const;
+
+public:
+	/*
+	 * Player counts are comma separated, e.g. "8,16,32,64"
+	 */
+	ServerBenchmark(const std::wstring & counts, uint32_t ticks);
+
+	/*
+	 * Runs every player count, false if a count could not be replayed or its update latencies are inconsistent
+	 */
+	bool Run(GameScene * loadedScene);
+};
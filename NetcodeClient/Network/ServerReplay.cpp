@@ -0,0 +1,258 @@
+#include "ServerReplay.h"
+#include <Netcode/IO/MappedFile.h>
+#include <Netcode/Utility.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+ServerReplay::ServerReplay(GameServer * srv, GameScene * replayScene) : ioContext{}, scene{ replayScene }, connections{}, routes{}, server{ srv }, digest{ 2166136261u } {
+
+}
+
+Connection * ServerReplay::FindConnection(int32_t id) {
+	Connection * found = nullptr;
+
+	connections.ForeachUnsafe<Connection>([&found, id](Connection * conn) -> void {
+		if(conn->id == id) {
+			found = conn;
+		}
+	});
+
+	return found;
+}
+
+void ServerReplay::Deliver(const nn::TrafficRecord & record, Netcode::Timestamp receivedAt) {
+	Connection * conn = FindConnection(record.connectionId);
+
+	// the connection was removed by a timeout or a disconnect, the live server dropped these too
+	if(conn == nullptr) {
+		return;
+	}
+
+	conn->dtlsRoute->lastReceivedAt = std::max(conn->dtlsRoute->lastReceivedAt, receivedAt);
+
+	const size_t size = record.content.Size();
+	Ref<nn::NetAllocator> alloc = MakeAllocator(static_cast<uint32_t>(std::max<size_t>(1024, 2 * size + 512)));
+
+	if(record.type == nn::TrafficRecordType::GAME_MESSAGE) {
+		uint8_t * content = alloc->MakeArray<uint8_t>(size);
+		std::copy(record.content.Data(), record.content.Data() + size, content);
+
+		nn::Node<nn::GameMessage> * node = alloc->Make<nn::Node<nn::GameMessage>>();
+		node->allocator = alloc;
+		node->content = Netcode::ArrayView<uint8_t>{ content, size };
+		node->sequence = record.sequence;
+		conn->sharedQueue.Produce(node);
+		return;
+	}
+
+	np::Control * control = alloc->MakeProto<np::Control>();
+
+	if(!control->ParseFromArray(record.content.Data(), static_cast<int>(size))) {
+		Log::Error("Replay: failed to parse a control message of connection {0}", record.connectionId);
+		return;
+	}
+
+	nn::Node<nn::ControlMessage> * node = alloc->Make<nn::Node<nn::ControlMessage>>();
+	node->allocator = alloc;
+	node->control = control;
+	conn->sharedControlQueue.Produce(node);
+}
+
+void ServerReplay::Connect(int32_t id) {
+	std::unique_ptr<nn::DtlsRoute> route = std::make_unique<nn::DtlsRoute>();
+	route->state = nn::DtlsRouteState::ESTABLISHED;
+	route->lastReceivedAt = server->Now();
+
+	Ref<Connection> conn = std::make_shared<Connection>(ioContext);
+	conn->id = id;
+	conn->dtlsRoute = route.get();
+	conn->remoteGameSequence = 0;
+	conn->localControlSequence = 1;
+	conn->localGameSequence = 1;
+	conn->state = nn::ConnectionState::SYNCHRONIZING;
+	conn->tickInterval = std::chrono::milliseconds(Netcode::Config::Get<uint32_t>(L"network.client.tickIntervalMs:u32"));
+
+	routes.emplace_back(std::move(route));
+
+	server->OnPlayerConnected(conn.get());
+	connections.AddConnection(conn);
+}
+
+void ServerReplay::RunTick(Netcode::Timestamp tickTimestamp, const std::vector<nn::TrafficRecord> & records) {
+	const Netcode::Timestamp receivedAt = tickTimestamp + server->gameClock.GetEpoch();
+
+	// the message queues are LIFO, producing in reverse makes the tick consume them in the recorded order
+	for(auto it = records.rbegin(); it != records.rend(); it++) {
+		if(it->type == nn::TrafficRecordType::GAME_MESSAGE || it->type == nn::TrafficRecordType::CONTROL_MESSAGE) {
+			Deliver(*it, receivedAt);
+		}
+	}
+
+	server->gameClock.Tick(tickTimestamp);
+	server->RunTick();
+
+	UpdateDigest();
+
+	// connections are accepted at the end of the live tick, the next tick sees them
+	for(const nn::TrafficRecord & record : records) {
+		if(record.type == nn::TrafficRecordType::CONNECT) {
+			Connect(record.connectionId);
+		}
+	}
+}
+
+void ServerReplay::LogFrameTimes() const {
+	std::vector<Netcode::Duration> frameTimes;
+	frameTimes.reserve(server->perf.size());
+
+	for(const PerfData & p : server->perf) {
+		frameTimes.push_back(p.frameTime);
+	}
+
+	if(frameTimes.empty()) {
+		return;
+	}
+
+	std::sort(std::begin(frameTimes), std::end(frameTimes));
+
+	const auto percentile = [&frameTimes](double p) -> double {
+		const size_t idx = std::min(frameTimes.size() - 1, static_cast<size_t>(p * static_cast<double>(frameTimes.size())));
+		return std::chrono::duration<double, std::micro>(frameTimes[idx]).count();
+	};
+
+	Log::Info("Replayed {0} ticks, frame time [us] p50: {1} p90: {2} p99: {3} max: {4}",
+		frameTimes.size(), percentile(0.5), percentile(0.9), percentile(0.99),
+		std::chrono::duration<double, std::micro>(frameTimes.back()).count());
+}
+
+void ServerReplay::UpdateDigest() {
+	// FNV-1a over the positions, states and unconfirmed action results of the players
+	const auto hash = [this](const void * data, size_t size) -> void {
+		const uint8_t * bytes = static_cast<const uint8_t *>(data);
+
+		for(size_t i = 0; i < size; i++) {
+			digest = (digest ^ bytes[i]) * 16777619u;
+		}
+	};
+
+	const auto hashFloat3 = [&hash](const Netcode::Float3 & value) -> void {
+		uint32_t bits[3];
+		std::memcpy(bits, &value, sizeof(bits));
+		hash(bits, sizeof(bits));
+	};
+
+	connections.ForeachUnsafe<Connection>([&](Connection * conn) -> void {
+		hash(&conn->id, sizeof(conn->id));
+
+		if(conn->gameObject == nullptr) {
+			return;
+		}
+
+		const uint32_t state = static_cast<uint32_t>(conn->gameObject->GetComponent<Network>()->state);
+		hash(&state, sizeof(state));
+		hashFloat3(conn->gameObject->GetComponent<Transform>()->position);
+
+		conn->redundancyBuffer.Foreach([&](const RedundancyItem & item) -> void {
+			const ServerReconciliation * recon = std::get_if<ServerReconciliation>(&item.storage);
+
+			if(recon == nullptr || recon->type == ReconciliationType::COMMAND) {
+				return;
+			}
+
+			const uint32_t values[3] = { recon->id, static_cast<uint32_t>(recon->type), static_cast<uint32_t>(recon->actionType) };
+			hash(values, sizeof(values));
+
+			if(recon->type == ReconciliationType::REJECTED && recon->actionType == ActionType::MOVEMENT) {
+				hashFloat3(recon->movementCorrection.position);
+			}
+		});
+	});
+}
+
+bool ServerReplay::CheckDigest(const std::wstring & path) const {
+	const std::string narrowPath = Netcode::Utility::ToNarrowString(path);
+	std::ifstream ifs{ narrowPath };
+	uint32_t expected = 0;
+
+	if(!(ifs >> std::hex >> expected)) {
+		std::ofstream ofs{ narrowPath };
+		ofs << std::hex << digest << std::endl;
+		Log::Info("Replay: digest saved to {0}", narrowPath);
+		return true;
+	}
+
+	if(expected != digest) {
+		Log::Error("Replay: the gameplay digest {0} does not match the expected {1}", digest, expected);
+		return false;
+	}
+
+	Log::Info("Replay: the gameplay digest matches");
+	return true;
+}
+
+bool ServerReplay::RunTicks(Netcode::ArrayView<uint8_t> recording) {
+	server->StartReplay(this, scene);
+
+	nn::TrafficRecordReader reader{ recording };
+	nn::TrafficRecord record;
+	std::vector<nn::TrafficRecord> tickRecords;
+	Netcode::Timestamp tickTimestamp{};
+	bool hasTick = false;
+
+	while(reader.Next(record)) {
+		if(record.type != nn::TrafficRecordType::TICK) {
+			tickRecords.push_back(record);
+			continue;
+		}
+
+		if(hasTick) {
+			RunTick(tickTimestamp, tickRecords);
+		}
+
+		tickRecords.clear();
+		tickTimestamp = record.timestamp;
+		hasTick = true;
+	}
+
+	if(hasTick) {
+		RunTick(tickTimestamp, tickRecords);
+	}
+
+	if(reader.HasFailed()) {
+		Log::Error("Replay: the recording is malformed, stopped early");
+		return false;
+	}
+
+	return true;
+}
+
+bool ServerReplay::Run(Netcode::ArrayView<uint8_t> recording) {
+	const bool isComplete = RunTicks(recording);
+
+	server->SavePerfData("replay_perf.csv");
+	LogFrameTimes();
+
+	Log::Info("Replay: gameplay digest {0}", digest);
+
+	const std::wstring digestPath = Netcode::Config::GetOptional<std::wstring>(L"network.server.replayDigest:string", std::wstring{});
+
+	if(!digestPath.empty() && !CheckDigest(digestPath)) {
+		return false;
+	}
+
+	return isComplete;
+}
+
+bool ServerReplay::Run(const std::wstring & path) {
+	Netcode::IO::MappedFile file{ path };
+
+	try {
+		file.Open();
+	} catch(Netcode::ExceptionBase & e) {
+		Log::Error("Replay: {0}", e.ToString());
+		return false;
+	}
+
+	return Run(file.GetView());
+}
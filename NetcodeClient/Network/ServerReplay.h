@@ -0,0 +1,68 @@
+#pragma once
+
+#include "GameServer.h"
+
+/*
+ * Drives a GameServer with a traffic recording instead of the network. Every recorded tick is run
+ * at its recorded time with the messages it consumed, so a tick is reproduced without the clients.
+ * The replayed server has no service: nothing is sent and clock sync requests are not answered.
+ * The gameplay outcome of every tick is hashed into a digest, replaying the same recording with a
+ * different configuration must reproduce it.
+ */
+class ServerReplay {
+	mutable boost::asio::io_context ioContext;
+	GameScene * scene;
+	nn::ConnectionStorage connections;
+	std::vector<std::unique_ptr<nn::DtlsRoute>> routes;
+	GameServer * server;
+	uint32_t digest;
+
+	Connection * FindConnection(int32_t id);
+
+	void Deliver(const nn::TrafficRecord & record, Netcode::Timestamp receivedAt);
+
+	void Connect(int32_t id);
+
+	void RunTick(Netcode::Timestamp tickTimestamp, const std::vector<nn::TrafficRecord> & records);
+
+	void LogFrameTimes() const;
+
+	void UpdateDigest();
+
+	bool CheckDigest(const std::wstring & path) const;
+
+public:
+	/*
+	 * The server is replayed on the scene, on the loaded scene if it is null
+	 */
+	ServerReplay(GameServer * srv, GameScene * replayScene = nullptr);
+
+	nn::ConnectionStorage * GetConnections() {
+		return &connections;
+	}
+
+	Ref<nn::NetAllocator> MakeAllocator(uint32_t blockSize) const {
+		return std::make_shared<nn::NetAllocator>(&ioContext, blockSize);
+	}
+
+	uint32_t GetDigest() const {
+		return digest;
+	}
+
+	/**
+	 * Starts the server in replay mode and runs the ticks of the recording, the perf data is left on the server
+	 * @return false if the recording is malformed
+	 */
+	bool RunTicks(Netcode::ArrayView<uint8_t> recording);
+
+	/**
+	 * Runs the ticks of the recording, saves the perf data and checks the digest if one is configured
+	 * @return false if the recording is malformed, the ticks before the malformed record are still run
+	 */
+	bool Run(Netcode::ArrayView<uint8_t> recording);
+
+	/**
+	 * Maps the recording file into memory and runs it
+	 */
+	bool Run(const std::wstring & path);
+};
@@ -0,0 +1,263 @@
+#include "ServerUpdateFrame.h"
+
+constexpr static uint32_t ACTION_RESULT_SIZE = 4 + 1 + 1 + 1;
+constexpr static uint32_t POSITION_SIZE = 3 * 4;
+constexpr static uint32_t COMMAND_SIZE = 4 + 1 + 4 + 4 + 4;
+constexpr static uint32_t REPLICATION_SIZE = 4 + 4;
+constexpr static uint32_t MAX_SECTION_ITEMS = 0xFFFF;
+
+static bool HasActionPosition(ReconciliationType type, ActionType actionType) {
+	return (actionType == ActionType::MOVEMENT && type == ReconciliationType::REJECTED) ||
+		(actionType == ActionType::SPAWN && type == ReconciliationType::ACCEPTED);
+}
+
+static Netcode::ArrayView<uint8_t> ToBytes(const std::string & str) {
+	return Netcode::ArrayView<uint8_t>{ reinterpret_cast<const uint8_t *>(str.data()), str.size() };
+}
+
+static uint32_t GetReconciliationSize(const ServerReconciliation & recon) {
+	if(recon.type == ReconciliationType::COMMAND) {
+		return COMMAND_SIZE + nn::WireWriter::GetBytesSize(static_cast<uint32_t>(recon.replData.size()));
+	}
+
+	return ACTION_RESULT_SIZE + (HasActionPosition(recon.type, recon.actionType) ? POSITION_SIZE : 0);
+}
+
+static void EncodeReconciliation(const ServerReconciliation & recon, std::vector<uint8_t> & dst) {
+	dst.resize(GetReconciliationSize(recon));
+
+	nn::WireWriter writer{ Netcode::MutableArrayView<uint8_t>{ dst.data(), dst.size() } };
+
+	if(recon.type == ReconciliationType::COMMAND) {
+		writer.WriteU32(recon.id);
+		writer.WriteU8(static_cast<uint8_t>(recon.command.type));
+		writer.WriteI32(recon.command.subject);
+		writer.WriteI32(recon.command.objectType);
+		writer.WriteU32(recon.command.objectId);
+		writer.WriteBytes(ToBytes(recon.replData));
+		return;
+	}
+
+	const bool hasPosition = HasActionPosition(recon.type, recon.actionType);
+
+	writer.WriteU32(recon.id);
+	writer.WriteU8(static_cast<uint8_t>(recon.type));
+	writer.WriteU8(static_cast<uint8_t>(recon.actionType));
+	writer.WriteU8(hasPosition ? 1 : 0);
+
+	if(hasPosition) {
+		writer.WriteF32(recon.movementCorrection.position.x);
+		writer.WriteF32(recon.movementCorrection.position.y);
+		writer.WriteF32(recon.movementCorrection.position.z);
+	}
+}
+
+void ReconciliationSections::Clear() {
+	results.clear();
+	commands.clear();
+	numResults = 0;
+	numCommands = 0;
+}
+
+void ReconciliationSections::Add(RedundancyItem & item) {
+	const ServerReconciliation & recon = std::get<ServerReconciliation>(item.storage);
+
+	if(item.wireData.empty()) {
+		EncodeReconciliation(recon, item.wireData);
+	}
+
+	if(recon.type == ReconciliationType::COMMAND) {
+		commands.insert(std::end(commands), std::begin(item.wireData), std::end(item.wireData));
+		numCommands++;
+	} else {
+		results.insert(std::end(results), std::begin(item.wireData), std::end(item.wireData));
+		numResults++;
+	}
+}
+
+ServerUpdateWriter::ServerUpdateWriter(Netcode::MutableArrayView<uint8_t> buffer, nn::ReplicationCoder * replicationCoder) :
+	writer{ buffer }, coder{ replicationCoder }, countOffset{ 0 }, count{ 0 }, tooManyItems{ false } {
+
+}
+
+void ServerUpdateWriter::BeginSection() {
+	countOffset = writer.GetOffset();
+	count = 0;
+	writer.WriteU16(0);
+}
+
+void ServerUpdateWriter::EndSection() {
+	if(count > MAX_SECTION_ITEMS) {
+		tooManyItems = true;
+		return;
+	}
+
+	writer.PatchU16(countOffset, static_cast<uint16_t>(count));
+}
+
+void ServerUpdateWriter::WriteReconciliations(uint32_t receivedId, const ReconciliationSections & reconciliations) {
+	writer.WriteU8(MAGIC);
+	writer.WriteU8(VERSION);
+	writer.WriteU8((coder != nullptr) ? FLAG_CODED_REPLICATIONS : 0);
+	writer.WriteU32((coder != nullptr) ? coder->GetModelId() : 0);
+	writer.WriteU32(receivedId);
+
+	if(reconciliations.numResults > MAX_SECTION_ITEMS || reconciliations.numCommands > MAX_SECTION_ITEMS) {
+		tooManyItems = true;
+		return;
+	}
+
+	writer.WriteU16(static_cast<uint16_t>(reconciliations.numResults));
+	writer.WriteRaw(Netcode::ArrayView<uint8_t>{ reconciliations.results.data(), reconciliations.results.size() });
+	writer.WriteU16(static_cast<uint16_t>(reconciliations.numCommands));
+	writer.WriteRaw(Netcode::ArrayView<uint8_t>{ reconciliations.commands.data(), reconciliations.commands.size() });
+}
+
+void ServerUpdateWriter::BeginReplications() {
+	BeginSection();
+}
+
+void ServerUpdateWriter::AddReplication(uint32_t objectId, uint32_t baselineId, Netcode::ArrayView<uint8_t> content) {
+	writer.WriteU32(objectId);
+	writer.WriteU32(baselineId);
+
+	if(coder != nullptr) {
+		const Netcode::ArrayView<uint8_t> coded = coder->Encode(content);
+
+		if(coded.Size() > 0) {
+			writer.WriteVarUInt(static_cast<uint32_t>(content.Size()));
+			writer.WriteBytes(coded);
+			count++;
+			return;
+		}
+
+		writer.WriteVarUInt(0);
+	}
+
+	writer.WriteBytes(content);
+	count++;
+}
+
+void ServerUpdateWriter::EndReplications() {
+	EndSection();
+}
+
+uint32_t ServerUpdateWriter::GetReplicationSize(uint32_t contentSize) {
+	// the raw size prefix of an uncoded content is 1 byte, coded contents are at least a byte smaller
+	// than the raw one, which pays for their longer prefix
+	return REPLICATION_SIZE + 1 + nn::WireWriter::GetBytesSize(contentSize);
+}
+
+bool ServerUpdateReader::IsFrame(Netcode::ArrayView<uint8_t> content) {
+	return content.Size() > 0 && content[0] == ServerUpdateWriter::MAGIC;
+}
+
+bool ServerUpdateReader::Read(Netcode::ArrayView<uint8_t> content, uint32_t sequence, uint32_t & receivedId,
+	std::vector<ServerReconciliation> & reconciliations, std::vector<ReplData> & replications,
+	nn::ReplicationCoder * replicationCoder) {
+	nn::WireReader reader{ content };
+
+	if(reader.ReadU8() != ServerUpdateWriter::MAGIC || reader.ReadU8() != ServerUpdateWriter::VERSION) {
+		return false;
+	}
+
+	const uint8_t flags = reader.ReadU8();
+	const uint32_t modelId = reader.ReadU32();
+	const bool coded = (flags & ServerUpdateWriter::FLAG_CODED_REPLICATIONS) != 0;
+
+	if((flags & ~ServerUpdateWriter::FLAG_CODED_REPLICATIONS) != 0 ||
+		(coded && (replicationCoder == nullptr || replicationCoder->GetModelId() != modelId))) {
+		return false;
+	}
+
+	const size_t numReconciliations = reconciliations.size();
+	const size_t numReplications = replications.size();
+
+	const auto reject = [&]() -> bool {
+		reconciliations.erase(std::begin(reconciliations) + numReconciliations, std::end(reconciliations));
+		replications.erase(std::begin(replications) + numReplications, std::end(replications));
+		return false;
+	};
+
+	const uint32_t received = reader.ReadU32();
+
+	const uint32_t numResults = reader.ReadU16();
+	for(uint32_t i = 0; i < numResults && !reader.HasOverflowed(); i++) {
+		ServerReconciliation sr = {};
+		sr.id = reader.ReadU32();
+		const uint8_t result = reader.ReadU8();
+		sr.actionType = static_cast<ActionType>(reader.ReadU8());
+		const uint8_t hasPosition = reader.ReadU8();
+
+		if(hasPosition > 1) {
+			return reject();
+		}
+
+		if(hasPosition) {
+			sr.movementCorrection.position.x = reader.ReadF32();
+			sr.movementCorrection.position.y = reader.ReadF32();
+			sr.movementCorrection.position.z = reader.ReadF32();
+		}
+
+		if(result != static_cast<uint8_t>(ReconciliationType::ACCEPTED) &&
+			result != static_cast<uint8_t>(ReconciliationType::REJECTED)) {
+			continue;
+		}
+
+		sr.type = static_cast<ReconciliationType>(result);
+
+		if(HasActionPosition(sr.type, sr.actionType) && !hasPosition) {
+			continue;
+		}
+
+		reconciliations.emplace_back(std::move(sr));
+	}
+
+	const uint32_t numCommands = reader.ReadU16();
+	for(uint32_t i = 0; i < numCommands && !reader.HasOverflowed(); i++) {
+		ServerReconciliation sr = {};
+		sr.type = ReconciliationType::COMMAND;
+		sr.actionType = ActionType::NOOP;
+		sr.id = reader.ReadU32();
+		sr.command.type = static_cast<CommandType>(reader.ReadU8());
+		sr.command.subject = reader.ReadI32();
+		sr.command.objectType = reader.ReadI32();
+		sr.command.objectId = reader.ReadU32();
+
+		const Netcode::ArrayView<uint8_t> replData = reader.ReadBytes();
+		sr.replData.assign(reinterpret_cast<const char *>(replData.Data()), replData.Size());
+
+		reconciliations.emplace_back(std::move(sr));
+	}
+
+	const uint32_t numRepls = reader.ReadU16();
+	for(uint32_t i = 0; i < numRepls && !reader.HasOverflowed(); i++) {
+		ReplData rd;
+		rd.sequence = sequence;
+		rd.objectId = reader.ReadU32();
+		rd.baselineId = reader.ReadU32();
+
+		const uint32_t rawSize = coded ? reader.ReadVarUInt() : 0;
+		const Netcode::ArrayView<uint8_t> data = reader.ReadBytes();
+
+		if(rawSize == 0) {
+			rd.content.assign(reinterpret_cast<const char *>(data.Data()), data.Size());
+		} else {
+			if(rawSize <= data.Size() || rawSize > nn::ReplicationCoder::MAX_PAYLOAD_SIZE || reader.HasOverflowed()) {
+				return reject();
+			}
+
+			rd.content.resize(rawSize);
+			replicationCoder->Decode(data, Netcode::MutableArrayView<uint8_t>{ reinterpret_cast<uint8_t *>(rd.content.data()), rawSize });
+		}
+
+		replications.emplace_back(std::move(rd));
+	}
+
+	if(reader.HasOverflowed() || reader.GetRemainingSize() != 0) {
+		return reject();
+	}
+
+	receivedId = received;
+	return true;
+}
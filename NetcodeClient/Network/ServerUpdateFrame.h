@@ -0,0 +1,110 @@
+#pragma once
+
+#include "../Components.h"
+#include "ReplBaseline.h"
+#include <Netcode/Network/WireFormat.h>
+#include <Netcode/Network/RangeCoder.h>
+
+/*
+ * Flat wire format of the server update, written straight into the message buffer and read in place.
+ * Schema of version 2, integers are in network byte order, bytes are VarUInt length prefixed:
+ *  header:        u8 magic, u8 version, u8 flags, u32 modelId, u32 receivedId
+ *  u16 count, action results:  u32 id, u8 result, u8 actionType, u8 hasPosition, [f32 x, y, z]
+ *  u16 count, commands:        u32 id, u8 type, i32 subject, i32 objectType, u32 objectId, bytes replData
+ *  u16 count, replications:    u32 objectId, u32 baselineId, [VarUInt rawSize], bytes content
+ * With FLAG_CODED_REPLICATIONS the contents are range coded with the model of modelId and prefixed with
+ * their decoded size, a rawSize of 0 marks a content that did not get smaller and is stored as is.
+ * The low 3 bits of the magic are an invalid protobuf wire type, so a frame is never mistaken
+ * for a protobuf encoded np::ServerUpdate, which remains the fallback format.
+ */
+/*
+ * The action results and the commands of a redundancy buffer in the frame format. Every item is
+ * encoded once, on its first send, later updates copy its bytes.
+ */
+struct ReconciliationSections {
+	std::vector<uint8_t> results;
+	std::vector<uint8_t> commands;
+	uint32_t numResults;
+	uint32_t numCommands;
+
+	ReconciliationSections() : results{}, commands{}, numResults{ 0 }, numCommands{ 0 } { }
+
+	/**
+	 * Keeps the capacity, the sections are refilled every tick
+	 */
+	void Clear();
+
+	/**
+	 * @param item a ServerReconciliation, its wire data is filled if empty
+	 */
+	void Add(RedundancyItem & item);
+
+	/**
+	 * @return the number of bytes WriteReconciliations adds besides the fixed size
+	 */
+	uint32_t GetSize() const {
+		return static_cast<uint32_t>(results.size() + commands.size());
+	}
+};
+
+class ServerUpdateWriter {
+	nn::WireWriter writer;
+	nn::ReplicationCoder * coder;
+	size_t countOffset;
+	uint32_t count;
+	bool tooManyItems;
+
+	void BeginSection();
+	void EndSection();
+
+public:
+	constexpr static uint8_t MAGIC = 0xF7;
+	constexpr static uint8_t VERSION = 2;
+	constexpr static uint8_t FLAG_CODED_REPLICATIONS = 1;
+	// header and the counts of the three sections
+	constexpr static uint32_t FIXED_SIZE = 11 + 3 * 2;
+
+	/**
+	 * @param replicationCoder if not null, the replications are entropy coded
+	 */
+	ServerUpdateWriter(Netcode::MutableArrayView<uint8_t> buffer, nn::ReplicationCoder * replicationCoder = nullptr);
+
+	/**
+	 * Writes the header, the action results and the commands of the redundancy buffer
+	 */
+	void WriteReconciliations(uint32_t receivedId, const ReconciliationSections & reconciliations);
+
+	void BeginReplications();
+
+	void AddReplication(uint32_t objectId, uint32_t baselineId, Netcode::ArrayView<uint8_t> content);
+
+	void EndReplications();
+
+	size_t GetSize() const {
+		return writer.GetOffset();
+	}
+
+	bool HasOverflowed() const {
+		return writer.HasOverflowed() || tooManyItems;
+	}
+
+	/**
+	 * @return upper bound of the bytes AddReplication writes, coded or not
+	 */
+	static uint32_t GetReplicationSize(uint32_t contentSize);
+};
+
+class ServerUpdateReader {
+public:
+	static bool IsFrame(Netcode::ArrayView<uint8_t> content);
+
+	/**
+	 * Decodes a whole frame, the outputs are appended to and left unchanged if the frame is malformed.
+	 * Malformed action results are dropped one by one, as the protobuf path does.
+	 * @param sequence the game sequence of the message, assigned to the replications
+	 * @param replicationCoder decodes coded replications, a coded frame is rejected without it or on a model mismatch
+	 */
+	static bool Read(Netcode::ArrayView<uint8_t> content, uint32_t sequence, uint32_t & receivedId,
+		std::vector<ServerReconciliation> & reconciliations, std::vector<ReplData> & replications,
+		nn::ReplicationCoder * replicationCoder = nullptr);
+};
@@ -21,7 +21,12 @@ void InitProgramOptions(po::options_description & root, MainConfig & config) {
 
 	netw.add_options()
 		("host_mode", po::wvalue<std::wstring>(&config.hostMode)->default_value(L"listen", "listen"), "Network host mode. Possible values: client, listen, dedicated")
-		("public", po::bool_switch(&config.isPublic)->default_value(false), "If set, the application will try to register itself when hosting a game. This value is permanent for dedicated servers. Listen servers can override this value");
+		("public", po::bool_switch(&config.isPublic)->default_value(false), "If set, the application will try to register itself when hosting a game. This value is permanent for dedicated servers. Listen servers can override this value")
+		("replay", po::wvalue<std::wstring>(&config.replayFile)->default_value(L"", ""), "Replays a server traffic recording, measures the server ticks and exits")
+		("replay_digest", po::wvalue<std::wstring>(&config.replayDigest)->default_value(L"", ""), "File of the gameplay digest of the replay. Written if missing, otherwise the replay must reproduce it")
+		("benchmark", po::wvalue<std::wstring>(&config.benchmarkPlayers)->default_value(L"", ""), "Runs the server ticks with synthesized players for each comma separated player count, e.g. 8,16,32,64, logs the tick costs and exits")
+		("benchmark_ticks", po::value<uint32_t>(&config.benchmarkTicks)->default_value(0), "Number of measured ticks per player count of the benchmark, 0 uses the configured value")
+		("matches", po::value<uint32_t>(&config.numMatches)->default_value(0), "Number of matches a dedicated server hosts in one process, 0 hosts a single game");
 
 	po::options_description window("Window");
 
@@ -59,6 +64,26 @@ void LoadVariablesIntoConfig(const MainConfig & config) {
 	if(config.hostMode == L"client") {
 		Netcode::Config::Set(L"game.hostMode", HostMode::CLIENT);
 	}
+
+	if(!config.replayFile.empty()) {
+		Netcode::Config::Set(L"network.server.replay:string", config.replayFile);
+	}
+
+	if(!config.replayDigest.empty()) {
+		Netcode::Config::Set(L"network.server.replayDigest:string", config.replayDigest);
+	}
+
+	if(!config.benchmarkPlayers.empty()) {
+		Netcode::Config::Set(L"network.server.benchmark.players:string", config.benchmarkPlayers);
+	}
+
+	if(config.benchmarkTicks > 0) {
+		Netcode::Config::Set(L"network.server.benchmark.ticks:u32", config.benchmarkTicks);
+	}
+
+	if(config.numMatches > 0) {
+		Netcode::Config::Set(L"network.server.matchHost.matches:u32", config.numMatches);
+	}
 	
 	if(config.windowSizeX != -1 && config.windowSizeY != -1) {
 		Netcode::Config::Set(L"window.size:Int2",
@@ -11,6 +11,11 @@ struct MainConfig {
 	std::wstring mediaRoot;
 	std::wstring configFile;
 	std::wstring hostMode;
+	std::wstring replayFile;
+	std::wstring replayDigest;
+	std::wstring benchmarkPlayers;
+	uint32_t benchmarkTicks;
+	uint32_t numMatches;
 	int windowPosX;
 	int windowPosY;
 	int windowSizeX;
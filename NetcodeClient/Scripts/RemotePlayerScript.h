@@ -5,11 +5,6 @@
 #include "LocalPlayerScript.h"
 
 
-struct ServerFrameData {
-	Netcode::Float3 position;
-	PlayerState state;
-};
-
 class RemotePlayerScript : public PlayerScript {
 	Netcode::PxPtr<physx::PxController> controller;
 	Transform* transform;
@@ -28,7 +23,6 @@ public:
 	Netcode::Float3 IND_ahead;
 	
 	Netcode::Timestamp serverLastUpdate;
-	std::unique_ptr<HistoryBuffer<ServerFrameData>> serverHistory;
 
 	physx::PxController* GetController() {
 		return controller.Get();
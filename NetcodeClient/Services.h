@@ -4,9 +4,10 @@
 #include "AssetManager.h"
 #include "GameScene.h"
 #include <Netcode/PhysXWrapper.h>
+#include <Netcode/System/JobSystem.h>
 
 class GameApp;
 
-using ServicesTuple = std::tuple<AssetManager, GameSceneManager, Netcode::Physics::PhysX, Netcode::Module::IGraphicsModule*, GameApp*>;
+using ServicesTuple = std::tuple<AssetManager, GameSceneManager, Netcode::Physics::PhysX, Netcode::Module::IGraphicsModule*, GameApp*, Netcode::JobSystem>;
 
 using Service = Netcode::Service<ServicesTuple>;
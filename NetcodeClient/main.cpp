@@ -144,13 +144,14 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance
 	Netcode::Initialize();
 	
 	Netcode::Module::DefaultModuleFactory defModuleFactory;
-	std::unique_ptr<Netcode::Module::AApp> app = std::make_unique<GameApp>();
+	std::unique_ptr<GameApp> app = std::make_unique<GameApp>();
 	app->Setup(&defModuleFactory);
 
 	Log::Info("Initialization successful");
 
 	app->Run();
 	app->Exit();
+	const int exitCode = app->exitCode;
 	app.reset();
 
 	Log::Info("Gracefully shutting down");
@@ -161,5 +162,5 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance
 		dxgiDebug->ReportLiveObjects(DXGI_DEBUG_ALL, DXGI_DEBUG_RLO_FLAGS(DXGI_DEBUG_RLO_SUMMARY | DXGI_DEBUG_RLO_IGNORE_INTERNAL));
 	}
 
-	return 0;
+	return exitCode;
 }
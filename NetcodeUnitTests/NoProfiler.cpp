@@ -0,0 +1,22 @@
+#include <Netcode/System/Profiler.h>
+
+#if !defined(NETCODE_NO_PROFILER)
+#error "NETCODE_NO_PROFILER did not reach the target"
+#endif
+
+#define NETCODE_NO_PROFILER_STRINGIZE_IMPL(...) #__VA_ARGS__
+#define NETCODE_NO_PROFILER_STRINGIZE(...) NETCODE_NO_PROFILER_STRINGIZE_IMPL(__VA_ARGS__)
+
+// the argument is expanded before it is stringized, a compiled out macro leaves an empty string
+static_assert(sizeof(NETCODE_NO_PROFILER_STRINGIZE(NETCODE_PROFILE_SCOPE("scope"))) == 1, "NETCODE_PROFILE_SCOPE is not compiled out");
+static_assert(sizeof(NETCODE_NO_PROFILER_STRINGIZE(NETCODE_PROFILE_COUNTER("counter", 1))) == 1, "NETCODE_PROFILE_COUNTER is not compiled out");
+static_assert(sizeof(NETCODE_NO_PROFILER_STRINGIZE(NETCODE_PROFILE_FRAME("frame"))) == 1, "NETCODE_PROFILE_FRAME is not compiled out");
+static_assert(sizeof(NETCODE_NO_PROFILER_STRINGIZE(NETCODE_PROFILE_THREAD("thread"))) == 1, "NETCODE_PROFILE_THREAD is not compiled out");
+
+// the call sites still have to compile without the profiler
+void NetcodeNoProfilerCallSites() {
+	NETCODE_PROFILE_THREAD("thread");
+	NETCODE_PROFILE_FRAME("frame");
+	NETCODE_PROFILE_SCOPE("scope");
+	NETCODE_PROFILE_COUNTER("counter", 1);
+}
@@ -10,6 +10,39 @@
 #include <boost/program_options.hpp>
 #include <NetcodeFoundation/Json.h>
 #include <Netcode/Network/ReplicationContext.h>
+#include <Netcode/Network/HttpSession.h>
+#include <Netcode/Network/CompletionToken.h>
+#include <Netcode/Network/MysqlSession.h>
+#include <Netcode/Network/MockDatabase.h>
+#include <Netcode/Network/ClockDiscipline.h>
+#include <Netcode/Network/RetransmissionTimer.h>
+#include <Netcode/Network/BitStream.h>
+#include <Netcode/Network/Quantization.h>
+#include <Netcode/Network/WireFormat.h>
+#include <Netcode/Network/RangeCoder.h>
+#include <Netcode/Network/TrafficRecording.h>
+#include <Netcode/Network/HistoryBuffer.h>
+#include <Netcode/Network/TournamentTree.hpp>
+#include <Netcode/Network/LagCompensation.h>
+#include <Netcode/System/GameClock.h>
+#include <Netcode/System/JobSystem.h>
+#include <Netcode/System/Profiler.h>
+#include <Netcode/AsyncLog.h>
+#include <Netcode/PhysXWrapper.h>
+#include <NetcodeClient/Network/ReplLayout.hpp>
+#include <NetcodeClient/Network/ReplBaseline.h>
+#include <NetcodeClient/Network/InterestGrid.h>
+#include <NetcodeClient/Network/PriorityAccumulator.h>
+#include <NetcodeClient/Network/RedundancyRing.hpp>
+#include <NetcodeClient/Network/MatchSchedule.h>
+#include <Netcode/System/SystemClock.h>
+#include <random>
+#include <Netcode/Stopwatch.h>
+#include <future>
+#include <thread>
+#include <fstream>
+#include <mutex>
+#include <condition_variable>
 
 struct MainConfig {
 	std::wstring shaderRoot;
@@ -629,6 +662,2836 @@ TEST(Replication, Context) {
 	}
 }
 
+TEST(Network, HttpSessionPool) {
+	namespace nn = Netcode::Network;
+	namespace http = boost::beast::http;
+	using boost::asio::ip::tcp;
+
+	constexpr uint32_t numRequests = 256;
+	constexpr uint32_t maxConnections = 2;
+
+	// blocking stub server, every accepted stream is served on its own thread
+	boost::asio::io_context serverIoc;
+	tcp::acceptor acceptor{ serverIoc, tcp::endpoint{ boost::asio::ip::make_address("127.0.0.1"), 0 } };
+	const tcp::endpoint serverEndpoint = acceptor.local_endpoint();
+
+	std::atomic_uint32_t numAccepted{ 0 };
+	std::atomic_bool isDone{ false };
+	std::vector<std::thread> streamThreads;
+
+	std::thread acceptorThread{ [&]() -> void {
+		for(;;) {
+			tcp::socket socket{ serverIoc };
+			boost::system::error_code ec;
+			acceptor.accept(socket, ec);
+
+			if(ec || isDone) {
+				return;
+			}
+
+			numAccepted++;
+
+			streamThreads.emplace_back([s = std::move(socket)]() mutable -> void {
+				boost::beast::flat_buffer buffer;
+				boost::system::error_code ec;
+
+				for(;;) {
+					http::request<http::string_body> req;
+					http::read(s, buffer, req, ec);
+
+					if(ec) {
+						return;
+					}
+
+					http::response<http::string_body> res{ http::status::ok, req.version() };
+					res.keep_alive(req.keep_alive());
+					res.body() = "{}";
+					res.prepare_payload();
+					http::write(s, res, ec);
+
+					if(ec || !res.keep_alive()) {
+						return;
+					}
+				}
+			});
+		}
+	} };
+
+	boost::asio::io_context clientIoc;
+	auto work = boost::asio::make_work_guard(clientIoc);
+	std::thread clientThread{ [&clientIoc]() -> void { clientIoc.run(); } };
+
+	nn::HttpPoolConfig config;
+	config.maxConnectionsPerHost = maxConnections;
+	Ref<nn::HttpSession> session = std::make_shared<nn::HttpSession>(clientIoc, config);
+
+	std::promise<void> allDone;
+	std::future<void> allDoneFuture = allDone.get_future();
+	std::atomic_uint32_t numCompleted{ 0 };
+	std::atomic_uint32_t numSucceeded{ 0 };
+
+	Netcode::Stopwatch sw;
+	sw.Start();
+
+	for(uint32_t i = 0; i < numRequests; i++) {
+		session->MakeRequest("127.0.0.1", std::to_string(serverEndpoint.port()), "/api/status", http::verb::get, "", "")
+			->Then([&](const nn::Response & response) -> void {
+			if(!response.GetErrorCode() && response.result() == http::status::ok) {
+				numSucceeded++;
+			}
+
+			if(++numCompleted == numRequests) {
+				allDone.set_value();
+			}
+		});
+	}
+
+	const bool isCompleted = allDoneFuture.wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+
+	sw.Stop();
+
+	if(isCompleted) {
+		const double seconds = std::chrono::duration<double>(sw.GetElapsedDuration()).count();
+		RecordProperty("requestsPerSecond", static_cast<int>(numRequests / std::max(seconds, 1e-6)));
+	}
+
+	session->Close();
+	session.reset();
+	work.reset();
+	clientThread.join();
+
+	isDone = true;
+	{
+		// unblocks the accept call
+		tcp::socket wakeUp{ serverIoc };
+		boost::system::error_code ec;
+		wakeUp.connect(serverEndpoint, ec);
+		acceptorThread.join();
+	}
+
+	for(std::thread & t : streamThreads) {
+		t.join();
+	}
+
+	EXPECT_TRUE(isCompleted);
+	EXPECT_EQ(numSucceeded.load(), numRequests);
+	EXPECT_LE(numAccepted.load(), maxConnections);
+}
+
+TEST(Network, HttpSessionRetry) {
+	namespace nn = Netcode::Network;
+	namespace http = boost::beast::http;
+	using boost::asio::ip::tcp;
+
+	// the first stream answers one request, then reads the pipelined ones and drops the stream without a response
+	constexpr uint32_t numDropped = 3;
+
+	boost::asio::io_context serverIoc;
+	tcp::acceptor acceptor{ serverIoc, tcp::endpoint{ boost::asio::ip::make_address("127.0.0.1"), 0 } };
+	const tcp::endpoint serverEndpoint = acceptor.local_endpoint();
+
+	std::mutex receivedMutex;
+	std::map<std::string, uint32_t> numReceived;
+	std::atomic_bool isDone{ false };
+	std::vector<std::thread> streamThreads;
+
+	std::thread acceptorThread{ [&]() -> void {
+		for(uint32_t streamIndex = 0;; streamIndex++) {
+			tcp::socket socket{ serverIoc };
+			boost::system::error_code ec;
+			acceptor.accept(socket, ec);
+
+			if(ec || isDone) {
+				return;
+			}
+
+			streamThreads.emplace_back([&, s = std::move(socket), streamIndex]() mutable -> void {
+				boost::beast::flat_buffer buffer;
+				boost::system::error_code ec;
+
+				for(uint32_t i = 0;; i++) {
+					http::request<http::string_body> req;
+					http::read(s, buffer, req, ec);
+
+					if(ec) {
+						return;
+					}
+
+					{
+						std::scoped_lock<std::mutex> lock{ receivedMutex };
+						numReceived[std::string{ req.target() }]++;
+					}
+
+					if(streamIndex == 0 && i > 0) {
+						if(i == numDropped) {
+							s.close(ec);
+							return;
+						}
+						continue;
+					}
+
+					http::response<http::string_body> res{ http::status::ok, req.version() };
+					res.keep_alive(req.keep_alive());
+					res.body() = "{}";
+					res.prepare_payload();
+					http::write(s, res, ec);
+
+					if(ec) {
+						return;
+					}
+				}
+			});
+		}
+	} };
+
+	boost::asio::io_context clientIoc;
+	auto work = boost::asio::make_work_guard(clientIoc);
+	std::thread clientThread{ [&clientIoc]() -> void { clientIoc.run(); } };
+
+	nn::HttpPoolConfig config;
+	config.maxConnectionsPerHost = 1;
+	config.maxPipelineDepth = 4;
+	Ref<nn::HttpSession> session = std::make_shared<nn::HttpSession>(clientIoc, config);
+	const std::string port = std::to_string(serverEndpoint.port());
+
+	auto makeRequest = [&](const std::string & path, http::verb method) -> std::future<bool> {
+		Ref<std::promise<bool>> succeeded = std::make_shared<std::promise<bool>>();
+		std::future<bool> result = succeeded->get_future();
+
+		session->MakeRequest("127.0.0.1", port, path, method, "", "{}")->Then([succeeded](const nn::Response & response) -> void {
+			succeeded->set_value(!response.GetErrorCode() && response.result() == http::status::ok);
+		});
+
+		return result;
+	};
+
+	// the stream has to be reused for a retry
+	std::future<bool> first = makeRequest("/first", http::verb::get);
+	const bool isFirstCompleted = first.wait_for(std::chrono::seconds(5)) == std::future_status::ready;
+
+	std::future<bool> login = makeRequest("/login", http::verb::post);
+	std::future<bool> logout = makeRequest("/logout", http::verb::post);
+	std::future<bool> status = makeRequest("/status", http::verb::get);
+
+	const bool isCompleted = isFirstCompleted &&
+		login.wait_for(std::chrono::seconds(5)) == std::future_status::ready &&
+		logout.wait_for(std::chrono::seconds(5)) == std::future_status::ready &&
+		status.wait_for(std::chrono::seconds(5)) == std::future_status::ready;
+
+	session->Close();
+	session.reset();
+	work.reset();
+	clientThread.join();
+
+	isDone = true;
+	{
+		// unblocks the accept call
+		tcp::socket wakeUp{ serverIoc };
+		boost::system::error_code ec;
+		wakeUp.connect(serverEndpoint, ec);
+		acceptorThread.join();
+	}
+
+	for(std::thread & t : streamThreads) {
+		t.join();
+	}
+
+	ASSERT_TRUE(isCompleted);
+	EXPECT_TRUE(first.get());
+
+	// the first unanswered request was dropped with the stream, it is sent again whatever its method is
+	EXPECT_TRUE(login.get());
+	EXPECT_EQ(numReceived["/login"], 2u);
+
+	// the host might have processed a later non-idempotent request, it is not replayed
+	EXPECT_FALSE(logout.get());
+	EXPECT_EQ(numReceived["/logout"], 1u);
+
+	EXPECT_TRUE(status.get());
+	EXPECT_EQ(numReceived["/status"], 2u);
+}
+
+TEST(Network, DatabasePoolMock) {
+	namespace nn = Netcode::Network;
+
+	constexpr uint32_t numPlayers = 256;
+
+	boost::asio::io_context ioc;
+	auto work = boost::asio::make_work_guard(ioc);
+	std::thread iocThread{ [&ioc]() -> void { ioc.run(); } };
+
+	Ref<nn::MockDatabase> db = std::make_shared<nn::MockDatabase>(std::chrono::milliseconds(1), true);
+	db->AddUser(1, "owner", "owner_hash", false);
+
+	nn::DatabasePoolConfig config;
+	config.poolSize = 4;
+	config.maxBatchSize = 64;
+
+	std::promise<void> allDone;
+	std::future<void> allDoneFuture = allDone.get_future();
+	std::atomic_uint32_t numCompleted{ 0 };
+	std::atomic_uint32_t numSucceeded{ 0 };
+	bool isSetUp = false;
+	bool isCompleted = false;
+	nn::DatabaseStats stats;
+
+	{
+		nn::MysqlSession session{ ioc, config, db->GetConnectionFactory() };
+
+		std::promise<bool> setupDone;
+		std::future<bool> setupFuture = setupDone.get_future();
+
+		// a failed connect cancels the queued registration too
+		session.Connect();
+		session.RegisterServer(1, 8, 500, "127.0.0.1", 8888, 8889)->Then([&](const Netcode::ErrorCode & ec) -> void {
+			setupDone.set_value(!ec);
+		});
+
+		isSetUp = setupFuture.wait_for(std::chrono::seconds(10)) == std::future_status::ready && setupFuture.get();
+
+		if(isSetUp) {
+			for(uint32_t i = 0; i < numPlayers; i++) {
+				session.QueryUserByHash("hash_" + std::to_string(i))->Then([&](const nn::QueryUserResult & result) -> void {
+					if(!result.errorCode) {
+						numSucceeded++;
+					}
+
+					if(++numCompleted == 2 * numPlayers) {
+						allDone.set_value();
+					}
+				});
+
+				session.CreateGameSession(static_cast<int>(i + 2))->Then([&](const Netcode::ErrorCode & ec) -> void {
+					if(!ec) {
+						numSucceeded++;
+					}
+
+					if(++numCompleted == 2 * numPlayers) {
+						allDone.set_value();
+					}
+				});
+			}
+
+			isCompleted = allDoneFuture.wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+		}
+
+		stats = session.GetStatistics();
+	}
+
+	work.reset();
+	iocThread.join();
+
+	const nn::DatabaseStatementStats & writeStats = stats[static_cast<size_t>(nn::DatabaseStatement::WRITE_GAME_SESSIONS)];
+	const nn::DatabaseStatementStats & queryStats = stats[static_cast<size_t>(nn::DatabaseStatement::QUERY_USER_BY_HASH)];
+
+	EXPECT_TRUE(isSetUp);
+	EXPECT_TRUE(isCompleted);
+	EXPECT_EQ(numSucceeded.load(), 2 * numPlayers);
+	EXPECT_EQ(db->GetOpenGameSessionCount(), numPlayers);
+	EXPECT_EQ(queryStats.executions, numPlayers);
+	EXPECT_EQ(writeStats.rows, numPlayers);
+	EXPECT_EQ(writeStats.errors, 0u);
+	// writes submitted while a batch was in flight must have been coalesced
+	EXPECT_LT(writeStats.executions, numPlayers);
+}
+
+TEST(Network, DatabasePoolReconnect) {
+	namespace nn = Netcode::Network;
+
+	boost::asio::io_context ioc;
+	auto work = boost::asio::make_work_guard(ioc);
+	std::thread iocThread{ [&ioc]() -> void { ioc.run(); } };
+
+	Ref<nn::MockDatabase> db = std::make_shared<nn::MockDatabase>(Netcode::Duration{}, true);
+
+	nn::DatabasePoolConfig config;
+	config.poolSize = 2;
+	config.reconnectDelay = std::chrono::milliseconds(5);
+	config.maxReconnectDelay = std::chrono::milliseconds(20);
+	// every query must reach the database
+	config.userCache.ttl = Netcode::Duration{};
+
+	uint32_t liveWhileOffline = config.poolSize;
+	uint32_t liveAfterRestart = 0;
+	bool isConnected = false;
+	bool isQueryFailedOffline = false;
+	bool isQuerySucceededAfterRestart = false;
+
+	{
+		nn::MysqlSession session{ ioc, config, db->GetConnectionFactory() };
+
+		const auto query = [&session](const std::string & hash) -> Netcode::ErrorCode {
+			std::promise<Netcode::ErrorCode> done;
+			std::future<Netcode::ErrorCode> doneFuture = done.get_future();
+
+			session.QueryUserByHash(hash)->Then([&done](const nn::QueryUserResult & result) -> void {
+				done.set_value(result.errorCode);
+			});
+
+			if(doneFuture.wait_for(std::chrono::seconds(10)) != std::future_status::ready) {
+				return nn::Errc::make_error_code(nn::Errc::timed_out);
+			}
+
+			return doneFuture.get();
+		};
+
+		const auto waitForLiveConnections = [&session](uint32_t expected) -> uint32_t {
+			const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+
+			while(session.GetLiveConnectionCount() != expected && std::chrono::steady_clock::now() < deadline) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+
+			return session.GetLiveConnectionCount();
+		};
+
+		std::promise<bool> connectDone;
+		std::future<bool> connectFuture = connectDone.get_future();
+
+		session.Connect()->Then([&connectDone](const Netcode::ErrorCode & ec) -> void {
+			connectDone.set_value(!ec);
+		});
+
+		isConnected = connectFuture.wait_for(std::chrono::seconds(10)) == std::future_status::ready && connectFuture.get();
+
+		if(isConnected) {
+			db->SetOnline(false);
+
+			// each worker notices the lost session after the job it ran, the pool fails fast once every session is gone
+			isQueryFailedOffline = static_cast<bool>(query("offline_0"));
+
+			for(uint32_t i = 1; i < 64 && session.GetLiveConnectionCount() > 0; i++) {
+				query("offline_" + std::to_string(i));
+			}
+
+			liveWhileOffline = session.GetLiveConnectionCount();
+
+			db->SetOnline(true);
+
+			liveAfterRestart = waitForLiveConnections(config.poolSize);
+			isQuerySucceededAfterRestart = !query("online");
+		}
+	}
+
+	work.reset();
+	iocThread.join();
+
+	EXPECT_TRUE(isConnected);
+	EXPECT_TRUE(isQueryFailedOffline);
+	EXPECT_EQ(liveWhileOffline, 0u);
+	EXPECT_EQ(liveAfterRestart, config.poolSize);
+	EXPECT_TRUE(isQuerySucceededAfterRestart);
+}
+
+TEST(Network, UserCache) {
+	namespace nn = Netcode::Network;
+
+	constexpr uint32_t numRetries = 64;
+
+	// holds the queries until every lookup of the round is issued, the coalescing does not depend on timing
+	struct QueryGate {
+		std::mutex mutex;
+		std::condition_variable opened;
+		bool isOpen = false;
+
+		void Wait() {
+			std::unique_lock<std::mutex> lock{ mutex };
+			opened.wait(lock, [this]() -> bool { return isOpen; });
+		}
+
+		void Open() {
+			{
+				std::unique_lock<std::mutex> lock{ mutex };
+				isOpen = true;
+			}
+			opened.notify_all();
+		}
+	};
+
+	class GatedConnection : public nn::DatabaseConnection {
+		std::unique_ptr<nn::DatabaseConnection> connection;
+		std::shared_ptr<QueryGate> gate;
+
+	public:
+		GatedConnection(std::unique_ptr<nn::DatabaseConnection> conn, std::shared_ptr<QueryGate> g) : connection{ std::move(conn) }, gate{ std::move(g) } { }
+
+		Netcode::ErrorCode Connect() override {
+			return connection->Connect();
+		}
+
+		bool IsAlive() override {
+			return connection->IsAlive();
+		}
+
+		nn::QueryUserResult QueryUserByHash(const std::string & hash) override {
+			gate->Wait();
+			return connection->QueryUserByHash(hash);
+		}
+
+		Netcode::ErrorCode RegisterServer(int ownerId, uint8_t playerSlots, uint32_t tickIntervalMs, const std::string & serverIp, uint16_t controlPort, uint16_t gamePort, uint64_t & serverId) override {
+			return connection->RegisterServer(ownerId, playerSlots, tickIntervalMs, serverIp, controlPort, gamePort, serverId);
+		}
+
+		Netcode::ErrorCode CloseServer(uint64_t serverId) override {
+			return connection->CloseServer(serverId);
+		}
+
+		Netcode::ErrorCode WriteGameSessions(uint64_t serverId, const nn::GameSessionWrite * writes, size_t numWrites) override {
+			return connection->WriteGameSessions(serverId, writes, numWrites);
+		}
+	};
+
+	boost::asio::io_context ioc;
+	auto work = boost::asio::make_work_guard(ioc);
+	std::thread iocThread{ [&ioc]() -> void { ioc.run(); } };
+
+	Ref<nn::MockDatabase> db = std::make_shared<nn::MockDatabase>(Netcode::Duration{}, false);
+	db->AddUser(7, "player", "known_hash", false);
+
+	std::shared_ptr<QueryGate> gate = std::make_shared<QueryGate>();
+	nn::DatabaseConnectionFactory factory = [mockFactory = db->GetConnectionFactory(), gate]() -> std::unique_ptr<nn::DatabaseConnection> {
+		return std::make_unique<GatedConnection>(mockFactory(), gate);
+	};
+
+	nn::DatabasePoolConfig config;
+	config.poolSize = 4;
+
+	std::atomic_uint32_t numKnown{ 0 };
+	std::atomic_uint32_t numUnknown{ 0 };
+	nn::DatabaseStats stats;
+	nn::UserCacheStats cacheStats;
+
+	const auto queryAll = [&](nn::MysqlSession & session, uint32_t count) -> std::future<void> {
+		auto done = std::make_shared<std::promise<void>>();
+		auto remaining = std::make_shared<std::atomic_uint32_t>(2 * count);
+		std::future<void> doneFuture = done->get_future();
+
+		for(uint32_t i = 0; i < count; i++) {
+			session.QueryUserByHash("known_hash")->Then([&numKnown, done, remaining](const nn::QueryUserResult & result) -> void {
+				if(!result.errorCode && std::get<0>(result.playerData) == 7) {
+					numKnown++;
+				}
+
+				if(--(*remaining) == 0) {
+					done->set_value();
+				}
+			});
+
+			session.QueryUserByHash("unknown_hash")->Then([&numUnknown, done, remaining](const nn::QueryUserResult & result) -> void {
+				if(result.errorCode) {
+					numUnknown++;
+				}
+
+				if(--(*remaining) == 0) {
+					done->set_value();
+				}
+			});
+		}
+
+		return doneFuture;
+	};
+
+	const auto isReady = [](const std::future<void> & f) -> bool {
+		return f.wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+	};
+
+	bool isCompleted = false;
+
+	{
+		nn::MysqlSession session{ ioc, config, std::move(factory) };
+		session.Connect();
+
+		// concurrent retries during a match start: one query per hash
+		std::future<void> firstRound = queryAll(session, numRetries);
+		gate->Open();
+		isCompleted = isReady(firstRound);
+		// warm entries, positive and negative
+		isCompleted = isCompleted && isReady(queryAll(session, numRetries));
+
+		session.InvalidateUser("known_hash");
+		isCompleted = isCompleted && isReady(queryAll(session, 1));
+
+		stats = session.GetStatistics();
+		cacheStats = session.GetUserCacheStatistics();
+	}
+
+	work.reset();
+	iocThread.join();
+
+	EXPECT_TRUE(isCompleted);
+	EXPECT_EQ(numKnown.load(), 2 * numRetries + 1);
+	EXPECT_EQ(numUnknown.load(), 2 * numRetries + 1);
+	EXPECT_EQ(stats[static_cast<size_t>(nn::DatabaseStatement::QUERY_USER_BY_HASH)].executions, 3u);
+	EXPECT_EQ(cacheStats.misses, 3u);
+	EXPECT_EQ(cacheStats.coalesced, 2u * (numRetries - 1));
+	EXPECT_EQ(cacheStats.hits, numRetries);
+	EXPECT_EQ(cacheStats.negativeHits, numRetries + 1);
+}
+
+TEST(Network, ClockDiscipline) {
+	namespace nn = Netcode::Network;
+	using Netcode::Duration;
+	using Netcode::Timestamp;
+	using Ms = std::chrono::duration<double, std::milli>;
+
+	constexpr double trueOffsetMs = 250.0;
+	constexpr double trueDrift = 100e-6;
+
+	const auto remoteOffsetAt = [&](double localMs) -> double {
+		return trueOffsetMs + trueDrift * localMs;
+	};
+
+	std::mt19937 rng{ 42 };
+	std::exponential_distribution<double> queueing{ 1.0 / 2.0 };
+	std::uniform_real_distribution<double> uniform{ 0.0, 1.0 };
+
+	nn::ClockDiscipline discipline;
+	nn::ClockDisciplineConfig config;
+
+	uint32_t numRejected = 0;
+	double previousOffset = 0.0;
+	double previousAt = 0.0;
+
+	for(uint32_t i = 0; i < 120; i++) {
+		const double t0 = 1000.0 * i;
+		const double forward = 10.0 + queueing(rng);
+		// a few packets get stuck in a long queue on the way back only
+		const double backward = 10.0 + queueing(rng) + ((uniform(rng) < 0.05) ? 300.0 : 0.0);
+		const double t1 = t0 + forward + remoteOffsetAt(t0 + forward);
+		const double t2 = t1 + 0.1;
+		const double t3 = t0 + forward + 0.1 + backward;
+
+		Netcode::Protocol::TimeSync ts;
+		ts.set_client_req_transmission(Netcode::ConvertTimestampToUInt64(Timestamp{ std::chrono::duration_cast<Duration>(Ms{ t0 }) }));
+		ts.set_server_req_reception(Netcode::ConvertTimestampToUInt64(Timestamp{ std::chrono::duration_cast<Duration>(Ms{ t1 }) }));
+		ts.set_server_resp_transmission(Netcode::ConvertTimestampToUInt64(Timestamp{ std::chrono::duration_cast<Duration>(Ms{ t2 }) }));
+		ts.set_client_resp_reception(Netcode::ConvertTimestampToUInt64(Timestamp{ std::chrono::duration_cast<Duration>(Ms{ t3 }) }));
+
+		const nn::ClockSampleResult result = discipline.Update(ts);
+
+		if(i == 0) {
+			EXPECT_EQ(result, nn::ClockSampleResult::STEPPED);
+		} else {
+			EXPECT_NE(result, nn::ClockSampleResult::STEPPED);
+		}
+
+		numRejected += (result == nn::ClockSampleResult::REJECTED) ? 1 : 0;
+
+		// the applied offset never jumps, it is slewed at a bounded rate
+		for(double at = std::max(t3, previousAt + 100.0); at < t0 + 1000.0; at += 100.0) {
+			const double offset = Ms{ discipline.GetOffset(Timestamp{ std::chrono::duration_cast<Duration>(Ms{ at }) }) }.count();
+
+			if(i > 0) {
+				const double maxChange = (config.maxSlewRate + config.maxFrequency) * (at - previousAt) + 1e-3;
+				EXPECT_LE(std::fabs(offset - previousOffset), maxChange);
+			}
+
+			previousOffset = offset;
+			previousAt = at;
+		}
+	}
+
+	const double now = 120000.0;
+	const Timestamp nowTs{ std::chrono::duration_cast<Duration>(Ms{ now }) };
+	const double error = std::fabs(Ms{ discipline.GetOffset(nowTs) }.count() - remoteOffsetAt(now));
+
+	EXPECT_TRUE(discipline.IsSynchronized());
+	EXPECT_LT(error, 2.0);
+	EXPECT_LE(error, Ms{ discipline.GetErrorBound(nowTs) }.count());
+	EXPECT_NEAR(discipline.GetFrequency(), trueDrift, 50e-6);
+	EXPECT_LT(numRejected, 20u);
+}
+
+TEST(Network, RetransmissionTimer) {
+	namespace nn = Netcode::Network;
+	using Netcode::Duration;
+	using Ms = std::chrono::milliseconds;
+
+	nn::RetransmissionConfig config;
+	config.minTimeout = Ms{ 100 };
+	config.maxTimeout = Ms{ 2000 };
+
+	nn::RetransmissionTimer timer;
+
+	// the per message type initial value is used until the first sample
+	EXPECT_FALSE(timer.HasSample());
+	EXPECT_EQ(timer.GetTimeout(Ms{ 500 }), Duration{ Ms{ 500 } });
+	EXPECT_EQ(timer.GetTimeout(Ms{ 500 }, 1, config), Duration{ Ms{ 1000 } });
+
+	// RFC 6298 2.2: SRTT = R, RTTVAR = R/2, RTO = SRTT + 4 * RTTVAR
+	timer.AddSample(Ms{ 40 });
+	EXPECT_EQ(timer.GetSmoothedRtt(), Duration{ Ms{ 40 } });
+	EXPECT_EQ(timer.GetRttVariance(), Duration{ Ms{ 20 } });
+	EXPECT_EQ(timer.GetTimeout(Ms{ 500 }), Duration{ Ms{ 120 } });
+
+	// RFC 6298 2.3: RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|, SRTT = 7/8 SRTT + 1/8 R
+	timer.AddSample(Ms{ 80 });
+	EXPECT_EQ(timer.GetRttVariance(), Duration{ Ms{ 25 } });
+	EXPECT_EQ(timer.GetSmoothedRtt(), Duration{ Ms{ 45 } });
+	EXPECT_EQ(timer.GetTimeout(Ms{ 500 }), Duration{ Ms{ 145 } });
+
+	// a stable low latency path converges to the floor
+	for(uint32_t i = 0; i < 64; i++) {
+		timer.AddSample(Ms{ 5 });
+	}
+	EXPECT_LT(timer.GetTimeout(Ms{ 500 }), Duration{ Ms{ 10 } });
+	EXPECT_EQ(timer.GetTimeout(Ms{ 500 }, 0, config), Duration{ Ms{ 100 } });
+
+	// exponential backoff, clamped by the ceiling
+	EXPECT_EQ(timer.GetTimeout(Ms{ 500 }, 1, config), Duration{ Ms{ 200 } });
+	EXPECT_EQ(timer.GetTimeout(Ms{ 500 }, 3, config), Duration{ Ms{ 800 } });
+	EXPECT_EQ(timer.GetTimeout(Ms{ 500 }, 5, config), Duration{ Ms{ 2000 } });
+	EXPECT_EQ(timer.GetTimeout(Ms{ 500 }, 64, config), Duration{ Ms{ 2000 } });
+
+	// a long haul path is not retransmitted before its round trip elapses
+	nn::RetransmissionTimer longHaul;
+	for(uint32_t i = 0; i < 16; i++) {
+		longHaul.AddSample(Ms{ 250 + (i % 2) * 20 });
+	}
+	EXPECT_GT(longHaul.GetTimeout(Ms{ 100 }, 0, config), Duration{ Ms{ 270 } });
+
+	timer.Reset();
+	EXPECT_EQ(timer.GetNumSamples(), 0u);
+	EXPECT_EQ(timer.GetTimeout(Ms{ 500 }), Duration{ Ms{ 500 } });
+}
+
+TEST(Network, BitStream) {
+	namespace nn = Netcode::Network;
+
+	uint8_t buffer[64] = {};
+	nn::BitWriter writer{ Netcode::MutableArrayView<uint8_t>{ buffer, sizeof(buffer) } };
+
+	writer.Write(5, 3);
+	writer.WriteBool(true);
+	writer.Write(0xABCDEF12u, 32);
+	writer.Write(0x7Fu, 7);
+	writer.WriteVarUInt(0);
+	writer.WriteVarUInt(300);
+	writer.WriteVarUInt(0xFFFFFFFFu);
+	writer.WriteVarInt(-1);
+	writer.WriteVarInt(-2147483647 - 1);
+	// only the low bits of the value are written
+	writer.Write(0xFFFFFFF0u, 4);
+
+	ASSERT_FALSE(writer.HasOverflowed());
+	EXPECT_EQ(writer.GetNumBits(), 3u + 1u + 32u + 7u + 8u + 16u + 40u + 8u + 40u + 4u);
+	// 3 + 1 bits are MSB first in the first byte
+	EXPECT_EQ(buffer[0] >> 4, 0xBu);
+
+	nn::BitReader reader{ Netcode::ArrayView<uint8_t>{ buffer, writer.GetNumBytes() } };
+
+	EXPECT_EQ(reader.Read(3), 5u);
+	EXPECT_TRUE(reader.ReadBool());
+	EXPECT_EQ(reader.Read(32), 0xABCDEF12u);
+	EXPECT_EQ(reader.Read(7), 0x7Fu);
+	EXPECT_EQ(reader.ReadVarUInt(), 0u);
+	EXPECT_EQ(reader.ReadVarUInt(), 300u);
+	EXPECT_EQ(reader.ReadVarUInt(), 0xFFFFFFFFu);
+	EXPECT_EQ(reader.ReadVarInt(), -1);
+	EXPECT_EQ(reader.ReadVarInt(), -2147483647 - 1);
+	EXPECT_EQ(reader.Read(4), 0u);
+	EXPECT_FALSE(reader.HasOverflowed());
+	EXPECT_EQ(reader.GetNumBytes(), writer.GetNumBytes());
+
+	// the padding is readable, anything after it is not
+	reader.Read(static_cast<uint32_t>(reader.GetNumBytes() * 8 - reader.GetNumBits()));
+	EXPECT_FALSE(reader.HasOverflowed());
+	EXPECT_EQ(reader.Read(1), 0u);
+	EXPECT_TRUE(reader.HasOverflowed());
+
+	uint8_t small[2] = {};
+	nn::BitWriter smallWriter{ Netcode::MutableArrayView<uint8_t>{ small, sizeof(small) } };
+	smallWriter.Write(1, 10);
+	smallWriter.Write(0x3F, 7);
+	EXPECT_TRUE(smallWriter.HasOverflowed());
+	EXPECT_EQ(smallWriter.GetNumBits(), 10u);
+
+	// a truncated varint is rejected
+	const uint8_t truncated[2] = { 0x80, 0x80 };
+	nn::BitReader truncatedReader{ Netcode::ArrayView<uint8_t>{ truncated, sizeof(truncated) } };
+	truncatedReader.ReadVarUInt();
+	EXPECT_TRUE(truncatedReader.HasOverflowed());
+}
+
+TEST(Network, Quantization) {
+	namespace nn = Netcode::Network;
+
+	std::mt19937 rng{ 42 };
+	std::uniform_real_distribution<float> unit{ -1.0f, 1.0f };
+
+	uint8_t buffer[64];
+
+	const auto roundTrip = [&buffer](const auto & quantizer, const auto & value, auto & result) -> size_t {
+		nn::BitWriter writer{ Netcode::MutableArrayView<uint8_t>{ buffer, sizeof(buffer) } };
+		quantizer.Write(writer, value);
+		EXPECT_FALSE(writer.HasOverflowed());
+		EXPECT_EQ(writer.GetNumBits(), quantizer.GetNumBits(value));
+
+		nn::BitReader reader{ Netcode::ArrayView<uint8_t>{ buffer, writer.GetNumBytes() } };
+		EXPECT_TRUE(quantizer.Read(reader, result));
+		EXPECT_EQ(reader.GetNumBits(), writer.GetNumBits());
+		return writer.GetNumBits();
+	};
+
+	nn::RangedFloatQuantizer ranged{ -100.0f, 50.0f, 12 };
+	EXPECT_NEAR(ranged.GetMaxError(), 150.0f / 4095.0f / 2.0f, 1e-4f);
+	EXPECT_EQ(ranged.Quantize(-100.0f), 0u);
+	EXPECT_EQ(ranged.Quantize(50.0f), 4095u);
+	EXPECT_FLOAT_EQ(ranged.Dequantize(ranged.Quantize(1000.0f)), 50.0f);
+	EXPECT_FLOAT_EQ(ranged.Dequantize(ranged.Quantize(std::numeric_limits<float>::quiet_NaN())), -100.0f);
+
+	nn::BoundedFloat3Quantizer bounded{ Netcode::Float3{ -2000.0f, -100.0f, -2000.0f }, Netcode::Float3{ 2000.0f, 500.0f, 2000.0f }, 20 };
+	nn::QuaternionQuantizer quaternion{ 10 };
+	// the reconstructed component inherits the error of the other three
+	const float quaternionBound = 5.0f * quaternion.GetMaxError();
+
+	for(uint32_t i = 0; i < 1000; i++) {
+		const float f = 75.0f * unit(rng) - 25.0f;
+		float fr;
+		EXPECT_EQ(roundTrip(ranged, f, fr), 12u);
+		EXPECT_LE(std::abs(fr - f), ranged.GetMaxError() * 1.001f);
+
+		const Netcode::Float3 p{ 2000.0f * unit(rng), 200.0f + 300.0f * unit(rng), 2000.0f * unit(rng) };
+		Netcode::Float3 pr;
+		EXPECT_EQ(roundTrip(bounded, p, pr), 60u);
+		EXPECT_LE(std::abs(pr.x - p.x), bounded.GetMaxError() * 1.001f);
+		EXPECT_LE(std::abs(pr.y - p.y), bounded.GetMaxError() * 1.001f);
+		EXPECT_LE(std::abs(pr.z - p.z), bounded.GetMaxError() * 1.001f);
+
+		Netcode::Float4 q{ unit(rng), unit(rng), unit(rng), unit(rng) };
+		const float len = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+		q = Netcode::Float4{ q.x / len, q.y / len, q.z / len, q.w / len };
+		Netcode::Float4 qr;
+		EXPECT_EQ(roundTrip(quaternion, q, qr), 32u);
+
+		// q and -q are the same rotation
+		const float dot = q.x * qr.x + q.y * qr.y + q.z * qr.z + q.w * qr.w;
+		const float sign = (dot < 0.0f) ? -1.0f : 1.0f;
+		EXPECT_LE(std::abs(sign * qr.x - q.x), quaternionBound);
+		EXPECT_LE(std::abs(sign * qr.y - q.y), quaternionBound);
+		EXPECT_LE(std::abs(sign * qr.z - q.z), quaternionBound);
+		EXPECT_LE(std::abs(sign * qr.w - q.w), quaternionBound);
+	}
+
+	nn::VarUIntQuantizer varUInt;
+	nn::VarIntQuantizer varInt;
+
+	const uint32_t unsignedValues[] = { 0u, 1u, 127u, 128u, 16383u, 16384u, 0xFFFFFFFFu };
+	const uint32_t unsignedBits[] = { 8u, 8u, 8u, 16u, 16u, 24u, 40u };
+	for(size_t i = 0; i < std::size(unsignedValues); i++) {
+		uint32_t r = 0;
+		EXPECT_EQ(roundTrip(varUInt, unsignedValues[i], r), unsignedBits[i]);
+		EXPECT_EQ(r, unsignedValues[i]);
+	}
+
+	const int32_t signedValues[] = { 0, -1, 63, -64, 64, 2147483647, -2147483647 - 1 };
+	const uint32_t signedBits[] = { 8u, 8u, 8u, 8u, 16u, 40u, 40u };
+	for(size_t i = 0; i < std::size(signedValues); i++) {
+		int32_t r = 0;
+		EXPECT_EQ(roundTrip(varInt, signedValues[i], r), signedBits[i]);
+		EXPECT_EQ(r, signedValues[i]);
+	}
+
+	// throughput of packing positions, the bit writer is on the hot path of every ServerUpdate
+	constexpr uint32_t numValues = 1 << 20;
+	std::vector<Netcode::Float3> positions;
+	positions.reserve(1024);
+	for(uint32_t i = 0; i < 1024; i++) {
+		positions.emplace_back(2000.0f * unit(rng), 200.0f + 300.0f * unit(rng), 2000.0f * unit(rng));
+	}
+
+	std::vector<uint8_t> stream(1024 * 8);
+	Netcode::Float3 sink{ 0.0f, 0.0f, 0.0f };
+
+	Netcode::Stopwatch sw;
+	sw.Start();
+
+	for(uint32_t i = 0; i < numValues; i += 1024) {
+		nn::BitWriter writer{ Netcode::MutableArrayView<uint8_t>{ stream.data(), stream.size() } };
+		for(const Netcode::Float3 & p : positions) {
+			bounded.Write(writer, p);
+		}
+		ASSERT_FALSE(writer.HasOverflowed());
+
+		nn::BitReader reader{ Netcode::ArrayView<uint8_t>{ stream.data(), writer.GetNumBytes() } };
+		for(size_t j = 0; j < positions.size(); j++) {
+			Netcode::Float3 p;
+			ASSERT_TRUE(bounded.Read(reader, p));
+			sink.x += p.x;
+		}
+	}
+
+	sw.Stop();
+
+	const double seconds = std::chrono::duration<double>(sw.GetElapsedDuration()).count();
+	RecordProperty("positionRoundTripsPerSecond", static_cast<int>(numValues / std::max(seconds, 1e-6)));
+	EXPECT_TRUE(std::isfinite(sink.x));
+}
+
+TEST(Network, WireFormat) {
+	namespace nn = Netcode::Network;
+
+	uint8_t buffer[64] = {};
+	const uint8_t payload[] = { 1, 2, 3, 4, 5 };
+
+	nn::WireWriter writer{ Netcode::MutableArrayView<uint8_t>{ buffer, sizeof(buffer) } };
+	writer.WriteU8(0xF7);
+	writer.WriteU16(0);
+	writer.WriteU32(0xDEADBEEFu);
+	writer.WriteI32(-5);
+	writer.WriteF32(1.5f);
+	writer.WriteVarUInt(300);
+	writer.WriteBytes(Netcode::ArrayView<uint8_t>{ payload, sizeof(payload) });
+	writer.WriteBytes(Netcode::ArrayView<uint8_t>{ nullptr, 0 });
+	writer.PatchU16(1, 0x1234);
+
+	ASSERT_FALSE(writer.HasOverflowed());
+	const size_t size = writer.GetOffset();
+	EXPECT_EQ(size, 1u + 2u + 4u + 4u + 4u + 2u + 6u + 1u);
+	EXPECT_EQ(nn::WireWriter::GetVarUIntSize(127), 1u);
+	EXPECT_EQ(nn::WireWriter::GetVarUIntSize(128), 2u);
+	EXPECT_EQ(nn::WireWriter::GetVarUIntSize(0xFFFFFFFFu), 5u);
+	EXPECT_EQ(nn::WireWriter::GetBytesSize(sizeof(payload)), 6u);
+	// network byte order
+	EXPECT_EQ(buffer[3], 0xDEu);
+
+	nn::WireReader reader{ Netcode::ArrayView<uint8_t>{ buffer, size } };
+	EXPECT_EQ(reader.ReadU8(), 0xF7u);
+	EXPECT_EQ(reader.ReadU16(), 0x1234u);
+	EXPECT_EQ(reader.ReadU32(), 0xDEADBEEFu);
+	EXPECT_EQ(reader.ReadI32(), -5);
+	EXPECT_EQ(reader.ReadF32(), 1.5f);
+	EXPECT_EQ(reader.ReadVarUInt(), 300u);
+
+	Netcode::ArrayView<uint8_t> bytes = reader.ReadBytes();
+	ASSERT_EQ(bytes.Size(), sizeof(payload));
+	// read in place
+	EXPECT_EQ(bytes.Data(), buffer + 1 + 2 + 4 + 4 + 4 + 2 + 1);
+	EXPECT_EQ(memcmp(bytes.Data(), payload, sizeof(payload)), 0);
+	EXPECT_EQ(reader.ReadBytes().Size(), 0u);
+	EXPECT_FALSE(reader.HasOverflowed());
+	EXPECT_EQ(reader.GetRemainingSize(), 0u);
+
+	// a full writer ignores the rest of the frame
+	nn::WireWriter small{ Netcode::MutableArrayView<uint8_t>{ buffer, 3 } };
+	small.WriteU16(1);
+	small.WriteU16(2);
+	EXPECT_TRUE(small.HasOverflowed());
+	EXPECT_EQ(small.GetOffset(), 2u);
+
+	// raw bytes have no prefix, an encoded part of a frame is copied in as is
+	uint8_t spliced[8] = {};
+	nn::WireWriter splicer{ Netcode::MutableArrayView<uint8_t>{ spliced, sizeof(spliced) } };
+	splicer.WriteRaw(Netcode::ArrayView<uint8_t>{ payload, sizeof(payload) });
+	splicer.WriteU8(9);
+	EXPECT_FALSE(splicer.HasOverflowed());
+	EXPECT_EQ(splicer.GetOffset(), sizeof(payload) + 1);
+	EXPECT_EQ(memcmp(spliced, payload, sizeof(payload)), 0);
+	EXPECT_EQ(spliced[sizeof(payload)], 9u);
+	splicer.WriteRaw(Netcode::ArrayView<uint8_t>{ payload, sizeof(payload) });
+	EXPECT_TRUE(splicer.HasOverflowed());
+
+	// every truncation of the frame fails somewhere instead of reading out of bounds
+	for(size_t cut = 0; cut < size; cut++) {
+		nn::WireReader r{ Netcode::ArrayView<uint8_t>{ buffer, cut } };
+		r.ReadU8();
+		r.ReadU16();
+		r.ReadU32();
+		r.ReadI32();
+		r.ReadF32();
+		r.ReadVarUInt();
+		r.ReadBytes();
+		r.ReadBytes();
+		EXPECT_TRUE(r.HasOverflowed());
+		EXPECT_LE(r.GetOffset(), cut);
+	}
+
+	// random input, lengths and varints must stay within the buffer
+	std::mt19937 rng{ 7 };
+	std::uniform_int_distribution<uint32_t> byteDist{ 0, 255 };
+	std::vector<uint8_t> noise(256);
+
+	for(uint32_t i = 0; i < 1000; i++) {
+		for(uint8_t & b : noise) {
+			b = static_cast<uint8_t>(byteDist(rng));
+		}
+
+		nn::WireReader r{ Netcode::ArrayView<uint8_t>{ noise.data(), byteDist(rng) } };
+
+		while(!r.HasOverflowed() && r.GetRemainingSize() > 0) {
+			Netcode::ArrayView<uint8_t> view = r.ReadBytes();
+
+			if(!r.HasOverflowed()) {
+				EXPECT_GE(view.Data(), noise.data());
+				EXPECT_LE(view.Data() + view.Size(), noise.data() + noise.size());
+			}
+		}
+
+		EXPECT_LE(r.GetOffset(), noise.size());
+	}
+}
+
+struct ReplLayoutTestState {
+	Netcode::Float3 position;
+	Netcode::Float3 ahead;
+	float health;
+	uint32_t kills;
+};
+
+/*
+ * Field of the runtime composed descriptor, every call on it is virtual
+ */
+template<typename Codec>
+struct ReplLayoutTestArgument : public ReplArgumentBase {
+	using ValueType = typename Codec::ValueType;
+
+	ReplLayoutTestState * state;
+	ValueType ReplLayoutTestState:: * member;
+	Codec codec;
+
+	ReplLayoutTestArgument(ReplType type, ReplLayoutTestState * state, ValueType ReplLayoutTestState:: * member, const Codec & codec) :
+		ReplArgumentBase{ type }, state{ state }, member{ member }, codec{ codec } { }
+
+	virtual uint32_t GetReplicatedSize(GameObject *) const override {
+		return codec.GetReplicatedSize(state->*member);
+	}
+
+	virtual uint32_t QueryReplicatedSize(Netcode::ArrayView<uint8_t> view) const override {
+		return codec.QueryReplicatedSize(view);
+	}
+
+	virtual uint32_t Write(GameObject *, Netcode::MutableArrayView<uint8_t> view) const override {
+		return codec.Write(view, state->*member);
+	}
+
+	virtual uint32_t Read(GameObject *, Netcode::ArrayView<uint8_t> view) override {
+		return codec.Read(state->*member, view);
+	}
+};
+
+TEST(Replication, StaticLayout) {
+	namespace nn = Netcode::Network;
+	using DirectionCodec = QuantizedCodec<nn::BoundedFloat3Quantizer>;
+
+	const nn::BoundedFloat3Quantizer direction{ Netcode::Float3{ -1.0f, -1.0f, -1.0f }, Netcode::Float3{ 1.0f, 1.0f, 1.0f }, 16 };
+
+	ReplLayoutTestState src{ Netcode::Float3{ 10.0f, 20.0f, 30.0f }, Netcode::Float3{ 0.0f, 0.0f, 1.0f }, 75.0f, 3 };
+	ReplLayoutTestState dst{ Netcode::Float3{ 0.0f, 0.0f, 0.0f }, Netcode::Float3{ 0.0f, 0.0f, 0.0f }, 0.0f, 0 };
+
+	const auto makeRuntimeDesc = [&direction](ReplLayoutTestState * state) -> ReplDesc {
+		std::vector<std::unique_ptr<ReplArgumentBase>> args;
+		args.emplace_back(std::make_unique<ReplLayoutTestArgument<ReplicatorCodec<Netcode::Float3>>>(ReplType::CLIENT_PREDICTED, state, &ReplLayoutTestState::position, ReplicatorCodec<Netcode::Float3>{}));
+		args.emplace_back(std::make_unique<ReplLayoutTestArgument<DirectionCodec>>(ReplType::DEFAULT, state, &ReplLayoutTestState::ahead, DirectionCodec{ direction }));
+		args.emplace_back(std::make_unique<ReplLayoutTestArgument<ReplicatorCodec<float>>>(ReplType::DEFAULT, state, &ReplLayoutTestState::health, ReplicatorCodec<float>{}));
+		args.emplace_back(std::make_unique<ReplLayoutTestArgument<ReplicatorCodec<uint32_t>>>(ReplType::DEFAULT, state, &ReplLayoutTestState::kills, ReplicatorCodec<uint32_t>{}));
+		return std::make_unique<ReplArgumentDesc>(std::move(args));
+	};
+
+	const auto makeStaticDesc = [&direction](ReplLayoutTestState * state) -> ReplDesc {
+		return MakeReplDesc(
+			ReplFromState<ReplType::CLIENT_PREDICTED, &ReplLayoutTestState::position>(state),
+			ReplQuantizedFromState<ReplType::DEFAULT, &ReplLayoutTestState::ahead>(state, direction),
+			ReplFromState<ReplType::DEFAULT, &ReplLayoutTestState::health>(state),
+			ReplFromState<ReplType::DEFAULT, &ReplLayoutTestState::kills>(state));
+	};
+
+	// fixed size fields fold into a constant
+	using FixedLayout = ReplLayout<GameObject,
+		decltype(ReplFromState<ReplType::DEFAULT, &ReplLayoutTestState::position>(nullptr)),
+		decltype(ReplFromState<ReplType::DEFAULT, &ReplLayoutTestState::kills>(nullptr))>;
+	static_assert(FixedLayout::FIXED_SIZE == 16, "Fixed size layout must sum its fields");
+	static_assert(FixedLayout::NUM_FIELDS == 2, "Number of fields must match the arguments");
+
+	ReplDesc runtimeSrc = makeRuntimeDesc(&src);
+	ReplDesc staticSrc = makeStaticDesc(&src);
+	ReplDesc staticDst = makeStaticDesc(&dst);
+
+	ASSERT_EQ(runtimeSrc->GetNumFields(), staticSrc->GetNumFields());
+	for(uint32_t i = 0; i < staticSrc->GetNumFields(); i++) {
+		EXPECT_EQ(runtimeSrc->GetFieldType(i), staticSrc->GetFieldType(i));
+	}
+
+	const uint32_t size = staticSrc->GetReplicatedSize(nullptr);
+	ASSERT_EQ(size, runtimeSrc->GetReplicatedSize(nullptr));
+	ASSERT_EQ(size, 12u + 6u + 4u + 4u);
+
+	std::vector<uint8_t> runtimeBytes(size);
+	std::vector<uint8_t> staticBytes(size);
+	ASSERT_EQ(runtimeSrc->Write(nullptr, Netcode::MutableArrayView<uint8_t>{ runtimeBytes.data(), runtimeBytes.size() }), size);
+	ASSERT_EQ(staticSrc->Write(nullptr, Netcode::MutableArrayView<uint8_t>{ staticBytes.data(), staticBytes.size() }), size);
+	EXPECT_EQ(runtimeBytes, staticBytes);
+
+	Netcode::ArrayView<uint8_t> view{ staticBytes.data(), staticBytes.size() };
+	EXPECT_EQ(staticDst->QueryFieldSize(0, view), 12u);
+	EXPECT_EQ(staticDst->QueryFieldSize(1, view.Offset(12)), 6u);
+
+	// predicted fields are skipped but still consumed
+	ASSERT_EQ(staticDst->Read(nullptr, view, true), size);
+	EXPECT_EQ(dst.position.x, 0.0f);
+	EXPECT_EQ(dst.kills, 3u);
+	EXPECT_EQ(dst.health, 75.0f);
+	EXPECT_NEAR(dst.ahead.z, 1.0f, direction.GetMaxError() * 1.001f);
+
+	ASSERT_EQ(staticDst->Read(nullptr, view, false), size);
+	EXPECT_EQ(dst.position.x, 10.0f);
+	EXPECT_EQ(dst.position.y, 20.0f);
+	EXPECT_EQ(dst.position.z, 30.0f);
+
+	// truncated buffers fail as a whole
+	EXPECT_EQ(staticSrc->Write(nullptr, Netcode::MutableArrayView<uint8_t>{ staticBytes.data(), size - 1 }), 0u);
+	EXPECT_EQ(staticDst->Read(nullptr, Netcode::ArrayView<uint8_t>{ staticBytes.data(), size - 1 }, false), 0u);
+
+	// serialization throughput of both descriptors over the same states
+	constexpr uint32_t numObjects = 1 << 20;
+	std::vector<uint8_t> stream(size * 1024);
+
+	const auto measure = [&](ReplDescBase * write, ReplDescBase * read) -> double {
+		Netcode::Stopwatch sw;
+		sw.Start();
+
+		for(uint32_t i = 0; i < numObjects; i += 1024) {
+			uint8_t * ptr = stream.data();
+			for(uint32_t j = 0; j < 1024; j++) {
+				src.kills = i + j;
+				ptr += write->Write(nullptr, Netcode::MutableArrayView<uint8_t>{ ptr, size });
+			}
+
+			const uint8_t * rptr = stream.data();
+			for(uint32_t j = 0; j < 1024; j++) {
+				rptr += read->Read(nullptr, Netcode::ArrayView<uint8_t>{ rptr, size }, false);
+			}
+		}
+
+		sw.Stop();
+		return std::chrono::duration<double>(sw.GetElapsedDuration()).count();
+	};
+
+	ReplDesc runtimeDst = makeRuntimeDesc(&dst);
+
+	const double runtimeSeconds = measure(runtimeSrc.get(), runtimeDst.get());
+	EXPECT_EQ(dst.kills, numObjects - 1);
+
+	const double staticSeconds = measure(staticSrc.get(), staticDst.get());
+	EXPECT_EQ(dst.kills, numObjects - 1);
+
+	RecordProperty("runtimeObjectsPerSecond", static_cast<int>(numObjects / std::max(runtimeSeconds, 1e-6)));
+	RecordProperty("staticObjectsPerSecond", static_cast<int>(numObjects / std::max(staticSeconds, 1e-6)));
+}
+
+TEST(Replication, DeltaEncoding) {
+	ReplLayoutTestState state{ Netcode::Float3{ 10.0f, 20.0f, 30.0f }, Netcode::Float3{ 0.0f, 0.0f, 1.0f }, 75.0f, 3 };
+
+	ReplDesc desc = MakeReplDesc(
+		ReplFromState<ReplType::CLIENT_PREDICTED, &ReplLayoutTestState::position>(&state),
+		ReplFromState<ReplType::DEFAULT, &ReplLayoutTestState::ahead>(&state),
+		ReplFromState<ReplType::DEFAULT, &ReplLayoutTestState::health>(&state),
+		ReplFromState<ReplType::DEFAULT, &ReplLayoutTestState::kills>(&state));
+
+	const uint32_t size = desc->GetReplicatedSize(nullptr);
+	const auto serialize = [&]() -> std::string {
+		std::string bytes(size, '\0');
+		EXPECT_EQ(desc->Write(nullptr, Netcode::MutableArrayView<uint8_t>{ reinterpret_cast<uint8_t *>(bytes.data()), bytes.size() }), size);
+		return bytes;
+	};
+
+	const std::string baseline = serialize();
+	std::string delta;
+	std::string decoded;
+
+	// an unchanged state is an empty delta
+	ASSERT_TRUE(ReplicateDeltaWrite(*desc, ToArrayView(baseline), ToArrayView(baseline), delta));
+	EXPECT_TRUE(delta.empty());
+	ASSERT_TRUE(ReplicateDeltaRead(*desc, ToArrayView(baseline), ToArrayView(delta), decoded));
+	EXPECT_EQ(decoded, baseline);
+
+	// a moving object only carries the mask and its position
+	state.position.x += 1.5f;
+	const std::string moved = serialize();
+	ASSERT_TRUE(ReplicateDeltaWrite(*desc, ToArrayView(baseline), ToArrayView(moved), delta));
+	EXPECT_EQ(delta.size(), 1u + sizeof(Netcode::Float3));
+	ASSERT_TRUE(ReplicateDeltaRead(*desc, ToArrayView(baseline), ToArrayView(delta), decoded));
+	EXPECT_EQ(decoded, moved);
+
+	// the first and the last field changed, the fields between them come from the baseline
+	state.kills = 4;
+	const std::string scored = serialize();
+	ASSERT_TRUE(ReplicateDeltaWrite(*desc, ToArrayView(baseline), ToArrayView(scored), delta));
+	EXPECT_EQ(static_cast<uint8_t>(delta[0]), 0x9u);
+	ASSERT_TRUE(ReplicateDeltaRead(*desc, ToArrayView(baseline), ToArrayView(delta), decoded));
+	EXPECT_EQ(decoded, scored);
+
+	// truncated inputs fall back to a full state instead of producing garbage
+	const std::string truncated = baseline.substr(0, size - 1);
+	EXPECT_FALSE(ReplicateDeltaWrite(*desc, ToArrayView(truncated), ToArrayView(scored), delta));
+	ASSERT_TRUE(ReplicateDeltaWrite(*desc, ToArrayView(baseline), ToArrayView(scored), delta));
+	EXPECT_FALSE(ReplicateDeltaRead(*desc, ToArrayView(baseline), ToArrayView(delta.substr(0, delta.size() - 1)), decoded));
+	EXPECT_FALSE(ReplicateDeltaRead(*desc, ToArrayView(truncated), ToArrayView(delta), decoded));
+
+	// bytes of a walking player acknowledged every update, the occasional kill changes a second field
+	constexpr uint32_t numUpdates = 1000;
+	size_t fullBytes = 0;
+	size_t deltaBytes = 0;
+	std::string previous = serialize();
+
+	for(uint32_t i = 0; i < numUpdates; i++) {
+		state.position.x += 0.25f;
+		state.kills += (i % 100 == 0) ? 1 : 0;
+
+		const std::string current = serialize();
+		ASSERT_TRUE(ReplicateDeltaWrite(*desc, ToArrayView(previous), ToArrayView(current), delta));
+		ASSERT_TRUE(ReplicateDeltaRead(*desc, ToArrayView(previous), ToArrayView(delta), decoded));
+		ASSERT_EQ(decoded, current);
+
+		fullBytes += current.size();
+		deltaBytes += delta.size();
+		previous = current;
+	}
+
+	EXPECT_LT(deltaBytes * 2, fullBytes);
+	RecordProperty("fullBytes", static_cast<int>(fullBytes));
+	RecordProperty("deltaBytes", static_cast<int>(deltaBytes));
+}
+
+TEST(Replication, BaselineHistory) {
+	constexpr uint32_t numSnapshots = 4;
+	ReplBaselineHistory history{ numSnapshots };
+
+	const auto makeSnapshot = [](std::initializer_list<uint32_t> objectIds, uint8_t value) -> Ref<const ReplSnapshot> {
+		Ref<ReplSnapshot> snapshot = std::make_shared<ReplSnapshot>();
+		for(uint32_t objectId : objectIds) {
+			const uint8_t content[2] = { static_cast<uint8_t>(objectId), value };
+			snapshot->Add(objectId, Netcode::ArrayView<uint8_t>{ content, sizeof(content) });
+		}
+		return snapshot;
+	};
+
+	uint32_t baselineSequence = 0;
+
+	// nothing is acknowledged yet, every object is sent in full
+	history.Store(1, makeSnapshot({ 10, 20 }, 1));
+	EXPECT_EQ(history.FindBaseline(2, 10, baselineSequence), nullptr);
+
+	history.Acknowledge(1);
+	const ReplSnapshot * baseline = history.FindBaseline(2, 10, baselineSequence);
+	ASSERT_NE(baseline, nullptr);
+	EXPECT_EQ(baselineSequence, 1u);
+
+	// the shared snapshot of update 2 has object 20, but it was not sent to this connection
+	history.Store(2, makeSnapshot({ 10, 20 }, 2), std::vector<uint32_t>{ 10 });
+	history.Acknowledge(2);
+
+	ASSERT_NE(history.FindBaseline(3, 10, baselineSequence), nullptr);
+	EXPECT_EQ(baselineSequence, 2u);
+	ASSERT_NE(history.FindBaseline(3, 20, baselineSequence), nullptr);
+	EXPECT_EQ(baselineSequence, 1u);
+
+	// an object that was never acknowledged has no baseline
+	EXPECT_EQ(history.FindBaseline(3, 30, baselineSequence), nullptr);
+
+	// a late acknowledgement of an older update does not move the baseline back
+	history.Store(3, makeSnapshot({ 10, 20, 30 }, 3));
+	history.Acknowledge(1);
+	EXPECT_EQ(history.GetAcknowledgedSequence(), 2u);
+	ASSERT_NE(history.FindBaseline(4, 10, baselineSequence), nullptr);
+	EXPECT_EQ(baselineSequence, 2u);
+
+	history.Acknowledge(3);
+	ASSERT_NE(history.FindBaseline(4, 30, baselineSequence), nullptr);
+	EXPECT_EQ(baselineSequence, 3u);
+
+	// object 20 was last acknowledged in update 1, it is evicted once the ring wraps around
+	for(uint32_t sequence = 4; sequence < 4 + numSnapshots; sequence++) {
+		history.Store(sequence, makeSnapshot({ 10, 30 }, static_cast<uint8_t>(sequence)));
+	}
+
+	EXPECT_EQ(history.Find(1), nullptr);
+	EXPECT_EQ(history.FindBaseline(8, 20, baselineSequence), nullptr);
+	// the acknowledged update itself was evicted by now as well
+	EXPECT_EQ(history.Find(3), nullptr);
+	EXPECT_EQ(history.FindBaseline(8, 10, baselineSequence), nullptr);
+
+	// acknowledging an update that is still stored gives new baselines
+	history.Acknowledge(4);
+	ASSERT_NE(history.FindBaseline(8, 10, baselineSequence), nullptr);
+	EXPECT_EQ(baselineSequence, 4u);
+
+	// an acknowledgement that arrives after its update was evicted only moves the acknowledged sequence
+	for(uint32_t sequence = 8; sequence < 8 + numSnapshots; sequence++) {
+		history.Store(sequence, makeSnapshot({ 10, 30 }, static_cast<uint8_t>(sequence)));
+	}
+
+	history.Acknowledge(5);
+	EXPECT_EQ(history.GetAcknowledgedSequence(), 5u);
+	EXPECT_EQ(history.FindBaseline(12, 10, baselineSequence), nullptr);
+
+	// baselines older than the window are not used even if the snapshot is still stored
+	history.Acknowledge(11);
+	ASSERT_NE(history.FindBaseline(11 + ReplBaselineHistory::BASELINE_WINDOW, 10, baselineSequence), nullptr);
+	EXPECT_EQ(baselineSequence, 11u);
+	EXPECT_EQ(history.FindBaseline(11 + ReplBaselineHistory::BASELINE_WINDOW + 1, 10, baselineSequence), nullptr);
+}
+
+TEST(Replication, InterestGrid) {
+	std::mt19937 rng{ 42 };
+
+	const auto bruteForce = [](const std::vector<Netcode::Float3> & positions, const Netcode::Float3 & center, float radius) -> std::vector<uint32_t> {
+		std::vector<uint32_t> indices;
+		for(uint32_t i = 0; i < static_cast<uint32_t>(positions.size()); i++) {
+			const float dx = positions[i].x - center.x;
+			const float dy = positions[i].y - center.y;
+			const float dz = positions[i].z - center.z;
+			if(dx * dx + dy * dy + dz * dz <= radius * radius) {
+				indices.push_back(i);
+			}
+		}
+		return indices;
+	};
+
+	const auto query = [](const InterestGrid & grid, const Netcode::Float3 & center, float radius) -> std::vector<uint32_t> {
+		std::vector<uint32_t> indices;
+		grid.Query(center, radius, indices);
+		std::sort(std::begin(indices), std::end(indices));
+		return indices;
+	};
+
+	{
+		// far more occupied cells than buckets: cells share buckets, negative coordinates are half of the world
+		InterestConfig config;
+		config.cellSize = 100.0f;
+		config.relevanceRadius = 250.0f;
+		InterestGrid grid{ config };
+
+		std::uniform_real_distribution<float> coord{ -5000.0f, 5000.0f };
+		std::vector<Netcode::Float3> positions;
+
+		grid.Clear();
+		for(uint32_t i = 0; i < 5000; i++) {
+			positions.push_back(Netcode::Float3{ coord(rng), coord(rng), coord(rng) });
+			grid.Add(i + 1, positions.back());
+		}
+		grid.Build();
+
+		uint32_t numFound = 0;
+		for(uint32_t i = 0; i < 200; i++) {
+			// half of the queries are centered on an object so they are not all empty
+			const Netcode::Float3 center = (i % 2 == 0) ? positions[i] : Netcode::Float3{ coord(rng), coord(rng), coord(rng) };
+			const std::vector<uint32_t> expected = bruteForce(positions, center, config.relevanceRadius);
+			EXPECT_EQ(query(grid, center, config.relevanceRadius), expected);
+			numFound += static_cast<uint32_t>(expected.size());
+		}
+		EXPECT_GE(numFound, 100u);
+
+		// objects on both sides of the origin, in the cells around it
+		grid.Clear();
+		positions = { Netcode::Float3{ -0.5f, -0.5f, -0.5f }, Netcode::Float3{ 0.5f, 0.5f, 0.5f }, Netcode::Float3{ -99.5f, 0.0f, 0.0f },
+			Netcode::Float3{ -100.5f, 0.0f, 0.0f }, Netcode::Float3{ 0.0f, -240.0f, 0.0f }, Netcode::Float3{ 0.0f, 0.0f, -260.0f } };
+		for(uint32_t i = 0; i < static_cast<uint32_t>(positions.size()); i++) {
+			grid.Add(i + 1, positions[i]);
+		}
+		grid.Build();
+
+		EXPECT_EQ(query(grid, Netcode::Float3{ 0.0f, 0.0f, 0.0f }, 250.0f), (std::vector<uint32_t>{ 0, 1, 2, 3, 4 }));
+		EXPECT_EQ(query(grid, Netcode::Float3{ -100.0f, 0.0f, 0.0f }, 1.0f), (std::vector<uint32_t>{ 2, 3 }));
+	}
+
+	{
+		// the sphere covers more cells than there are objects, the linear scan gives the same result
+		InterestConfig config;
+		config.cellSize = 10.0f;
+		config.relevanceRadius = 1000.0f;
+		InterestGrid grid{ config };
+
+		const std::vector<Netcode::Float3> positions = { Netcode::Float3{ 0.0f, 0.0f, 0.0f }, Netcode::Float3{ -999.0f, 0.0f, 0.0f },
+			Netcode::Float3{ 0.0f, 0.0f, 1001.0f } };
+
+		grid.Clear();
+		for(uint32_t i = 0; i < static_cast<uint32_t>(positions.size()); i++) {
+			grid.Add(i + 1, positions[i]);
+		}
+		grid.Build();
+
+		EXPECT_EQ(query(grid, Netcode::Float3{ 0.0f, 0.0f, 0.0f }, config.relevanceRadius), (std::vector<uint32_t>{ 0, 1 }));
+	}
+
+	{
+		InterestConfig config;
+		config.cellSize = 1000.0f;
+		config.relevanceRadius = 1000.0f;
+		InterestGrid grid{ config };
+		InterestSet interestSet;
+
+		// the viewer's own object is relevant even where the PVS test rejects everything
+		grid.SetPvsFunction([](const Netcode::Float3 &, const Netcode::Float3 &) -> bool { return false; });
+
+		grid.Clear();
+		grid.Add(1, Netcode::Float3{ 0.0f, 0.0f, 0.0f });
+		grid.Add(2, Netcode::Float3{ 10.0f, 0.0f, 0.0f });
+		grid.Build();
+
+		grid.UpdateInterest(interestSet, 1, Netcode::Float3{ 0.0f, 0.0f, 0.0f }, 1);
+		EXPECT_TRUE(interestSet.IsRelevant(1));
+		EXPECT_FALSE(interestSet.IsRelevant(2));
+
+		// also when the viewer is out of its own radius, eg. the position is from an older tick
+		grid.UpdateInterest(interestSet, 2, Netcode::Float3{ 50000.0f, 0.0f, 0.0f }, 1);
+		EXPECT_TRUE(interestSet.IsRelevant(1));
+		EXPECT_EQ(interestSet.GetRelevantSince(1), 1u);
+
+		// a viewer without an object in the grid gets nothing forced in
+		grid.UpdateInterest(interestSet, 3, Netcode::Float3{ 0.0f, 0.0f, 0.0f }, 7);
+		EXPECT_FALSE(interestSet.IsRelevant(7));
+		EXPECT_EQ(interestSet.GetLeft(), (std::vector<uint32_t>{ 1 }));
+
+		grid.SetPvsFunction(nullptr);
+		interestSet.Clear();
+
+		// enter and leave events are the difference of two consecutive sets
+		grid.Clear();
+		grid.Add(1, Netcode::Float3{ 0.0f, 0.0f, 0.0f });
+		grid.Add(2, Netcode::Float3{ 500.0f, 0.0f, 0.0f });
+		grid.Add(3, Netcode::Float3{ -500.0f, 0.0f, 0.0f });
+		grid.Add(4, Netcode::Float3{ 5000.0f, 0.0f, 0.0f });
+		grid.Build();
+
+		grid.UpdateInterest(interestSet, 10, Netcode::Float3{ 0.0f, 0.0f, 0.0f }, 1);
+		EXPECT_EQ(interestSet.GetEntered(), (std::vector<uint32_t>{ 1, 2, 3 }));
+		EXPECT_TRUE(interestSet.GetLeft().empty());
+
+		grid.Clear();
+		grid.Add(1, Netcode::Float3{ 0.0f, 0.0f, 0.0f });
+		grid.Add(2, Netcode::Float3{ 1500.0f, 0.0f, 0.0f });
+		grid.Add(3, Netcode::Float3{ -600.0f, 0.0f, 0.0f });
+		grid.Add(4, Netcode::Float3{ 900.0f, 0.0f, 0.0f });
+		grid.Add(5, Netcode::Float3{ 0.0f, -1.0f, 0.0f });
+		grid.Build();
+
+		grid.UpdateInterest(interestSet, 11, Netcode::Float3{ 0.0f, 0.0f, 0.0f }, 1);
+		EXPECT_EQ(interestSet.GetEntered(), (std::vector<uint32_t>{ 4, 5 }));
+		EXPECT_EQ(interestSet.GetLeft(), (std::vector<uint32_t>{ 2 }));
+		EXPECT_EQ(interestSet.GetRelevantSince(3), 10u);
+		EXPECT_EQ(interestSet.GetRelevantSince(4), 11u);
+		EXPECT_EQ(interestSet.GetRelevantSince(2), 0u);
+
+		// an unchanged set has no events
+		grid.UpdateInterest(interestSet, 12, Netcode::Float3{ 0.0f, 0.0f, 0.0f }, 1);
+		EXPECT_TRUE(interestSet.GetEntered().empty());
+		EXPECT_TRUE(interestSet.GetLeft().empty());
+	}
+}
+
+TEST(Replication, PriorityAccumulator) {
+	PriorityAccumulator accumulator;
+
+	// priorities grow while an object is not sent and restart from zero when it is
+	EXPECT_FLOAT_EQ(accumulator.Accumulate(5, 1.0f), 1.0f);
+	EXPECT_FLOAT_EQ(accumulator.Accumulate(5, 0.5f), 1.5f);
+	EXPECT_FLOAT_EQ(accumulator.Accumulate(3, 2.0f), 2.0f);
+	accumulator.Reset(5);
+	accumulator.Reset(42);
+	EXPECT_FLOAT_EQ(accumulator.Accumulate(5, 1.0f), 1.0f);
+	EXPECT_FLOAT_EQ(accumulator.Accumulate(3, 2.0f), 4.0f);
+
+	// an object that was not accumulated since the last RemoveStale is forgotten
+	accumulator.RemoveStale();
+	accumulator.Accumulate(3, 1.0f);
+	accumulator.RemoveStale();
+	EXPECT_FLOAT_EQ(accumulator.Accumulate(5, 1.0f), 1.0f);
+	EXPECT_FLOAT_EQ(accumulator.Accumulate(3, 1.0f), 6.0f);
+
+	accumulator.Clear();
+	EXPECT_FLOAT_EQ(accumulator.Accumulate(3, 1.0f), 1.0f);
+
+	// the first candidate is taken even if it alone exceeds the budget
+	std::vector<PriorityCandidate> candidates = { PriorityCandidate{ 0, 2000, 1.0f } };
+	EXPECT_EQ(SelectByPriority(candidates, 1000), 1u);
+	EXPECT_EQ(SelectByPriority(candidates, 0), 1u);
+
+	candidates.clear();
+	EXPECT_EQ(SelectByPriority(candidates, 1000), 0u);
+
+	// the ones that do not fit are skipped, smaller ones of lower priority fill the rest of the budget
+	candidates = { PriorityCandidate{ 0, 300, 1.0f }, PriorityCandidate{ 1, 800, 2.0f }, PriorityCandidate{ 2, 500, 3.0f },
+		PriorityCandidate{ 3, 100, 0.5f }, PriorityCandidate{ 4, 200, 0.25f } };
+	ASSERT_EQ(SelectByPriority(candidates, 1000), 3u);
+	EXPECT_EQ(candidates[0].index, 2u);
+	EXPECT_EQ(candidates[1].index, 0u);
+	EXPECT_EQ(candidates[2].index, 3u);
+
+	// exactly filling the budget is allowed
+	candidates = { PriorityCandidate{ 0, 600, 2.0f }, PriorityCandidate{ 1, 400, 1.0f } };
+	EXPECT_EQ(SelectByPriority(candidates, 1000), 2u);
+
+	// one near object and far ones competing for a budget of one object per tick: the far ones are not starved
+	PriorityConfig config;
+	config.distanceFalloff = 2000.0f;
+
+	constexpr uint32_t numObjects = 4;
+	constexpr uint32_t numTicks = 200;
+	const float distances[numObjects] = { 0.0f, 20000.0f, 30000.0f, 40000.0f };
+	uint32_t numSends[numObjects] = {};
+	uint32_t lastSentAt[numObjects] = {};
+	uint32_t maxGap[numObjects] = {};
+
+	accumulator.Clear();
+
+	for(uint32_t tick = 1; tick <= numTicks; tick++) {
+		candidates.clear();
+
+		for(uint32_t i = 0; i < numObjects; i++) {
+			const float priority = accumulator.Accumulate(i + 1, config.Evaluate(1.0f, distances[i], 0.05f));
+			candidates.push_back(PriorityCandidate{ i, 100, priority });
+		}
+
+		accumulator.RemoveStale();
+
+		ASSERT_EQ(SelectByPriority(candidates, 100), 1u);
+
+		const uint32_t sent = candidates[0].index;
+		accumulator.Reset(sent + 1);
+		maxGap[sent] = std::max(maxGap[sent], tick - lastSentAt[sent]);
+		lastSentAt[sent] = tick;
+		numSends[sent]++;
+	}
+
+	for(uint32_t i = 0; i < numObjects; i++) {
+		maxGap[i] = std::max(maxGap[i], numTicks + 1 - lastSentAt[i]);
+		EXPECT_GT(numSends[i], 0u);
+		// the farthest object gains a twenty-first of the near one's priority a tick
+		EXPECT_LE(maxGap[i], 30u);
+	}
+
+	// closer objects are sent more often
+	EXPECT_GT(numSends[0], numSends[1]);
+	EXPECT_GT(numSends[1], numSends[3]);
+}
+
+TEST(Network, RedundancyRing) {
+	struct Item {
+		uint32_t sequence;
+		uint32_t value;
+		std::vector<uint8_t> payload;
+	};
+
+	const auto sequencesOf = [](const RedundancyRing<Item> & ring) -> std::vector<uint32_t> {
+		std::vector<uint32_t> sequences;
+		ring.Foreach([&sequences](const Item & item) -> void {
+			sequences.push_back(item.sequence);
+		});
+		return sequences;
+	};
+
+	const auto push = [](RedundancyRing<Item> & ring, uint32_t sequence) -> void {
+		Item & item = ring.Push(sequence);
+		item.value = 3 * sequence;
+		item.payload.assign(1 + sequence % 7, static_cast<uint8_t>(sequence));
+	};
+
+	const auto isIntact = [](const RedundancyRing<Item> & ring) -> bool {
+		bool intact = true;
+		ring.Foreach([&intact](const Item & item) -> void {
+			intact = intact && item.value == 3 * item.sequence &&
+				item.payload == std::vector<uint8_t>(1 + item.sequence % 7, static_cast<uint8_t>(item.sequence));
+		});
+		return intact;
+	};
+
+	constexpr uint32_t capacity = RedundancyRing<Item>::INITIAL_CAPACITY;
+
+	RedundancyRing<Item> ring;
+	ring.Confirm(100);
+	EXPECT_EQ(ring.GetCount(), 0u);
+
+	// wraparound: while the remote keeps acknowledging, the slots are reused and the ring does not grow
+	uint32_t sequence = 1;
+
+	for(uint32_t round = 0; round < 10; round++) {
+		for(uint32_t i = 0; i < capacity - 4; i++) {
+			push(ring, sequence++);
+		}
+
+		ASSERT_EQ(ring.GetCount(), (round == 0) ? capacity - 4 : capacity);
+		ring.Confirm(sequence - 5);
+
+		ASSERT_EQ(ring.GetCapacity(), capacity);
+		ASSERT_EQ(sequencesOf(ring), (std::vector<uint32_t>{ sequence - 4, sequence - 3, sequence - 2, sequence - 1 }));
+		ASSERT_TRUE(isIntact(ring));
+	}
+
+	// grow when full: the front is in the middle of the slots, the items keep their order and their members
+	ring.Confirm(sequence);
+	ASSERT_EQ(ring.GetCount(), 0u);
+
+	const uint32_t firstSequence = sequence;
+
+	for(uint32_t i = 0; i < capacity; i++) {
+		push(ring, sequence++);
+	}
+
+	ASSERT_EQ(ring.GetCapacity(), capacity);
+	push(ring, sequence++);
+	push(ring, sequence++);
+	ASSERT_EQ(ring.GetCapacity(), 2 * capacity);
+	ASSERT_EQ(ring.GetCount(), capacity + 2);
+
+	std::vector<uint32_t> expected;
+	for(uint32_t s = firstSequence; s < sequence; s++) {
+		expected.push_back(s);
+	}
+
+	EXPECT_EQ(sequencesOf(ring), expected);
+	EXPECT_TRUE(isIntact(ring));
+
+	// confirm: removes every item up to and including the acknowledged sequence, an older ack changes nothing
+	ring.Confirm(firstSequence - 1);
+	EXPECT_EQ(ring.GetCount(), capacity + 2);
+
+	ring.Confirm(firstSequence + 9);
+	EXPECT_EQ(ring.GetCount(), capacity - 8);
+	EXPECT_EQ(sequencesOf(ring).front(), firstSequence + 10);
+
+	ring.Confirm(firstSequence + 9);
+	EXPECT_EQ(ring.GetCount(), capacity - 8);
+	EXPECT_TRUE(isIntact(ring));
+
+	// several items of the same update share a sequence, they are confirmed together
+	ring.Confirm(sequence);
+	push(ring, sequence);
+	push(ring, sequence);
+	push(ring, sequence + 1);
+
+	ring.Confirm(sequence);
+	EXPECT_EQ(sequencesOf(ring), (std::vector<uint32_t>{ sequence + 1 }));
+
+	ring.Confirm(sequence + 1000);
+	EXPECT_EQ(ring.GetCount(), 0u);
+	EXPECT_EQ(ring.GetCapacity(), 2 * capacity);
+}
+
+// shaped like delta encoded snapshots: small position deltas, mostly unchanged fields, a repeated state
+static std::vector<uint8_t> MakeRangeCoderTestPayload(std::mt19937 & rng) {
+	std::geometric_distribution<uint32_t> small{ 0.35 };
+	std::uniform_int_distribution<uint32_t> byteDist{ 0, 255 };
+	std::uniform_int_distribution<uint32_t> percent{ 0, 99 };
+
+	std::vector<uint8_t> payload;
+	payload.push_back(0x07);
+	for(uint32_t i = 0; i < 6; i++) {
+		payload.push_back(static_cast<uint8_t>(std::min(small(rng), 255u)));
+	}
+	for(uint32_t i = 0; i < 8; i++) {
+		payload.push_back((percent(rng) < 90) ? 0 : static_cast<uint8_t>(byteDist(rng)));
+	}
+	payload.push_back((percent(rng) < 95) ? 100 : static_cast<uint8_t>(byteDist(rng) % 100));
+	payload.push_back(static_cast<uint8_t>(percent(rng) % 4));
+	payload.push_back(static_cast<uint8_t>(byteDist(rng)));
+	return payload;
+}
+
+TEST(Network, RangeCoder) {
+	namespace nn = Netcode::Network;
+
+	std::mt19937 rng{ 38 };
+
+	// the bare coder on skewed bits, with and without trailing zeros
+	{
+		std::bernoulli_distribution skewed{ 0.05 };
+		std::vector<uint32_t> bits(4096);
+		for(uint32_t & b : bits) {
+			b = skewed(rng) ? 1 : 0;
+		}
+
+		std::vector<uint8_t> coded(1024);
+		uint16_t probability = nn::RangeEncoder::PROBABILITY_HALF;
+		nn::RangeEncoder encoder{ Netcode::MutableArrayView<uint8_t>{ coded.data(), coded.size() } };
+		for(uint32_t b : bits) {
+			encoder.EncodeBit(probability, b);
+		}
+		encoder.Flush();
+		ASSERT_FALSE(encoder.HasOverflowed());
+		EXPECT_LT(encoder.GetSize(), bits.size() / 8 / 2);
+
+		probability = nn::RangeEncoder::PROBABILITY_HALF;
+		nn::RangeDecoder decoder{ Netcode::ArrayView<uint8_t>{ coded.data(), encoder.GetSize() } };
+		for(uint32_t b : bits) {
+			ASSERT_EQ(decoder.DecodeBit(probability), b);
+		}
+
+		uint8_t tiny[2];
+		uint16_t p = nn::RangeEncoder::PROBABILITY_HALF;
+		nn::RangeEncoder small{ Netcode::MutableArrayView<uint8_t>{ tiny, sizeof(tiny) } };
+		for(uint32_t i = 0; i < 64; i++) {
+			small.EncodeBit(p, i & 1);
+		}
+		small.Flush();
+		EXPECT_TRUE(small.HasOverflowed());
+	}
+
+	std::vector<std::vector<uint8_t>> training;
+	std::vector<std::vector<uint8_t>> samples;
+	for(uint32_t i = 0; i < 4096; i++) {
+		training.emplace_back(MakeRangeCoderTestPayload(rng));
+		samples.emplace_back(MakeRangeCoderTestPayload(rng));
+	}
+
+	nn::ReplicationModelTrainer trainer;
+	for(const std::vector<uint8_t> & t : training) {
+		trainer.Add(Netcode::ArrayView<uint8_t>{ t.data(), t.size() });
+	}
+	const nn::ReplicationModel model = trainer.Build();
+	EXPECT_EQ(trainer.GetNumBytes(), 4096u * training.front().size());
+	EXPECT_NE(model.GetId(), nn::ReplicationModel{}.GetId());
+
+	const std::vector<uint8_t> serialized = model.Serialize();
+	nn::ReplicationModel loaded;
+	ASSERT_TRUE(loaded.Deserialize(Netcode::ArrayView<uint8_t>{ serialized.data(), serialized.size() }));
+	EXPECT_EQ(loaded.GetProbabilities(), model.GetProbabilities());
+	EXPECT_EQ(loaded.GetId(), model.GetId());
+
+	nn::ReplicationModel rejected;
+	EXPECT_FALSE(rejected.Deserialize(Netcode::ArrayView<uint8_t>{ serialized.data(), serialized.size() - 1 }));
+	std::vector<uint8_t> badMagic = serialized;
+	badMagic[0] = 'X';
+	EXPECT_FALSE(rejected.Deserialize(Netcode::ArrayView<uint8_t>{ badMagic.data(), badMagic.size() }));
+	EXPECT_EQ(rejected.GetId(), nn::ReplicationModel{}.GetId());
+
+	nn::ReplicationCoder coder{ loaded };
+	EXPECT_EQ(coder.GetModelId(), model.GetId());
+
+	size_t rawBytes = 0;
+	size_t codedBytes = 0;
+	std::vector<uint8_t> decoded;
+
+	for(const std::vector<uint8_t> & s : samples) {
+		const Netcode::ArrayView<uint8_t> raw{ s.data(), s.size() };
+		const Netcode::ArrayView<uint8_t> coded = coder.Encode(raw);
+		rawBytes += s.size();
+
+		if(coded.Size() == 0) {
+			codedBytes += s.size();
+			continue;
+		}
+
+		ASSERT_LT(coded.Size(), s.size());
+		codedBytes += coded.Size();
+
+		decoded.assign(s.size(), 0xCC);
+		ASSERT_TRUE(coder.Decode(coded, Netcode::MutableArrayView<uint8_t>{ decoded.data(), decoded.size() }));
+		ASSERT_EQ(decoded, s);
+	}
+
+	// every payload starts from the trained model, coding it again gives the same bytes
+	const Netcode::ArrayView<uint8_t> first = coder.Encode(Netcode::ArrayView<uint8_t>{ samples[0].data(), samples[0].size() });
+	const std::vector<uint8_t> firstCopy{ first.Data(), first.Data() + first.Size() };
+	coder.Encode(Netcode::ArrayView<uint8_t>{ samples[1].data(), samples[1].size() });
+	const Netcode::ArrayView<uint8_t> again = coder.Encode(Netcode::ArrayView<uint8_t>{ samples[0].data(), samples[0].size() });
+	EXPECT_EQ(std::vector<uint8_t>(again.Data(), again.Data() + again.Size()), firstCopy);
+
+	const double ratio = static_cast<double>(codedBytes) / static_cast<double>(rawBytes);
+	RecordProperty("compressionRatioPercent", static_cast<int>(ratio * 100.0));
+	EXPECT_LT(ratio, 0.6);
+
+	// noise does not compress, it is sent as is
+	std::uniform_int_distribution<uint32_t> byteDist{ 0, 255 };
+	std::vector<uint8_t> noise(64);
+	for(uint8_t & b : noise) {
+		b = static_cast<uint8_t>(byteDist(rng));
+	}
+	EXPECT_EQ(coder.Encode(Netcode::ArrayView<uint8_t>{ noise.data(), noise.size() }).Size(), 0u);
+
+	std::vector<uint8_t> oversized(nn::ReplicationCoder::MAX_PAYLOAD_SIZE + 1, 0);
+	EXPECT_EQ(coder.Encode(Netcode::ArrayView<uint8_t>{ oversized.data(), oversized.size() }).Size(), 0u);
+	EXPECT_FALSE(coder.Decode(Netcode::ArrayView<uint8_t>{ nullptr, 0 }, Netcode::MutableArrayView<uint8_t>{ oversized.data(), oversized.size() }));
+
+	// a 64 player server at 60 Hz codes up to 64 objects for every client on every tick
+	constexpr uint32_t requiredPayloadsPerSecond = 64 * 64 * 60;
+	constexpr uint32_t numPayloads = 1 << 18;
+	size_t sink = 0;
+
+	Netcode::Stopwatch sw;
+	sw.Start();
+	for(uint32_t i = 0; i < numPayloads; i++) {
+		const std::vector<uint8_t> & s = samples[i % samples.size()];
+		sink += coder.Encode(Netcode::ArrayView<uint8_t>{ s.data(), s.size() }).Size();
+	}
+	sw.Stop();
+	const double encodeSeconds = std::chrono::duration<double>(sw.GetElapsedDuration()).count();
+
+	std::vector<std::vector<uint8_t>> codedSamples;
+	for(const std::vector<uint8_t> & s : samples) {
+		const Netcode::ArrayView<uint8_t> coded = coder.Encode(Netcode::ArrayView<uint8_t>{ s.data(), s.size() });
+		codedSamples.emplace_back(coded.Data(), coded.Data() + coded.Size());
+	}
+
+	sw.Reset();
+	sw.Start();
+	for(uint32_t i = 0; i < numPayloads; i++) {
+		const std::vector<uint8_t> & c = codedSamples[i % codedSamples.size()];
+		decoded.resize(samples[i % samples.size()].size());
+		coder.Decode(Netcode::ArrayView<uint8_t>{ c.data(), c.size() }, Netcode::MutableArrayView<uint8_t>{ decoded.data(), decoded.size() });
+		sink += decoded[0];
+	}
+	sw.Stop();
+	const double decodeSeconds = std::chrono::duration<double>(sw.GetElapsedDuration()).count();
+
+	const double encodesPerSecond = numPayloads / std::max(encodeSeconds, 1e-6);
+	const double decodesPerSecond = numPayloads / std::max(decodeSeconds, 1e-6);
+	RecordProperty("encodedPayloadsPerSecond", static_cast<int>(encodesPerSecond));
+	RecordProperty("decodedPayloadsPerSecond", static_cast<int>(decodesPerSecond));
+	EXPECT_GT(sink, 0u);
+
+#if defined(NDEBUG)
+	EXPECT_GT(encodesPerSecond, requiredPayloadsPerSecond);
+	EXPECT_GT(decodesPerSecond, requiredPayloadsPerSecond);
+#endif
+}
+
+TEST(Network, TrafficRecording) {
+	namespace nn = Netcode::Network;
+
+	const std::vector<uint8_t> gameContent{ 0xF7, 0x02, 0x00, 0x11, 0x22 };
+	const std::vector<uint8_t> controlContent(300, 0x5A);
+
+	std::vector<nn::TrafficRecord> records(5);
+	records[0].type = nn::TrafficRecordType::TICK;
+	records[0].timestamp = Netcode::Timestamp{} + std::chrono::milliseconds(1500) + std::chrono::nanoseconds(7);
+	records[1].type = nn::TrafficRecordType::GAME_MESSAGE;
+	records[1].connectionId = 3;
+	records[1].sequence = 70000;
+	records[1].content = Netcode::ArrayView<uint8_t>{ gameContent.data(), gameContent.size() };
+	records[2].type = nn::TrafficRecordType::CONTROL_MESSAGE;
+	records[2].connectionId = 200;
+	records[2].content = Netcode::ArrayView<uint8_t>{ controlContent.data(), controlContent.size() };
+	records[3].type = nn::TrafficRecordType::CONNECT;
+	records[3].connectionId = 4;
+	records[4].type = nn::TrafficRecordType::TICK;
+	records[4].timestamp = Netcode::Timestamp{} + std::chrono::milliseconds(2000);
+
+	nn::TrafficRecordWriter writer;
+	writer.WriteHeader();
+	for(const nn::TrafficRecord & r : records) {
+		writer.Write(r);
+	}
+
+	const std::vector<uint8_t> recording{ writer.GetBuffer().Data(), writer.GetBuffer().Data() + writer.GetBuffer().Size() };
+
+	nn::TrafficRecordReader reader{ Netcode::ArrayView<uint8_t>{ recording.data(), recording.size() } };
+	nn::TrafficRecord r;
+	for(const nn::TrafficRecord & expected : records) {
+		ASSERT_TRUE(reader.Next(r));
+		EXPECT_EQ(r.type, expected.type);
+
+		if(expected.type == nn::TrafficRecordType::TICK) {
+			EXPECT_EQ(r.timestamp, expected.timestamp);
+			continue;
+		}
+
+		EXPECT_EQ(r.connectionId, expected.connectionId);
+		EXPECT_EQ(r.sequence, expected.sequence);
+		EXPECT_EQ(std::vector<uint8_t>(r.content.Data(), r.content.Data() + r.content.Size()),
+			std::vector<uint8_t>(expected.content.Data(), expected.content.Data() + expected.content.Size()));
+	}
+	EXPECT_FALSE(reader.Next(r));
+	EXPECT_FALSE(reader.HasFailed());
+
+	// a recording cut off by a crash replays up to the last whole record
+	nn::TrafficRecordReader truncated{ Netcode::ArrayView<uint8_t>{ recording.data(), recording.size() - 100 } };
+	EXPECT_TRUE(truncated.Next(r));
+	EXPECT_TRUE(truncated.Next(r));
+	EXPECT_FALSE(truncated.Next(r));
+	EXPECT_TRUE(truncated.HasFailed());
+
+	std::vector<uint8_t> badHeader = recording;
+	badHeader[4] = 0xFF;
+	nn::TrafficRecordReader badVersion{ Netcode::ArrayView<uint8_t>{ badHeader.data(), badHeader.size() } };
+	EXPECT_FALSE(badVersion.Next(r));
+	EXPECT_TRUE(badVersion.HasFailed());
+
+	nn::TrafficRecordWriter empty;
+	empty.WriteHeader();
+	nn::TrafficRecordReader emptyReader{ empty.GetBuffer() };
+	EXPECT_FALSE(emptyReader.Next(r));
+	EXPECT_FALSE(emptyReader.HasFailed());
+
+	// replayed ticks advance the clock by the recorded deltas
+	Netcode::GameClock clock;
+	clock.Tick(records[0].timestamp);
+	clock.Tick(records[4].timestamp);
+	EXPECT_EQ(clock.GetLocalTime(), records[4].timestamp);
+	EXPECT_EQ(clock.GetDeltaTime(), records[4].timestamp - records[0].timestamp);
+}
+
+/*
+ * The array of structs HistoryBuffer the server used before, kept as the reference of the lookup
+ */
+template<typename T>
+class ReferenceHistoryBuffer {
+	struct Item {
+		Netcode::Timestamp timestamp;
+		T value;
+	};
+
+	std::unique_ptr<Item[]> data;
+	int32_t index;
+	int32_t size;
+	int32_t capacity;
+
+public:
+	ReferenceHistoryBuffer(int32_t numElements) : data{ std::make_unique<Item[]>(numElements) }, index{ 0 }, size{ 0 }, capacity{ numElements } { }
+
+	void Insert(Netcode::Timestamp timestamp, const T & value) {
+		data[index] = Item{ timestamp, value };
+		index = (index + 1) % capacity;
+		size = std::min(size + 1, capacity);
+	}
+
+	std::pair<const Item *, const Item *> FindAt(const Netcode::Timestamp & timestamp) const {
+		const Item * first = nullptr;
+		const Item * last = nullptr;
+
+		int32_t idx = index - 1;
+		for(int32_t i = 0; i < size; i++, idx--) {
+			if(idx < 0) {
+				idx += capacity;
+			}
+
+			const Item * bufferItem = data.get() + idx;
+
+			if(bufferItem->timestamp > timestamp) {
+				first = bufferItem;
+			}
+
+			if(bufferItem->timestamp <= timestamp) {
+				last = bufferItem;
+				if(first == nullptr) {
+					last = nullptr;
+				}
+				break;
+			}
+		}
+
+		return { first, last };
+	}
+};
+
+TEST(Network, TournamentTree) {
+	namespace nn = Netcode::Network;
+
+	std::mt19937 rng{ 42 };
+	nn::TournamentTree tree;
+
+	for(uint32_t numSources : { 0u, 1u, 2u, 3u, 7u, 16u, 33u }) {
+		std::vector<std::vector<uint32_t>> sources(numSources);
+		std::vector<uint32_t> cursors(numSources, 0);
+		std::vector<std::pair<uint32_t, uint32_t>> expected;
+
+		for(uint32_t s = 0; s < numSources; s++) {
+			uint32_t key = 0;
+			const uint32_t length = rng() % 20;
+			for(uint32_t i = 0; i < length; i++) {
+				// few distinct keys, so the fronts tie across the sources
+				key += rng() % 3;
+				sources[s].push_back(key);
+				expected.emplace_back(key, s);
+			}
+		}
+
+		// equal keys come in the order of the sources
+		std::stable_sort(std::begin(expected), std::end(expected));
+
+		const auto before = [&](uint32_t a, uint32_t b) -> bool {
+			return sources[a][cursors[a]] < sources[b][cursors[b]];
+		};
+
+		tree.Reset(numSources);
+		for(uint32_t s = 0; s < numSources; s++) {
+			if(!sources[s].empty()) {
+				tree.SetLeaf(s);
+			}
+		}
+		tree.Build(before);
+
+		std::vector<std::pair<uint32_t, uint32_t>> merged;
+
+		for(uint32_t s = tree.GetWinner(); s != nn::TournamentTree::NONE; s = tree.GetWinner()) {
+			merged.emplace_back(sources[s][cursors[s]], s);
+			cursors[s]++;
+			tree.Replay(s, cursors[s] < sources[s].size(), before);
+		}
+
+		EXPECT_EQ(merged, expected);
+	}
+}
+
+TEST(Network, HistoryBuffer) {
+	namespace nn = Netcode::Network;
+	using Netcode::Float3;
+	using Netcode::Float4;
+
+	const Float4 identity{ 0.0f, 0.0f, 0.0f, 1.0f };
+	const Netcode::Timestamp t0{};
+	std::mt19937 rng{ 41 };
+	std::uniform_int_distribution<int32_t> stepDist{ 0, 40 };
+	std::uniform_real_distribution<float> posDist{ -1000.0f, 1000.0f };
+	std::uniform_int_distribution<uint32_t> flagDist{ 0, 3 };
+
+	// against the reference: same brackets, same interpolated positions and both flags
+	for(uint32_t run = 0; run < 16; run++) {
+		nn::HistoryBuffer history{ std::chrono::hours(1), 2 };
+		ReferenceHistoryBuffer<std::pair<Float3, uint32_t>> reference{ 512 };
+		Netcode::Timestamp t = t0;
+
+		const uint32_t numSamples = 1 + run * 31;
+		for(uint32_t i = 0; i < numSamples; i++) {
+			// zero steps give samples with equal timestamps
+			t += std::chrono::milliseconds(stepDist(rng));
+			const Float3 p{ posDist(rng), posDist(rng), posDist(rng) };
+			const uint32_t f = flagDist(rng);
+			history.Insert(t, p, identity, f);
+			reference.Insert(t, { p, f });
+		}
+		ASSERT_EQ(history.GetSize(), numSamples);
+
+		std::uniform_int_distribution<int64_t> queryDist{ -50, std::chrono::duration_cast<std::chrono::milliseconds>(t - t0).count() + 50 };
+		for(uint32_t q = 0; q < 2000; q++) {
+			const Netcode::Timestamp query = t0 + std::chrono::microseconds(queryDist(rng) * 1000 + (q % 3) * 333);
+			const auto [newer, older] = reference.FindAt(query);
+
+			nn::HistorySample sample;
+			const bool found = history.Sample(query, sample);
+			ASSERT_EQ(found, newer != nullptr && older != nullptr);
+
+			if(!found) {
+				continue;
+			}
+
+			const float alpha = std::chrono::duration<float>(query - older->timestamp).count() /
+				std::chrono::duration<float>(newer->timestamp - older->timestamp).count();
+			const Float3 & p0 = older->value.first;
+			const Float3 & p1 = newer->value.first;
+			ASSERT_NEAR(sample.position.x, p0.x + (p1.x - p0.x) * alpha, 0.01f);
+			ASSERT_NEAR(sample.position.y, p0.y + (p1.y - p0.y) * alpha, 0.01f);
+			ASSERT_NEAR(sample.position.z, p0.z + (p1.z - p0.z) * alpha, 0.01f);
+			ASSERT_EQ(sample.flags, older->value.second & newer->value.second);
+		}
+	}
+
+	// the capacity is a duration: everything inside the window stays answerable, older samples are dropped
+	{
+		const Netcode::Duration window = std::chrono::milliseconds(500);
+		nn::HistoryBuffer history{ window, 4 };
+		Netcode::Timestamp t = t0;
+
+		for(uint32_t i = 0; i < 2000; i++) {
+			history.Insert(t, Float3{ 0.0f, 0.0f, 0.0f }, identity);
+
+			ASSERT_LE(history.GetSize(), 500u + 2u);
+			if(history.GetSize() > 2) {
+				ASSERT_GT(history.GetTimestamp(1), t - window);
+			}
+
+			if(t - t0 >= window) {
+				nn::HistorySample sample;
+				ASSERT_TRUE(history.Sample(t - window, sample));
+				ASSERT_TRUE(history.Sample(t - std::chrono::milliseconds(1), sample));
+			}
+
+			t += std::chrono::milliseconds(1 + stepDist(rng));
+		}
+
+		nn::HistorySample sample;
+		EXPECT_FALSE(history.Sample(history.GetTimestamp(history.GetSize() - 1), sample));
+		EXPECT_FALSE(history.Sample(history.GetTimestamp(0) - std::chrono::milliseconds(1), sample));
+
+		history.Clear();
+		EXPECT_EQ(history.GetSize(), 0u);
+		EXPECT_FALSE(history.Sample(t0, sample));
+	}
+
+	// rotations are interpolated on the sphere
+	{
+		nn::HistoryBuffer history{ std::chrono::seconds(1) };
+		const float s = std::sqrt(0.5f);
+		history.Insert(t0, Float3{ 0.0f, 0.0f, 0.0f }, identity);
+		history.Insert(t0 + std::chrono::milliseconds(100), Float3{ 10.0f, 0.0f, 0.0f }, Float4{ 0.0f, s, 0.0f, s });
+
+		nn::HistorySample sample;
+		ASSERT_TRUE(history.Sample(t0 + std::chrono::milliseconds(50), sample));
+		EXPECT_NEAR(sample.position.x, 5.0f, 1e-4f);
+		EXPECT_NEAR(sample.rotation.y, std::sin(3.14159265f / 8.0f), 1e-4f);
+		EXPECT_NEAR(sample.rotation.w, std::cos(3.14159265f / 8.0f), 1e-4f);
+	}
+}
+
+static float LagCompensationTestSegmentDistance(const Netcode::Float3 & p, const Netcode::Float3 & a, const Netcode::Float3 & b) {
+	const float abx = b.x - a.x, aby = b.y - a.y, abz = b.z - a.z;
+	const float apx = p.x - a.x, apy = p.y - a.y, apz = p.z - a.z;
+	const float abab = abx * abx + aby * aby + abz * abz;
+	const float t = (abab > 0.0f) ? std::clamp((apx * abx + apy * aby + apz * abz) / abab, 0.0f, 1.0f) : 0.0f;
+	const float dx = apx - abx * t, dy = apy - aby * t, dz = apz - abz * t;
+	return std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+TEST(Network, LagCompensation) {
+	namespace nn = Netcode::Network;
+	using Netcode::Float3;
+
+	const Netcode::Timestamp t0{};
+	const nn::HitboxShape shape{ 50.0f, 40.0f, 100.0f };
+
+	nn::LagCompensation lc{ std::chrono::seconds(1) };
+	lc.AddPlayer(1, shape);
+	lc.AddPlayer(2, shape);
+	lc.AddPlayer(3, shape);
+
+	for(int32_t i = 0; i < 4; i++) {
+		const Netcode::Timestamp t = t0 + std::chrono::milliseconds(100 * i);
+		lc.Record(1, t, Float3{ 1000.0f, 0.0f, 100.0f * i }, true);
+		lc.Record(2, t, Float3{ 0.0f, 0.0f, 0.0f }, true);
+		lc.Record(3, t, Float3{ -1000.0f, 0.0f, 0.0f }, i != 2);
+	}
+
+	// player 1 is interpolated to z = 50, player 3 was not hittable at 200ms
+	EXPECT_EQ(lc.Rewind(t0 + std::chrono::milliseconds(50)), 3u);
+	nn::HitboxHit hit = lc.Raycast(Float3{ 0.0f, 100.0f, 50.0f }, Float3{ 1.0f, 0.0f, 0.0f }, 10000.0f, 2);
+	EXPECT_EQ(hit.ownerId, 1);
+	EXPECT_NEAR(hit.distance, 950.0f, 0.1f);
+	EXPECT_EQ(lc.Raycast(Float3{ 0.0f, 100.0f, 150.0f }, Float3{ 1.0f, 0.0f, 0.0f }, 10000.0f, 2).ownerId, -1);
+	EXPECT_EQ(lc.Raycast(Float3{ 0.0f, 100.0f, 50.0f }, Float3{ 1.0f, 0.0f, 0.0f }, 900.0f, 2).ownerId, -1);
+
+	// the shooter's own hitbox is skipped, the rewound state is shared by the shots
+	EXPECT_EQ(lc.Raycast(Float3{ 0.0f, 100.0f, -500.0f }, Float3{ 0.0f, 0.0f, 1.0f }, 10000.0f, 1).ownerId, 2);
+	EXPECT_EQ(lc.Raycast(Float3{ 0.0f, 100.0f, -500.0f }, Float3{ 0.0f, 0.0f, 1.0f }, 10000.0f, 2).ownerId, -1);
+
+	EXPECT_EQ(lc.Rewind(t0 + std::chrono::milliseconds(250)), 2u);
+	EXPECT_EQ(lc.Raycast(Float3{ 0.0f, 100.0f, 0.0f }, Float3{ -1.0f, 0.0f, 0.0f }, 10000.0f, 2).ownerId, -1);
+
+	// outside of the history
+	EXPECT_EQ(lc.Rewind(t0 + std::chrono::milliseconds(300)), 0u);
+	EXPECT_EQ(lc.Rewind(t0 - std::chrono::milliseconds(1)), 0u);
+
+	// from above the top sphere is hit, from inside nothing
+	lc.Rewind(t0 + std::chrono::milliseconds(150));
+	hit = lc.Raycast(Float3{ 0.0f, 1000.0f, 0.0f }, Float3{ 0.0f, -1.0f, 0.0f }, 10000.0f);
+	EXPECT_EQ(hit.ownerId, 2);
+	EXPECT_NEAR(hit.distance, 1000.0f - (100.0f + 40.0f + 50.0f), 0.1f);
+	lc.Rewind(t0 + std::chrono::milliseconds(50));
+	hit = lc.Raycast(Float3{ 0.0f, 100.0f, 0.0f }, Float3{ -1.0f, 0.0f, 0.0f }, 10000.0f);
+	EXPECT_EQ(hit.ownerId, 3);
+	EXPECT_NEAR(hit.distance, 950.0f, 0.1f);
+
+	lc.RemovePlayer(2);
+	EXPECT_EQ(lc.Rewind(t0 + std::chrono::milliseconds(50)), 2u);
+
+	// random scenes against sampling the ray: nothing closer than the hit, the hit is on the surface
+	std::mt19937 rng{ 40 };
+	std::uniform_real_distribution<float> posDist{ -2000.0f, 2000.0f };
+	std::uniform_real_distribution<float> radiusDist{ 20.0f, 80.0f };
+	std::normal_distribution<float> dirDist{ 0.0f, 1.0f };
+
+	for(uint32_t scene = 0; scene < 12; scene++) {
+		const uint32_t numPlayers = 1 + scene * 3;
+		nn::LagCompensation rlc{ std::chrono::seconds(1) };
+		std::vector<nn::HitboxShape> shapes;
+		std::vector<Float3> feet;
+
+		for(uint32_t i = 0; i < numPlayers; i++) {
+			shapes.emplace_back(radiusDist(rng), radiusDist(rng), 0.0f);
+			shapes.back().centerHeight = shapes.back().radius + shapes.back().halfHeight;
+			feet.emplace_back(posDist(rng), posDist(rng) * 0.1f, posDist(rng));
+			rlc.AddPlayer(static_cast<int32_t>(i), shapes.back());
+			rlc.Record(static_cast<int32_t>(i), t0, feet.back(), true);
+			rlc.Record(static_cast<int32_t>(i), t0 + std::chrono::milliseconds(100), feet.back(), true);
+		}
+
+		ASSERT_EQ(rlc.Rewind(t0 + std::chrono::milliseconds(50)), numPlayers);
+
+		const auto minDistance = [&](const Float3 & p, uint32_t & closest) -> float {
+			float best = std::numeric_limits<float>::max();
+			for(uint32_t i = 0; i < numPlayers; i++) {
+				const float c = feet[i].y + shapes[i].centerHeight;
+				const float d = LagCompensationTestSegmentDistance(p,
+					Float3{ feet[i].x, c - shapes[i].halfHeight, feet[i].z },
+					Float3{ feet[i].x, c + shapes[i].halfHeight, feet[i].z }) - shapes[i].radius;
+				if(d < best) {
+					best = d;
+					closest = i;
+				}
+			}
+			return best;
+		};
+
+		for(uint32_t ray = 0; ray < 64; ray++) {
+			Float3 origin{ posDist(rng), posDist(rng) * 0.1f, posDist(rng) };
+			uint32_t closest;
+			if(minDistance(origin, closest) <= 1.0f) {
+				continue;
+			}
+
+			Float3 dir{ dirDist(rng), dirDist(rng), dirDist(rng) };
+			const float len = std::sqrt(dir.x * dir.x + dir.y * dir.y + dir.z * dir.z);
+			dir = Float3{ dir.x / len, dir.y / len, dir.z / len };
+
+			const float maxDistance = 3000.0f;
+			const nn::HitboxHit h = rlc.Raycast(origin, dir, maxDistance);
+			const float end = (h.ownerId >= 0) ? h.distance : maxDistance;
+
+			for(float t = 0.0f; t < end - 1.0f; t += 4.0f) {
+				ASSERT_GT(minDistance(Float3{ origin.x + dir.x * t, origin.y + dir.y * t, origin.z + dir.z * t }, closest), -0.05f);
+			}
+
+			if(h.ownerId >= 0) {
+				const Float3 p{ origin.x + dir.x * h.distance, origin.y + dir.y * h.distance, origin.z + dir.z * h.distance };
+				ASSERT_NEAR(minDistance(p, closest), 0.0f, 0.05f);
+				ASSERT_EQ(static_cast<int32_t>(closest), h.ownerId);
+			}
+		}
+	}
+
+	// a 64 player server validating a shot of every player on every tick at 60 Hz
+	nn::LagCompensation plc{ std::chrono::seconds(2) };
+	for(int32_t i = 0; i < 64; i++) {
+		plc.AddPlayer(i, shape);
+		for(int32_t s = 0; s < 64; s++) {
+			plc.Record(i, t0 + std::chrono::milliseconds(16 * s), Float3{ posDist(rng), 0.0f, posDist(rng) }, true);
+		}
+	}
+
+	constexpr uint32_t numShots = 1 << 14;
+	uint32_t numHits = 0;
+	Netcode::Stopwatch sw;
+	sw.Start();
+	for(uint32_t i = 0; i < numShots; i++) {
+		plc.Rewind(t0 + std::chrono::milliseconds(8 + (i % 1000)));
+		const float angle = static_cast<float>(i) * 0.01f;
+		numHits += (plc.Raycast(Float3{ 0.0f, 100.0f, 0.0f }, Float3{ std::cos(angle), 0.0f, std::sin(angle) }, 10000.0f, static_cast<int32_t>(i % 64)).ownerId >= 0) ? 1 : 0;
+	}
+	sw.Stop();
+
+	const double shotsPerSecond = numShots / std::chrono::duration<double>(sw.GetElapsedDuration()).count();
+	RecordProperty("shotsPerSecond", static_cast<int>(shotsPerSecond));
+	EXPECT_GT(numHits, 0u);
+#if defined(NDEBUG)
+	EXPECT_GT(shotsPerSecond, 64.0 * 60.0);
+#endif
+}
+
+TEST(MatchHost, RouteConnection) {
+	constexpr uint32_t maxPlayers = 2;
+
+	EXPECT_EQ(SelectMatch({ 3, 1, 2 }, 8), 1u);
+	// the first one on a tie
+	EXPECT_EQ(SelectMatch({ 2, 1, 1 }, 8), 1u);
+	EXPECT_EQ(SelectMatch({ 2, 1 }, maxPlayers), 1u);
+	// every match is full
+	EXPECT_EQ(SelectMatch({ 2, 2 }, maxPlayers), 2u);
+	EXPECT_EQ(SelectMatch({}, maxPlayers), 0u);
+
+	// the joining players are spread over the matches until they are full
+	std::vector<uint32_t> playerCounts(3, 0);
+	std::vector<uint32_t> routed;
+
+	for(uint32_t i = 0; i < 7; i++) {
+		const uint32_t selected = SelectMatch(playerCounts, maxPlayers);
+		routed.push_back(selected);
+
+		if(selected < playerCounts.size()) {
+			playerCounts[selected]++;
+		}
+	}
+
+	EXPECT_EQ(routed, (std::vector<uint32_t>{ 0, 1, 2, 0, 1, 2, 3 }));
+}
+
+TEST(MatchHost, TickSchedule) {
+	using std::chrono::milliseconds;
+
+	const Netcode::Timestamp t0 = Netcode::Timestamp{} + std::chrono::seconds(10);
+	const Netcode::Duration tickInterval = milliseconds(20);
+
+	MatchSchedule schedule;
+	schedule.Start(4, tickInterval, std::chrono::seconds(1), t0);
+
+	// the first ticks are staggered over the interval
+	for(uint32_t i = 0; i < 4; i++) {
+		EXPECT_EQ(schedule.GetNextTickAt(i), t0 + milliseconds(5 * i));
+	}
+
+	EXPECT_EQ(schedule.CollectDue(t0), (std::vector<uint32_t>{ 0 }));
+	EXPECT_EQ(schedule.GetNextTickAt(0), t0 + milliseconds(20));
+	EXPECT_EQ(schedule.CollectDue(t0 + milliseconds(12)), (std::vector<uint32_t>{ 1, 2 }));
+	EXPECT_EQ(schedule.CollectDue(t0 + milliseconds(14)), (std::vector<uint32_t>{}));
+	EXPECT_EQ(schedule.CollectDue(t0 + milliseconds(15)), (std::vector<uint32_t>{ 3 }));
+	EXPECT_EQ(schedule.CollectDue(t0 + milliseconds(20)), (std::vector<uint32_t>{ 0 }));
+
+	// the matches fell behind by several ticks, the missed ones are skipped instead of ticked in a burst
+	EXPECT_EQ(schedule.CollectDue(t0 + milliseconds(100)), (std::vector<uint32_t>{ 0, 1, 2, 3 }));
+
+	for(uint32_t i = 0; i < 4; i++) {
+		EXPECT_EQ(schedule.GetNextTickAt(i), t0 + milliseconds(120));
+	}
+
+	EXPECT_EQ(schedule.CollectDue(t0 + milliseconds(119)), (std::vector<uint32_t>{}));
+	EXPECT_EQ(schedule.CollectDue(t0 + milliseconds(120)), (std::vector<uint32_t>{ 0, 1, 2, 3 }));
+
+	// late by less than a tick: the match keeps its cadence
+	EXPECT_EQ(schedule.CollectDue(t0 + milliseconds(150)), (std::vector<uint32_t>{ 0, 1, 2, 3 }));
+	EXPECT_EQ(schedule.GetNextTickAt(0), t0 + milliseconds(160));
+}
+
+TEST(MatchHost, CpuAccounting) {
+	using std::chrono::milliseconds;
+	using std::chrono::microseconds;
+
+	const Netcode::Timestamp t0 = Netcode::Timestamp{} + std::chrono::seconds(10);
+
+	MatchSchedule schedule;
+	schedule.Start(4, milliseconds(20), std::chrono::seconds(1), t0);
+
+	schedule.AccountTick(0, milliseconds(3));
+	schedule.AccountTick(0, milliseconds(5));
+	schedule.AccountTick(1, milliseconds(2));
+
+	EXPECT_EQ(schedule.GetLoad(0).cpuTime, milliseconds(8));
+	EXPECT_EQ(schedule.GetLoad(0).maxTickCpuTime, milliseconds(5));
+	EXPECT_EQ(schedule.GetLoad(0).numTicks, 2u);
+	EXPECT_EQ(schedule.GetLoad(1).cpuTime, milliseconds(2));
+	EXPECT_EQ(schedule.GetLoad(1).numTicks, 1u);
+	EXPECT_EQ(schedule.GetLoad(2).numTicks, 0u);
+
+	EXPECT_FALSE(schedule.IsReportDue(t0 + milliseconds(999)));
+	EXPECT_TRUE(schedule.IsReportDue(t0 + milliseconds(1000)));
+
+	schedule.ResetLoads(t0 + milliseconds(1000));
+
+	EXPECT_EQ(schedule.GetReportedAt(), t0 + milliseconds(1000));
+	EXPECT_FALSE(schedule.IsReportDue(t0 + milliseconds(1500)));
+
+	for(uint32_t i = 0; i < 4; i++) {
+		EXPECT_EQ(schedule.GetLoad(i).cpuTime, Netcode::Duration{});
+		EXPECT_EQ(schedule.GetLoad(i).maxTickCpuTime, Netcode::Duration{});
+		EXPECT_EQ(schedule.GetLoad(i).numTicks, 0u);
+	}
+
+	// the due matches are accounted from their own jobs
+	Netcode::JobSystem jobs{ 4 };
+
+	for(uint32_t tick = 0; tick < 100; tick++) {
+		jobs.ParallelFor(0, 4, 1, [&](uint32_t first, uint32_t last) -> void {
+			for(uint32_t i = first; i < last; i++) {
+				schedule.AccountTick(i, microseconds(i + 1));
+			}
+		});
+	}
+
+	for(uint32_t i = 0; i < 4; i++) {
+		EXPECT_EQ(schedule.GetLoad(i).cpuTime, microseconds(100 * (i + 1)));
+		EXPECT_EQ(schedule.GetLoad(i).maxTickCpuTime, microseconds(i + 1));
+		EXPECT_EQ(schedule.GetLoad(i).numTicks, 100u);
+	}
+}
+
+TEST(SystemTest, PhysicsStepScene) {
+	Netcode::Physics::PhysX px;
+	px.CreateResources();
+
+	// scenes sharing a PhysX instance, like the matches of a host, are stepped independently
+	constexpr uint32_t numMatches = 2;
+	const Netcode::Duration tickInterval = std::chrono::milliseconds(20);
+	const float dt = std::chrono::duration<float>(tickInterval).count();
+	const float gravity = 981.0f;
+
+	Netcode::PxPtr<physx::PxScene> scenes[numMatches];
+	Netcode::PxPtr<physx::PxRigidDynamic> bodies[numMatches];
+
+	for(uint32_t i = 0; i < numMatches; i++) {
+		physx::PxSceneDesc sceneDesc{ px.physics->getTolerancesScale() };
+		sceneDesc.gravity = physx::PxVec3{ 0.0f, -gravity, 0.0f };
+		sceneDesc.cpuDispatcher = px.dispatcher.Get();
+		sceneDesc.filterShader = physx::PxDefaultSimulationFilterShader;
+		scenes[i] = px.physics->createScene(sceneDesc);
+
+		bodies[i] = physx::PxCreateDynamic(*px.physics, physx::PxTransform{ physx::PxVec3{ 0.0f, 1000.0f, 0.0f } }, physx::PxSphereGeometry{ 10.0f }, *px.defaultMaterial, 1.0f);
+		bodies[i]->setLinearDamping(0.0f);
+		scenes[i]->addActor(*bodies[i]);
+	}
+
+	// the velocity is integrated before the position: n steps drop g * dt^2 * n * (n + 1) / 2
+	const auto expectedHeight = [&](uint32_t numSteps) -> float {
+		return 1000.0f - gravity * dt * dt * static_cast<float>(numSteps * (numSteps + 1)) / 2.0f;
+	};
+
+	// the first match is due on every tick of the host, the second on every other, the due ones tick in parallel
+	Netcode::JobSystem jobs{ 2 };
+	uint32_t numTicks[numMatches] = {};
+	std::vector<uint32_t> dueMatches;
+
+	for(uint32_t tick = 0; tick < 20; tick++) {
+		dueMatches.clear();
+		dueMatches.push_back(0);
+
+		if(tick % 2 == 0) {
+			dueMatches.push_back(1);
+		}
+
+		jobs.ParallelFor(0, static_cast<uint32_t>(dueMatches.size()), 1, [&](uint32_t first, uint32_t last) -> void {
+			for(uint32_t i = first; i < last; i++) {
+				Netcode::Physics::StepScene(scenes[dueMatches[i]].Get(), tickInterval);
+				numTicks[dueMatches[i]]++;
+			}
+		});
+	}
+
+	ASSERT_EQ(numTicks[0], 20u);
+	ASSERT_EQ(numTicks[1], 10u);
+	EXPECT_NEAR(bodies[0]->getGlobalPose().p.y, expectedHeight(20), 0.5f);
+	EXPECT_NEAR(bodies[1]->getGlobalPose().p.y, expectedHeight(10), 0.5f);
+
+	// a match that is not due stands still
+	const float heightOfSecond = bodies[1]->getGlobalPose().p.y;
+
+	for(uint32_t tick = 0; tick < 5; tick++) {
+		Netcode::Physics::StepScene(scenes[0].Get(), tickInterval);
+	}
+
+	EXPECT_NEAR(bodies[0]->getGlobalPose().p.y, expectedHeight(25), 0.5f);
+	EXPECT_EQ(bodies[1]->getGlobalPose().p.y, heightOfSecond);
+
+	for(uint32_t i = 0; i < numMatches; i++) {
+		bodies[i].Reset();
+		scenes[i].Reset();
+	}
+}
+
+TEST(SystemTest, JobSystem) {
+	Netcode::JobSystem jobs{ 4 };
+	EXPECT_EQ(jobs.GetNumThreads(), 4u);
+
+	// every index is visited exactly once, range after range
+	std::vector<std::atomic<uint32_t>> runs(1000);
+	for(uint32_t stage = 0; stage < 64; stage++) {
+		const uint32_t count = (stage * 37) % 1000;
+		jobs.ParallelFor(0, count, 1 + stage % 8, [&runs](uint32_t first, uint32_t last) -> void {
+			for(uint32_t i = first; i < last; i++) {
+				runs[i].fetch_add(1);
+			}
+		});
+
+		for(uint32_t i = 0; i < 1000; i++) {
+			ASSERT_EQ(runs[i].exchange(0), (i < count) ? 1u : 0u);
+		}
+	}
+
+	// fork/join, the root waits for its children and grandchildren
+	std::atomic<uint32_t> numRun{ 0 };
+	Netcode::JobHandle root = jobs.Create([&numRun]() -> void { numRun++; });
+	for(uint32_t i = 0; i < 64; i++) {
+		jobs.Run(jobs.CreateChild(root, [&jobs, &numRun, root]() -> void {
+			for(uint32_t j = 0; j < 8; j++) {
+				jobs.Run(jobs.CreateChild(root, [&numRun]() -> void { numRun++; }));
+			}
+			numRun++;
+		}));
+	}
+	jobs.Run(root);
+	jobs.Wait(root);
+	EXPECT_TRUE(jobs.IsFinished(root));
+	EXPECT_EQ(numRun.load(), 1u + 64u + 64u * 8u);
+
+	// dependencies: a -> (b, c) -> d, a dependency waits for the children of its job too
+	std::atomic<uint32_t> sequence{ 0 };
+	uint32_t order[5] = {};
+	Netcode::JobHandle a = jobs.Create([&]() -> void { order[0] = sequence++; });
+	Netcode::JobHandle aChild = jobs.CreateChild(a, [&]() -> void {
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		order[1] = sequence++;
+	});
+	Netcode::JobHandle b = jobs.Create([&]() -> void { order[2] = sequence++; });
+	Netcode::JobHandle c = jobs.Create([&]() -> void { order[3] = sequence++; });
+	Netcode::JobHandle d = jobs.Create([&]() -> void { order[4] = sequence++; });
+	jobs.AddDependency(b, a);
+	jobs.AddDependency(c, a);
+	jobs.AddDependency(d, b);
+	jobs.AddDependency(d, c);
+	jobs.Run(d);
+	jobs.Run(c);
+	jobs.Run(b);
+	jobs.Run(aChild);
+	jobs.Run(a);
+	jobs.Wait(d);
+	EXPECT_LT(order[0], order[2]);
+	EXPECT_LT(order[1], order[2]);
+	EXPECT_LT(order[1], order[3]);
+	EXPECT_LT(order[2], order[4]);
+	EXPECT_LT(order[3], order[4]);
+
+	// main thread affinity jobs created on the workers and on a foreign thread
+	const std::thread::id mainId = std::this_thread::get_id();
+	std::vector<std::thread::id> mainThreadIds(16);
+	jobs.ParallelFor(0, 16, 1, [&](uint32_t first, uint32_t last) -> void {
+		for(uint32_t i = first; i < last; i++) {
+			jobs.Run(jobs.CreateMainThread([&mainThreadIds, i]() -> void { mainThreadIds[i] = std::this_thread::get_id(); }));
+		}
+	});
+
+	Netcode::JobHandle foreignJob = nullptr;
+	std::thread foreign{ [&]() -> void {
+		foreignJob = jobs.Create([&numRun]() -> void { numRun++; });
+		jobs.Run(foreignJob);
+		jobs.Wait(foreignJob);
+	} };
+	foreign.join();
+	EXPECT_TRUE(jobs.IsFinished(foreignJob));
+
+	jobs.RunMainThreadJobs();
+	for(const std::thread::id & id : mainThreadIds) {
+		EXPECT_EQ(id, mainId);
+	}
+
+	// a main thread job is also run while the main thread waits
+	bool ranOnMain = false;
+	Netcode::JobHandle mainJob = jobs.CreateMainThread([&]() -> void { ranOnMain = (std::this_thread::get_id() == mainId); });
+	Netcode::JobHandle afterMain = jobs.Create([]() -> void { });
+	jobs.AddDependency(afterMain, mainJob);
+	jobs.Run(afterMain);
+	jobs.Run(mainJob);
+	jobs.Wait(afterMain);
+	EXPECT_TRUE(ranOnMain);
+
+	// recycles the pools many times over
+	for(uint32_t i = 0; i < 4 * Netcode::JobSystem::JOB_POOL_SIZE; i++) {
+		Netcode::JobHandle job = jobs.Create([&numRun]() -> void { numRun++; });
+		jobs.Run(job);
+		jobs.Wait(job);
+	}
+}
+
+TEST(SystemTest, JobSystemScaling) {
+	constexpr uint32_t numItems = 1 << 16;
+	std::vector<uint64_t> results(numItems);
+
+	const auto work = [&results](uint32_t first, uint32_t last) -> void {
+		for(uint32_t i = first; i < last; i++) {
+			uint64_t x = i + 1;
+			for(uint32_t j = 0; j < 256; j++) {
+				x = x * 6364136223846793005ull + 1442695040888963407ull;
+			}
+			results[i] = x;
+		}
+	};
+
+	const uint32_t maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	double singleThreaded = 0.0;
+	double bestSpeedup = 1.0;
+
+	for(uint32_t numThreads = 1; numThreads <= std::min(maxThreads, 16u); numThreads *= 2) {
+		Netcode::JobSystem jobs{ numThreads };
+
+		// warm up, the workers start asleep
+		jobs.ParallelFor(0, numItems, 256, work);
+
+		Netcode::Stopwatch sw;
+		sw.Start();
+		for(uint32_t i = 0; i < 8; i++) {
+			jobs.ParallelFor(0, numItems, 256, work);
+		}
+		sw.Stop();
+
+		const double itemsPerSecond = 8.0 * numItems / std::max(std::chrono::duration<double>(sw.GetElapsedDuration()).count(), 1e-9);
+
+		if(numThreads == 1) {
+			singleThreaded = itemsPerSecond;
+		} else {
+			bestSpeedup = std::max(bestSpeedup, itemsPerSecond / singleThreaded);
+		}
+
+		RecordProperty("itemsPerSecond" + std::to_string(numThreads), static_cast<int>(itemsPerSecond));
+	}
+
+	RecordProperty("bestSpeedupPercent", static_cast<int>(bestSpeedup * 100.0));
+
+#if defined(NDEBUG)
+	if(maxThreads >= 4) {
+		EXPECT_GT(bestSpeedup, 1.5);
+	}
+#endif
+}
+
+#if !defined(NETCODE_NO_PROFILER)
+TEST(SystemTest, Profiler) {
+	Netcode::ProfileCapture capture;
+
+	// disabled scopes record nothing
+	{
+		NETCODE_PROFILE_SCOPE("Disabled");
+	}
+	Netcode::Profiler::Collect(capture);
+	EXPECT_TRUE(capture.events.empty());
+
+	Netcode::Profiler::SetEnabled(true);
+
+	{
+		NETCODE_PROFILE_THREAD("Test main");
+		NETCODE_PROFILE_FRAME("Frame");
+		NETCODE_PROFILE_SCOPE("Outer");
+		{
+			NETCODE_PROFILE_SCOPE("Inner");
+			NETCODE_PROFILE_COUNTER("Count", 42);
+		}
+	}
+
+	std::thread worker{ []() -> void {
+		NETCODE_PROFILE_THREAD("Test worker");
+		NETCODE_PROFILE_SCOPE("Inner");
+	} };
+	worker.join();
+
+	Netcode::Profiler::SetEnabled(false);
+	Netcode::Profiler::Collect(capture);
+
+	ASSERT_EQ(capture.events.size(), 8);
+	EXPECT_EQ(capture.numDropped, 0);
+	// the names are deduplicated across the threads
+	EXPECT_EQ(capture.names.size(), 4);
+
+	const auto nameOf = [&capture](const Netcode::ProfileCapture::Event & e) -> const std::string & {
+		return capture.names[e.nameIndex];
+	};
+
+	const uint32_t mainThread = capture.events[0].threadIndex;
+	EXPECT_EQ(capture.threads[mainThread].name, "Test main");
+
+	const Netcode::ProfileEventType expectedTypes[] = {
+		Netcode::ProfileEventType::FRAME, Netcode::ProfileEventType::BEGIN, Netcode::ProfileEventType::BEGIN,
+		Netcode::ProfileEventType::COUNTER, Netcode::ProfileEventType::END, Netcode::ProfileEventType::END
+	};
+	const char * expectedNames[] = { "Frame", "Outer", "Inner", "Count", "Inner", "Outer" };
+
+	for(uint32_t i = 0; i < 6; i++) {
+		EXPECT_EQ(capture.events[i].type, expectedTypes[i]);
+		EXPECT_EQ(capture.events[i].threadIndex, mainThread);
+		EXPECT_EQ(nameOf(capture.events[i]), expectedNames[i]);
+
+		if(i > 0) {
+			EXPECT_LE(capture.events[i - 1].timestamp, capture.events[i].timestamp);
+		}
+	}
+	EXPECT_EQ(capture.events[3].value, 42);
+
+	EXPECT_NE(capture.events[6].threadIndex, mainThread);
+	EXPECT_EQ(capture.threads[capture.events[6].threadIndex].name, "Test worker");
+	EXPECT_EQ(nameOf(capture.events[6]), "Inner");
+	EXPECT_EQ(capture.events[7].type, Netcode::ProfileEventType::END);
+
+	const std::string trace = capture.ToChromeTrace();
+	EXPECT_EQ(trace.find("{\"traceEvents\":["), 0);
+	EXPECT_NE(trace.find(R"("ph":"B")"), std::string::npos);
+	EXPECT_NE(trace.find(R"("ph":"C","args":{"value":42})"), std::string::npos);
+	EXPECT_NE(trace.find(R"("args":{"name":"Test worker"})"), std::string::npos);
+
+	const std::vector<uint8_t> binary = capture.ToBinary();
+
+	Netcode::ProfileCapture read;
+	ASSERT_TRUE(read.FromBinary(Netcode::ArrayView<uint8_t>{ binary.data(), binary.size() }));
+	ASSERT_EQ(read.events.size(), capture.events.size());
+	EXPECT_EQ(read.names, capture.names);
+	ASSERT_EQ(read.threads.size(), capture.threads.size());
+
+	for(size_t i = 0; i < capture.events.size(); i++) {
+		EXPECT_EQ(read.events[i].type, capture.events[i].type);
+		EXPECT_EQ(read.events[i].threadIndex, capture.events[i].threadIndex);
+		EXPECT_EQ(read.events[i].nameIndex, capture.events[i].nameIndex);
+		EXPECT_EQ(read.events[i].timestamp, capture.events[i].timestamp);
+		EXPECT_EQ(read.events[i].value, capture.events[i].value);
+	}
+
+	// a truncated capture is rejected and leaves the target unchanged
+	Netcode::ProfileCapture truncated;
+	EXPECT_FALSE(truncated.FromBinary(Netcode::ArrayView<uint8_t>{ binary.data(), binary.size() - 1 }));
+	EXPECT_TRUE(truncated.events.empty());
+	EXPECT_TRUE(truncated.names.empty());
+
+	// a full buffer drops whole scopes, every admitted BEGIN keeps the slot of its END
+	{
+		using Netcode::ProfileEventType;
+
+		Netcode::ProfileThreadBuffer buffer{ 1 };
+		const uint32_t capacity = Netcode::ProfileThreadBuffer::CAPACITY;
+
+		const auto push = [&buffer](ProfileEventType type) -> bool {
+			return buffer.Push(Netcode::ProfileEvent{ "Scope", 0, 0, type });
+		};
+
+		// nested scopes are opened until only their ENDs fit
+		uint32_t numOpen = 0;
+		while(push(ProfileEventType::BEGIN)) {
+			numOpen++;
+		}
+
+		EXPECT_EQ(numOpen, capacity / 2);
+		EXPECT_FALSE(push(ProfileEventType::COUNTER));
+		EXPECT_FALSE(push(ProfileEventType::FRAME));
+
+		// a scope nested in the dropped one is dropped with it, even after the buffer was drained
+		uint64_t numDrained = 0;
+		int64_t depth = 0;
+		bool isBalanced = true;
+
+		const auto drain = [&]() -> void {
+			buffer.Drain([&](const Netcode::ProfileEvent & e) -> void {
+				depth += (e.type == ProfileEventType::BEGIN) ? 1 : ((e.type == ProfileEventType::END) ? -1 : 0);
+				isBalanced = isBalanced && depth >= 0;
+				numDrained++;
+			});
+		};
+
+		drain();
+		EXPECT_FALSE(push(ProfileEventType::BEGIN));
+		EXPECT_FALSE(push(ProfileEventType::END));
+		// closes the dropped scope, the admitted ones still have their slots
+		EXPECT_FALSE(push(ProfileEventType::END));
+
+		EXPECT_TRUE(push(ProfileEventType::COUNTER));
+
+		for(uint32_t i = 0; i < numOpen; i++) {
+			ASSERT_TRUE(push(ProfileEventType::END));
+		}
+
+		EXPECT_EQ(buffer.GetNumDropped(), 6u);
+
+		drain();
+		EXPECT_TRUE(isBalanced);
+		EXPECT_EQ(depth, 0);
+		EXPECT_EQ(numDrained, 2ull * numOpen + 1);
+
+		EXPECT_TRUE(push(ProfileEventType::BEGIN));
+		EXPECT_TRUE(push(ProfileEventType::END));
+	}
+}
+#endif
+
+TEST(SystemTest, AsyncLog) {
+	const std::wstring path = L"async_log_test.nlog";
+	ASSERT_TRUE(Log::AsyncLog::SetBinaryOutput(path));
+
+	enum class Color : uint8_t { RED = 3 };
+	const std::string name = "player";
+
+	NETCODE_LOG_INFO(0, "int {0} uint {1} double {2:.2f} bool {3} string {4} enum {5} {{literal}}", -42, 7u, 1.5, true, name, Color::RED);
+
+	std::thread worker{ []() -> void {
+		for(uint32_t i = 0; i < 100; i++) {
+			NETCODE_LOG_INFO(10, "limited {}", i);
+		}
+	} };
+	worker.join();
+
+	Log::AsyncLog::Flush();
+	ASSERT_TRUE(Log::AsyncLog::SetBinaryOutput(std::wstring{}));
+
+	std::vector<uint8_t> binary;
+	{
+		std::ifstream ifs{ "async_log_test.nlog", std::ios::binary };
+		binary.assign(std::istreambuf_iterator<char>{ ifs }, std::istreambuf_iterator<char>{});
+	}
+	std::remove("async_log_test.nlog");
+
+	std::vector<Log::DecodedLogRecord> decoded;
+	ASSERT_TRUE(Log::DecodeBinaryLog(Netcode::ArrayView<uint8_t>{ binary.data(), binary.size() }, [&decoded](const Log::DecodedLogRecord & r) -> void {
+		decoded.push_back(r);
+	}));
+
+	// the rate limit of the second site admits 10 records in a second, the loop may cross into a second window
+	ASSERT_GE(decoded.size(), 11);
+	ASSERT_LE(decoded.size(), 21);
+
+	const auto first = std::find_if(std::begin(decoded), std::end(decoded), [](const Log::DecodedLogRecord & r) -> bool {
+		return r.message.find("int") == 0;
+	});
+	ASSERT_NE(first, std::end(decoded));
+	EXPECT_EQ(first->message, "int -42 uint 7 double 1.50 bool true string player enum 3 {literal}");
+	EXPECT_EQ(first->level, Log::LogLevel::INFO);
+
+	// the first record of a window reports the records suppressed since the previous one
+	uint32_t expectedIndex = 0;
+	for(const Log::DecodedLogRecord & r : decoded) {
+		if(&r == &*first) {
+			continue;
+		}
+
+		const std::string expectedMessage = "limited " + std::to_string(expectedIndex + r.numSuppressed);
+		EXPECT_EQ(r.message, expectedMessage);
+		EXPECT_NE(r.threadIndex, first->threadIndex);
+		expectedIndex += r.numSuppressed + 1;
+	}
+
+	// a truncated log is read up to its last whole record
+	std::vector<Log::DecodedLogRecord> truncated;
+	ASSERT_TRUE(Log::DecodeBinaryLog(Netcode::ArrayView<uint8_t>{ binary.data(), binary.size() - 1 }, [&truncated](const Log::DecodedLogRecord & r) -> void {
+		truncated.push_back(r);
+	}));
+	EXPECT_EQ(truncated.size(), decoded.size() - 1);
+
+	const uint8_t garbage[] = { 'N', 'P', 'R', 'F', 1 };
+	EXPECT_FALSE(Log::DecodeBinaryLog(Netcode::ArrayView<uint8_t>{ garbage, sizeof(garbage) }, [](const Log::DecodedLogRecord &) -> void { }));
+
+	// the rate limit on an injected clock, the windows are the whole seconds
+	{
+		constexpr int64_t second = 1000000000;
+		Log::CallSite site{ Log::LogLevel::INFO, 3, __FILE__, __LINE__ };
+		uint32_t numSuppressed = 0;
+		uint32_t numAdmitted = 0;
+
+		for(uint32_t i = 0; i < 10; i++) {
+			numAdmitted += Log::AsyncLog::Admit(site, 5 * second + i * 1000, numSuppressed) ? 1 : 0;
+			EXPECT_EQ(numSuppressed, 0u);
+		}
+		EXPECT_EQ(numAdmitted, 3u);
+
+		// the first record of the next window takes the suppressed count
+		EXPECT_TRUE(Log::AsyncLog::Admit(site, 6 * second + 10, numSuppressed));
+		EXPECT_EQ(numSuppressed, 7u);
+		EXPECT_TRUE(Log::AsyncLog::Admit(site, 6 * second + 20, numSuppressed));
+		EXPECT_EQ(numSuppressed, 0u);
+
+		// a timestamp read before the window started counts into it
+		EXPECT_TRUE(Log::AsyncLog::Admit(site, 5 * second + 999, numSuppressed));
+		EXPECT_FALSE(Log::AsyncLog::Admit(site, 6 * second + 30, numSuppressed));
+
+		// a window without suppressed records reports none, skipped windows carry the count over
+		EXPECT_TRUE(Log::AsyncLog::Admit(site, 9 * second, numSuppressed));
+		EXPECT_EQ(numSuppressed, 1u);
+		EXPECT_TRUE(Log::AsyncLog::Admit(site, 10 * second, numSuppressed));
+		EXPECT_EQ(numSuppressed, 0u);
+	}
+
+	// concurrent records of one window: exactly the limit is admitted, every other record is counted as suppressed
+	{
+		constexpr int64_t now = 7000000000;
+		Log::CallSite site{ Log::LogLevel::INFO, 1000, __FILE__, __LINE__ };
+		std::atomic<uint32_t> numAdmitted{ 0 };
+		std::atomic<uint32_t> numReported{ 0 };
+
+		std::vector<std::thread> threads;
+		for(uint32_t t = 0; t < 4; t++) {
+			threads.emplace_back([&]() -> void {
+				for(uint32_t i = 0; i < 10000; i++) {
+					uint32_t numSuppressed = 0;
+					numAdmitted += Log::AsyncLog::Admit(site, now, numSuppressed) ? 1 : 0;
+					numReported += numSuppressed;
+				}
+			});
+		}
+
+		for(std::thread & t : threads) {
+			t.join();
+		}
+
+		EXPECT_EQ(numAdmitted.load(), 1000u);
+		EXPECT_EQ(numReported.load(), 0u);
+		EXPECT_EQ(site.numSuppressed.load(), 40000u - 1000u);
+	}
+}
+
 int wmain(int argc, wchar_t * argv[]) {
 	std::wstring workingDirectory = Netcode::IO::Path::CurrentWorkingDirectory();
 	Netcode::IO::Path::SetWorkingDirectiory(workingDirectory);